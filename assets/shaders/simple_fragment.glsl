@@ -37,13 +37,22 @@
 
 layout(location=0) smooth in vec4  iColor;
 layout(location=1) flat in vec2  iUV;
+#ifdef USE_BINDLESS_TEXTURES
+layout(location=2) flat in uvec2 iTexture;  // picked from the material table by the vertex shader
+layout(location=3) flat in vec4  iTint;
+layout(location=4) smooth in vec2  iFootprint;
+#endif
 layout(location=0) out vec4 fragColor;
-uniform uint64_t samplers[256];
-uniform int useBindless;
-uniform int currentFrame;
 
 void main() {
-    sampler2D s = sampler2D(samplers[currentFrame]);
-    if (useBindless>0) fragColor = texture2D(s, iUV);
-    else fragColor = iColor;
+#ifdef USE_BINDLESS_TEXTURES
+    sampler2D s = sampler2D(iTexture);
+    // *** INTERESTING ***
+    // iUV is flat, one texel per building, so its derivatives are zero and an implicit lookup always
+    // reads level 0. The gradients of the building's share of the city UV pick the mip level instead:
+    // zoomed out, many buildings fall on one pixel and a filtered level of the frame is read.
+    fragColor = textureGrad(s, iUV, dFdx(iFootprint), dFdy(iFootprint)) * iTint;
+#else
+    fragColor = iColor;
+#endif
 }
\ No newline at end of file
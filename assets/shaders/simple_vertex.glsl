@@ -35,6 +35,8 @@
 #extension GL_NV_shader_buffer_load : require
 #extension GL_NV_bindless_texture : require
 #extension GL_NV_gpu_shader5 : require // uint64_t
+#extension GL_ARB_shader_storage_buffer_object : require
+// USE_BINDLESS_UNIFORMS and USE_BINDLESS_TEXTURES are injected by ShaderVariants
 struct PerMeshUniforms;
 
 
@@ -48,13 +50,27 @@ layout(location=5) in vec4             iAttrib5;
 layout(location=6) in vec4             iAttrib6; 
 layout(location=7) in vec4             iAttrib7; 
 
-uniform uint64_t samplers[256];
-uniform int useBindless;
-uniform int currentFrame;
-
 // Outputs
 layout(location=0) smooth out vec4 oColor;
 layout(location=1) flat out vec2 oUV;
+#ifdef USE_BINDLESS_TEXTURES
+layout(location=2) flat out uvec2 oTexture;   // bindless handle of the color texture
+layout(location=3) flat out vec4 oTint;
+layout(location=4) smooth out vec2 oFootprint; // city UV across the building, for the texture's screen space gradients
+#endif
+
+// Packed on the CPU, see MaterialTable::Material
+struct Material
+{
+  uint firstTexture;    // color handles of the frames, from here in TextureHandles
+  uint firstDisplacement;
+  uint frameCount;
+  uint phase;           // frames ahead of CurrentFrame
+  uint tint;            // unorm8 x4
+  float displacementScale;
+  uint reserved0;
+  uint reserved1;
+};
 
 
 // Uniforms
@@ -62,12 +78,21 @@ layout(std140, binding=2) uniform TransformParams
 {
     mat4 ModelView;
     mat4 ModelViewProjection;
-    bool UseBindlessUniforms;
+    bool UseBindlessUniforms; // unused, the variant decides; kept for the std140 layout
+    mat4* ModelMatrices;      // world matrices of all meshes, in a resident buffer (bindless uniforms only)
+    Material* Materials;      // resident material table, indexed by the mesh's material ID
+    uint64_t* TextureHandles; // resident handles the materials name
+    int CurrentFrame;         // of the global animation
+    float TextureFootprint;   // city UV per model space unit: one building step covers 1 / grid size
 };
 
+// Packed on the CPU, see BindlessApp::PerMeshUniforms
 struct PerMeshUniforms
 { 
-  float r, g, b, a, u, v;
+  uint rg;              // snorm16 x2
+  uint bm;              // half, material ID in the high 16 bits
+  uint uv;              // unorm16 x2
+  uint model;           // index into ModelMatrices
 };
 
 layout(std140, binding=3) uniform NonBindlessPerMeshUniforms
@@ -75,40 +100,69 @@ layout(std140, binding=3) uniform NonBindlessPerMeshUniforms
   PerMeshUniforms nonBindlessPerMeshUniforms;
 };
 
+#ifndef USE_BINDLESS_UNIFORMS
+// Without bindless uniforms the world matrices are bound as a storage buffer rather than read through a pointer
+layout(std430, binding=4) readonly buffer NonBindlessModelMatrices
+{
+  mat4 nonBindlessModelMatrices[];
+};
+#endif
+
 
 void main() 
 {
   float r, g, b, u, v;
+  uint material;
+  mat4 model;
 
-  if(UseBindlessUniforms)
+#ifdef USE_BINDLESS_UNIFORMS
   {
     // For bindless uniforms, we pass in a pointer in GPU memory to the uniform data through a vertex attribute.
     // We use this pointer to load the uniform data.
     // *** INTERESTING ***
-    r = bindlessPerMeshUniformsPtr->r;
-    g = bindlessPerMeshUniformsPtr->g;
-    b = bindlessPerMeshUniformsPtr->b;
-    u = bindlessPerMeshUniformsPtr->u;
-    v = bindlessPerMeshUniformsPtr->v;
+    vec2 rg = unpackSnorm2x16(bindlessPerMeshUniformsPtr->rg);
+    vec2 uv = unpackUnorm2x16(bindlessPerMeshUniformsPtr->uv);
+    r = rg.x;
+    g = rg.y;
+    b = unpackHalf2x16(bindlessPerMeshUniformsPtr->bm).x;
+    u = uv.x;
+    v = uv.y;
+    material = bindlessPerMeshUniformsPtr->bm >> 16;
+    model = ModelMatrices[bindlessPerMeshUniformsPtr->model];
   }
-  else
+#else
   {
     // For non-bindless uniforms, we directly used the uniforms
-    r = nonBindlessPerMeshUniforms.r;
-    g = nonBindlessPerMeshUniforms.g;
-    b = nonBindlessPerMeshUniforms.b;
+    vec2 rg = unpackSnorm2x16(nonBindlessPerMeshUniforms.rg);
+    r = rg.x;
+    g = rg.y;
+    b = unpackHalf2x16(nonBindlessPerMeshUniforms.bm).x;
     u = 0.0;
     v = 0.0;
+    material = nonBindlessPerMeshUniforms.bm >> 16;
+    model = nonBindlessModelMatrices[nonBindlessPerMeshUniforms.model];
   }
+#endif
 
   vec4 positionModelSpace;
   positionModelSpace = iPos;
-  if (useBindless>0) {
-      sampler2D s = sampler2D(samplers[currentFrame]);
-     positionModelSpace.y += texture2D(s, vec2(u, v)).g;
+#ifdef USE_BINDLESS_TEXTURES
+  {
+    // *** INTERESTING ***
+    // The mesh's material names its textures; the fragment shader gets the color handle as a flat input
+    Material m = Materials[material];
+    uint frame = (uint(CurrentFrame) + m.phase) % m.frameCount;
+    sampler2D s = sampler2D(TextureHandles[m.firstDisplacement + frame]);
+    positionModelSpace.y += texture2D(s, vec2(u, v)).g * m.displacementScale;
+    oTexture = unpackUint2x32(TextureHandles[m.firstTexture + frame]);
+    oTint = unpackUnorm4x8(m.tint);
+    // u follows the buildings along z and v along x, see computePerMeshUniforms()
+    oFootprint = iPos.zx * TextureFootprint;
   }
-  else positionModelSpace.y += sin(positionModelSpace.y * r ) * .2f;
-  gl_Position = ModelViewProjection * positionModelSpace;
+#else
+  positionModelSpace.y += sin(positionModelSpace.y * r ) * .2f;
+#endif
+  gl_Position = ModelViewProjection * (model * positionModelSpace);
     
   oColor.r = iColor.r * r;
   oColor.g = iColor.g * g;
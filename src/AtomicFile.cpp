@@ -0,0 +1,46 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/AtomicFile.cpp
+//----------------------------------------------------------------------------------
+#include "AtomicFile.h"
+#include <cstdio>
+#include <fstream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+
+bool writeFileAtomic(const std::string& path, const std::function<void(std::ostream&)>& write, bool binary)
+{
+    const std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath.c_str(), binary ? std::ios::binary | std::ios::trunc : std::ios::trunc);
+        if(!file)
+        {
+            return false;
+        }
+        write(file);
+        file.flush();
+        if(!file)
+        {
+            file.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    // *** INTERESTING ***
+    // The destination is never removed first: in between, a reader would find no file at all
+#if defined(_WIN32)
+    const bool replaced = MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    const bool replaced = std::rename(tempPath.c_str(), path.c_str()) == 0;
+#endif
+    if(!replaced)
+    {
+        std::remove(tempPath.c_str());
+    }
+    return replaced;
+}
@@ -0,0 +1,22 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/AtomicFile.h
+//
+// Writes a file so that a reader, a second instance or a crash sees either the
+// old contents or all of the new ones. The data goes to path + ".tmp", which
+// then replaces path in one step: rename() on POSIX, MoveFileEx with
+// MOVEFILE_REPLACE_EXISTING on Windows, where rename() fails when the
+// destination exists. Used by the shader, texture and tile caches, the
+// auto-tune profile and GL traces.
+//----------------------------------------------------------------------------------
+#ifndef ATOMIC_FILE_H
+#define ATOMIC_FILE_H
+
+#include <functional>
+#include <ostream>
+#include <string>
+
+// write() fills the stream. If the file cannot be written or replaced, path keeps its old contents
+// and no temporary file is left behind.
+bool writeFileAtomic(const std::string& path, const std::function<void(std::ostream&)>& write, bool binary = true);
+
+#endif
@@ -0,0 +1,228 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/AutoTuner.cpp
+//----------------------------------------------------------------------------------
+#include "AutoTuner.h"
+#include "AtomicFile.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    double median(std::vector<double>& samples)
+    {
+        const size_t middle = samples.size() / 2;
+        std::nth_element(samples.begin(), samples.begin() + middle, samples.end());
+        const double upper = samples[middle];
+        if(samples.size() % 2 != 0)
+        {
+            return upper;
+        }
+        return 0.5 * (upper + *std::max_element(samples.begin(), samples.begin() + middle));
+    }
+}
+
+const double AutoTuner::TieTolerance = 0.03;
+
+
+AutoTuner::AutoTuner(uint32_t warmupFrames, uint32_t measuredFrames)
+    : m_warmupFrames(warmupFrames)
+    , m_measuredFrames(std::max(measuredFrames, 1u))
+    , m_current(0)
+    , m_frame(0)
+{
+    Config defaults = { true, true, false };
+    m_best = defaults;
+}
+
+
+void AutoTuner::start(bool hasVbum, bool hasBindlessUniforms)
+{
+    enumerate(hasVbum, hasBindlessUniforms, m_configs);
+    m_results.clear();
+    m_samples.clear();
+    m_current = 0;
+    m_frame   = 0;
+}
+
+
+void AutoTuner::stop()
+{
+    m_current = m_configs.size();
+}
+
+
+const AutoTuner::Config& AutoTuner::getConfig() const
+{
+    return isRunning() ? m_configs[m_current] : m_best;
+}
+
+
+void AutoTuner::addFrame(double seconds)
+{
+    if(!isRunning())
+    {
+        return;
+    }
+
+    // The first frames after a switch pay for it (program binds, driver revalidation)
+    if(m_frame++ >= m_warmupFrames)
+    {
+        m_samples.push_back(seconds);
+    }
+    if(m_samples.size() < m_measuredFrames)
+    {
+        return;
+    }
+
+    Result result;
+    result.m_config         = m_configs[m_current];
+    result.m_frames         = uint32_t(m_samples.size());
+    result.m_secondsPerFrame = median(m_samples);
+    m_results.push_back(result);
+    m_samples.clear();
+    m_frame = 0;
+
+    if(++m_current == m_configs.size())
+    {
+        const size_t best = select(m_results);
+        if(best < m_results.size())
+        {
+            m_best = m_results[best].m_config;
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: AutoTuner::enumerate()
+//
+//    The sweep order is also the tie break order: within a tie the bindless
+//    paths, then the shared vertex format, are preferred.
+//
+////////////////////////////////////////////////////////////////////////////////
+void AutoTuner::enumerate(bool hasVbum, bool hasBindlessUniforms, std::vector<Config>& configs)
+{
+    configs.clear();
+    for(int32_t vbum = 1; vbum >= 0; vbum--)
+    {
+        for(int32_t bindless = 1; bindless >= 0; bindless--)
+        {
+            for(int32_t formatPerDraw = 0; formatPerDraw <= 1; formatPerDraw++)
+            {
+                if((vbum && !hasVbum) || (bindless && !hasBindlessUniforms))
+                {
+                    continue;
+                }
+                Config config = { vbum != 0, bindless != 0, formatPerDraw != 0 };
+                configs.push_back(config);
+            }
+        }
+    }
+}
+
+
+size_t AutoTuner::select(const std::vector<Result>& results)
+{
+    size_t cheapest = results.size();
+    for(size_t i = 0; i < results.size(); i++)
+    {
+        if(results[i].m_frames != 0 && (cheapest == results.size() || results[i].m_secondsPerFrame < results[cheapest].m_secondsPerFrame))
+        {
+            cheapest = i;
+        }
+    }
+    if(cheapest == results.size())
+    {
+        return cheapest;
+    }
+
+    const double limit = results[cheapest].m_secondsPerFrame * (1.0 + TieTolerance);
+    for(size_t i = 0; i < cheapest; i++)
+    {
+        if(results[i].m_frames != 0 && results[i].m_secondsPerFrame <= limit)
+        {
+            return i;
+        }
+    }
+    return cheapest;
+}
+
+
+std::string AutoTuner::describe(const Config& config)
+{
+    std::ostringstream text;
+    text << (config.m_vbum ? "VBUM" : "VAO")
+         << (config.m_bindlessUniforms ? ", bindless uniforms" : ", UBO uniforms")
+         << (config.m_vertexFormatPerDraw ? ", format per draw" : ", shared format");
+    return text.str();
+}
+
+
+bool AutoTuner::loadProfile(const std::string& path, const std::string& driverIdentity, Config& config)
+{
+    std::ifstream file(path.c_str());
+    std::string line;
+    while(std::getline(file, line))
+    {
+        const size_t tab = line.rfind('\t');
+        if(tab == std::string::npos || line.compare(0, tab, driverIdentity) != 0 || tab != driverIdentity.size())
+        {
+            continue;
+        }
+
+        // Lines with more fields come from sweeps that ranked by the cost per draw call; they are measured again
+        std::istringstream fields(line.substr(tab + 1));
+        int32_t vbum, bindless, formatPerDraw;
+        std::string extra;
+        if(!(fields >> vbum >> bindless >> formatPerDraw) || (fields >> extra))
+        {
+            return false;
+        }
+        config.m_vbum                = vbum != 0;
+        config.m_bindlessUniforms    = bindless != 0;
+        config.m_vertexFormatPerDraw = formatPerDraw != 0;
+        return true;
+    }
+    return false;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: AutoTuner::storeProfile()
+//
+//    Keeps the lines of other drivers. Written to a temporary file and renamed
+//    into place, like the program binary cache.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool AutoTuner::storeProfile(const std::string& path, const std::string& driverIdentity, const Config& config)
+{
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(path.c_str());
+        std::string line;
+        while(std::getline(file, line))
+        {
+            const size_t tab = line.rfind('\t');
+            if(!line.empty() && !(tab == driverIdentity.size() && line.compare(0, tab, driverIdentity) == 0))
+            {
+                lines.push_back(line);
+            }
+        }
+    }
+
+    std::ostringstream entry;
+    entry << driverIdentity << '\t' << int32_t(config.m_vbum) << ' ' << int32_t(config.m_bindlessUniforms) << ' '
+          << int32_t(config.m_vertexFormatPerDraw);
+    lines.push_back(entry.str());
+
+    return writeFileAtomic(path, [&](std::ostream& file) {
+        for(size_t i = 0; i < lines.size(); i++)
+        {
+            file << lines[i] << '\n';
+        }
+    }, false);
+}
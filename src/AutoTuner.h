@@ -0,0 +1,86 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/AutoTuner.h
+//
+// Finds the fastest combination of the submission toggles (VBUM, bindless
+// uniforms, vertex format per draw) by drawing a few frames with each one.
+// The app applies getConfig() before a frame and reports the cost of its draw
+// phase with addFrame(); after a few warmup frames the median draw phase time
+// of each configuration is kept, and the cheapest one wins.
+//
+// Only toggles that leave the frame unchanged are candidates, so every
+// configuration draws the same thing and whole frames can be compared. Draw
+// calls per state and per mesh uniforms change what is drawn (repeated draws,
+// one color for the whole city): the app holds them at 1 and on while it
+// sweeps. A cost per issued draw call would rank a configuration that draws
+// more calls as cheaper even when its frames take longer. Configurations within a small tolerance of the
+// cheapest count as a tie and the earlier one in the sweep order is taken, so
+// noise does not flip the choice between launches.
+//
+// The winner is stored in a small text profile keyed by the driver identity
+// (GL_RENDERER|GL_VERSION), so later launches on the same driver skip the sweep.
+// Nothing here touches GL: the sweep can be driven with synthetic timings.
+//----------------------------------------------------------------------------------
+#ifndef AUTO_TUNER_H
+#define AUTO_TUNER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class AutoTuner
+{
+public:
+    struct Config
+    {
+        bool     m_vbum;
+        bool     m_bindlessUniforms;
+        bool     m_vertexFormatPerDraw;
+    };
+
+    struct Result
+    {
+        Config   m_config;
+        double   m_secondsPerFrame;     // median draw phase over the measured frames
+        uint32_t m_frames;
+    };
+
+    // Costs within this fraction of the cheapest are a tie
+    static const double TieTolerance;
+
+    AutoTuner(uint32_t warmupFrames, uint32_t measuredFrames);
+
+    // Sweeps the combinations the driver supports
+    void start(bool hasVbum, bool hasBindlessUniforms);
+    void stop();
+    bool isRunning() const                  { return m_current < m_configs.size(); }
+
+    // Configuration for the coming frame while running, the winner afterwards
+    const Config& getConfig() const;
+    // Draw phase of the frame drawn with getConfig()
+    void addFrame(double seconds);
+
+    const std::vector<Result>& getResults() const { return m_results; }
+    uint32_t getConfigCount() const         { return uint32_t(m_configs.size()); }
+    uint32_t getConfigIndex() const         { return uint32_t(m_current); }
+
+    // Profile file: one line per driver, the identity, a tab and the configuration
+    static bool loadProfile(const std::string& path, const std::string& driverIdentity, Config& config);
+    static bool storeProfile(const std::string& path, const std::string& driverIdentity, const Config& config);
+
+    static void        enumerate(bool hasVbum, bool hasBindlessUniforms, std::vector<Config>& configs);
+    // Index of the winner, results.size() if there is none
+    static size_t      select(const std::vector<Result>& results);
+    static std::string describe(const Config& config);
+
+private:
+    uint32_t            m_warmupFrames;
+    uint32_t            m_measuredFrames;
+    std::vector<Config> m_configs;
+    size_t              m_current;          // config being measured, m_configs.size() when done
+    uint32_t            m_frame;            // frames drawn with the current config
+    std::vector<double> m_samples;
+    std::vector<Result> m_results;
+    Config              m_best;
+};
+
+#endif
@@ -0,0 +1,148 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/Benchmark.cpp
+//----------------------------------------------------------------------------------
+#include "Benchmark.h"
+#include "cinder/app/App.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+volatile uint64_t Benchmark::m_sink = 0;
+
+namespace
+{
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        const double position = p * double(sorted.size() - 1);
+        const size_t below    = size_t(position);
+        const size_t above    = std::min(below + 1, sorted.size() - 1);
+        return sorted[below] + (position - double(below)) * (sorted[above] - sorted[below]);
+    }
+}
+
+
+Benchmark::Benchmark(uint32_t samples, double minSampleSeconds, uint32_t seed)
+    : m_samples(std::max(samples, 1u))
+    , m_minSampleSeconds(minSampleSeconds)
+    , m_seed(seed)
+{
+}
+
+
+double Benchmark::now()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+void Benchmark::addResult(const char* name, uint64_t items, const char* itemName, uint64_t repeats, std::vector<double>& samples)
+{
+    std::sort(samples.begin(), samples.end());
+
+    Result result;
+    result.m_suite    = m_currentSuite;
+    result.m_name     = name;
+    result.m_samples  = uint32_t(samples.size());
+    result.m_repeats  = repeats;
+    result.m_items    = items;
+    result.m_itemName = itemName;
+    result.m_min      = samples.front();
+    result.m_median   = percentile(samples, 0.5);
+    result.m_p95      = percentile(samples, 0.95);
+
+    double sum = 0.0;
+    for(size_t i = 0; i < samples.size(); i++)
+    {
+        sum += samples[i];
+    }
+    result.m_mean = sum / double(samples.size());
+
+    std::vector<double> deviations(samples.size());
+    for(size_t i = 0; i < samples.size(); i++)
+    {
+        deviations[i] = std::fabs(samples[i] - result.m_median);
+    }
+    std::sort(deviations.begin(), deviations.end());
+    result.m_mad = percentile(deviations, 0.5);
+
+    result.m_itemsPerSecond = result.m_median > 0.0 ? double(items) / result.m_median : 0.0;
+    m_results.push_back(result);
+}
+
+
+void Benchmark::addSuite(const std::string& name, const Suite& suite)
+{
+    m_suites.push_back(std::make_pair(name, suite));
+}
+
+
+void Benchmark::runSuites()
+{
+    for(size_t i = 0; i < m_suites.size(); i++)
+    {
+        m_currentSuite = m_suites[i].first;
+        m_suites[i].second(*this);
+    }
+    m_currentSuite.clear();
+}
+
+
+void Benchmark::addMetric(const std::string& name, double value)
+{
+    m_metrics.push_back(std::make_pair(name, value));
+}
+
+
+void Benchmark::print() const
+{
+    for(size_t i = 0; i < m_results.size(); i++)
+    {
+        const Result& r = m_results[i];
+        ci::app::console() << "benchmark " << r.m_name << ": median " << r.m_median * 1.0e6 << " us (+/- " << r.m_mad * 1.0e6
+                           << "), min " << r.m_min * 1.0e6 << " us, p95 " << r.m_p95 * 1.0e6 << " us, "
+                           << r.m_itemsPerSecond / 1.0e6 << " M " << r.m_itemName << "/s" << std::endl;
+    }
+    for(size_t i = 0; i < m_metrics.size(); i++)
+    {
+        ci::app::console() << "benchmark " << m_metrics[i].first << ": " << m_metrics[i].second << std::endl;
+    }
+}
+
+
+std::string Benchmark::toJson() const
+{
+    std::ostringstream out;
+    out.precision(9);
+    out << "{\n  \"seed\": " << m_seed << ",\n  \"results\": [\n";
+    for(size_t i = 0; i < m_results.size(); i++)
+    {
+        const Result& r = m_results[i];
+        out << "    { \"suite\": \"" << r.m_suite << "\", \"name\": \"" << r.m_name << "\", \"samples\": " << r.m_samples << ", \"repeats\": " << r.m_repeats
+            << ", \"items\": " << r.m_items << ", \"item\": \"" << r.m_itemName << "\""
+            << ", \"min_s\": " << r.m_min << ", \"median_s\": " << r.m_median << ", \"mean_s\": " << r.m_mean
+            << ", \"p95_s\": " << r.m_p95 << ", \"mad_s\": " << r.m_mad << ", \"items_per_s\": " << r.m_itemsPerSecond
+            << " }" << (i + 1 < m_results.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n  \"metrics\": {";
+    for(size_t i = 0; i < m_metrics.size(); i++)
+    {
+        out << (i ? "," : "") << "\n    \"" << m_metrics[i].first << "\": " << m_metrics[i].second;
+    }
+    out << (m_metrics.empty() ? "}\n}\n" : "\n  }\n}\n");
+    return out.str();
+}
+
+
+bool Benchmark::write(const std::string& path) const
+{
+    std::ofstream file(path.c_str(), std::ios::trunc);
+    if(!file)
+    {
+        return false;
+    }
+    file << toJson();
+    return bool(file);
+}
@@ -0,0 +1,121 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/Benchmark.h
+//
+// Small harness for timing CPU kernels in isolation. Each case is warmed up,
+// then its repeat count is calibrated so one sample takes at least
+// m_minSampleSeconds, and a fixed number of samples is taken. The median and
+// the median absolute deviation are reported next to min/mean/p95, as they
+// hold up against the odd preempted sample. rand() is reseeded with the same
+// seed before every sample, so every sample does the same work.
+//
+// Cases are grouped into suites, one per subsystem, registered with addSuite()
+// and run in that order by runSuites(); each result records its suite.
+//
+// Results go to the console and, as JSON, to a file for comparing runs.
+//----------------------------------------------------------------------------------
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+class Benchmark
+{
+public:
+    struct Result
+    {
+        std::string m_suite;            // empty for cases run outside runSuites()
+        std::string m_name;
+        uint32_t    m_samples;
+        uint64_t    m_repeats;          // calls of the kernel per sample
+        uint64_t    m_items;            // items processed per call (vertices, meshes, bytes, ...)
+        const char* m_itemName;
+        // Seconds per call
+        double      m_min;
+        double      m_median;
+        double      m_mean;
+        double      m_p95;
+        double      m_mad;              // median absolute deviation
+        double      m_itemsPerSecond;   // at the median
+    };
+
+    typedef std::function<void(Benchmark&)> Suite;
+
+    Benchmark(uint32_t samples = 31, double minSampleSeconds = 0.005, uint32_t seed = 1);
+
+    // suite(*this) calls run() and addMetric() for one subsystem
+    void addSuite(const std::string& name, const Suite& suite);
+    void runSuites();
+
+    // fn() runs one call of the kernel processing 'items' items
+    template<class F>
+    void run(const char* name, uint64_t items, const char* itemName, F fn);
+
+    // Extra values reported with the results (e.g. memory use)
+    void addMetric(const std::string& name, double value);
+
+    // Keeps the compiler from dropping a computation whose result is unused
+    static void consume(uint64_t value) { m_sink = m_sink + value; }
+
+    const std::vector<Result>& getResults() const { return m_results; }
+    uint32_t getSeed() const { return m_seed; }
+
+    void        print() const;
+    std::string toJson() const;
+    bool        write(const std::string& path) const;
+
+private:
+    static double now();
+    void          addResult(const char* name, uint64_t items, const char* itemName, uint64_t repeats, std::vector<double>& samples);
+
+    uint32_t            m_samples;
+    double              m_minSampleSeconds;
+    uint32_t            m_seed;
+    std::vector<Result> m_results;
+    std::vector<std::pair<std::string, double> > m_metrics;
+    std::vector<std::pair<std::string, Suite> >  m_suites;
+    std::string         m_currentSuite;
+
+    static volatile uint64_t m_sink;
+};
+
+
+template<class F>
+void Benchmark::run(const char* name, uint64_t items, const char* itemName, F fn)
+{
+    // Warm up caches and the branch predictor, and find a repeat count long enough to time reliably
+    uint64_t repeats = 1;
+    for(;;)
+    {
+        srand(m_seed);
+        const double start = now();
+        for(uint64_t r = 0; r < repeats; r++)
+        {
+            fn();
+        }
+        if(now() - start >= m_minSampleSeconds || repeats >= (uint64_t(1) << 30))
+        {
+            break;
+        }
+        repeats *= 2;
+    }
+
+    std::vector<double> samples(m_samples);
+    for(uint32_t s = 0; s < m_samples; s++)
+    {
+        srand(m_seed);
+        const double start = now();
+        for(uint64_t r = 0; r < repeats; r++)
+        {
+            fn();
+        }
+        samples[s] = (now() - start) / double(repeats);
+    }
+    addResult(name, items, itemName, repeats, samples);
+}
+
+#endif
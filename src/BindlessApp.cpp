@@ -2,6 +2,7 @@
 #define DISABLE_FRAMERATE
 //#define REVERSE_Z
 #define USE_IMGUI
+#define USE_COMPRESSED_TEXTURES
 
 #include "cinder/app/App.h"
 #include "cinder/app/RendererGl.h"
@@ -17,10 +18,59 @@
 #include "cinder/params/Params.h"
 #endif //USE_IMGUI
 #include "Mesh.h"
+#include "TextureCompressor.h"
+#include "MipGenerator.h"
+#include "TextureResidency.h"
+#include "GLStateCache.h"
+#include "ProgramBinaryCache.h"
+#include "ShaderVariants.h"
+#include "TransformHierarchy.h"
+#include "MeshRegistry.h"
+#include "UploadQueue.h"
+#include "GLTrace.h"
+#include "Benchmark.h"
+#include "MemoryTracker.h"
+#include "GeometryCache.h"
+#include "MeshImporter.h"
+#include "FrameArena.h"
+#include "JobSystem.h"
+#include "TaskGraph.h"
+#include "AutoTuner.h"
+#include "DirtyRangeTracker.h"
+#include "UniformSlotLayout.h"
+#include "CityStreamer.h"
+#include "GeometryCodec.h"
+#include "MaterialTable.h"
+#include "ViewCuller.h"
+#include "GLObjectQueue.h"
+#include <glm/gtc/packing.hpp>
 
 #define SQRT_BUILDING_COUNT 100
+#define MESH_CAPACITY (2 * (1 + SQRT_BUILDING_COUNT * SQRT_BUILDING_COUNT))
 #define TEXTURE_FRAME_COUNT 181
 #define ANIMATION_DURATION 5.0f
+#define TEXTURE_RESIDENCY_WINDOW_BEHIND 2
+#define TEXTURE_RESIDENCY_WINDOW_AHEAD 8
+#define TEXTURE_RESIDENCY_BUDGET_BYTES (1024 * 1024)
+#define UPLOAD_BUDGET_BYTES (4 * 1024 * 1024)
+#define UPLOAD_BUDGET_SECONDS 0.002
+#define CAPTURE_FRAME_COUNT 10
+#define FRAME_ARENA_BYTES (4 * 1024 * 1024)
+#define AUTOTUNE_WARMUP_FRAMES 4
+#define AUTOTUNE_MEASURED_FRAMES 16
+#define PER_MESH_UNIFORMS_MERGE_GAP 8
+#define STREAMED_CITY_SIZE 256					// buildings per side of the --stream-city city
+#define CITY_TILE_SIZE 16						// buildings per side of a streamed tile
+#define CITY_STREAMING_BUDGET_BYTES (48 * 1024 * 1024)
+#define CITY_VISIBLE_RADIUS 2.4f
+#define CITY_PREFETCH_RADIUS 3.2f
+#define CITY_PREFETCH_LOOK_AHEAD 30.0f			// frames
+#define MATERIAL_COUNT 64
+#define MATERIAL_PHASES 8						// distinct animation phases among the materials
+#define MATERIAL_TABLE_MERGE_GAP 4
+#define VIEW_COUNT_MAX 4						// the main view and up to three inset views
+#define VIEW_CULL_GRAIN 1024					// draw list items per culling job
+#define GL_OBJECT_BATCH_SIZE 256				// buffer or texture names generated per glGen* call
 
 using namespace ci;
 using namespace ci::app;
@@ -46,7 +96,25 @@ using namespace std;
 // Mesh::renderFinish() in Mesh.cpp resets related state
 
 
-class BindlessApp : public App {
+// Our programs are plain GL programs rather than gl::GlslProg, so bind them directly and
+// hand back the program Cinder believes is bound when the scope ends
+struct ScopedProgram
+{
+	ScopedProgram(GLuint program) { glUseProgram(program); }
+	~ScopedProgram() { const gl::GlslProg* prog = gl::context()->getGlslProg(); glUseProgram(prog ? prog->getHandle() : 0); }
+};
+
+// Ends the object queue's frame however draw() returns, so the names released up to it keep being
+// fenced and deleted even on frames that draw nothing
+struct ScopedObjectFrame
+{
+	ScopedObjectFrame(GLObjectQueue* queue) : m_queue(queue) {}
+	~ScopedObjectFrame() { if (m_queue) m_queue->endFrame(); }
+	GLObjectQueue* m_queue;
+};
+
+
+class BindlessApp : public App, public TileBackend {
 public:
 	BindlessApp();
 	~BindlessApp() {}
@@ -58,9 +126,13 @@ public:
 	void update() override;
 	void draw() override;
 	void resize() override;
+	void cleanup() override;
 
 	void updatePerMeshUniforms(float t);
+	void computePerMeshUniforms(float t);
 	void InitBindlessTextures();
+	static void makeTextureFileNames(std::vector<std::string>& fileNames);
+	bool InitCompressedTextures(const std::vector<std::string>& fileNames);
 
 
 private:
@@ -70,18 +142,90 @@ private:
 		glm::mat4 ModelView;
 		glm::mat4 ModelViewProjection;
 		int32_t      UseBindlessUniforms;
+		GLuint64EXT  ModelMatrices;	// GPU pointer to m_modelMatrices; without bindless uniforms it is bound to storage buffer 4
+		GLuint64EXT  Materials;		// GPU pointers to the material table's buffers
+		GLuint64EXT  TextureHandles;
+		int32_t      CurrentFrame;
+		float        TextureFootprint;	// city texture UV per world unit, for the shader's mip level
 	};
 
+	// *** INTERESTING ***
+	// 16 bytes instead of 32: the values are packed the way the vertex shader unpacks them (unpackSnorm2x16,
+	// unpackHalf2x16, unpackUnorm2x16), and the model matrix is an index into m_modelMatrices instead of a pointer
 	struct PerMeshUniforms
 	{
-		float r, g, b, a, u, v;
+		uint32_t rg;		// r, g in [-1, 1] as snorm16
+		uint32_t bm;		// b as a half float, the material ID in the high 16 bits
+		uint32_t uv;		// u, v in [0, 1] as unorm16
+		uint32_t model;		// transform node of the mesh, its world matrix in m_modelMatrices
+	};
+
+	static uint32_t packBM(float b, uint32_t material) { return (glm::packHalf2x16(glm::vec2(b, 0.0f)) & 0xFFFF) | (material << 16); }
+	static uint32_t getBuildingMaterial(int32_t i, int32_t k) { return 1 + (uint32_t)(i * 7 + k * 13) % (MATERIAL_COUNT - 1); }
+
+	// One entry per mesh drawn, in the order they are drawn
+	struct DrawItem
+	{
+		uint32_t mesh;			// dense index into m_meshes
+		uint32_t slot;
+		GLint    uniformsLow;	// GPU pointer to the slot's per mesh uniforms, split for glVertexAttribI2i
+		GLint    uniformsHigh;
 	};
 
 	void initRendering();
+	void initMaterials();
+	void uploadMaterials();
+
+	void setupViews();
+	void getViewProjection(uint32_t view, float* matrix) const;
+	void computeWorldBounds(uint32_t begin, uint32_t end);
+	void cullViews();
+	void drawItems(const uint32_t* items, uint32_t count);
 
 	void createBuilding(Mesh& mesh, ci::vec3 pos, ci::vec3 dim, ci::vec2 uv);
+	void generateBuilding(ci::vec3 pos, ci::vec3 dim, std::vector<Vertex>& vertices, std::vector<uint16_t>& indices);
+	void placeBuilding(int32_t i, int32_t k, float height);
+	void rebuildRandomBuilding();
+	void bakeCityTiles(const std::string& dir);
+	// TileBackend: the streamed city's tiles come and go as meshes in the registry
+	bool load(int32_t x, int32_t z, CityTile& tile) override;
+	bool attach(const CityTile& tile, uint64_t& bytes) override;
+	void detach(int32_t x, int32_t z) override;
 	void createGround(Mesh& mesh, ci::vec3 pos, ci::vec3 dim);
+	void generateGround(ci::vec3 pos, ci::vec3 dim, std::vector<Vertex>& vertices, std::vector<uint16_t>& indices);
 	void randomColor(float &r, float &g, float &b);
+	void importMeshes(const std::string& path);
+
+	void initTraceOptions();
+	void writeCapture();
+	void runCpuBenchmarks(const std::string& outputPath);
+	// The suites runCpuBenchmarks() registers, one per subsystem
+	void benchmarkMeshGeneration(Benchmark& bench);
+	void benchmarkGeometryCache(Benchmark& bench);
+	void benchmarkMeshImport(Benchmark& bench);
+	void benchmarkPerMeshUniforms(Benchmark& bench);
+	void benchmarkFrameGraph(Benchmark& bench);
+	void benchmarkFrameArena(Benchmark& bench);
+	void benchmarkTextures(Benchmark& bench);
+	void benchmarkCityStreaming(Benchmark& bench);
+	void benchmarkGeometryCodec(Benchmark& bench);
+	void benchmarkMaterialTable(Benchmark& bench);
+	void benchmarkViewCulling(Benchmark& bench);
+	void benchmarkGLObjects(Benchmark& bench);
+	void benchmarkMemory(Benchmark& bench);
+
+	float advanceAnimationTime();
+	void uploadPerMeshUniforms();
+	void computePerMeshUniforms(float t, bool perMeshUniforms, std::vector<PerMeshUniforms>& uniforms, int32_t firstRow, int32_t lastRow);
+	void buildDrawList(std::vector<DrawItem>& drawList, uint32_t begin, uint32_t end);
+	TaskGraph::TaskId buildFrameGraph(TaskGraph& graph);
+	void launchNextFrame();
+	static void animationTask(void* app, uint32_t begin, uint32_t end);
+	static void transformsTask(void* app, uint32_t begin, uint32_t end);
+	static void perMeshUniformsTask(void* app, uint32_t begin, uint32_t end);
+	static void drawListTask(void* app, uint32_t begin, uint32_t end);
+	void applyTuning(const AutoTuner::Config& config);
+	void finishAutoTune();
 
 	//ci::gl::Texture2dRef	createFromDds(const DataSourceRef &dataSource, const ci::gl::Texture2d::Format &format = ci::gl::Texture2d::Format());
 
@@ -89,30 +233,124 @@ private:
 	CameraPersp mCam;
 	CameraUi mCamUI;
 
-	// Simple collection of meshes to render
-	std::vector<Mesh>				m_meshes;
+	// Mesh buffers, geometry cache buffers and compressed textures are generated in batches and deleted together
+	// once the GPU is done with the frame that released them. Declared before everything holding its handles.
+	GLDirectObjectBackend         m_glObjectBackend;
+	std::unique_ptr<GLObjectQueue> m_glObjects;
+
+	// Simple collection of meshes to render; a mesh's slot is also its per mesh uniform and transform slot
+	MeshRegistry					m_meshes;
+	MeshRegistry::Handle			m_groundHandle;
+	std::vector<MeshRegistry::Handle> m_buildingHandles;	// i * m_cityGridSize + k
+	int32_t							m_cityGridSize;			// buildings per side
+	std::vector<MeshRegistry::Handle> m_importedHandles;	// parts of the --import-mesh file
+	MeshImporter::Stats				m_importStats;
 	//std::vector<ci::gl::VboMeshRef> m_vbo_meshes;
 
+	// Per frame GL calls go through m_gl; m_glStateCache drops the redundant ones before they reach m_glDirect,
+	// passing m_glCapture on the way, which records them while a capture is running
+	GLDirectBackend               m_glDirect;
+	GLCaptureBackend              m_glCapture;
+	GLStateCache                  m_glStateCache;
+	GLBackend*                    m_gl;
+	bool                          m_useStateCache;
+
+	// GL call stream capture (--capture-trace <file> [--capture-frames N]) and replay (--replay-trace <file>)
+	std::string                   m_capturePath;
+	uint32_t                      m_captureFrames;
+	bool                          m_captureStarted;
+	GLTrace                       m_replayTrace;
+	std::unique_ptr<GLTraceReplayer> m_replayer;
+	RecordingGLBackend            m_replayStandIn;	// replays a trace that must not reach the driver
+	GLTraceReplayer::Stats        m_replayStats;
+
+	// Buffer and texture uploads are queued and drained once per frame within a budget
+	GLuint                        m_uploadStaging;
+	std::unique_ptr<UploadQueue>  m_uploads;
+
+	// Meshes with identical vertex or index data share one resident buffer
+	std::unique_ptr<GeometryCache> m_geometryCache;
+
+	// Per frame data (immediate upload payloads, UI strings) comes from a double-buffered linear arena
+	FrameArena                    m_frameArena;
+	uint64_t                      m_heapAllocationsAtFrameStart;
+	uint64_t                      m_heapAllocationsPerFrame;	// operator new calls from one update() to the next
+
 	// Shader stuff
-	gl::GlslProgRef               m_shader;
+	std::unique_ptr<ProgramBinaryCache> m_programCache;
+	std::unique_ptr<ShaderVariants> m_shaderVariants;	// one program per combination of shader affecting toggles
+	ShaderVariants::Key           m_shaderKey;
+	std::string                   m_shaderVariantNames[ShaderVariants::KeyCount];	// for the UI, built once
 	GLuint                        m_bindlessPerMeshUniformsPtrAttribLocation;
 
-	// uniform buffer object (UBO) for tranform data
+	// uniform buffer object (UBO) for tranform data, one slot per view
 	GLuint                        m_transformUniforms;
-	TransformUniforms             m_transformUniformsData;
-	glm::mat4                  m_projectionMatrix;
+	UniformSlotLayout             m_transformUniformsLayout;
+	TransformUniforms             m_transformUniformsData[VIEW_COUNT_MAX];
+	std::vector<uint8_t>          m_transformUniformsPadded;	// the slots as uploaded
 
 	// uniform buffer object (UBO) for mesh param data
 	GLuint                        m_perMeshUniforms;
 	std::vector<PerMeshUniforms>  m_perMeshUniformsData;
 	GLuint64EXT                   m_perMeshUniformsGPUPtr;
+	DirtyRangeTracker             m_perMeshUniformsDirty;	// what m_perMeshUniforms holds; only changed runs are uploaded
+
+	// The same uniforms one per GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, bound by offset when they are not bindless
+	GLuint                        m_perMeshUniformSlots;
+	UniformSlotLayout             m_perMeshUniformSlotLayout;
+	std::vector<uint8_t>          m_perMeshUniformSlotData;	// padded copy that is uploaded from
+	DirtyRangeTracker             m_perMeshUniformSlotsDirty;
+
+	// Per mesh model matrices; the meshes hang off one city node
+	TransformHierarchy            m_transforms;
+	std::vector<uint32_t>         m_meshNodes;			// per mesh slot
+	uint32_t                      m_cityNode;
+	GLuint                        m_modelMatrices;		// resident buffer of world matrices, one per node
+	GLuint64EXT                   m_modelMatricesGPUPtr;
+	uint32_t                      m_transformsUpdated;
 
 	//bindless texture handle
 	ci::gl::Texture2dRef		  m_textureRefs[TEXTURE_FRAME_COUNT];
 	GLuint64EXT*				  m_textureHandles;
+	ci::gl::Texture2dRef		  m_displacementTextureRefs[TEXTURE_FRAME_COUNT];
+	GLuint64EXT*				  m_displacementTextureHandles;	// BC4 copies of the displacement channel, or the same as m_textureHandles
 	GLuint*						  m_textureIds;
+	std::vector<GLTextureHandle>  m_compressedTextures;	// own the GL textures the compressed frames' Texture2d refs wrap
 	GLint					      m_numTextures;
+	GLResidencyBackend			  m_residencyBackend;
+	TextureResidencyManager		  m_textureResidency;	// one entry per animation frame
 	bool						  m_useBindlessTextures;
+
+	// *** Material table ***
+	// The materials and the texture handles they name, in resident buffers the vertex shader indexes with the
+	// material ID of the mesh's per mesh uniforms. Only written when a material or handle changes.
+	MaterialTable                 m_materialTable;
+	GLuint                        m_materials;
+	GLuint64EXT                   m_materialsGPUPtr;
+	GLuint                        m_textureHandleTable;
+	GLuint64EXT                   m_textureHandleTableGPUPtr;
+	uint32_t                      m_firstFrameHandle;	// in the table, the color handle of animation frame 0
+
+	// *** Multi-view ***
+	// The draw list and per mesh uniforms are built once per frame and culled against all views in one pass;
+	// each view then draws its share of the draw list with its own slot of the transform uniforms
+	struct View
+	{
+		ci::Area                  m_viewport;
+		glm::mat4                 m_view;
+		glm::mat4                 m_projection;
+	};
+	View                          m_views[VIEW_COUNT_MAX];
+	uint32_t                      m_viewCount;
+	int32_t                       m_extraViews;			// inset views drawn next to the main view
+	ViewCuller                    m_viewCuller;
+	std::vector<ViewCuller::Sphere> m_worldBounds;		// per draw list item
+	std::vector<uint32_t>         m_viewMasks;			// per draw list item, a bit per view it is visible in
+	std::vector<uint32_t>         m_viewItems[VIEW_COUNT_MAX];	// per view, indices into m_drawList
+	uint32_t                      m_viewItemCounts[VIEW_COUNT_MAX];
+	uint32_t                      m_frustumTests;
+	uint32_t                      m_drawCount;			// meshes drawn last frame, over all views
+
 	int							  m_currentFrame;
 	float						  m_currentTime;
 	float						  avgfps;//avgfps
@@ -122,11 +360,48 @@ private:
 	bool                          m_useBindlessUniforms;
 	bool                          m_updateUniformsEveryFrame;
 	bool                          m_usePerMeshUniforms;
+	bool                          m_animateTransforms;
 
 	// Timing related stuff
 	float                         m_t;
 	float                         m_minimumFrameDeltaTime;
 
+	// *** Pipelined frames ***
+	// While frame N is submitted, the frame graph computes frame N+1's uniforms, transforms and draw list on
+	// the job system. Its results go to the m_next* copies, which draw() swaps in at the start of the next frame.
+	std::unique_ptr<JobSystem>    m_jobs;
+	std::unique_ptr<TaskGraph>    m_frameGraph;
+	TaskGraph::TaskId             m_drawListTask;
+	bool                          m_pipelineFrames;
+	bool                          m_nextFrameReady;
+	uint32_t                      m_nextMeshesVersion;	// m_meshes.getVersion() the next frame was computed for
+	bool                          m_nextUsePerMeshUniforms;
+	bool                          m_nextAnimateTransforms;
+	float                         m_nextT;
+	float                         m_nextCityAngle;
+	uint32_t                      m_nextTransformsUpdated;
+	std::vector<PerMeshUniforms>  m_nextPerMeshUniformsData;
+	std::vector<DrawItem>         m_drawList;
+	std::vector<DrawItem>         m_nextDrawList;
+
+	// *** City streaming (--stream-city) ***
+	// The city is baked into tiles on disk and only the tiles around the camera are registered as meshes
+	std::unique_ptr<CityStreamer> m_cityStreamer;
+	std::string                   m_cityTileDir;
+	std::vector<Vertex>           m_tileVertices;		// attach() scratch
+	std::vector<uint16_t>         m_tileIndices;
+
+	// *** Auto-tuning ***
+	// The submission toggles are swept once per driver and the winner kept in m_autoTuneProfilePath
+	// (--autotune sweeps again, --no-autotune keeps the defaults).
+	AutoTuner                     m_autoTuner;
+	bool                          m_autoTunePending;	// starts once the startup uploads are through
+	bool                          m_autoTuneLoaded;		// the profile had an entry for this driver
+	bool                          m_autoTuneSavedPerMeshUniforms;	// the toggles the sweep resets, restored when it ends
+	uint32_t                      m_autoTuneSavedDrawCallsPerState;
+	std::string                   m_autoTuneProfilePath;
+	std::string                   m_driverIdentity;
+
 #ifndef USE_IMGUI
 	params::InterfaceGlRef mParams;
 #endif //!USE_IMGUI
@@ -134,12 +409,63 @@ private:
 
 BindlessApp::BindlessApp() :
 	m_drawCallsPerSecondText(0.f)
+	, m_meshes(MESH_CAPACITY)
+	, m_cityGridSize(SQRT_BUILDING_COUNT)
 	, m_useBindlessUniforms(true)
 	, m_updateUniformsEveryFrame(true)
 	, m_usePerMeshUniforms(true)
+	, m_animateTransforms(false)
+	, m_transformsUpdated(0)
+	, m_drawListTask(0)
+	, m_pipelineFrames(true)
+	, m_nextFrameReady(false)
+	, m_nextMeshesVersion(0)
+	, m_nextUsePerMeshUniforms(true)
+	, m_nextAnimateTransforms(false)
+	, m_nextT(0.0f)
+	, m_nextCityAngle(0.0f)
+	, m_nextTransformsUpdated(0)
+	, m_t(0.0f)
+	, m_minimumFrameDeltaTime(1.0e6f)
 	, m_useBindlessTextures(false)
 	, m_currentFrame(0)
 	, m_currentTime(0.0f)
+	, m_glCapture(m_glDirect)
+	, m_glStateCache(m_glCapture)
+	, m_gl(&m_glStateCache)
+	, m_useStateCache(true)
+	, m_captureFrames(CAPTURE_FRAME_COUNT)
+	, m_captureStarted(false)
+	, m_uploadStaging(0)
+	, m_transformUniforms(0)
+	, m_perMeshUniforms(0)
+	, m_perMeshUniformSlots(0)
+	, m_modelMatrices(0)
+	, m_textureHandles(nullptr)
+	, m_displacementTextureHandles(nullptr)
+	, m_textureIds(nullptr)
+	, m_shaderKey(0)
+	, m_frameArena(FRAME_ARENA_BYTES)
+	, m_heapAllocationsAtFrameStart(0)
+	, m_heapAllocationsPerFrame(0)
+	, m_textureResidency(m_residencyBackend, TEXTURE_RESIDENCY_WINDOW_BEHIND, TEXTURE_RESIDENCY_WINDOW_AHEAD, TEXTURE_RESIDENCY_BUDGET_BYTES)
+	, m_materialTable(MATERIAL_COUNT, 2 * TEXTURE_FRAME_COUNT, MATERIAL_TABLE_MERGE_GAP)
+	, m_materials(0)
+	, m_materialsGPUPtr(0)
+	, m_textureHandleTable(0)
+	, m_textureHandleTableGPUPtr(0)
+	, m_firstFrameHandle(0)
+	, m_viewCount(1)
+	, m_extraViews(0)
+	, m_frustumTests(0)
+	, m_drawCount(0)
+	, m_perMeshUniformsDirty(sizeof(PerMeshUniforms), MESH_CAPACITY, PER_MESH_UNIFORMS_MERGE_GAP)
+	, m_perMeshUniformSlotsDirty(sizeof(PerMeshUniforms), MESH_CAPACITY, PER_MESH_UNIFORMS_MERGE_GAP)
+	, m_autoTuner(AUTOTUNE_WARMUP_FRAMES, AUTOTUNE_MEASURED_FRAMES)
+	, m_autoTunePending(false)
+	, m_autoTuneLoaded(false)
+	, m_autoTuneSavedPerMeshUniforms(true)
+	, m_autoTuneSavedDrawCallsPerState(1)
 {
 #ifdef USE_IMGUI
 	ui::initialize(ui::Options().fboRender(false));//ui::initialize();
@@ -162,7 +488,11 @@ BindlessApp::BindlessApp() :
 	mParams->addParam("Set vertex format for each mesh", &Mesh::m_setVertexFormatOnEveryDrawCall);
 	mParams->addParam("Use heavy vertex format", &Mesh::m_useHeavyVertexFormat);
 	mParams->addParam("Use bindless textures", &m_useBindlessTextures);
+	mParams->addParam("Use GL state cache", &m_useStateCache);
+	mParams->addParam("Animate transforms", &m_animateTransforms);
+	mParams->addButton("Rebuild a random building", [this]() { rebuildRandomBuilding(); });
 	mParams->addParam("Draw calls per state", &Mesh::m_drawCallsPerState).min(1).max(20);
+	mParams->addParam("Extra views", &m_extraViews).min(0).max(VIEW_COUNT_MAX - 1);
 #endif //USE_IMGUI
 
 	// Set up camera 
@@ -207,23 +537,53 @@ void BindlessApp::initRendering() {
 	if (!gl::isExtensionAvailable("GL_NV_bindless_texture")) return;
 
 
+	// Route the per frame GL calls of the meshes through the same state cache as ours
+	Mesh::m_gl = m_gl;
+
+	// *** INTERESTING ***
+	// Geometry, uniform and texture data goes through the upload queue, so a burst of new meshes or
+	// textures is spread over several frames instead of stalling one
+	glGenBuffers(1, &m_uploadStaging);
+	m_uploads.reset(new UploadQueue(*m_gl, m_uploadStaging, UPLOAD_BUDGET_BYTES, UPLOAD_BUDGET_SECONDS));
+	Mesh::m_uploads = m_uploads.get();
+	m_uploads->setFrameArena(&m_frameArena);
+	m_glObjects.reset(new GLObjectQueue(m_glObjectBackend, GL_OBJECT_BATCH_SIZE));
+	Mesh::m_objects = m_glObjects.get();
+	m_geometryCache.reset(new GeometryCache(m_uploads.get(), m_glObjects.get()));
+	Mesh::m_geometryCache = m_geometryCache.get();
+
+	// Worker threads for the frame graph, and for loading work (mesh import, texture compression) before it
+	m_jobs.reset(new JobSystem());
+
 	// Create our pixel and vertex shader
-	auto loadGlslProg = [&](const gl::GlslProg::Format& format) -> gl::GlslProgRef
-	{
-		const string names = format.getVertexPath().string() + " + " + format.getFragmentPath().string();
-		gl::GlslProgRef glslProg;
-		try {
-			glslProg = gl::GlslProg::create(format);
-		}
-		catch (const Exception& ex) {
-			//	CI_LOG_EXCEPTION(names, ex);
-			ci::app::console() << "CI_LOG_EXCEPTION" << names << &ex << std::endl;
-			quit();
-		}
-		return glslProg;
-	};
-	m_shader = loadGlslProg(gl::GlslProg::Format().vertex(loadAsset("shaders/simple_vertex.glsl")).fragment(loadAsset("shaders/simple_fragment.glsl")));
-	m_bindlessPerMeshUniformsPtrAttribLocation = m_shader->getAttribLocation("bindlessPerMeshUniformsPtr");//, true);
+	// *** INTERESTING ***
+	// Linked programs are cached on disk per driver (GL_RENDERER + GL_VERSION), so later launches skip the GLSL compiler
+	fs::path shaderCacheDir = getAppPath() / "shader_cache";
+	try {
+		fs::create_directories(shaderCacheDir);
+	}
+	catch (const std::exception&) {
+		shaderCacheDir.clear();
+	}
+	m_driverIdentity = string((const char*)glGetString(GL_RENDERER)) + "|" + string((const char*)glGetString(GL_VERSION));
+	m_programCache.reset(new ProgramBinaryCache(shaderCacheDir.string(), m_driverIdentity));
+
+	// *** INTERESTING ***
+	// The bindless uniform/texture toggles select a specialized program instead of branching in the shaders.
+	// The variant for the current toggles is built now, the others are warmed in update().
+	m_shaderVariants.reset(new ShaderVariants(*m_programCache, loadString(loadAsset("shaders/simple_vertex.glsl")), loadString(loadAsset("shaders/simple_fragment.glsl"))));
+	for (ShaderVariants::Key key = 0; key < ShaderVariants::KeyCount; key++) m_shaderVariantNames[key] = ShaderVariants::getName(key);
+	m_shaderKey = ShaderVariants::makeKey(m_useBindlessUniforms, m_useBindlessTextures);
+	const GLuint program = m_shaderVariants->getProgram(m_shaderKey);
+	const GLuint bindlessUniformsProgram = m_shaderVariants->getProgram(ShaderVariants::makeKey(true, m_useBindlessTextures));
+	if (program == 0 || bindlessUniformsProgram == 0) {
+		ci::app::console() << "failed to create program shaders/simple_vertex.glsl + shaders/simple_fragment.glsl" << std::endl;
+		quit();
+		return;
+	}
+	ci::app::console() << "programs: " << m_programCache->getCounters().m_hits << " loaded from binary cache, " << m_programCache->getCounters().m_misses << " compiled from source" << std::endl;
+	// Only the bindless uniform variants read the attribute; its location is fixed by the layout qualifier
+	m_bindlessPerMeshUniformsPtrAttribLocation = glGetAttribLocation(bindlessUniformsProgram, "bindlessPerMeshUniformsPtr");
 	//LOGI("m_bindlessPerMeshUniformsPtrAttribLocation = %d", m_bindlessPerMeshUniformsPtrAttribLocation);
 	ci::app::console() << "m_bindlessPerMeshUniformsPtrAttribLocation = " << m_bindlessPerMeshUniformsPtrAttribLocation << std::endl;
 
@@ -231,73 +591,830 @@ void BindlessApp::initRendering() {
 	//m_transformer->setRotationVec(ci::vec3(30.0f * (3.14f / 180.0f), 30.0f * (3.14f / 180.0f), 0.0f));
 
 	// Create the meshes
-	m_meshes.resize(1 + SQRT_BUILDING_COUNT * SQRT_BUILDING_COUNT);
-	//m_vbo_meshes.resize(1 + SQRT_BUILDING_COUNT * SQRT_BUILDING_COUNT);
-	m_perMeshUniformsData.resize(m_meshes.size());
+	// Uniform and transform data is sized for every slot the registry can hand out, so meshes added later
+	// never move the GPU buffers
+	m_perMeshUniformsData.resize(m_meshes.getCapacity());
+
+	// --stream-city builds a city of STREAMED_CITY_SIZE^2 buildings, more than the registry holds, and streams
+	// its tiles in around the camera; the buildings keep the spacing of the fixed grid
+	const vector<string>& args = getCommandLineArgs();
+	const bool streamCity = std::find(args.begin(), args.end(), "--stream-city") != args.end();
+	m_cityGridSize = streamCity ? STREAMED_CITY_SIZE : SQRT_BUILDING_COUNT;
+	const float citySize = 5.0f * (float)m_cityGridSize / (float)SQRT_BUILDING_COUNT;
 
 	// Create a mesh for the ground
-	createGround(m_meshes[0], ci::vec3(0.f, -.001f, 0.f), ci::vec3(5.0f, 0.0f, 5.0f));
+	m_groundHandle = m_meshes.insert();
+	createGround(*m_meshes.get(m_groundHandle), ci::vec3(0.f, -.001f, 0.f), ci::vec3(citySize, 0.0f, citySize));
 	//m_vbo_meshes[0] = ci::gl::VboMesh::create(ci::geom::Plane().size(vec2(5.f,5.f)) );
 	// Create "building" meshes
-	int32_t meshIndex = 0;
-	for (int32_t i = 0; i < SQRT_BUILDING_COUNT; i++)
+	m_buildingHandles.assign(m_cityGridSize * m_cityGridSize, MeshRegistry::InvalidHandle);
+	for (int32_t i = 0; i < SQRT_BUILDING_COUNT && !streamCity; i++)
 	{
 		for (int32_t k = 0; k < SQRT_BUILDING_COUNT; k++)
 		{
-			float x, y, z;
-			float size;
+			placeBuilding(i, k, 0.2f + .1f * sin(5.0f * (float)(i * k)));
+		}
+	}
 
-			x = float(i) / (float)SQRT_BUILDING_COUNT - 0.5f;
-			y = 0.0f;
-			z = float(k) / (float)SQRT_BUILDING_COUNT - 0.5f;
-			size = .025f * (100.0f / (float)SQRT_BUILDING_COUNT);
+	// *** INTERESTING ***
+	// One transform node per mesh slot under a common city node. The buildings keep their world space vertices,
+	// so the model matrices start out as identity; moving a mesh is then a matrix write, not a VBO rebuild.
+	m_cityNode = m_transforms.createNode();
+	m_meshNodes.resize(m_meshes.getCapacity());
+	for (size_t i = 0; i < m_meshNodes.size(); i++) {
+		m_meshNodes[i] = m_transforms.createNode(m_cityNode);
+	}
 
-			createBuilding(m_meshes[meshIndex + 1], ci::vec3(5.0f * x, y, 5.0f * z),
-				ci::vec3(size, 0.2f + .1f * sin(5.0f * (float)(i * k)), size), ci::vec2(float(k) / (float)SQRT_BUILDING_COUNT, float(i) / (float)SQRT_BUILDING_COUNT));
-			//ci::gl::VertBatchRef vBatch = ci::gl::VertBatch::create(GL_TRIANGLES, false);
-			//m_vbo_meshes[meshIndex + 1] = ci::gl::VboMesh::create( ci::geom::Cube().size(ci::vec3(size, 0.2f + .1f * sin(5.0f * (float)(i * k)), size)) );
-			//m_vbo_meshes[meshIndex + 1]->getVertexArrayVbos()[0]->
-			meshIndex++;
-		}
+	// --import-mesh <file.obj|file.glb> adds a model to the city
+	vector<string>::const_iterator importPath = std::find(args.begin(), args.end(), "--import-mesh");
+	memset(&m_importStats, 0, sizeof(m_importStats));
+	if (importPath != args.end() && importPath + 1 != args.end()) importMeshes(*(importPath + 1));
+	m_transforms.update();
+	m_transforms.clearChangedRange();
+
+	glGenBuffers(1, &m_modelMatrices);
+	glNamedBufferDataEXT(m_modelMatrices, m_transforms.getNodeCount() * TransformHierarchy::MatrixBytes, m_transforms.getWorldMatrices(), GL_DYNAMIC_DRAW);
+	glGetNamedBufferParameterui64vNV(m_modelMatrices, GL_BUFFER_GPU_ADDRESS_NV, &m_modelMatricesGPUPtr);
+	glMakeNamedBufferResidentNV(m_modelMatrices, GL_READ_ONLY);
+	MemoryTracker::track(MemoryTracker::SubsystemTransforms, MemoryTracker::KindBuffer, m_modelMatrices, m_transforms.getNodeCount() * TransformHierarchy::MatrixBytes);
+	MemoryTracker::setResident(MemoryTracker::KindBuffer, m_modelMatrices, true);
+
+	// The nodes never change, so they are set once here rather than in updatePerMeshUniforms()
+	for (size_t i = 0; i < m_meshNodes.size(); i++) {
+		m_perMeshUniformsData[i].model = m_meshNodes[i];
 	}
+	m_nextPerMeshUniformsData = m_perMeshUniformsData;
 
 	// Initialize Bindless Textures
 	InitBindlessTextures();
+	initMaterials();
 
-	// create Uniform Buffer Object (UBO) for transform data and initialize 
+	// Range offsets must be multiples of the driver's GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	GLint uniformOffsetAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformOffsetAlignment);
+
+	// create Uniform Buffer Object (UBO) for transform data and initialize; each view binds its own slot
+	memset(m_transformUniformsData, 0, sizeof(m_transformUniformsData));
+	m_transformUniformsLayout = UniformSlotLayout(sizeof(TransformUniforms), (size_t)uniformOffsetAlignment, VIEW_COUNT_MAX);
+	m_transformUniformsPadded.assign(m_transformUniformsLayout.getBufferBytes(), 0);
 	glGenBuffers(1, &m_transformUniforms);
-	glNamedBufferDataEXT(m_transformUniforms, sizeof(TransformUniforms), &m_transformUniforms, GL_STREAM_DRAW);
+	glNamedBufferDataEXT(m_transformUniforms, m_transformUniformsLayout.getBufferBytes(), nullptr, GL_STREAM_DRAW);
+	MemoryTracker::track(MemoryTracker::SubsystemUniforms, MemoryTracker::KindBuffer, m_transformUniforms, m_transformUniformsLayout.getBufferBytes());
 
 	// create Uniform Buffer Object (UBO) for param data and initialize
 	glGenBuffers(1, &m_perMeshUniforms);
+	glNamedBufferDataEXT(m_perMeshUniforms, m_perMeshUniformsData.size() * sizeof(m_perMeshUniformsData[0]), nullptr, GL_DYNAMIC_DRAW);
+
+	// *** INTERESTING ***
+	// Get the GPU pointer for the per mesh uniform buffer and make the buffer resident on the GPU
+	// For bindless uniforms, this GPU pointer will later be passed to the vertex shader via a
+	// vertex attribute. The vertex shader will then directly use the GPU pointer to access the
+	// uniform data. The storage is allocated once and updated through the upload queue, so the
+	// pointer stays valid.
+	glGetNamedBufferParameterui64vNV(m_perMeshUniforms, GL_BUFFER_GPU_ADDRESS_NV, &m_perMeshUniformsGPUPtr);
+	glMakeNamedBufferResidentNV(m_perMeshUniforms, GL_READ_ONLY);
+	MemoryTracker::track(MemoryTracker::SubsystemUniforms, MemoryTracker::KindBuffer, m_perMeshUniforms, m_perMeshUniformsData.size() * sizeof(m_perMeshUniformsData[0]));
+	MemoryTracker::setResident(MemoryTracker::KindBuffer, m_perMeshUniforms, true);
+	MemoryTracker::track(MemoryTracker::SubsystemUniforms, &m_perMeshUniformsData[0], m_perMeshUniformsData.capacity() * sizeof(m_perMeshUniformsData[0]));
+	MemoryTracker::track(MemoryTracker::SubsystemUniforms, &m_nextPerMeshUniformsData[0], m_nextPerMeshUniformsData.capacity() * sizeof(m_nextPerMeshUniformsData[0]));
+
+	// *** INTERESTING ***
+	// Without bindless uniforms each draw binds its mesh's entry with glBindBufferRange instead of
+	// copying it over a single shared entry. Range offsets must be multiples of the driver's
+	// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, so this buffer holds the entries at that stride.
+	m_perMeshUniformSlotLayout = UniformSlotLayout(sizeof(PerMeshUniforms), (size_t)uniformOffsetAlignment, (uint32_t)m_perMeshUniformsData.size());
+	m_perMeshUniformSlotData.assign(m_perMeshUniformSlotLayout.getBufferBytes(), 0);
+	glGenBuffers(1, &m_perMeshUniformSlots);
+	glNamedBufferDataEXT(m_perMeshUniformSlots, m_perMeshUniformSlotLayout.getBufferBytes(), nullptr, GL_DYNAMIC_DRAW);
+	MemoryTracker::track(MemoryTracker::SubsystemUniforms, MemoryTracker::KindBuffer, m_perMeshUniformSlots, m_perMeshUniformSlotLayout.getBufferBytes());
+	MemoryTracker::track(MemoryTracker::SubsystemUniforms, &m_perMeshUniformSlotData[0], m_perMeshUniformSlotData.capacity());
 
 	// Initialize the per mesh Uniforms
 	updatePerMeshUniforms(0.0f);
 
+	// The draw lists never outgrow the registry, so resizing them per frame does not allocate
+	m_drawList.reserve(m_meshes.getCapacity());
+	m_nextDrawList.reserve(m_meshes.getCapacity());
+	m_worldBounds.reserve(m_meshes.getCapacity());
+	m_viewMasks.reserve(m_meshes.getCapacity());
+	for (uint32_t v = 0; v < VIEW_COUNT_MAX; v++) {
+		m_viewItems[v].resize(m_meshes.getCapacity());
+		m_viewItemCounts[v] = 0;
+	}
+	m_frameGraph.reset(new TaskGraph(*m_jobs));
+	m_drawListTask = buildFrameGraph(*m_frameGraph);
+
+	if (streamCity) {
+		fs::path tileDir = getAppPath() / "city_tiles";
+		try {
+			fs::create_directories(tileDir);
+		}
+		catch (const std::exception&) {
+		}
+		m_cityTileDir = tileDir.string();
+		bakeCityTiles(m_cityTileDir);
+
+		// Cells are centered on their building, so the grid starts half a cell before the first one
+		const float pitch = 5.0f / (float)SQRT_BUILDING_COUNT;
+		const float origin = -0.5f * citySize - 0.5f * pitch;
+		const int32_t tiles = m_cityGridSize / CITY_TILE_SIZE;
+		m_cityStreamer.reset(new CityStreamer(*this, tiles, tiles, CITY_TILE_SIZE * pitch, origin, origin, CITY_STREAMING_BUDGET_BYTES, true));
+		m_cityStreamer->setRadii(CITY_VISIBLE_RADIUS, CITY_PREFETCH_RADIUS);
+		m_cityStreamer->setLookAhead(CITY_PREFETCH_LOOK_AHEAD);
+	}
+
+	initTraceOptions();
+
+	// *** INTERESTING ***
+	// Which submission path is fastest depends on the driver, so it is measured rather than assumed.
+	// A stored profile for this GL_RENDERER/GL_VERSION is applied as is; otherwise draw() runs the sweep.
+	m_autoTuneProfilePath = (getAppPath() / "autotune_profile.txt").string();
+	AutoTuner::Config tuned;
+	if (std::find(args.begin(), args.end(), "--no-autotune") == args.end() && !m_replayer && m_capturePath.empty()) {
+		m_autoTuneLoaded = std::find(args.begin(), args.end(), "--autotune") == args.end() && AutoTuner::loadProfile(m_autoTuneProfilePath, m_driverIdentity, tuned);
+		if (m_autoTuneLoaded) {
+			applyTuning(tuned);
+			console() << "auto-tune profile: " << AutoTuner::describe(tuned) << endl;
+		}
+		m_autoTunePending = !m_autoTuneLoaded;
+	}
+
+	// --cpu-benchmark [--benchmark-out <file>] times the CPU side hot paths in isolation
+	if (std::find(args.begin(), args.end(), "--cpu-benchmark") != args.end()) {
+		vector<string>::const_iterator out = std::find(args.begin(), args.end(), "--benchmark-out");
+		runCpuBenchmarks((out != args.end() && out + 1 != args.end()) ? *(out + 1) : (getAppPath() / "cpu_benchmark.json").string());
+	}
+
 	//CHECK_GL_ERROR();
 }
 
 
-void BindlessApp::InitBindlessTextures()
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::initTraceOptions()
+//
+//    --capture-trace <file> records the GL calls of the first frames after the
+//    startup uploads (--capture-frames N, default CAPTURE_FRAME_COUNT) and
+//    writes them with a snapshot of the buffers they use.
+//    --replay-trace <file> loads such a trace and draws it instead of the
+//    scene, reporting the replay rate in the UI. A trace with GPU pointers in
+//    its buffers is only replayed into a stand-in backend, never drawn.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::initTraceOptions()
+{
+	const vector<string>& args = getCommandLineArgs();
+	std::string replayPath;
+	for (size_t i = 0; i + 1 < args.size(); ++i) {
+		if (args[i] == "--capture-trace") m_capturePath = args[i + 1];
+		if (args[i] == "--capture-frames") m_captureFrames = (uint32_t)std::max(1, atoi(args[i + 1].c_str()));
+		if (args[i] == "--replay-trace") replayPath = args[i + 1];
+	}
+	memset(&m_replayStats, 0, sizeof(m_replayStats));
+	if (replayPath.empty()) return;
+
+	if (!m_replayTrace.read(replayPath)) {
+		console() << "failed to read GL trace " << replayPath << endl;
+		return;
+	}
+
+	// Without a driver first: the cost of decoding and dispatching the calls alone
+	RecordingGLBackend recording;
+	recording.setRecordData(false);
+	GLTraceReplayer offline(m_replayTrace);
+	const GLTraceReplayer::Stats offlineStats = offline.replay(recording, 10);
+	console() << "GL trace " << replayPath << ": " << m_replayTrace.m_frames.size() << " frames, " << m_replayTrace.getCallCount() << " calls, "
+		<< m_replayTrace.m_buffers.size() << " buffers; replays at " << offlineStats.m_callsPerSecond / 1.0e6 << " M calls/sec without a driver" << endl;
+
+	// *** INTERESTING ***
+	// The snapshot buffers are recreated here; the replayer maps the captured names and GPU addresses onto the new ones,
+	// including the pointers writeCapture() declared in the transform uniforms. Any other GPU pointer inside the buffers
+	// cannot be mapped, and the shaders would dereference it, so such a trace is only replayed into the stand-in.
+	m_replayer.reset(new GLTraceReplayer(m_replayTrace));
+	m_replayStandIn.setRecordData(false);
+	if (!m_replayer->createBuffers())
+		console() << "GL trace " << replayPath << " holds GPU pointers of the capturing process; replaying it without a driver" << endl;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::runCpuBenchmarks()
+//
+//    Times the CPU kernels of scene creation and the per frame path on the
+//    live scene, one suite per subsystem (the benchmark*() methods below, run
+//    in the order they are registered). Inputs come from a fixed seed, the
+//    results are printed and written as JSON to outputPath.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::runCpuBenchmarks(const std::string& outputPath)
+{
+	Benchmark bench;
+
+	bench.addSuite("mesh_generation", [this](Benchmark& b) { benchmarkMeshGeneration(b); });
+	bench.addSuite("geometry_cache", [this](Benchmark& b) { benchmarkGeometryCache(b); });
+	bench.addSuite("mesh_import", [this](Benchmark& b) { benchmarkMeshImport(b); });
+	bench.addSuite("per_mesh_uniforms", [this](Benchmark& b) { benchmarkPerMeshUniforms(b); });
+	bench.addSuite("frame_graph", [this](Benchmark& b) { benchmarkFrameGraph(b); });
+	bench.addSuite("frame_arena", [this](Benchmark& b) { benchmarkFrameArena(b); });
+	bench.addSuite("textures", [this](Benchmark& b) { benchmarkTextures(b); });
+	bench.addSuite("city_streaming", [this](Benchmark& b) { benchmarkCityStreaming(b); });
+	bench.addSuite("geometry_codec", [this](Benchmark& b) { benchmarkGeometryCodec(b); });
+	bench.addSuite("material_table", [this](Benchmark& b) { benchmarkMaterialTable(b); });
+	bench.addSuite("view_culling", [this](Benchmark& b) { benchmarkViewCulling(b); });
+	bench.addSuite("gl_objects", [this](Benchmark& b) { benchmarkGLObjects(b); });
+	bench.addSuite("memory", [this](Benchmark& b) { benchmarkMemory(b); });
+	bench.runSuites();
+
+	bench.print();
+	if (bench.write(outputPath))
+		console() << "benchmark results written to " << outputPath << endl;
+	else
+		console() << "failed to write benchmark results to " << outputPath << endl;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkMeshGeneration()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkMeshGeneration(Benchmark& bench)
+{
+	// Vertex constructor: position copy and float to RGBA8 color packing
+	const size_t vertexCount = 4096;
+	std::vector<float> inputs(vertexCount * 7);
+	srand(bench.getSeed());
+	for (size_t i = 0; i < inputs.size(); ++i) inputs[i] = float(rand() % 1024) / 1023.0f;
+	std::vector<Vertex> vertices;
+	std::vector<uint16_t> indices;
+	vertices.reserve(vertexCount);
+	bench.run("vertex_construct", vertexCount, "vertices", [&]() {
+		vertices.clear();
+		for (size_t i = 0; i < vertexCount; ++i) {
+			const float* v = &inputs[i * 7];
+			vertices.push_back(Vertex(v[0], v[1], v[2], v[3], v[4], v[5], v[6]));
+		}
+		Benchmark::consume(vertices.back().m_color[0]);
+	});
+
+	// Mesh generation without the GL side of Mesh::update()
+	bench.run("create_building", 1, "meshes", [&]() {
+		generateBuilding(ci::vec3(0.5f, 0.0f, -0.5f), ci::vec3(0.025f, 0.25f, 0.025f), vertices, indices);
+		Benchmark::consume(vertices.size() + indices.size());
+	});
+	bench.run("create_ground", 1, "meshes", [&]() {
+		generateGround(ci::vec3(0.f, -.001f, 0.f), ci::vec3(5.0f, 0.0f, 5.0f), vertices, indices);
+		Benchmark::consume(vertices.size() + indices.size());
+	});
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkGeometryCache()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkGeometryCache(Benchmark& bench)
+{
+	// Content hash the geometry cache computes for every vertex and index buffer
+	std::vector<uint8_t> geometryBytes(1024 * 1024);
+	srand(bench.getSeed());
+	for (size_t i = 0; i < geometryBytes.size(); ++i) geometryBytes[i] = (uint8_t)rand();
+	bench.run("geometry_hash", geometryBytes.size(), "bytes", [&]() {
+		Benchmark::consume(GeometryCache::hash(&geometryBytes[0], geometryBytes.size()));
+	});
+	if (m_geometryCache) {
+		const GeometryCache::Counters& geometry = m_geometryCache->getCounters();
+		bench.addMetric("geometry_cache.hit_rate", m_geometryCache->getHitRate());
+		bench.addMetric("geometry_cache.bytes_saved", (double)m_geometryCache->getBytesSaved());
+		bench.addMetric("geometry_cache.entries", geometry.m_entries);
+		bench.addMetric("geometry_cache.collisions", (double)geometry.m_collisions);
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkMeshImport()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkMeshImport(Benchmark& bench)
+{
+	// Importer throughput on generated files of a few MB, mapping and welding included
+	MeshImporter importer(*m_jobs);
+	std::vector<MeshImporter::Part> parts;
+	const char* importFormats[] = { "obj", "glb" };
+	for (size_t f = 0; f < sizeof(importFormats) / sizeof(importFormats[0]); ++f) {
+		const std::string importPath = (getAppPath() / (std::string("import_benchmark.") + importFormats[f])).string();
+		if (!MeshImporter::writeTestFile(importPath, 512) || !importer.load(importPath, parts)) continue;
+		bench.run((std::string("import_") + importFormats[f]).c_str(), importer.getStats().m_fileBytes, "bytes", [&]() {
+			importer.load(importPath, parts);
+			Benchmark::consume(parts.size());
+		});
+		bench.addMetric(std::string("import_") + importFormats[f] + ".parts", importer.getStats().m_parts);
+		bench.addMetric(std::string("import_") + importFormats[f] + ".triangles", (double)importer.getStats().m_triangles);
+		std::remove(importPath.c_str());
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkPerMeshUniforms()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkPerMeshUniforms(Benchmark& bench)
+{
+	// Per mesh uniforms for every building, as updatePerMeshUniforms() computes them each frame
+	const bool usePerMeshUniforms = m_usePerMeshUniforms;
+	m_usePerMeshUniforms = true;
+	bench.run("update_per_mesh_uniforms", m_meshes.size(), "meshes", [&]() { computePerMeshUniforms(1.0f); });
+
+	// Comparing the packed uniforms against what the GPU holds, with nothing changed; and the bytes a frame
+	// uploads with every building animated and with one row of them, against a full upload of the unpacked 32 byte layout
+	bench.run("per_mesh_uniforms_diff", m_meshes.size(), "meshes", [&]() {
+		Benchmark::consume(m_perMeshUniformsDirty.update(&m_perMeshUniformsData[0], 0, (uint32_t)m_perMeshUniformsData.size()).size());
+	});
+	computePerMeshUniforms(2.0f);
+	m_perMeshUniformsDirty.update(&m_perMeshUniformsData[0], 0, (uint32_t)m_perMeshUniformsData.size());
+	bench.addMetric("per_mesh_uniforms.animated_upload_bytes", (double)m_perMeshUniformsDirty.getStats().m_uploadedBytes);
+	computePerMeshUniforms(3.0f, m_usePerMeshUniforms, m_perMeshUniformsData, 0, 1);
+	m_perMeshUniformsDirty.update(&m_perMeshUniformsData[0], 0, (uint32_t)m_perMeshUniformsData.size());
+	bench.addMetric("per_mesh_uniforms.one_row_upload_bytes", (double)m_perMeshUniformsDirty.getStats().m_uploadedBytes);
+	bench.addMetric("per_mesh_uniforms.one_row_upload_runs", m_perMeshUniformsDirty.getStats().m_ranges);
+	bench.addMetric("per_mesh_uniforms.unpacked_full_upload_bytes", (double)m_meshes.getCapacity() * 32.0);
+	// The GPU copy was not updated by the above
+	m_perMeshUniformsDirty.invalidateAll();
+
+	// Spreading every mesh's uniforms out to their bind offsets, as the UBO path does for a fully animated frame
+	bench.run("per_mesh_uniform_slots_scatter", m_meshes.size(), "meshes", [&]() {
+		m_perMeshUniformSlotLayout.scatter(&m_perMeshUniformsData[0], 0, (uint32_t)m_perMeshUniformsData.size(), &m_perMeshUniformSlotData[0]);
+		Benchmark::consume(m_perMeshUniformSlotData[0]);
+	});
+	bench.addMetric("per_mesh_uniforms.slot_stride_bytes", (double)m_perMeshUniformSlotLayout.getStride());
+	bench.addMetric("per_mesh_uniforms.slot_buffer_bytes", (double)m_perMeshUniformSlotLayout.getBufferBytes());
+	m_usePerMeshUniforms = usePerMeshUniforms;
+
+	// The GPU pointer computation and split of the bindless uniform draw loop
+	bench.run("per_mesh_pointer_math", m_meshes.size(), "meshes", [&]() {
+		uint64_t sum = 0;
+		for (uint32_t i = 0; i < m_meshes.size(); i++) {
+			const GLuint64EXT perMeshUniformsGPUPtr = m_perMeshUniformsGPUPtr + sizeof(m_perMeshUniformsData[0]) * m_meshes.getSlot(i);
+			sum += (uint32_t)(perMeshUniformsGPUPtr & 0xFFFFFFFF) ^ (uint32_t)((perMeshUniformsGPUPtr >> 32) & 0xFFFFFFFF);
+		}
+		Benchmark::consume(sum);
+	});
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkFrameGraph()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkFrameGraph(Benchmark& bench)
+{
+	// The frame graph on a growing number of threads. Each run has to produce the same uniforms and draw list
+	// as the single threaded one, whatever order the jobs ran in.
+	if (m_frameGraph) {
+		const uint32_t threadCounts[] = { 1, 2, 4, 8, std::max(1u, std::thread::hardware_concurrency()) };
+		std::vector<PerMeshUniforms> referenceUniforms;
+		std::vector<DrawItem> referenceDrawList;
+		bool deterministic = true;
+		m_nextT = 1.0f;
+		m_nextUsePerMeshUniforms = m_usePerMeshUniforms;
+		m_nextAnimateTransforms = false;
+		m_nextDrawList.resize(m_meshes.size());
+		for (size_t c = 0; c < sizeof(threadCounts) / sizeof(threadCounts[0]); ++c) {
+			JobSystem jobs(threadCounts[c]);
+			TaskGraph graph(jobs);
+			buildFrameGraph(graph);
+			bench.run(("frame_graph_" + ci::toString(threadCounts[c]) + "_threads").c_str(), m_meshes.size(), "meshes", [&]() {
+				graph.run();
+				Benchmark::consume(m_nextDrawList.back().slot);
+			});
+			if (c == 0) {
+				referenceUniforms = m_nextPerMeshUniformsData;
+				referenceDrawList = m_nextDrawList;
+			}
+			else {
+				deterministic = deterministic
+					&& memcmp(&referenceUniforms[0], &m_nextPerMeshUniformsData[0], referenceUniforms.size() * sizeof(PerMeshUniforms)) == 0
+					&& memcmp(&referenceDrawList[0], &m_nextDrawList[0], referenceDrawList.size() * sizeof(DrawItem)) == 0;
+			}
+		}
+		bench.addMetric("frame_graph.deterministic", deterministic ? 1.0 : 0.0);
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkFrameArena()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkFrameArena(Benchmark& bench)
+{
+	// Frame arena against the heap for a draw list sized scratch vector
+	bench.run("frame_arena_vector", m_meshes.size(), "items", [&]() {
+		m_frameArena.beginFrame();
+		FrameVector<uint32_t> list((FrameAllocator<uint32_t>(m_frameArena)));
+		list.reserve(m_meshes.size());
+		for (uint32_t i = 0; i < m_meshes.size(); i++) list.push_back(i);
+		Benchmark::consume(list.back());
+	});
+	bench.run("heap_vector", m_meshes.size(), "items", [&]() {
+		std::vector<uint32_t> list;
+		list.reserve(m_meshes.size());
+		for (uint32_t i = 0; i < m_meshes.size(); i++) list.push_back(i);
+		Benchmark::consume(list.back());
+	});
+
+	// Heap allocations of the steady state frame path: uniform upload through the queue and the UI strings
+	// (counted only when FrameArena.cpp is built with FRAME_ARENA_COUNT_HEAP)
+	if (m_uploads && FrameArena::isCountingHeapAllocations()) {
+		const uint32_t warmupFrames = 4, measuredFrames = 16;
+		uint64_t heapAllocations = 0;
+		for (uint32_t frame = 0; frame < warmupFrames + measuredFrames; frame++) {
+			if (frame == warmupFrames) heapAllocations = FrameArena::getHeapAllocationCount();
+			m_frameArena.beginFrame();
+			updatePerMeshUniforms(1.0f);
+			m_uploads->drain();
+			Benchmark::consume((uint64_t)m_frameArena.format("GL calls issued: %u", m_glStateCache.getFrameCounters().m_issued)[0]);
+		}
+		bench.addMetric("frame_arena.heap_allocations_per_frame", (double)(FrameArena::getHeapAllocationCount() - heapAllocations) / measuredFrames);
+		bench.addMetric("frame_arena.high_water_bytes", (double)m_frameArena.getStats().m_highWaterBytes);
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkTextures()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkTextures(Benchmark& bench)
+{
+	// Texture file names, and loading the first frames from disk (decode included, no GL)
+	std::vector<std::string> fileNames;
+	bench.run("texture_file_names", TEXTURE_FRAME_COUNT, "names", [&]() {
+		makeTextureFileNames(fileNames);
+		Benchmark::consume(fileNames.size());
+	});
+	const size_t loadCount = 8;
+	std::vector<std::string> paths;
+	for (size_t i = 0; i < loadCount && i < fileNames.size(); ++i) {
+		fs::path assetPath = getAssetPath(fileNames[i]);
+		if (!assetPath.empty()) paths.push_back(assetPath.string());
+	}
+	if (paths.size() == loadCount) {
+		std::vector<TextureCompressor::Image> images(loadCount);
+		uint64_t bytes = 0;
+		for (size_t i = 0; i < loadCount; ++i) {
+			TextureCompressor::loadDds(paths[i], images[i]);
+			bytes += fs::file_size(paths[i]);
+		}
+		bench.run("texture_load", bytes, "bytes", [&]() {
+			for (size_t i = 0; i < loadCount; ++i) TextureCompressor::loadDds(paths[i], images[i]);
+			Benchmark::consume(images[0].m_rgba.size());
+		});
+
+		// Mip chains of the loaded frames (source RGBA bytes/s), and the BC1 compression of the chain on top
+		uint64_t texelBytes = 0;
+		for (size_t i = 0; i < loadCount; ++i) texelBytes += images[i].m_rgba.size();
+		std::vector<MipGenerator::Level> levels;
+		bench.run("mip_chain_box", texelBytes, "bytes", [&]() {
+			for (size_t i = 0; i < loadCount; ++i) MipGenerator::generateChain(&images[i].m_rgba[0], images[i].m_width, images[i].m_height, MipGenerator::FilterBox, MipGenerator::SrgbColor, levels);
+			Benchmark::consume(levels.back().m_rgba[0]);
+		});
+		bench.run("mip_chain_kaiser", texelBytes, "bytes", [&]() {
+			for (size_t i = 0; i < loadCount; ++i) MipGenerator::generateChain(&images[i].m_rgba[0], images[i].m_width, images[i].m_height, MipGenerator::FilterKaiser, MipGenerator::SrgbColor, levels);
+			Benchmark::consume(levels.back().m_rgba[0]);
+		});
+		TextureCompressor::CompressedFrame frame;
+		bench.run("mip_chain_kaiser_bc1", texelBytes, "bytes", [&]() {
+			for (size_t i = 0; i < loadCount; ++i) TextureCompressor::compressMips(images[i], MipGenerator::FilterKaiser, MipGenerator::SrgbColor, frame);
+			Benchmark::consume(frame.m_bc1Mips.size());
+		});
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkCityStreaming()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkCityStreaming(Benchmark& bench)
+{
+	// The streaming policy of the --stream-city city with the camera circling through it. The tiles are
+	// neither read nor drawn; each one reports the memory its buildings would take.
+	struct SimulatedTiles : public TileBackend
+	{
+		bool load(int32_t, int32_t, CityTile&) override { return true; }
+		bool attach(const CityTile&, uint64_t& bytes) override { bytes = CITY_TILE_SIZE * CITY_TILE_SIZE * (24 * sizeof(Vertex) + 36 * sizeof(uint16_t)); return true; }
+		void detach(int32_t, int32_t) override {}
+	} simulatedTiles;
+	const float pitch = 5.0f / (float)SQRT_BUILDING_COUNT;
+	const int32_t streamedTiles = STREAMED_CITY_SIZE / CITY_TILE_SIZE;
+	CityStreamer streamer(simulatedTiles, streamedTiles, streamedTiles, CITY_TILE_SIZE * pitch, -0.5f * pitch * (STREAMED_CITY_SIZE + 1), -0.5f * pitch * (STREAMED_CITY_SIZE + 1),
+		CITY_STREAMING_BUDGET_BYTES, false);
+	streamer.setRadii(CITY_VISIBLE_RADIUS, CITY_PREFETCH_RADIUS);
+	streamer.setLookAhead(CITY_PREFETCH_LOOK_AHEAD);
+	uint32_t streamingStep = 0, maxMissingTiles = 0;
+	bench.run("city_streaming_update", streamedTiles * streamedTiles, "tiles", [&]() {
+		const float angle = 0.002f * (float)streamingStep++;
+		streamer.update(4.0f * cos(angle), 4.0f * sin(angle));
+		maxMissingTiles = std::max(maxMissingTiles, streamingStep > 8 ? streamer.getCounters().m_misses : 0u);
+	});
+	const CityStreamer::Counters& streaming = streamer.getCounters();
+	bench.addMetric("city_streaming.updates", streamingStep);
+	bench.addMetric("city_streaming.reads", streaming.m_reads);
+	bench.addMetric("city_streaming.evictions", streaming.m_evictions);
+	bench.addMetric("city_streaming.cancelled", streaming.m_cancelled);
+	bench.addMetric("city_streaming.max_missing_tiles", maxMissingTiles);
+	bench.addMetric("city_streaming.peak_resident_bytes", (double)streaming.m_peakResidentBytes);
+	bench.addMetric("city_streaming.budget_bytes", (double)CITY_STREAMING_BUDGET_BYTES);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkGeometryCodec()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkGeometryCodec(Benchmark& bench)
+{
+	// The geometry codec on one tile of generated buildings, in the Vertex layout Mesh::update() takes and in
+	// the packed one of the tile files. Throughput counts decoded bytes; the index ratio is against 16 bit indices.
+	const float pitch = 5.0f / (float)SQRT_BUILDING_COUNT;
+	std::vector<Vertex> codecVertices;
+	std::vector<uint32_t> codecIndices;
+	{
+		std::vector<Vertex> vertices;
+		std::vector<uint16_t> indices;
+		srand(1);
+		for (int32_t i = 0; i < CITY_TILE_SIZE; i++) {
+			for (int32_t k = 0; k < CITY_TILE_SIZE; k++) {
+				const float height = 0.2f + .1f * sin(5.0f * (float)(i * k));
+				generateBuilding(ci::vec3(pitch * (float)i, 0.0f, pitch * (float)k), ci::vec3(0.5f * pitch, height, 0.5f * pitch), vertices, indices);
+				for (size_t n = 0; n < indices.size(); n++) codecIndices.push_back((uint32_t)codecVertices.size() + indices[n]);
+				codecVertices.insert(codecVertices.end(), vertices.begin(), vertices.end());
+			}
+		}
+	}
+	std::vector<CityTile::PackedVertex> codecPacked(codecVertices.size());
+	for (size_t v = 0; v < codecVertices.size(); v++) {
+		memcpy(codecPacked[v].m_position, codecVertices[v].m_position, sizeof(codecPacked[v].m_position));
+		memcpy(codecPacked[v].m_color, codecVertices[v].m_color, sizeof(codecPacked[v].m_color));
+	}
+	const uint64_t codecVertexBytes = codecVertices.size() * sizeof(Vertex);
+	const uint64_t codecPackedBytes = codecPacked.size() * sizeof(CityTile::PackedVertex);
+	std::vector<uint8_t> encodedVertices, encodedPacked, encodedIndices;
+	bench.run("geometry_codec_encode_vertices", codecVertexBytes, "bytes", [&]() {
+		GeometryCodec::encodeVertices(&codecVertices[0], codecVertices.size(), sizeof(Vertex), encodedVertices);
+		Benchmark::consume(encodedVertices.size());
+	});
+	GeometryCodec::encodeVertices(&codecPacked[0], codecPacked.size(), sizeof(CityTile::PackedVertex), encodedPacked);
+	GeometryCodec::encodeIndices(&codecIndices[0], codecIndices.size(), encodedIndices);
+	std::vector<Vertex> decodedVertices(codecVertices.size());
+	std::vector<CityTile::PackedVertex> decodedPacked(codecPacked.size());
+	std::vector<uint32_t> decodedIndices(codecIndices.size());
+	bench.run("geometry_codec_decode_vertices", codecVertexBytes, "bytes", [&]() {
+		GeometryCodec::decodeVertices(&encodedVertices[0], encodedVertices.size(), &decodedVertices[0], decodedVertices.size(), sizeof(Vertex));
+		Benchmark::consume(decodedVertices.back().m_color[0]);
+	});
+	bench.run("geometry_codec_decode_packed_vertices", codecPackedBytes, "bytes", [&]() {
+		GeometryCodec::decodeVertices(&encodedPacked[0], encodedPacked.size(), &decodedPacked[0], decodedPacked.size(), sizeof(CityTile::PackedVertex));
+		Benchmark::consume(decodedPacked.back().m_color[0]);
+	});
+	bench.run("geometry_codec_decode_indices", codecIndices.size(), "indices", [&]() {
+		GeometryCodec::decodeIndices(&encodedIndices[0], encodedIndices.size(), &decodedIndices[0], decodedIndices.size());
+		Benchmark::consume(decodedIndices.back());
+	});
+	const bool lossless = memcmp(&decodedVertices[0], &codecVertices[0], codecVertexBytes) == 0 &&
+		memcmp(&decodedPacked[0], &codecPacked[0], codecPackedBytes) == 0 && decodedIndices == codecIndices;
+	bench.addMetric("geometry_codec.lossless", lossless ? 1.0 : 0.0);
+	bench.addMetric("geometry_codec.vertex_ratio", (double)codecVertexBytes / encodedVertices.size());
+	bench.addMetric("geometry_codec.packed_vertex_ratio", (double)codecPackedBytes / encodedPacked.size());
+	bench.addMetric("geometry_codec.index_ratio", (double)(codecIndices.size() * sizeof(uint16_t)) / encodedIndices.size());
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkMaterialTable()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkMaterialTable(Benchmark& bench)
+{
+	// The material table's per frame check on a copy: with nothing edited it finds nothing to send, and
+	// shifting every material's phase sends the materials but none of the handles
+	MaterialTable materials = m_materialTable;
+	materials.updateMaterials();
+	materials.updateHandles();
+	bench.run("material_table_unchanged", materials.getMaterialCount(), "materials", [&]() {
+		Benchmark::consume(materials.updateMaterials().size() + materials.updateHandles().size());
+	});
+	bench.addMetric("material_table.unchanged_upload_bytes", (double)(materials.getMaterialStats().m_uploadedBytes + materials.getHandleStats().m_uploadedBytes));
+	bench.run("material_table_shift_phases", materials.getMaterialCount(), "materials", [&]() {
+		for (uint32_t m = 0; m < materials.getMaterialCount(); m++) {
+			MaterialTable::Material material = materials.getMaterial(m);
+			material.m_phase = (material.m_phase + 1) % material.m_frameCount;
+			materials.set(m, material);
+		}
+		Benchmark::consume(materials.updateMaterials().size() + materials.updateHandles().size());
+	});
+	bench.addMetric("material_table.shifted_upload_bytes", (double)(materials.getMaterialStats().m_uploadedBytes + materials.getHandleStats().m_uploadedBytes));
+	bench.addMetric("material_table.buffer_bytes", (double)(materials.getMaterialBufferBytes() + materials.getHandleBufferBytes()));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkViewCulling()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkViewCulling(Benchmark& bench)
+{
+	// Culling the city for 1 to VIEW_COUNT_MAX views on one thread: the world bounds once and one pass for all
+	// views, against bounds, culling and lists rebuilt for every view. The difference per added view is what a
+	// view costs on the CPU before its draws.
+	const int32_t extraViews = m_extraViews;
+	m_extraViews = VIEW_COUNT_MAX - 1;
+	setupViews();
+	m_extraViews = extraViews;
+	m_drawList.resize(m_meshes.size());
+	buildDrawList(m_drawList, 0, m_meshes.size());
+	const uint32_t cullCount = (uint32_t)m_drawList.size();
+	m_worldBounds.resize(cullCount);
+	m_viewMasks.resize(cullCount);
+	float viewProjections[VIEW_COUNT_MAX * 16];
+	for (uint32_t v = 0; v < VIEW_COUNT_MAX; v++) getViewProjection(v, &viewProjections[v * 16]);
+	double sharedSeconds[VIEW_COUNT_MAX];
+	uint32_t sharedTests = 0;
+	for (uint32_t n = 1; n <= VIEW_COUNT_MAX && cullCount != 0; n++) {
+		ViewCuller culler;
+		culler.setViews(viewProjections, n);
+		bench.run(("multi_view_cull_" + ci::toString(n) + "_views").c_str(), cullCount, "meshes", [&]() {
+			computeWorldBounds(0, cullCount);
+			sharedTests = culler.cull(&m_worldBounds[0], cullCount, &m_viewMasks[0]);
+			for (uint32_t v = 0; v < n; v++) Benchmark::consume(ViewCuller::compact(&m_viewMasks[0], cullCount, v, &m_viewItems[v][0]));
+		});
+		sharedSeconds[n - 1] = bench.getResults().back().m_median;
+	}
+	if (cullCount != 0) {
+		std::vector<ViewCuller> separate(VIEW_COUNT_MAX);
+		for (uint32_t v = 0; v < VIEW_COUNT_MAX; v++) separate[v].setViews(&viewProjections[v * 16], 1);
+		bench.run(("separate_view_cull_" + ci::toString(VIEW_COUNT_MAX) + "_views").c_str(), cullCount, "meshes", [&]() {
+			for (uint32_t v = 0; v < VIEW_COUNT_MAX; v++) {
+				computeWorldBounds(0, cullCount);
+				separate[v].cull(&m_worldBounds[0], cullCount, &m_viewMasks[0]);
+				Benchmark::consume(ViewCuller::compact(&m_viewMasks[0], cullCount, 0, &m_viewItems[v][0]));
+			}
+		});
+		const double separateSeconds = bench.getResults().back().m_median;
+		bench.addMetric("multi_view.seconds_per_extra_view", (sharedSeconds[VIEW_COUNT_MAX - 1] - sharedSeconds[0]) / (VIEW_COUNT_MAX - 1));
+		bench.addMetric("multi_view.separate_seconds_per_extra_view", (separateSeconds - sharedSeconds[0]) / (VIEW_COUNT_MAX - 1));
+		bench.addMetric("multi_view.frustum_tests_per_mesh", (double)sharedTests / cullCount);
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkGLObjects()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkGLObjects(Benchmark& bench)
+{
+	// Setup and teardown of a full city's mesh buffers: a glGenBuffers and a glDeleteBuffers per buffer, against
+	// names generated in batches and deleted in one call after the fence of the frame that released them
+	const uint32_t objectCount = 2 * MESH_CAPACITY;
+	std::vector<GLuint> objectNames(objectCount);
+	bench.run("gl_buffers_one_at_a_time", objectCount, "buffers", [&]() {
+		for (uint32_t i = 0; i < objectCount; i++) glGenBuffers(1, &objectNames[i]);
+		for (uint32_t i = 0; i < objectCount; i++) glDeleteBuffers(1, &objectNames[i]);
+	});
+	const double oneAtATimeSeconds = bench.getResults().back().m_median;
+	GLObjectQueue::Counters batched = GLObjectQueue::Counters();
+	bench.run("gl_buffers_batched", objectCount, "buffers", [&]() {
+		GLObjectQueue objects(m_glObjectBackend, GL_OBJECT_BATCH_SIZE);
+		for (uint32_t i = 0; i < objectCount; i++) objectNames[i] = objects.create(GLObjectQueue::KindBuffer);
+		for (uint32_t i = 0; i < objectCount; i++) objects.release(GLObjectQueue::KindBuffer, objectNames[i], false);
+		objects.endFrame();
+		objects.finish();
+		batched = objects.getCounters();
+	});
+	bench.addMetric("gl_objects.one_at_a_time_calls", 2.0 * objectCount);
+	bench.addMetric("gl_objects.batched_calls", batched.m_genCalls + batched.m_deleteCalls);
+	bench.addMetric("gl_objects.batched_speedup", oneAtATimeSeconds / bench.getResults().back().m_median);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::benchmarkMemory()
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::benchmarkMemory(Benchmark& bench)
+{
+	// What every subsystem holds on the CPU and GPU after the suites before this one
+	for (int32_t s = 0; s < MemoryTracker::SubsystemCount; s++) {
+		const MemoryTracker::Counters memory = MemoryTracker::getCounters((MemoryTracker::Subsystem)s);
+		const std::string prefix = std::string("memory.") + MemoryTracker::getName((MemoryTracker::Subsystem)s);
+		bench.addMetric(prefix + ".gpu_bytes", (double)memory.m_gpuBytes);
+		bench.addMetric(prefix + ".gpu_peak_bytes", (double)memory.m_gpuPeakBytes);
+		bench.addMetric(prefix + ".cpu_bytes", (double)memory.m_cpuBytes);
+		bench.addMetric(prefix + ".cpu_peak_bytes", (double)memory.m_cpuPeakBytes);
+		bench.addMetric(prefix + ".objects", (double)memory.m_objects);
+		bench.addMetric(prefix + ".resident_handles", (double)memory.m_residentHandles);
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::writeCapture()
+//
+//    Adds the buffers the captured calls read from (contents and GPU address)
+//    to the trace, along with where the transform uniforms hold GPU pointers
+//    so a replay can remap them, and writes it out.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::writeCapture()
+{
+	GLTrace& trace = m_glCapture.getTrace();
+	for (uint32_t i = 0; i < m_meshes.size(); i++) {
+		const Mesh& mesh = m_meshes.getMesh(i);
+		trace.addBuffer(mesh.m_vertexBuffer.get(), mesh.m_vertexBufferGPUPtr);
+		trace.addBuffer(mesh.m_indexBuffer.get(), mesh.m_indexBufferGPUPtr);
+	}
+	trace.addBuffer(m_perMeshUniforms, m_perMeshUniformsGPUPtr);
+	trace.addBuffer(m_perMeshUniformSlots, 0);
+	trace.addBuffer(m_modelMatrices, m_modelMatricesGPUPtr);
+	trace.addBuffer(m_materials, m_materialsGPUPtr);
+	trace.addBuffer(m_textureHandleTable, m_textureHandleTableGPUPtr);
+	trace.addBuffer(m_transformUniforms, 0);
+	trace.addBuffer(m_uploadStaging, 0);
+	for (uint32_t v = 0; v < m_transformUniformsLayout.getCount(); v++) {
+		const uint64_t slot = m_transformUniformsLayout.getOffset(v);
+		trace.addRelocation(m_transformUniforms, slot + offsetof(TransformUniforms, ModelMatrices));
+		trace.addRelocation(m_transformUniforms, slot + offsetof(TransformUniforms, Materials));
+		trace.addRelocation(m_transformUniforms, slot + offsetof(TransformUniforms, TextureHandles));
+	}
+
+	if (trace.write(m_capturePath))
+		console() << "GL trace: " << trace.m_frames.size() << " frames, " << trace.getCallCount() << " calls written to " << m_capturePath << endl;
+	else
+		console() << "failed to write GL trace " << m_capturePath << endl;
+	m_capturePath.clear();
+	trace.clear();
+}
+
+
+void BindlessApp::makeTextureFileNames(std::vector<std::string>& fileNames)
 {
 	char fileName[64] = { "textures/NV" };
 	char Num[16];
-	int i;
 
-	m_textureHandles = new GLuint64[TEXTURE_FRAME_COUNT];
-	m_textureIds = new GLuint[TEXTURE_FRAME_COUNT];
-	m_numTextures = TEXTURE_FRAME_COUNT;
-
-	for (i = 0; i < TEXTURE_FRAME_COUNT; ++i) {
+	fileNames.clear();
+	for (int i = 0; i < TEXTURE_FRAME_COUNT; ++i) {
 		sprintf(Num, "%d", i);
 		fileName[9] = 'N';
 		fileName[10] = 'V';
 		fileName[11] = 0;
 		strcat(fileName, Num);
 		strcat(fileName, ".dds");
+		fileNames.push_back(fileName);
+	}
+}
+
 
+void BindlessApp::InitBindlessTextures()
+{
+	int i;
+	std::vector<std::string> fileNames;
+
+	m_textureHandles = new GLuint64[TEXTURE_FRAME_COUNT];
+	m_displacementTextureHandles = new GLuint64[TEXTURE_FRAME_COUNT];
+	m_textureIds = new GLuint[TEXTURE_FRAME_COUNT];
+	m_numTextures = TEXTURE_FRAME_COUNT;
+	MemoryTracker::track(MemoryTracker::SubsystemTextures, m_textureHandles, sizeof(GLuint64) * TEXTURE_FRAME_COUNT);
+	MemoryTracker::track(MemoryTracker::SubsystemTextures, m_displacementTextureHandles, sizeof(GLuint64) * TEXTURE_FRAME_COUNT);
+	MemoryTracker::track(MemoryTracker::SubsystemTextures, m_textureIds, sizeof(GLuint) * TEXTURE_FRAME_COUNT);
+
+	makeTextureFileNames(fileNames);
+
+#ifdef USE_COMPRESSED_TEXTURES
+	if (InitCompressedTextures(fileNames)) return;
+	ci::app::console() << "falling back to uncompressed textures" << std::endl;
+#endif //USE_COMPRESSED_TEXTURES
+
+	for (i = 0; i < TEXTURE_FRAME_COUNT; ++i) {
 		try {
-			m_textureRefs[i] = ci::gl::Texture2d::createFromDds(ci::app::loadAsset(ci::fs::path(fileName)), gl::Texture2d::Format().internalFormat( GL_RGBA ).wrapS(GL_REPEAT).wrapT(GL_REPEAT).magFilter(GL_NEAREST).minFilter(GL_NEAREST).mipmap(false));
+			m_textureRefs[i] = ci::gl::Texture2d::createFromDds(ci::app::loadAsset(ci::fs::path(fileNames[i])), gl::Texture2d::Format().internalFormat( GL_RGBA ).wrapS(GL_REPEAT).wrapT(GL_REPEAT).magFilter(GL_NEAREST).minFilter(GL_NEAREST).mipmap(false));
 		}
 		catch (ci::Exception& e) {
 			//CI_LOG_EXCEPTION("failed to create texture from DDS file", e);
@@ -306,9 +1423,383 @@ void BindlessApp::InitBindlessTextures()
 		}
 		m_textureIds[i] = m_textureRefs[i]->getId();
 		m_textureRefs[i]->bind(m_textureIds[i]);
+		MemoryTracker::track(MemoryTracker::SubsystemTextures, MemoryTracker::KindTexture, m_textureIds[i], (uint64_t)m_textureRefs[i]->getWidth() * m_textureRefs[i]->getHeight() * 4);
 
+		// *** INTERESTING ***
+		// Residency is left to m_textureResidency, which only keeps the frames around m_currentFrame resident
 		m_textureHandles[i] = glGetTextureHandleNV(m_textureIds[i]);
-		glMakeTextureHandleResidentNV(m_textureHandles[i]);
+		m_displacementTextureHandles[i] = m_textureHandles[i];
+		m_textureResidency.addEntry(&m_textureHandles[i], 1, (uint64_t)m_textureRefs[i]->getWidth() * m_textureRefs[i]->getHeight() * 4);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::InitCompressedTextures()
+//
+//    Bakes the animation frames to BC1 (color, sampled by the fragment shader)
+//    and BC4 (the .g displacement channel, sampled by the vertex shader).
+//    Baked frames are cached next to the app and reused on later launches.
+//    Pass --bc-benchmark on the command line to time the compressor.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool BindlessApp::InitCompressedTextures(const std::vector<std::string>& fileNames)
+{
+	std::vector<std::string> sourcePaths;
+	for (size_t i = 0; i < fileNames.size(); ++i) {
+		fs::path assetPath = getAssetPath(fileNames[i]);
+		if (assetPath.empty()) return false;
+		sourcePaths.push_back(assetPath.string());
+	}
+
+	fs::path cacheDir = getAppPath() / "texture_cache";
+	try {
+		fs::create_directories(cacheDir);
+	}
+	catch (const std::exception&) {
+		cacheDir.clear();
+	}
+
+	TextureCompressor compressor(*m_jobs);
+	std::vector<TextureCompressor::CompressedFrame> frames;
+	if (!compressor.bake(sourcePaths, cacheDir.string(), frames)) return false;
+
+	const TextureCompressor::Stats& stats = compressor.getStats();
+	console() << "BC1/BC4 textures: " << stats.m_frameCount << " frames, " << stats.m_cacheHits << " from cache, "
+		<< stats.m_sourceBytes / 1024 << " KB -> " << stats.m_compressedBytes / 1024 << " KB (" << stats.m_mipBytes / 1024 << " KB mips) in " << stats.m_compressSeconds * 1000.0 << " ms on "
+		<< stats.m_threadCount << " threads" << endl;
+	console() << "BC1 PSNR min/avg " << stats.m_minPsnrBC1 << "/" << stats.m_avgPsnrBC1 << " dB, BC4 PSNR min/avg "
+		<< stats.m_minPsnrBC4 << "/" << stats.m_avgPsnrBC4 << " dB" << endl;
+
+	const vector<string>& args = getCommandLineArgs();
+	if (std::find(args.begin(), args.end(), "--bc-benchmark") != args.end()) {
+		std::vector<TextureCompressor::Image> images(sourcePaths.size());
+		for (size_t i = 0; i < sourcePaths.size(); ++i) TextureCompressor::loadDds(sourcePaths[i], images[i]);
+		compressor.benchmark(images, 10);
+	}
+
+	for (int i = 0; i < TEXTURE_FRAME_COUNT; ++i) {
+		const TextureCompressor::CompressedFrame& frame = frames[i];
+		GLTextureHandle textures[2] = { GLTextureHandle::create(m_glObjects.get()), GLTextureHandle::create(m_glObjects.get()) };
+		const GLuint ids[2] = { textures[0].get(), textures[1].get() };
+
+		// Color: BC1. Storage only; the frames are uploaded through the queue in animation order
+		glCompressedTextureImage2DEXT(ids[0], GL_TEXTURE_2D, 0, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, frame.m_width, frame.m_height, 0, (GLsizei)frame.m_bc1.size(), nullptr);
+		m_uploads->enqueueCompressedTexture(UploadQueue::PriorityNormal, ids[0], 0, frame.m_width, frame.m_height, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, &frame.m_bc1[0], frame.m_bc1.size());
+		// *** INTERESTING ***
+		// The CPU built mip chain follows the base level. The fragment shader picks the level with textureGrad()
+		// from the building's footprint on screen (see TextureFootprint), so zoomed out buildings read a filtered one
+		size_t mipOffset = 0;
+		for (int32_t level = 1; level < frame.m_mipLevels; ++level) {
+			const GLsizei width = MipGenerator::getLevelSize(frame.m_width, level);
+			const GLsizei height = MipGenerator::getLevelSize(frame.m_height, level);
+			const size_t size = TextureCompressor::blockBytes(width, height, 8);
+			glCompressedTextureImage2DEXT(ids[0], GL_TEXTURE_2D, level, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, width, height, 0, (GLsizei)size, nullptr);
+			m_uploads->enqueueCompressedTexture(UploadQueue::PriorityNormal, ids[0], level, width, height, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, &frame.m_bc1Mips[mipOffset], size);
+			mipOffset += size;
+		}
+		// Displacement: BC4 decodes to .r, swizzle it into .g where the vertex shader reads it
+		glCompressedTextureImage2DEXT(ids[1], GL_TEXTURE_2D, 0, GL_COMPRESSED_RED_RGTC1, frame.m_width, frame.m_height, 0, (GLsizei)frame.m_bc4.size(), nullptr);
+		m_uploads->enqueueCompressedTexture(UploadQueue::PriorityNormal, ids[1], 0, frame.m_width, frame.m_height, GL_COMPRESSED_RED_RGTC1, &frame.m_bc4[0], frame.m_bc4.size());
+		glTextureParameteriEXT(ids[1], GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_RED);
+
+		for (int t = 0; t < 2; ++t) {
+			glTextureParameteriEXT(ids[t], GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+			glTextureParameteriEXT(ids[t], GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+			glTextureParameteriEXT(ids[t], GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+		glTextureParameteriEXT(ids[0], GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, frame.m_mipLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST);
+		glTextureParameteriEXT(ids[0], GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, frame.m_mipLevels - 1);
+		glTextureParameteriEXT(ids[1], GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteriEXT(ids[1], GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+		// The handles own the GL textures; Texture2d only wraps them and leaves the deletion to the queue
+		m_textureRefs[i] = gl::Texture2d::create(GL_TEXTURE_2D, ids[0], frame.m_width, frame.m_height, true);
+		m_displacementTextureRefs[i] = gl::Texture2d::create(GL_TEXTURE_2D, ids[1], frame.m_width, frame.m_height, true);
+		m_compressedTextures.push_back(std::move(textures[0]));
+		m_compressedTextures.push_back(std::move(textures[1]));
+		m_textureIds[i] = ids[0];
+		MemoryTracker::track(MemoryTracker::SubsystemTextures, MemoryTracker::KindTexture, ids[0], frame.m_bc1.size() + frame.m_bc1Mips.size());
+		MemoryTracker::track(MemoryTracker::SubsystemTextures, MemoryTracker::KindTexture, ids[1], frame.m_bc4.size());
+
+		// Both handles of a frame share one residency entry
+		m_textureHandles[i] = glGetTextureHandleNV(ids[0]);
+		m_displacementTextureHandles[i] = glGetTextureHandleNV(ids[1]);
+		const GLuint64EXT handles[2] = { m_textureHandles[i], m_displacementTextureHandles[i] };
+		m_textureResidency.addEntry(handles, 2, frame.m_bc1.size() + frame.m_bc1Mips.size() + frame.m_bc4.size());
+	}
+	return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::initMaterials()
+//
+//    The animation frames' handles go into the table once, color then
+//    displacement. Material 0 plays them as the global animation and is what
+//    the ground and imported meshes use; the buildings spread over the rest,
+//    which differ in tint, displacement and phase. There are only
+//    MATERIAL_PHASES phases, since every phase keeps another frame resident.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::initMaterials()
+{
+	m_firstFrameHandle = m_materialTable.addHandles(m_textureHandles, TEXTURE_FRAME_COUNT);
+	const uint32_t firstDisplacement = m_materialTable.addHandles(m_displacementTextureHandles, TEXTURE_FRAME_COUNT);
+	for (uint32_t m = 0; m < MATERIAL_COUNT; m++) {
+		MaterialTable::Material material;
+		memset(&material, 0, sizeof(material));
+		material.m_firstTexture = m_firstFrameHandle;
+		material.m_firstDisplacement = firstDisplacement;
+		material.m_frameCount = TEXTURE_FRAME_COUNT;
+		material.m_phase = (m % MATERIAL_PHASES) * TEXTURE_FRAME_COUNT / MATERIAL_PHASES;
+		material.m_tint = glm::packUnorm4x8(m == 0 ? glm::vec4(1.0f) :
+			glm::vec4(0.75f + 0.25f * sin((float)m), 0.75f + 0.25f * sin(2.1f * (float)m), 0.75f + 0.25f * sin(3.7f * (float)m), 1.0f));
+		material.m_displacementScale = (m == 0) ? 1.0f : 0.5f + 0.25f * (float)(m % 5);
+		m_materialTable.add(material);
+	}
+
+	// *** INTERESTING ***
+	// Both buffers are sized for the table's capacity and made resident once, so their GPU pointers in the
+	// transform uniforms never change; edits are uploaded into them in place
+	glGenBuffers(1, &m_materials);
+	glNamedBufferDataEXT(m_materials, m_materialTable.getMaterialBufferBytes(), nullptr, GL_STATIC_DRAW);
+	glGetNamedBufferParameterui64vNV(m_materials, GL_BUFFER_GPU_ADDRESS_NV, &m_materialsGPUPtr);
+	glMakeNamedBufferResidentNV(m_materials, GL_READ_ONLY);
+	MemoryTracker::track(MemoryTracker::SubsystemTextures, MemoryTracker::KindBuffer, m_materials, m_materialTable.getMaterialBufferBytes());
+	MemoryTracker::setResident(MemoryTracker::KindBuffer, m_materials, true);
+
+	glGenBuffers(1, &m_textureHandleTable);
+	glNamedBufferDataEXT(m_textureHandleTable, m_materialTable.getHandleBufferBytes(), nullptr, GL_STATIC_DRAW);
+	glGetNamedBufferParameterui64vNV(m_textureHandleTable, GL_BUFFER_GPU_ADDRESS_NV, &m_textureHandleTableGPUPtr);
+	glMakeNamedBufferResidentNV(m_textureHandleTable, GL_READ_ONLY);
+	MemoryTracker::track(MemoryTracker::SubsystemTextures, MemoryTracker::KindBuffer, m_textureHandleTable, m_materialTable.getHandleBufferBytes());
+	MemoryTracker::setResident(MemoryTracker::KindBuffer, m_textureHandleTable, true);
+
+	uploadMaterials();
+}
+
+
+void BindlessApp::uploadMaterials()
+{
+	const std::vector<DirtyRangeTracker::Range>& materials = m_materialTable.updateMaterials();
+	for (size_t r = 0; r < materials.size(); r++) {
+		m_uploads->enqueueBuffer(UploadQueue::KindUniform, UploadQueue::PriorityImmediate, m_materials, materials[r].m_first * sizeof(MaterialTable::Material),
+			m_materialTable.getMaterials() + materials[r].m_first, materials[r].m_count * sizeof(MaterialTable::Material));
+	}
+	const std::vector<DirtyRangeTracker::Range>& handles = m_materialTable.updateHandles();
+	for (size_t r = 0; r < handles.size(); r++) {
+		m_uploads->enqueueBuffer(UploadQueue::KindUniform, UploadQueue::PriorityImmediate, m_textureHandleTable, handles[r].m_first * sizeof(uint64_t),
+			m_materialTable.getHandles() + handles[r].m_first, handles[r].m_count * sizeof(uint64_t));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::placeBuilding()
+//
+//    Creates the building of grid cell (i, k) in a new registry slot
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::placeBuilding(int32_t i, int32_t k, float height)
+{
+	MeshRegistry::Handle handle = m_meshes.insert();
+	if (handle == MeshRegistry::InvalidHandle) return;
+	m_buildingHandles[i * m_cityGridSize + k] = handle;
+
+	float x, y, z;
+	float size;
+
+	x = (float(i) - 0.5f * (float)m_cityGridSize) / (float)SQRT_BUILDING_COUNT;
+	y = 0.0f;
+	z = (float(k) - 0.5f * (float)m_cityGridSize) / (float)SQRT_BUILDING_COUNT;
+	size = .025f * (100.0f / (float)SQRT_BUILDING_COUNT);
+
+	createBuilding(*m_meshes.get(handle), ci::vec3(5.0f * x, y, 5.0f * z),
+		ci::vec3(size, height, size), ci::vec2(float(k) / (float)m_cityGridSize, float(i) / (float)m_cityGridSize));
+	//ci::gl::VertBatchRef vBatch = ci::gl::VertBatch::create(GL_TRIANGLES, false);
+	//m_vbo_meshes[meshIndex + 1] = ci::gl::VboMesh::create( ci::geom::Cube().size(ci::vec3(size, 0.2f + .1f * sin(5.0f * (float)(i * k)), size)) );
+	//m_vbo_meshes[meshIndex + 1]->getVertexArrayVbos()[0]->
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::rebuildRandomBuilding()
+//
+//    Removes a building and adds a new one of a different height in its place.
+//    *** INTERESTING ***
+//    The new mesh reuses the freed slot (so the same uniform slot and GPU pointer);
+//    no other mesh is touched. The old geometry went back to the cache on removal.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::rebuildRandomBuilding()
+{
+	const int32_t i = rand() % m_cityGridSize;
+	const int32_t k = rand() % m_cityGridSize;
+	// A streamed city only has the buildings of the attached tiles
+	if (!m_meshes.remove(m_buildingHandles[i * m_cityGridSize + k])) return;
+	m_buildingHandles[i * m_cityGridSize + k] = MeshRegistry::InvalidHandle;
+	placeBuilding(i, k, 0.1f + 0.3f * float(rand() % 255) / 255.0f);
+
+	// A reused slot may have been moved by its previous owner
+	const MeshRegistry::Handle handle = m_buildingHandles[i * m_cityGridSize + k];
+	if (m_meshes.isValid(handle)) {
+		const glm::mat4 identity(1.0f);
+		m_transforms.setLocal(m_meshNodes[handle.m_index], &identity[0][0]);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::bakeCityTiles()
+//
+//    Writes the tiles of the streamed city that are not on disk yet. The
+//    buildings are generated like the fixed grid's, with the colors seeded
+//    per tile, so a tile comes out the same whenever it is baked.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::bakeCityTiles(const std::string& dir)
+{
+	const int32_t tiles = m_cityGridSize / CITY_TILE_SIZE;
+	const float pitch = 5.0f / (float)SQRT_BUILDING_COUNT;
+	const float citySize = pitch * (float)m_cityGridSize;
+	std::vector<Vertex> vertices;
+	std::vector<uint16_t> indices;
+	std::vector<CityTile::PackedVertex> packed;
+	CityTile tile;
+	uint32_t baked = 0;
+	const double start = getElapsedSeconds();
+	for (int32_t z = 0; z < tiles; z++) {
+		for (int32_t x = 0; x < tiles; x++) {
+			const std::string path = CityTile::getPath(dir, x, z);
+			if (CityTile::probe(path, x, z)) continue;
+
+			srand(z * tiles + x + 1);
+			tile.clear();
+			tile.m_x = x;
+			tile.m_z = z;
+			for (int32_t i = x * CITY_TILE_SIZE; i < (x + 1) * CITY_TILE_SIZE; i++) {
+				for (int32_t k = z * CITY_TILE_SIZE; k < (z + 1) * CITY_TILE_SIZE; k++) {
+					const float height = 0.2f + .1f * sin(5.0f * (float)(i * k));
+					generateBuilding(ci::vec3(pitch * (float)i - 0.5f * citySize, 0.0f, pitch * (float)k - 0.5f * citySize), ci::vec3(0.5f * pitch, height, 0.5f * pitch), vertices, indices);
+					packed.resize(vertices.size());
+					for (size_t v = 0; v < vertices.size(); v++) {
+						memcpy(packed[v].m_position, vertices[v].m_position, sizeof(packed[v].m_position));
+						memcpy(packed[v].m_color, vertices[v].m_color, sizeof(packed[v].m_color));
+					}
+					tile.addBuilding(i, k, &packed[0], (uint32_t)packed.size(), &indices[0], (uint32_t)indices.size());
+				}
+			}
+			if (!tile.write(path)) {
+				console() << "failed to write city tile " << path << endl;
+				return;
+			}
+			baked++;
+		}
+	}
+	if (baked != 0) console() << "baked " << baked << " city tiles to " << dir << " in " << (getElapsedSeconds() - start) * 1000.0 << " ms" << endl;
+}
+
+
+// On the streamer's I/O thread; m_cityTileDir does not change once the streamer exists
+bool BindlessApp::load(int32_t x, int32_t z, CityTile& tile)
+{
+	return tile.read(CityTile::getPath(m_cityTileDir, x, z), x, z);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::attach()
+//
+//    *** INTERESTING ***
+//    Each building of the tile gets a registry slot, so it is drawn, animated
+//    and uploaded like the buildings of the fixed grid; a registry that runs
+//    full takes back the buildings added so far. The buffers come from the
+//    geometry cache, so identical buildings share them, and detaching a tile
+//    drops its references: buffers no attached building uses are deleted.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool BindlessApp::attach(const CityTile& tile, uint64_t& bytes)
+{
+	const glm::mat4 identity(1.0f);
+	bytes = 0;
+	for (size_t b = 0; b < tile.m_buildings.size(); b++) {
+		const CityTile::Building& building = tile.m_buildings[b];
+		if (building.m_i / CITY_TILE_SIZE != tile.m_x || building.m_k / CITY_TILE_SIZE != tile.m_z || building.m_i < 0 || building.m_k < 0) continue;
+
+		const MeshRegistry::Handle handle = m_meshes.insert();
+		if (handle == MeshRegistry::InvalidHandle) {
+			detach(tile.m_x, tile.m_z);
+			return false;
+		}
+
+		m_tileVertices.clear();
+		for (uint32_t v = 0; v < building.m_vertexCount; v++) {
+			const CityTile::PackedVertex& packed = tile.m_vertices[building.m_firstVertex + v];
+			m_tileVertices.push_back(Vertex(packed.m_position[0], packed.m_position[1], packed.m_position[2], 0.0f, 0.0f, 0.0f, 0.0f));
+			memcpy(m_tileVertices.back().m_color, packed.m_color, sizeof(packed.m_color));
+		}
+		m_tileIndices.assign(tile.m_indices.begin() + building.m_firstIndex, tile.m_indices.begin() + building.m_firstIndex + building.m_indexCount);
+		m_meshes.get(handle)->update(m_tileVertices, m_tileIndices);
+
+		// A reused slot may have been moved by its previous owner
+		m_transforms.setLocal(m_meshNodes[handle.m_index], &identity[0][0]);
+		m_meshes.remove(m_buildingHandles[building.m_i * m_cityGridSize + building.m_k]);
+		m_buildingHandles[building.m_i * m_cityGridSize + building.m_k] = handle;
+		bytes += m_tileVertices.size() * sizeof(Vertex) + m_tileIndices.size() * sizeof(uint16_t);
+	}
+	return true;
+}
+
+
+void BindlessApp::detach(int32_t x, int32_t z)
+{
+	for (int32_t i = x * CITY_TILE_SIZE; i < (x + 1) * CITY_TILE_SIZE; i++) {
+		for (int32_t k = z * CITY_TILE_SIZE; k < (z + 1) * CITY_TILE_SIZE; k++) {
+			m_meshes.remove(m_buildingHandles[i * m_cityGridSize + k]);
+			m_buildingHandles[i * m_cityGridSize + k] = MeshRegistry::InvalidHandle;
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::importMeshes()
+//
+//    Loads an OBJ or glTF binary file into one mesh per 64K vertex part.
+//    The parts share a model matrix that scales the model to the size of the
+//    city and stands it on the ground in the middle.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::importMeshes(const std::string& path)
+{
+	MeshImporter importer(*m_jobs);
+	std::vector<MeshImporter::Part> parts;
+	if (!importer.load(path, parts)) {
+		console() << "failed to import " << path << endl;
+		return;
+	}
+	m_importStats = importer.getStats();
+	console() << "imported " << path << ": " << m_importStats.m_fileBytes / 1024 << " KB, " << m_importStats.m_positions << " vertices welded to "
+		<< m_importStats.m_vertices << ", " << m_importStats.m_triangles << " triangles in " << m_importStats.m_parts << " parts, "
+		<< m_importStats.m_totalSeconds * 1000.0 << " ms (" << m_importStats.m_fileBytes / 1.0e6 / std::max(m_importStats.m_totalSeconds, 1.0e-9) << " MB/s)" << endl;
+
+	const float* low = m_importStats.m_boundsMin;
+	const float* high = m_importStats.m_boundsMax;
+	const float scale = 5.0f / std::max(std::max(high[0] - low[0], high[2] - low[2]), 1.0e-6f);
+	glm::mat4 fit(scale);
+	fit[3] = glm::vec4(-0.5f * (low[0] + high[0]) * scale, -low[1] * scale, -0.5f * (low[2] + high[2]) * scale, 1.0f);
+
+	for (size_t i = 0; i < parts.size(); i++) {
+		MeshRegistry::Handle handle = m_meshes.insert();
+		if (handle == MeshRegistry::InvalidHandle) {
+			console() << "mesh registry full, " << parts.size() - i << " parts of " << path << " dropped" << endl;
+			break;
+		}
+		m_meshes.get(handle)->update(parts[i].m_vertices, parts[i].m_indices);
+		m_transforms.setLocal(m_meshNodes[handle.m_index], &fit[0][0]);
+		m_importedHandles.push_back(handle);
 	}
 }
 
@@ -332,84 +1823,280 @@ void BindlessApp::mouseWheel(MouseEvent event)
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-//  Method: BindlessApp::updatePerMeshUniforms()
+//  Method: BindlessApp::updatePerMeshUniforms()
+//
+//    Computes per mesh uniforms based on t and sends the uniforms to the GPU
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::updatePerMeshUniforms(float t)
+{
+	computePerMeshUniforms(t);
+	uploadPerMeshUniforms();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::uploadPerMeshUniforms()
+//
+//    *** INTERESTING ***
+//    Only the meshes whose packed uniforms differ from what the buffer holds
+//    are sent, in merged runs. This frame's draws need them, so they are not
+//    subject to the upload budget. Without per mesh uniforms only the shared
+//    first entry is used. When the entries are bound by offset the changed
+//    runs are spread to their aligned slots first; a run is one upload from
+//    its first slot to the end of its last, padding included.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::uploadPerMeshUniforms()
+{
+	if (m_usePerMeshUniforms == true && m_useBindlessUniforms == false)
+	{
+		const std::vector<DirtyRangeTracker::Range>& ranges = m_perMeshUniformSlotsDirty.update(&m_perMeshUniformsData[0], 0, (uint32_t)m_perMeshUniformsData.size());
+		for (size_t r = 0; r < ranges.size(); r++)
+		{
+			const size_t offset = m_perMeshUniformSlotLayout.getOffset(ranges[r].m_first);
+			m_perMeshUniformSlotLayout.scatter(&m_perMeshUniformsData[0], ranges[r].m_first, ranges[r].m_count, &m_perMeshUniformSlotData[0]);
+			m_uploads->enqueueBuffer(UploadQueue::KindUniform, UploadQueue::PriorityImmediate, m_perMeshUniformSlots, offset,
+				&m_perMeshUniformSlotData[offset], m_perMeshUniformSlotLayout.getSpanBytes(ranges[r].m_count));
+		}
+		return;
+	}
+
+	const uint32_t count = m_usePerMeshUniforms ? (uint32_t)m_perMeshUniformsData.size() : 1;
+	const std::vector<DirtyRangeTracker::Range>& ranges = m_perMeshUniformsDirty.update(&m_perMeshUniformsData[0], 0, count);
+	for (size_t r = 0; r < ranges.size(); r++)
+	{
+		m_uploads->enqueueBuffer(UploadQueue::KindUniform, UploadQueue::PriorityImmediate, m_perMeshUniforms, ranges[r].m_first * sizeof(PerMeshUniforms),
+			&(m_perMeshUniformsData[ranges[r].m_first]), ranges[r].m_count * sizeof(PerMeshUniforms));
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::computePerMeshUniforms()
 //
-//    Computes per mesh uniforms based on t and sends the uniforms to the GPU
+//    The CPU side of updatePerMeshUniforms(), kept apart so it can be timed
+//    on its own. The frame graph runs it on slices of the building rows;
+//    the first slice also does the ground and the imported meshes. The
+//    toggle is a parameter: on a worker it has to be the value captured by
+//    launchNextFrame(), the auto-tuner and the UI change the member meanwhile.
 //
 ////////////////////////////////////////////////////////////////////////////////
-void BindlessApp::updatePerMeshUniforms(float t)
+void BindlessApp::computePerMeshUniforms(float t)
+{
+	computePerMeshUniforms(t, m_usePerMeshUniforms, m_perMeshUniformsData, 0, m_cityGridSize);
+}
+
+
+void BindlessApp::computePerMeshUniforms(float t, bool perMeshUniforms, std::vector<PerMeshUniforms>& uniforms, int32_t firstRow, int32_t lastRow)
 {
-	// If we're using per mesh uniforms, compute the values for the uniforms for all of the meshes and
-	// give the data to the GPU.
-	if (m_usePerMeshUniforms == true)
+	// If we're using per mesh uniforms, compute the values for the uniforms for all of the meshes
+	if (perMeshUniforms == true)
 	{
-		// Update uniforms for the "ground" mesh
-		m_perMeshUniformsData[0].r = 1.0f;
-		m_perMeshUniformsData[0].g = 1.0f;
-		m_perMeshUniformsData[0].b = 1.0f;
-		m_perMeshUniformsData[0].a = 0.0f;
-
-		// Compute the per mesh uniforms for all of the "building" meshes
-		int32_t index = 1;
-		for (int32_t i = 0; i < SQRT_BUILDING_COUNT; i++)
+		if (firstRow == 0)
+		{
+			// Update uniforms for the "ground" mesh
+			PerMeshUniforms& ground = uniforms[m_groundHandle.m_index];
+			ground.rg = glm::packSnorm2x16(glm::vec2(1.0f, 1.0f));
+			ground.bm = packBM(1.0f, 0);
+
+			// Imported models are drawn like the ground, in their own colors
+			for (size_t i = 0; i < m_importedHandles.size(); i++)
+			{
+				if (!m_meshes.isValid(m_importedHandles[i])) continue;
+				PerMeshUniforms& imported = uniforms[m_importedHandles[i].m_index];
+				imported.rg = ground.rg;
+				imported.bm = ground.bm;
+			}
+		}
+
+		// Compute the per mesh uniforms for all of the "building" meshes, in the slot each one lives in
+		for (int32_t i = firstRow; i < lastRow; i++)
 		{
-			for (int32_t j = 0; j < SQRT_BUILDING_COUNT; j++, index++)
+			for (int32_t j = 0; j < m_cityGridSize; j++)
 			{
+				const MeshRegistry::Handle handle = m_buildingHandles[i * m_cityGridSize + j];
+				if (!m_meshes.isValid(handle)) continue;
+				const int32_t index = handle.m_index;
+
 				float x, z, radius;
 
-				x = float(i) / float(SQRT_BUILDING_COUNT) - 0.5f;
-				z = float(j) / float(SQRT_BUILDING_COUNT) - 0.5f;
+				x = (float(i) - 0.5f * float(m_cityGridSize)) / float(SQRT_BUILDING_COUNT);
+				z = (float(j) - 0.5f * float(m_cityGridSize)) / float(SQRT_BUILDING_COUNT);
 				radius = sqrt((x * x) + (z * z));
 
-				m_perMeshUniformsData[index].r = sin(-4.f*10.0f * radius + t);
-				m_perMeshUniformsData[index].g = cos(-4.f*10.0f * radius + t);
-				m_perMeshUniformsData[index].b = radius;
-				m_perMeshUniformsData[index].a = 0.0f;
-				m_perMeshUniformsData[index].u = float(j) / float(SQRT_BUILDING_COUNT);
-				m_perMeshUniformsData[index].v = float(i) / float(SQRT_BUILDING_COUNT);
+				uniforms[index].rg = glm::packSnorm2x16(glm::vec2(sin(-4.f*10.0f * radius + t), cos(-4.f*10.0f * radius + t)));
+				uniforms[index].bm = packBM(radius, getBuildingMaterial(i, j));
+				uniforms[index].uv = glm::packUnorm2x16(glm::vec2(float(j) / float(m_cityGridSize), float(i) / float(m_cityGridSize)));
 			}
 		}
-
-		// Give the uniform data to the GPU
-		glNamedBufferDataEXT(m_perMeshUniforms, m_perMeshUniformsData.size() * sizeof(m_perMeshUniformsData[0]), &(m_perMeshUniformsData[0]), GL_STREAM_DRAW);
 	}
-	else
+	else if (firstRow == 0)
 	{
 		// All meshes will use these uniforms
-		m_perMeshUniformsData[0].r = sin(t);
-		m_perMeshUniformsData[0].g = cos(t);
-		m_perMeshUniformsData[0].b = 1.0f;
-		m_perMeshUniformsData[0].a = 0.0f;
-
-		// Give the uniform data to the GPU
-		glNamedBufferSubDataEXT(m_perMeshUniforms, 0, sizeof(m_perMeshUniformsData[0]), &(m_perMeshUniformsData[0]));
+		uniforms[0].rg = glm::packSnorm2x16(glm::vec2(sin(t), cos(t)));
+		uniforms[0].bm = packBM(1.0f, 0);
 	}
+}
 
 
+float BindlessApp::advanceAnimationTime()
+{
+	const float deltaTime = (float)getElapsedSeconds();
+	if (deltaTime < m_minimumFrameDeltaTime)
+	{
+		m_minimumFrameDeltaTime = deltaTime;
+	}
+	const float dt = std::min(0.00005f / m_minimumFrameDeltaTime, .01f);
+	return m_t + dt * (float)Mesh::m_drawCallsPerState;
+}
+
 
-	if (m_useBindlessUniforms == true)
+void BindlessApp::buildDrawList(std::vector<DrawItem>& drawList, uint32_t begin, uint32_t end)
+{
+	for (uint32_t i = begin; i < end; i++)
 	{
 		// *** INTERESTING ***
-		// Get the GPU pointer for the per mesh uniform buffer and make the buffer resident on the GPU
-		// For bindless uniforms, this GPU pointer will later be passed to the vertex shader via a
-		// vertex attribute. The vertex shader will then directly use the GPU pointer to access the
-		// uniform data.
-		int32_t perMeshUniformsDataSize;
-		glBindBuffer(GL_UNIFORM_BUFFER, m_perMeshUniforms);
-		glGetBufferParameterui64vNV(GL_UNIFORM_BUFFER, GL_BUFFER_GPU_ADDRESS_NV, &m_perMeshUniformsGPUPtr);
-		glGetBufferParameteriv(GL_UNIFORM_BUFFER, GL_BUFFER_SIZE, &perMeshUniformsDataSize);
-		glMakeBufferResidentNV(GL_UNIFORM_BUFFER, GL_READ_ONLY);
-		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		// Compute a GPU pointer for the per mesh uniforms for this mesh, once, ahead of the draw loop
+		const uint32_t slot = m_meshes.getSlot(i);
+		const GLuint64EXT perMeshUniformsGPUPtr = m_perMeshUniformsGPUPtr + sizeof(PerMeshUniforms) * slot;
+		DrawItem& item = drawList[i];
+		item.mesh = i;
+		item.slot = slot;
+		item.uniformsLow = (int)(perMeshUniformsGPUPtr & 0xFFFFFFFF);
+		item.uniformsHigh = (int)((perMeshUniformsGPUPtr >> 32) & 0xFFFFFFFF);
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::buildFrameGraph()
+//
+//    The CPU work of a frame: the city animation feeds the transform update,
+//    the per mesh uniforms and the draw list depend on nothing and are split
+//    over the job system. Every task writes only to the m_next* state (and
+//    the transform hierarchy, which draw() leaves alone while the graph runs)
+//    and reads toggles only from the m_next* copies, never the members the
+//    UI and the auto-tuner write. Returns the draw list task, its size changes with the mesh count.
+//
+////////////////////////////////////////////////////////////////////////////////
+TaskGraph::TaskId BindlessApp::buildFrameGraph(TaskGraph& graph)
+{
+	const TaskGraph::TaskId animation = graph.add("animation", &BindlessApp::animationTask, this);
+	const TaskGraph::TaskId transforms = graph.add("transforms", &BindlessApp::transformsTask, this);
+	graph.add("per_mesh_uniforms", &BindlessApp::perMeshUniformsTask, this, m_cityGridSize, 10);
+	const TaskGraph::TaskId drawList = graph.add("draw_list", &BindlessApp::drawListTask, this, m_meshes.size(), 1024);
+	graph.precede(animation, transforms);
+	return drawList;
+}
+
+
+void BindlessApp::animationTask(void* context, uint32_t, uint32_t)
+{
+	BindlessApp& app = *static_cast<BindlessApp*>(context);
+	if (app.m_nextAnimateTransforms)
+	{
+		glm::mat4 cityRotation = glm::rotate(glm::mat4(1.0f), app.m_nextCityAngle, glm::vec3(0.0f, 1.0f, 0.0f));
+		app.m_transforms.setLocal(app.m_cityNode, &cityRotation[0][0]);
+	}
+}
+
+
+void BindlessApp::transformsTask(void* context, uint32_t, uint32_t)
+{
+	BindlessApp& app = *static_cast<BindlessApp*>(context);
+	app.m_nextTransformsUpdated = app.m_transforms.update();
+}
+
+
+void BindlessApp::perMeshUniformsTask(void* context, uint32_t begin, uint32_t end)
+{
+	BindlessApp& app = *static_cast<BindlessApp*>(context);
+	app.computePerMeshUniforms(app.m_nextT, app.m_nextUsePerMeshUniforms, app.m_nextPerMeshUniformsData, (int32_t)begin, (int32_t)end);
+}
+
+
+void BindlessApp::drawListTask(void* context, uint32_t begin, uint32_t end)
+{
+	BindlessApp& app = *static_cast<BindlessApp*>(context);
+	app.buildDrawList(app.m_nextDrawList, begin, end);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::launchNextFrame()
+//
+//    Starts the frame graph for the next frame. Everything it reads from the
+//    main thread's side (time, toggles, mesh count) is captured here, so the
+//    tasks see one consistent snapshot.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::launchNextFrame()
+{
+	m_nextMeshesVersion = m_meshes.getVersion();
+	m_nextUsePerMeshUniforms = m_usePerMeshUniforms;
+	m_nextAnimateTransforms = m_animateTransforms;
+	m_nextT = m_updateUniformsEveryFrame ? advanceAnimationTime() : m_t;
+	m_nextCityAngle = 0.25f * (float)getElapsedSeconds();
+	m_nextDrawList.resize(m_meshes.size());
+	m_frameGraph->setCount(m_drawListTask, m_meshes.size());
+	m_frameGraph->launch();
+}
+
+
+void BindlessApp::applyTuning(const AutoTuner::Config& config)
+{
+	Mesh::m_enableVBUM = config.m_vbum;
+	m_useBindlessUniforms = config.m_bindlessUniforms;
+	Mesh::m_setVertexFormatOnEveryDrawCall = config.m_vertexFormatPerDraw;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::finishAutoTune()
+//
+//    Applies the winner of the sweep and stores it for this driver, and
+//    restores the toggles the sweep had reset.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::finishAutoTune()
+{
+	const AutoTuner::Config& best = m_autoTuner.getConfig();
+	applyTuning(best);
+	m_usePerMeshUniforms = m_autoTuneSavedPerMeshUniforms;
+	Mesh::m_drawCallsPerState = m_autoTuneSavedDrawCallsPerState;
+	m_autoTuneLoaded = false;
+
+	const std::vector<AutoTuner::Result>& results = m_autoTuner.getResults();
+	for (size_t i = 0; i < results.size(); i++) {
+		console() << "auto-tune " << AutoTuner::describe(results[i].m_config) << ": " << results[i].m_secondsPerFrame * 1.0e3 << " ms/frame" << endl;
+	}
+	console() << "auto-tune picked " << AutoTuner::describe(best) << endl;
+	if (!AutoTuner::storeProfile(m_autoTuneProfilePath, m_driverIdentity, best)) {
+		console() << "failed to write auto-tune profile " << m_autoTuneProfilePath << endl;
 	}
 }
 
 
 void BindlessApp::update()
 {
+	// *** INTERESTING ***
+	// Cinder calls update() before draw(), so a frame's arena allocations start here. Once the arena
+	// has grown to the high water mark the count below should stay at zero for the frame path.
+	const uint64_t heapAllocations = FrameArena::getHeapAllocationCount();
+	m_heapAllocationsPerFrame = heapAllocations - m_heapAllocationsAtFrameStart;
+	m_heapAllocationsAtFrameStart = heapAllocations;
+	m_frameArena.beginFrame();
+
 	avgfps = getAverageFps();
 	// Update the rendering stats in the UI
 	float drawCallsPerSecond;
-	drawCallsPerSecond = (float)m_meshes.size() * getAverageFps() * (float)Mesh::m_drawCallsPerState;
+	drawCallsPerSecond = (float)m_drawCount * getAverageFps() * (float)Mesh::m_drawCallsPerState;
 	m_drawCallsPerSecondText = drawCallsPerSecond / 1.0e6f;
 	//m_drawCallsPerSecondText->SetValue(drawCallsPerSecond / 1.0e6f);
 
@@ -419,6 +2106,19 @@ void BindlessApp::update()
 
 	gl::clear();//cleared in update
 
+	// Build one of the shader variants not used yet per frame, so toggling a mode later does not stall
+	if (m_shaderVariants) m_shaderVariants->compilePending(1);
+
+	// *** INTERESTING ***
+	// Stream the city tiles around the point the camera orbits and pans about, in the city's space since the
+	// city spins. Tiles are attached here, while the frame graph is not running.
+	if (m_cityStreamer) {
+		glm::mat4 city;
+		memcpy(&city[0][0], m_transforms.getWorld(m_cityNode), TransformHierarchy::MatrixBytes);
+		const glm::vec4 pivot = glm::inverse(city) * glm::vec4(mCam.getPivotPoint(), 1.0f);
+		m_cityStreamer->update(pivot.x, pivot.z);
+	}
+
 #ifdef USE_IMGUI
 	{
 		ui::ScopedWindow ui_sc_win("BindlessApp");
@@ -426,8 +2126,99 @@ void BindlessApp::update()
 			{
 				ui::ScopedStyleColor scTcol(ImGuiCol_Text, Mesh::m_enableVBUM ? ImVec4(1., 1., 1., 1.) : ImVec4(0.90f, 0.00f, 0.90f, 1.00f));
 
-				ui::Text(("avg fps: " + ci::toString(getAverageFps())).c_str());
-				ui::Text((ci::toString(m_drawCallsPerSecondText) + " M draw calls/sec").c_str());
+				// The strings live in the frame arena, building them does not touch the heap
+				typedef unsigned long long ull;
+				ui::TextUnformatted(m_frameArena.format("avg fps: %g", getAverageFps()));
+				ui::TextUnformatted(m_frameArena.format("%g M draw calls/sec", m_drawCallsPerSecondText));
+
+				const TextureResidencyManager::Counters& residency = m_textureResidency.getFrameCounters();
+				const TextureResidencyManager::Counters& residencyTotal = m_textureResidency.getTotalCounters();
+				ui::TextUnformatted(m_frameArena.format("resident textures: %u (%llu KB)", residency.m_residentCount, (ull)(residency.m_residentBytes / 1024)));
+				ui::TextUnformatted(m_frameArena.format("hit/miss/evict: %u/%u/%u", residencyTotal.m_hits, residencyTotal.m_misses, residencyTotal.m_evictions));
+				ui::TextUnformatted(m_frameArena.format("materials: %u, %u texture handles", m_materialTable.getMaterialCount(), m_materialTable.getHandleCount()));
+				ui::TextUnformatted(m_frameArena.format("views: %u, %u meshes drawn, %u frustum tests for %u meshes", m_viewCount, m_drawCount, m_frustumTests,
+					(uint32_t)m_drawList.size()));
+
+				const GLStateCache::Counters& glCalls = m_glStateCache.getFrameCounters();
+				ui::TextUnformatted(m_frameArena.format("GL calls issued: %u", glCalls.m_issued));
+				ui::TextUnformatted(m_frameArena.format("skipped state/binds/uniforms: %u/%u/%u", glCalls.m_skippedState, glCalls.m_skippedBinds, glCalls.m_skippedUniforms));
+				ui::TextUnformatted(m_frameArena.format("shader variant: %s", m_shaderVariantNames[m_shaderKey].c_str()));
+				ui::TextUnformatted(m_frameArena.format("transforms updated: %u", m_transformsUpdated));
+				const bool perMeshSlots = m_usePerMeshUniforms && !m_useBindlessUniforms;
+				const DirtyRangeTracker::Stats& perMeshUploads = (perMeshSlots ? m_perMeshUniformSlotsDirty : m_perMeshUniformsDirty).getStats();
+				// A run of slots is uploaded with the padding between them
+				const uint64_t perMeshUploadBytes = perMeshSlots ? (uint64_t)(perMeshUploads.m_uploadedElements - perMeshUploads.m_ranges) * m_perMeshUniformSlotLayout.getStride()
+					+ (uint64_t)perMeshUploads.m_ranges * sizeof(PerMeshUniforms) : perMeshUploads.m_uploadedBytes;
+				ui::TextUnformatted(m_frameArena.format("per mesh uniforms: %u changed, %u runs, %llu KB", perMeshUploads.m_changedElements, perMeshUploads.m_ranges, (ull)(perMeshUploadBytes / 1024)));
+				if (m_frameGraph) {
+					ui::TextUnformatted(m_frameArena.format("frame graph: %.3f ms on %u threads, %llu steals", m_frameGraph->getSeconds() * 1000.0,
+						m_jobs->getThreadCount(), (ull)m_jobs->getStats().m_steals));
+				}
+
+				if (m_autoTuner.isRunning()) {
+					ui::TextUnformatted(m_frameArena.format("auto-tuning: %u/%u", m_autoTuner.getConfigIndex() + 1, m_autoTuner.getConfigCount()));
+				}
+				else if (m_autoTuneLoaded) {
+					ui::TextUnformatted("auto-tune: from profile");
+				}
+				else if (!m_autoTuner.getResults().empty()) {
+					ui::TextUnformatted("auto-tune: measured");
+				}
+
+				const FrameArena::Stats& arena = m_frameArena.getStats();
+				ui::TextUnformatted(m_frameArena.format("frame arena: %llu KB used, high water %llu KB, %llu KB overflow", (ull)(arena.m_lastFrameBytes / 1024), (ull)(arena.m_highWaterBytes / 1024), (ull)(arena.m_overflowBytes / 1024)));
+				if (FrameArena::isCountingHeapAllocations()) {
+					ui::TextUnformatted(m_frameArena.format("heap allocations last frame: %llu", (ull)m_heapAllocationsPerFrame));
+				}
+
+				if (m_replayer) {
+					ui::TextUnformatted(m_frameArena.format("trace replay%s: %llu calls, %g M calls/sec", m_replayer->canDraw() ? "" : " (not drawn, GPU pointers)",
+						(ull)m_replayStats.m_calls, m_replayStats.m_callsPerSecond / 1.0e6));
+				}
+				else if (!m_capturePath.empty()) {
+					ui::TextUnformatted(m_frameArena.format("capturing GL calls: %u/%u frames", (uint32_t)m_glCapture.getTrace().m_frames.size(), m_captureFrames));
+				}
+
+				if (ui::CollapsingHeader("Memory")) {
+					for (int32_t s = 0; s < MemoryTracker::SubsystemCount; s++) {
+						const MemoryTracker::Counters memory = MemoryTracker::getCounters((MemoryTracker::Subsystem)s);
+						ui::TextUnformatted(m_frameArena.format("%s: GPU %llu KB (peak %llu), CPU %llu KB (peak %llu), %u objects, %u resident", MemoryTracker::getName((MemoryTracker::Subsystem)s),
+							(ull)(memory.m_gpuBytes / 1024), (ull)(memory.m_gpuPeakBytes / 1024), (ull)(memory.m_cpuBytes / 1024), (ull)(memory.m_cpuPeakBytes / 1024),
+							memory.m_objects, memory.m_residentHandles));
+					}
+					const MemoryTracker::Counters total = MemoryTracker::getTotal();
+					ui::TextUnformatted(m_frameArena.format("total: GPU %llu KB, CPU %llu KB", (ull)(total.m_gpuBytes / 1024), (ull)(total.m_cpuBytes / 1024)));
+				}
+
+				if (m_geometryCache) {
+					const GeometryCache::Counters& geometry = m_geometryCache->getCounters();
+					ui::TextUnformatted(m_frameArena.format("geometry cache: %llu buffers, %d%% hits, %llu KB saved", (ull)geometry.m_entries, (int)(m_geometryCache->getHitRate() * 100.0f),
+						(ull)(m_geometryCache->getBytesSaved() / 1024)));
+				}
+
+				if (m_glObjects) {
+					const GLObjectQueue::Counters& objects = m_glObjects->getCounters();
+					ui::TextUnformatted(m_frameArena.format("GL objects: %llu created, %llu deleted, %u pending, %u gen/%u delete calls", (ull)objects.m_created,
+						(ull)objects.m_deleted, objects.m_pending, objects.m_genCalls, objects.m_deleteCalls));
+				}
+
+				if (m_cityStreamer) {
+					const CityStreamer::Counters& streaming = m_cityStreamer->getCounters();
+					ui::TextUnformatted(m_frameArena.format("city tiles: %u attached (%llu KB), %u reading, %u missing in view", streaming.m_residentTiles,
+						(ull)(streaming.m_residentBytes / 1024), streaming.m_readingTiles, streaming.m_misses));
+					ui::TextUnformatted(m_frameArena.format("tile reads/evictions/cancelled: %u/%u/%u", streaming.m_reads, streaming.m_evictions, streaming.m_cancelled));
+				}
+
+				if (!m_importedHandles.empty()) {
+					ui::TextUnformatted(m_frameArena.format("imported: %u meshes, %llu vertices, %llu triangles", (uint32_t)m_importedHandles.size(),
+						(ull)m_importStats.m_vertices, (ull)m_importStats.m_triangles));
+				}
+
+				if (m_uploads) {
+					const UploadQueue::Counters& uploads = m_uploads->getFrameCounters();
+					ui::TextUnformatted(m_frameArena.format("uploads: %u jobs, %llu KB, %u copies", uploads.m_jobsIssued, (ull)(uploads.m_bytesIssued / 1024), uploads.m_copies));
+					ui::TextUnformatted(m_frameArena.format("upload queue: %u jobs, %llu KB, latency max %u frames", uploads.m_queuedJobs, (ull)(uploads.m_queuedBytes / 1024), uploads.m_maxLatencyFrames));
+				}
 
 			}
 			{
@@ -458,10 +2249,46 @@ void BindlessApp::update()
 				ui::ScopedStyleColor scTcol(ImGuiCol_Text, m_useBindlessTextures ? ImVec4(1., 1., 1., 1.) : ImVec4(0.90f, 0.00f, 0.90f, 1.00f));
 				if (ui::Button("Use bindless textures"))m_useBindlessTextures = !m_useBindlessTextures;
 			}
+			{
+				ui::ScopedStyleColor scTcol(ImGuiCol_Text, m_useStateCache ? ImVec4(1., 1., 1., 1.) : ImVec4(0.90f, 0.00f, 0.90f, 1.00f));
+				if (ui::Button("Use GL state cache"))m_useStateCache = !m_useStateCache;
+			}
+			{
+				ui::ScopedStyleColor scTcol(ImGuiCol_Text, m_animateTransforms ? ImVec4(1., 1., 1., 1.) : ImVec4(0.90f, 0.00f, 0.90f, 1.00f));
+				if (ui::Button("Animate transforms"))m_animateTransforms = !m_animateTransforms;
+			}
+			{
+				ui::ScopedStyleColor scTcol(ImGuiCol_Text, m_pipelineFrames ? ImVec4(1., 1., 1., 1.) : ImVec4(0.90f, 0.00f, 0.90f, 1.00f));
+				if (ui::Button("Pipeline frame CPU work"))m_pipelineFrames = !m_pipelineFrames;
+			}
+			{
+				if (ui::Button("Rebuild a random building"))rebuildRandomBuilding();
+			}
+			{
+				if (ui::DragInt("Extra views", &m_extraViews, 1., 0, VIEW_COUNT_MAX - 1));
+			}
+			{
+				if (ui::Button("Re-run auto-tune"))m_autoTunePending = !m_autoTuner.isRunning();
+			}
 			{
 				ui::ScopedStyleColor scTcol(ImGuiCol_Text, Mesh::m_drawCallsPerState ? ImVec4(1., 1., 1., 1.) : ImVec4(0.90f, 0.00f, 0.90f, 1.00f));
 				if (ui::DragInt("Draw calls per state", (int*)&Mesh::m_drawCallsPerState, 1., 1, 20));
 			}
+			if (m_uploads) {
+				int budgetKB = (int)(m_uploads->getBudgetBytes() / 1024);
+				if (ui::DragInt("Upload budget (KB/frame)", &budgetKB, 16., 16, 64 * 1024))
+					m_uploads->setBudget((uint64_t)budgetKB * 1024, m_uploads->getBudgetSeconds());
+			}
+			{
+				int windowAhead = m_textureResidency.getWindowAhead();
+				if (ui::DragInt("Texture residency window", &windowAhead, 1., 0, TEXTURE_FRAME_COUNT))
+					m_textureResidency.setWindow(m_textureResidency.getWindowBehind(), windowAhead);
+			}
+			if (m_cityStreamer) {
+				int budgetMB = (int)(m_cityStreamer->getBudget() / (1024 * 1024));
+				if (ui::DragInt("City tile budget (MB)", &budgetMB, 1., 1, 1024))
+					m_cityStreamer->setBudget((uint64_t)budgetMB * 1024 * 1024);
+			}
 
 		}
 
@@ -482,7 +2309,8 @@ void BindlessApp::update()
 ////////////////////////////////////////////////////////////////////////////////
 void BindlessApp::draw()
 {
-	glm::mat4 modelviewMatrix;
+	// Buffers and textures released up to this frame are deleted once the GPU has finished it
+	ScopedObjectFrame scObjects(m_glObjects.get());
 	gl::ScopedMatrices scM;
 	//gl::ScopedModelMatrix scMM;
 	//gl::clear(Color(0, 0, 0));
@@ -491,66 +2319,170 @@ void BindlessApp::draw()
 	gl::ScopedDepth scDep(true);
 
 	gl::setMatrices(mCam);
+
+	// Cinder and the UI may have changed GL state since our last frame
+	m_glStateCache.setEnabled(m_useStateCache);
+	m_glStateCache.beginFrame();
+
+	// The startup uploads would be counted against the first candidates, so the sweep waits for them.
+	// Both NV extensions were checked in initRendering(), every combination is available. The candidates
+	// are compared by whole frames, so the toggles that change what is drawn go back to their defaults
+	// for the sweep, and to the user's settings after it.
+	if (m_autoTunePending && m_uploads->isEmpty()) {
+		m_autoTunePending = false;
+		m_autoTuneSavedPerMeshUniforms = m_usePerMeshUniforms;
+		m_autoTuneSavedDrawCallsPerState = Mesh::m_drawCallsPerState;
+		m_usePerMeshUniforms = true;
+		Mesh::m_drawCallsPerState = 1;
+		m_autoTuner.start(true, true);
+		applyTuning(m_autoTuner.getConfig());
+	}
+
+	// Select the shader variant for the current toggles
+	m_shaderKey = ShaderVariants::makeKey(m_useBindlessUniforms, m_useBindlessTextures);
+	const GLuint program = m_shaderVariants->getProgram(m_shaderKey);
+	if (program == 0) return;
+
+	if (m_replayer) {
+		if (m_replayer->canDraw()) {
+			// Draw the captured frames instead of the scene; the replay leaves GL state the cache does not know about.
+			// The handle table holds the capturing process's bindless texture handles, so the replay samples no textures.
+			const GLuint replayProgram = m_shaderVariants->getProgram(ShaderVariants::makeKey(m_useBindlessUniforms, false));
+			if (replayProgram == 0) return;
+			ScopedProgram scProg(replayProgram);
+			m_replayer->setProgram(replayProgram);
+			m_replayStats = m_replayer->replay(m_glDirect, 1);
+			m_glStateCache.invalidate();
+		}
+		else {
+			m_replayStandIn.clear();
+			m_replayStats = m_replayer->replay(m_replayStandIn, 1);
+		}
+		return;
+	}
+
+	// Capture once the startup uploads are through, so the trace holds steady state frames. The cache
+	// forgets what it has sent, so the first captured frame sets all the state the following ones rely on.
+	if (!m_capturePath.empty() && !m_captureStarted && m_uploads->isEmpty()) {
+		m_glStateCache.invalidate();
+		m_glCapture.start(m_captureFrames);
+		m_captureStarted = true;
+	}
+	m_glCapture.beginFrame();
+
 	// Enable the vertex and pixel shader
 	//m_shader->enable();
 	{
-		gl::ScopedGlslProg scGl(m_shader);
+		ScopedProgram scProg(program);
 
 		if (m_useBindlessTextures) {
-			GLuint samplersLocation(m_shader->getUniformLocation("samplers"));
-			glUniform1ui64vNV(samplersLocation, m_numTextures, m_textureHandles);
-
+			// *** INTERESTING ***
+			// Make the frames around m_currentFrame resident (batched, once per frame) before the shader samples them.
+			// The materials run ahead of the global animation by their phase; the frames they sample are needed too.
+			for (uint32_t m = 0; m < m_materialTable.getMaterialCount(); m++) {
+				const MaterialTable::Material& material = m_materialTable.getMaterial(m);
+				const uint32_t entry = material.m_firstTexture - m_firstFrameHandle + MaterialTable::getFrame(material, (uint32_t)m_currentFrame);
+				if (entry < (uint32_t)m_textureResidency.getEntryCount()) m_textureResidency.touch((int32_t)entry);
+			}
+			m_textureResidency.update(m_currentFrame);
 		}
 
-		GLuint bBindlessTexture(m_shader->getUniformLocation("useBindless"));
-		glUniform1i(bBindlessTexture, m_useBindlessTextures);
+		// The shader finds its textures through the material table; nothing texture related is set per frame,
+		// this only sends materials or handles edited since the last one
+		uploadMaterials();
 
-		GLuint currentTexture(m_shader->getUniformLocation("currentFrame"));
-		glUniform1i(currentTexture, m_currentFrame);
-
-		// Set the transformation matices up
-		modelviewMatrix = ci::gl::getModelView();//m_transformer->getModelViewMat();
-		m_projectionMatrix = mCam.getProjectionMatrix();
-		m_transformUniformsData.ModelView = modelviewMatrix;
-		m_transformUniformsData.ModelViewProjection = m_projectionMatrix * modelviewMatrix;
-		m_transformUniformsData.UseBindlessUniforms = m_useBindlessUniforms;
-		glBindBufferBase(GL_UNIFORM_BUFFER, 2, m_transformUniforms);
-		glNamedBufferSubDataEXT(m_transformUniforms, 0, sizeof(TransformUniforms), &m_transformUniformsData);
 
+		// *** INTERESTING ***
+		// With pipelining, this frame's uniforms, transforms and draw list were computed by the frame graph while
+		// the previous frame was submitted. That state is dropped when meshes came or went in between.
+		const bool prepared = m_nextFrameReady && m_nextMeshesVersion == m_meshes.getVersion() && m_nextUsePerMeshUniforms == m_usePerMeshUniforms;
+		m_nextFrameReady = false;
+		m_transformsUpdated = 0;
+		if (prepared)
+		{
+			std::swap(m_drawList, m_nextDrawList);
+			m_transformsUpdated = m_nextTransformsUpdated;
+		}
+		else
+		{
+			m_drawList.resize(m_meshes.size());
+			buildDrawList(m_drawList, 0, m_meshes.size());
+		}
 
 		// If we are going to update the uniforms every frame, do it now
 		if (m_updateUniformsEveryFrame == true)
 		{
-			float deltaTime;
-			float dt;
-
-			deltaTime = getElapsedSeconds();
-
-			if (deltaTime < m_minimumFrameDeltaTime)
+			if (prepared)
+			{
+				std::swap(m_perMeshUniformsData, m_nextPerMeshUniformsData);
+				m_t = m_nextT;
+				uploadPerMeshUniforms();
+			}
+			else
 			{
-				m_minimumFrameDeltaTime = deltaTime;
+				m_t = advanceAnimationTime();
+				updatePerMeshUniforms(m_t);
 			}
+		}
 
-			dt = std::min(0.00005f / m_minimumFrameDeltaTime, .01f);
-			m_t += dt * (float)Mesh::m_drawCallsPerState;
 
-			updatePerMeshUniforms(m_t);
+		// Spin the city node; only the dirty matrices are recomputed and only their range is uploaded.
+		// A prepared frame has done that already, this only catches nodes moved since.
+		if (m_animateTransforms && !prepared)
+		{
+			glm::mat4 cityRotation = glm::rotate(glm::mat4(1.0f), 0.25f * (float)getElapsedSeconds(), glm::vec3(0.0f, 1.0f, 0.0f));
+			m_transforms.setLocal(m_cityNode, &cityRotation[0][0]);
+		}
+		m_transformsUpdated += m_transforms.update();
+		uint32_t firstNode, nodeCount;
+		if (m_transforms.getChangedRange(firstNode, nodeCount))
+		{
+			m_uploads->enqueueBuffer(UploadQueue::KindUniform, UploadQueue::PriorityImmediate, m_modelMatrices, firstNode * TransformHierarchy::MatrixBytes,
+				m_transforms.getWorld(firstNode), nodeCount * TransformHierarchy::MatrixBytes);
+			m_transforms.clearChangedRange();
+		}
+
+		// *** INTERESTING ***
+		// The draw list is culled against all views in one pass, with the world matrices just computed. The
+		// transform uniforms are the only per view state: one slot each, all of them sent in one upload.
+		setupViews();
+		cullViews();
+		for (uint32_t v = 0; v < m_viewCount; v++)
+		{
+			TransformUniforms& transform = m_transformUniformsData[v];
+			transform.ModelView = m_views[v].m_view;
+			transform.ModelViewProjection = m_views[v].m_projection * m_views[v].m_view;
+			transform.UseBindlessUniforms = m_useBindlessUniforms;
+			transform.ModelMatrices = m_modelMatricesGPUPtr;
+			transform.Materials = m_materialsGPUPtr;
+			transform.TextureHandles = m_textureHandleTableGPUPtr;
+			transform.CurrentFrame = m_currentFrame;
+			transform.TextureFootprint = (float)SQRT_BUILDING_COUNT / (5.0f * (float)m_cityGridSize);
 		}
+		m_transformUniformsLayout.scatter(m_transformUniformsData, 0, m_viewCount, &m_transformUniformsPadded[0]);
+		m_gl->namedBufferSubData(m_transformUniforms, 0, m_transformUniformsLayout.getSpanBytes(m_viewCount), &m_transformUniformsPadded[0]);
+
+		// Issue this frame's share of the queued uploads before drawing
+		m_uploads->drain();
 
+		// The uploads hold copies of this frame's data, so the next frame can be computed while this one is drawn
+		if (m_pipelineFrames) launchNextFrame();
 
 		// Set up default per mesh uniforms. These may be changed on a per mesh basis in the rendering loop below 
 		if (m_useBindlessUniforms == true)
 		{
 			// *** INTERESTING ***
 			// Pass a GPU pointer to the vertex shader for the per mesh uniform data via a vertex attribute
-			glVertexAttribI2i(m_bindlessPerMeshUniformsPtrAttribLocation,
+			m_gl->vertexAttribI2i(m_bindlessPerMeshUniformsPtrAttribLocation,
 				(int)(m_perMeshUniformsGPUPtr & 0xFFFFFFFF),
 				(int)((m_perMeshUniformsGPUPtr >> 32) & 0xFFFFFFFF));
 		}
 		else
 		{
-			glBindBufferBase(GL_UNIFORM_BUFFER, 3, m_perMeshUniforms);
-			glNamedBufferSubDataEXT(m_perMeshUniforms, 0, sizeof(m_perMeshUniformsData[0]), &(m_perMeshUniformsData[0]));
+			// The shared first entry went out with uploadPerMeshUniforms(); the shader reads the world matrices
+			// from a storage buffer instead of through the ModelMatrices pointer
+			m_gl->bindBufferBase(GL_UNIFORM_BUFFER, 3, m_perMeshUniforms);
+			m_gl->bindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_modelMatrices);
 		}
 
 		// If all of the meshes are sharing the same vertex format, we can just set the vertex format once
@@ -559,49 +2491,21 @@ void BindlessApp::draw()
 			Mesh::renderPrep();
 		}
 
-		// Render all of the meshes
-		for (int32_t i = 0; i < (int32_t)m_meshes.size(); i++)
+		// Render every view's visible meshes in draw list order; the inset views are drawn over the main view
+		const double drawStart = getElapsedSeconds();
+		m_drawCount = 0;
+		for (uint32_t v = 0; v < m_viewCount; v++)
 		{
-			// If enabled, update the per mesh uniforms for each mesh rendered
-			if (m_usePerMeshUniforms == true)
-			{
-				if (m_useBindlessUniforms == true)
-				{
-					GLuint64EXT perMeshUniformsGPUPtr;
-
-					// *** INTERESTING ***
-					// Compute a GPU pointer for the per mesh uniforms for this mesh
-					perMeshUniformsGPUPtr = m_perMeshUniformsGPUPtr + sizeof(m_perMeshUniformsData[0]) * i;
-					// Pass a GPU pointer to the vertex shader for the per mesh uniform data via a vertex attribute
-					glVertexAttribI2i(m_bindlessPerMeshUniformsPtrAttribLocation,
-						(int)(perMeshUniformsGPUPtr & 0xFFFFFFFF),
-						(int)((perMeshUniformsGPUPtr >> 32) & 0xFFFFFFFF));
-				}
-				else
-				{
-					glBindBufferBase(GL_UNIFORM_BUFFER, 3, m_perMeshUniforms);
-					glNamedBufferSubDataEXT(m_perMeshUniforms, 0, sizeof(m_perMeshUniformsData[0]), &(m_perMeshUniformsData[i]));
-				}
-			}
-
-			// If we're not sharing vertex formats between meshes, we have to set the vertex format everytime it changes.
-			if (Mesh::m_setVertexFormatOnEveryDrawCall == true)
-			{
-				Mesh::renderPrep();
-			}
-
-			// Now that everything is set up, do the actual rendering
-			// The code that selects between rendering with Vertex Array Objects (VAO) and 
-			// Vertex Buffer Unified Memory (VBUM) is located in Mesh::render()
-			// The code that gets the GPU pointer for use with VBUM rendering is located in Mesh::update()
-			m_meshes[i].render();
-
-
-			// If we're not sharing vertex formats between meshes, we have to reset the vertex format to a default state after each mesh
-			if (Mesh::m_setVertexFormatOnEveryDrawCall == true)
+			const Area& viewport = m_views[v].m_viewport;
+			gl::ScopedViewport scViewport(viewport.getUL(), viewport.getSize());
+			if (v != 0)
 			{
-				Mesh::renderFinish();
+				gl::ScopedScissor scScissor(viewport.getUL(), viewport.getSize());
+				gl::clear(ColorA(0.1f, 0.1f, 0.15f, 1.0f), true);
 			}
+			m_gl->bindBufferRange(GL_UNIFORM_BUFFER, 2, m_transformUniforms, m_transformUniformsLayout.getOffset(v), sizeof(TransformUniforms));
+			drawItems(&m_viewItems[v][0], m_viewItemCounts[v]);
+			m_drawCount += m_viewItemCounts[v];
 		}
 
 		// If we're sharing vertex formats between meshes, we only have to reset vertex format to a default state once
@@ -610,10 +2514,192 @@ void BindlessApp::draw()
 			Mesh::renderFinish();
 		}
 
+		// The sweep compares the CPU cost of submitting the whole frame; the next frame uses the next candidate
+		if (m_autoTuner.isRunning())
+		{
+			m_autoTuner.addFrame(getElapsedSeconds() - drawStart);
+			applyTuning(m_autoTuner.getConfig());
+			if (!m_autoTuner.isRunning()) finishAutoTune();
+		}
+
+		// Usually done by now; update() may change the scene, so the graph does not run past the frame
+		if (m_frameGraph->isLaunched())
+		{
+			m_frameGraph->wait();
+			m_nextFrameReady = true;
+		}
+
+		// Apply the deferred attribute/client state disables before the UI draws
+		m_glStateCache.flush();
+
+		m_glCapture.endFrame();
+		if (!m_capturePath.empty() && m_glCapture.isDone()) writeCapture();
+
 		// Disable the vertex and pixel shader
 		//m_shader->disable();
 	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::setupViews()
+//
+//    The main camera fills the window; the inset views stack up its right
+//    edge. The first is the main camera zoomed in, inside its frustum, so its
+//    culling comes for free; the second looks straight down on the point the
+//    camera orbits, and the third is a shadow style orthographic view along a
+//    light direction around that point.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::setupViews()
+{
+	const ivec2 window = toPixels(getWindowSize());
+	m_viewCount = 1 + (uint32_t)std::max(0, std::min(m_extraViews, VIEW_COUNT_MAX - 1));
+	m_views[0].m_viewport = Area(0, 0, window.x, window.y);
+	m_views[0].m_view = mCam.getViewMatrix();
+	m_views[0].m_projection = mCam.getProjectionMatrix();
+
+	const int32_t size = window.y / 4;
+	const int32_t margin = 8;
+	const vec3 pivot = mCam.getPivotPoint();
+	for (uint32_t v = 1; v < m_viewCount; v++) {
+		View& view = m_views[v];
+		const int32_t y = margin + (int32_t)(v - 1) * (size + margin);
+		view.m_viewport = Area(window.x - size - margin, y, window.x - margin, y + size);
+		if (v == 1) {
+			CameraPersp zoom = mCam;
+			zoom.setAspectRatio(1.0f);
+			zoom.setFov(0.5f * mCam.getFov());
+			view.m_view = zoom.getViewMatrix();
+			view.m_projection = zoom.getProjectionMatrix();
+		}
+		else if (v == 2) {
+			CameraPersp overview(size, size, 60.0f, 0.1f, 20.0f);
+			overview.lookAt(pivot + vec3(0.0f, 6.0f, 0.01f), pivot);
+			view.m_view = overview.getViewMatrix();
+			view.m_projection = overview.getProjectionMatrix();
+		}
+		else {
+			CameraOrtho light(-3.0f, 3.0f, -3.0f, 3.0f, 0.1f, 20.0f);
+			light.lookAt(pivot + 10.0f * glm::normalize(vec3(1.0f, 2.0f, 1.0f)), pivot);
+			view.m_view = light.getViewMatrix();
+			view.m_projection = light.getProjectionMatrix();
+		}
+	}
+}
+
+
+void BindlessApp::getViewProjection(uint32_t view, float* matrix) const
+{
+	const glm::mat4 viewProjection = m_views[view].m_projection * m_views[view].m_view;
+	memcpy(matrix, &viewProjection[0][0], sizeof(viewProjection));
+}
+
+
+// Bounding spheres of draw list items [begin, end) in world space
+void BindlessApp::computeWorldBounds(uint32_t begin, uint32_t end)
+{
+	for (uint32_t d = begin; d < end; d++) {
+		const DrawItem& item = m_drawList[d];
+		const float* bounds = m_meshes.getMesh(item.mesh).m_bounds;
+		const float* world = m_transforms.getWorld(m_meshNodes[item.slot]);
+		ViewCuller::Sphere& sphere = m_worldBounds[d];
+		float scale = 0.0f;
+		for (int32_t k = 0; k < 3; k++) {
+			sphere.m_center[k] = world[k] * bounds[0] + world[4 + k] * bounds[1] + world[8 + k] * bounds[2] + world[12 + k];
+			scale = std::max(scale, world[4 * k] * world[4 * k] + world[4 * k + 1] * world[4 * k + 1] + world[4 * k + 2] * world[4 * k + 2]);
+		}
+		sphere.m_radius = bounds[3] * sqrt(scale);
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::cullViews()
+//
+//    *** INTERESTING ***
+//    One pass over the draw list for all views, split over the job system:
+//    the world space bounds are computed once and each is tested against the
+//    views it is not already known to be in or out of. Every view then gets
+//    its list of visible items, still in draw list order.
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::cullViews()
+{
+	float viewProjections[VIEW_COUNT_MAX * 16];
+	for (uint32_t v = 0; v < m_viewCount; v++) getViewProjection(v, &viewProjections[v * 16]);
+	m_viewCuller.setViews(viewProjections, m_viewCount);
+
+	const uint32_t count = (uint32_t)m_drawList.size();
+	m_worldBounds.resize(count);
+	m_viewMasks.resize(count);
+	std::atomic<uint32_t> tests(0);
+	if (count != 0) {
+		m_jobs->parallelFor(count, VIEW_CULL_GRAIN, [this, &tests](uint32_t begin, uint32_t end) {
+			computeWorldBounds(begin, end);
+			tests += m_viewCuller.cull(&m_worldBounds[begin], end - begin, &m_viewMasks[begin]);
+		});
+	}
+	m_frustumTests = tests;
+
+	for (uint32_t v = 0; v < m_viewCount; v++) {
+		m_viewItemCounts[v] = (count != 0) ? ViewCuller::compact(&m_viewMasks[0], count, v, &m_viewItems[v][0]) : 0;
+	}
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::drawItems()
+//
+//    Draws the given entries of m_drawList with the view state that is bound;
+//    each item knows the mesh's uniform slot and its GPU pointer
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::drawItems(const uint32_t* items, uint32_t count)
+{
+	for (uint32_t d = 0; d < count; d++)
+	{
+		const DrawItem& item = m_drawList[items[d]];
+
+		// If enabled, update the per mesh uniforms for each mesh rendered
+		if (m_usePerMeshUniforms == true)
+		{
+			if (m_useBindlessUniforms == true)
+			{
+				// *** INTERESTING ***
+				// Pass a GPU pointer to the vertex shader for the per mesh uniform data via a vertex attribute
+				m_gl->vertexAttribI2i(m_bindlessPerMeshUniformsPtrAttribLocation, item.uniformsLow, item.uniformsHigh);
+			}
+			else
+			{
+				// *** INTERESTING ***
+				// Point the uniform block at the mesh's slot; nothing is copied per draw
+				m_gl->bindBufferRange(GL_UNIFORM_BUFFER, 3, m_perMeshUniformSlots,
+					m_perMeshUniformSlotLayout.getOffset(item.slot), sizeof(PerMeshUniforms));
+			}
+		}
+
+		// If we're not sharing vertex formats between meshes, we have to set the vertex format everytime it changes.
+		if (Mesh::m_setVertexFormatOnEveryDrawCall == true)
+		{
+			Mesh::renderPrep();
+		}
+
+		// Now that everything is set up, do the actual rendering
+		// The code that selects between rendering with Vertex Array Objects (VAO) and 
+		// Vertex Buffer Unified Memory (VBUM) is located in Mesh::render()
+		// The code that gets the GPU pointer for use with VBUM rendering is located in Mesh::update()
+		m_meshes.getMesh(item.mesh).render();
 
+
+		// If we're not sharing vertex formats between meshes, we have to reset the vertex format to a default state after each mesh
+		if (Mesh::m_setVertexFormatOnEveryDrawCall == true)
+		{
+			Mesh::renderFinish();
+		}
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -627,8 +2713,18 @@ void BindlessApp::createGround(Mesh& mesh, ci::vec3 pos, ci::vec3 dim)
 {
 	std::vector<Vertex>         vertices;
 	std::vector<uint16_t> indices;
+
+	generateGround(pos, dim, vertices, indices);
+	mesh.update(vertices, indices);
+}
+
+void BindlessApp::generateGround(ci::vec3 pos, ci::vec3 dim, std::vector<Vertex>& vertices, std::vector<uint16_t>& indices)
+{
 	float                  r, g, b;
 
+	vertices.clear();
+	indices.clear();
+
 	dim.x *= 0.5f;
 	dim.z *= 0.5f;
 
@@ -642,8 +2738,6 @@ void BindlessApp::createGround(Mesh& mesh, ci::vec3 pos, ci::vec3 dim)
 	// Create the indices
 	indices.push_back(0); indices.push_back(1); indices.push_back(2);
 	indices.push_back(0); indices.push_back(2); indices.push_back(3);
-
-	mesh.update(vertices, indices);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -657,8 +2751,18 @@ void BindlessApp::createBuilding(Mesh& mesh, ci::vec3 pos, ci::vec3 dim, ci::vec
 {
 	std::vector<Vertex>         vertices;
 	std::vector<uint16_t> indices;
+
+	generateBuilding(pos, dim, vertices, indices);
+	mesh.update(vertices, indices);
+}
+
+void BindlessApp::generateBuilding(ci::vec3 pos, ci::vec3 dim, std::vector<Vertex>& vertices, std::vector<uint16_t>& indices)
+{
 	float                  r, g, b;
 
+	vertices.clear();
+	indices.clear();
+
 	dim.x *= 0.5f;
 	dim.z *= 0.5f;
 
@@ -724,9 +2828,6 @@ void BindlessApp::createBuilding(Mesh& mesh, ci::vec3 pos, ci::vec3 dim, ci::vec
 		indices.push_back((uint16_t)(2 + i));
 		indices.push_back((uint16_t)(3 + i));
 	}
-
-
-	mesh.update(vertices, indices);
 }
 
 
@@ -750,6 +2851,75 @@ void BindlessApp::resize()
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: BindlessApp::cleanup()
+//
+//    Frees what initRendering() created, then reports whatever the memory
+//    tracker still knows about as a leak
+//
+////////////////////////////////////////////////////////////////////////////////
+void BindlessApp::cleanup()
+{
+	// Nothing may still be running on the workers
+	m_frameGraph.reset();
+	m_jobs.reset();
+
+	// The streamed tiles are meshes too; this also waits for a read in flight
+	if (m_cityStreamer) m_cityStreamer->releaseAll();
+	m_cityStreamer.reset();
+
+	// Meshes first: their uploads may still be queued
+	Mesh::m_uploads = nullptr;
+	m_uploads.reset();
+	m_meshes = MeshRegistry(0);
+	Mesh::m_geometryCache = nullptr;
+	m_geometryCache.reset();
+	if (m_replayer) m_replayer->releaseBuffers();
+
+	// Handles must not be resident when their textures go away
+	m_textureResidency.releaseAll();
+	for (int i = 0; i < TEXTURE_FRAME_COUNT; ++i) {
+		if (m_textureRefs[i]) MemoryTracker::untrack(MemoryTracker::KindTexture, m_textureRefs[i]->getId());
+		if (m_displacementTextureRefs[i]) MemoryTracker::untrack(MemoryTracker::KindTexture, m_displacementTextureRefs[i]->getId());
+		m_textureRefs[i].reset();
+		m_displacementTextureRefs[i].reset();
+	}
+	std::vector<GLTextureHandle>().swap(m_compressedTextures);
+
+	// Waits for the GPU once and deletes everything released above
+	Mesh::m_objects = nullptr;
+	m_glObjects.reset();
+
+	// *** INTERESTING ***
+	// These were never freed before the tracker reported them
+	MemoryTracker::untrack(m_textureHandles);
+	MemoryTracker::untrack(m_displacementTextureHandles);
+	MemoryTracker::untrack(m_textureIds);
+	delete[] m_textureHandles;
+	delete[] m_displacementTextureHandles;
+	delete[] m_textureIds;
+	m_textureHandles = m_displacementTextureHandles = nullptr;
+	m_textureIds = nullptr;
+
+	const GLuint buffers[] = { m_uploadStaging, m_transformUniforms, m_perMeshUniforms, m_perMeshUniformSlots, m_modelMatrices, m_materials, m_textureHandleTable };
+	for (size_t i = 0; i < sizeof(buffers) / sizeof(buffers[0]); ++i) {
+		if (buffers[i] == 0) continue;
+		MemoryTracker::untrack(MemoryTracker::KindBuffer, buffers[i]);
+		glDeleteBuffers(1, &buffers[i]);
+	}
+	m_uploadStaging = m_transformUniforms = m_perMeshUniforms = m_perMeshUniformSlots = m_modelMatrices = m_materials = m_textureHandleTable = 0;
+
+	if (!m_perMeshUniformsData.empty()) MemoryTracker::untrack(&m_perMeshUniformsData[0]);
+	if (!m_nextPerMeshUniformsData.empty()) MemoryTracker::untrack(&m_nextPerMeshUniformsData[0]);
+	std::vector<PerMeshUniforms>().swap(m_perMeshUniformsData);
+	std::vector<PerMeshUniforms>().swap(m_nextPerMeshUniformsData);
+	if (!m_perMeshUniformSlotData.empty()) MemoryTracker::untrack(&m_perMeshUniformSlotData[0]);
+	std::vector<uint8_t>().swap(m_perMeshUniformSlotData);
+
+	MemoryTracker::reportLeaks();
+}
+
 
 auto settingsFunc = [](App::Settings *settings)
 {
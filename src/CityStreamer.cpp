@@ -0,0 +1,412 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/CityStreamer.cpp
+//----------------------------------------------------------------------------------
+#include "CityStreamer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+
+CityStreamer::CityStreamer(TileBackend& backend, int32_t tilesX, int32_t tilesZ, float tileSize, float originX, float originZ, uint64_t budgetBytes, bool threaded)
+    : m_backend(backend)
+    , m_tilesX(tilesX)
+    , m_tilesZ(tilesZ)
+    , m_tileSize(tileSize)
+    , m_originX(originX)
+    , m_originZ(originZ)
+    , m_visibleRadius(tileSize)
+    , m_prefetchRadius(2.0f * tileSize)
+    , m_lookAhead(0.0f)
+    , m_budgetBytes(budgetBytes)
+    , m_maxAttachesPerUpdate(MaxReads)
+    , m_update(0)
+    , m_hasCamera(false)
+    , m_lastCameraX(0.0f)
+    , m_lastCameraZ(0.0f)
+    , m_attachedBytes(0)
+    , m_threaded(threaded)
+    , m_busySlot(MaxReads)
+    , m_stop(false)
+{
+    Tile empty;
+    memset(&empty, 0, sizeof(empty));
+    m_tiles.assign(size_t(tilesX) * tilesZ, empty);
+    m_candidates.reserve(m_tiles.size());
+    for(uint32_t r = 0; r < MaxReads; r++)
+    {
+        m_reads[r].m_tile = -1;
+        m_reads[r].m_done = false;
+        m_reads[r].m_ok   = false;
+    }
+    memset(&m_counters, 0, sizeof(m_counters));
+
+    if(m_threaded)
+    {
+        m_thread = std::thread(&CityStreamer::ioMain, this);
+    }
+}
+
+
+CityStreamer::~CityStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    if(m_thread.joinable())
+    {
+        m_thread.join();
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: CityStreamer::update()
+//
+//    *** INTERESTING ***
+//    Finished reads are attached before the budget is applied, and the budget
+//    is applied before new reads are issued, so the memory a tile is going to
+//    take is known before the next one is asked for.
+//
+////////////////////////////////////////////////////////////////////////////////
+void CityStreamer::update(float cameraX, float cameraZ)
+{
+    classify(cameraX, cameraZ);
+    completeReads();
+    enforceBudget();
+    issueReads();
+
+    m_counters.m_residentTiles = 0;
+    m_counters.m_readingTiles  = 0;
+    for(size_t t = 0; t < m_tiles.size(); t++)
+    {
+        m_counters.m_residentTiles += m_tiles[t].m_state == StateResident ? 1 : 0;
+        m_counters.m_readingTiles  += m_tiles[t].m_state == StateReading ? 1 : 0;
+    }
+    m_counters.m_peakResidentBytes = std::max(m_counters.m_peakResidentBytes, m_counters.m_residentBytes);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: CityStreamer::classify()
+//
+//    The prefetch radius is also applied around where the camera will be in
+//    m_lookAhead frames at its current speed, so tiles ahead of a moving
+//    camera are read before the ones it is leaving.
+//
+////////////////////////////////////////////////////////////////////////////////
+void CityStreamer::classify(float cameraX, float cameraZ)
+{
+    const float velocityX = m_hasCamera ? cameraX - m_lastCameraX : 0.0f;
+    const float velocityZ = m_hasCamera ? cameraZ - m_lastCameraZ : 0.0f;
+    const float aheadX = cameraX + velocityX * m_lookAhead;
+    const float aheadZ = cameraZ + velocityZ * m_lookAhead;
+    m_hasCamera   = true;
+    m_lastCameraX = cameraX;
+    m_lastCameraZ = cameraZ;
+
+    m_update++;
+    m_counters.m_misses = 0;
+    for(int32_t t = 0; t < int32_t(m_tiles.size()); t++)
+    {
+        Tile& tile = m_tiles[t];
+        const float distance = getDistance(t, cameraX, cameraZ);
+        tile.m_distance = std::min(distance, getDistance(t, aheadX, aheadZ));
+        tile.m_pinned   = distance <= m_visibleRadius;
+        tile.m_wanted   = tile.m_pinned || tile.m_distance <= m_prefetchRadius;
+        if(tile.m_wanted)
+        {
+            tile.m_lastUsed = m_update;
+        }
+        if(tile.m_pinned && tile.m_state != StateResident)
+        {
+            m_counters.m_misses++;
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: CityStreamer::completeReads()
+//
+//    Queued reads of tiles that went out of range are dropped unread.
+//    Finished reads are attached nearest first; the ones over the per update
+//    limit keep their slot and are attached by a later update.
+//
+////////////////////////////////////////////////////////////////////////////////
+void CityStreamer::completeReads()
+{
+    uint32_t done[MaxReads];
+    uint32_t doneCount = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for(std::deque<uint32_t>::iterator slot = m_queue.begin(); slot != m_queue.end();)
+        {
+            Read& read = m_reads[*slot];
+            if(m_tiles[read.m_tile].m_wanted)
+            {
+                ++slot;
+                continue;
+            }
+            m_tiles[read.m_tile].m_state = StateUnloaded;
+            read.m_tile = -1;
+            m_counters.m_cancelled++;
+            slot = m_queue.erase(slot);
+        }
+
+        for(uint32_t r = 0; r < MaxReads; r++)
+        {
+            if(m_reads[r].m_tile >= 0 && m_reads[r].m_done)
+            {
+                done[doneCount++] = r;
+            }
+        }
+    }
+
+    for(uint32_t i = 1; i < doneCount; i++)
+    {
+        for(uint32_t j = i; j > 0 && m_tiles[m_reads[done[j]].m_tile].m_distance < m_tiles[m_reads[done[j - 1]].m_tile].m_distance; j--)
+        {
+            std::swap(done[j], done[j - 1]);
+        }
+    }
+
+    uint32_t attaches = 0;
+    for(uint32_t i = 0; i < doneCount; i++)
+    {
+        Read& read = m_reads[done[i]];
+        Tile& tile = m_tiles[read.m_tile];
+        if(read.m_ok && tile.m_wanted)
+        {
+            if(attaches == m_maxAttachesPerUpdate)
+            {
+                continue;
+            }
+            attaches++;
+
+            uint64_t bytes = 0;
+            if(m_backend.attach(read.m_data, bytes))
+            {
+                tile.m_state = StateResident;
+                tile.m_bytes = bytes;
+                m_counters.m_residentBytes += bytes;
+                m_counters.m_attached++;
+                m_attachedBytes += bytes;
+                read.m_tile = -1;
+                continue;
+            }
+        }
+
+        if(!read.m_ok || tile.m_wanted)
+        {
+            m_counters.m_failures++;
+        }
+        else
+        {
+            m_counters.m_cancelled++;
+        }
+        tile.m_state = StateUnloaded;
+        read.m_tile = -1;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: CityStreamer::enforceBudget()
+//
+//    *** INTERESTING ***
+//    Evicts the least recently wanted tiles first, among equally recent ones
+//    the farthest. Pinned tiles are never evicted: if they alone exceed the
+//    budget the streamer stays over it rather than leave holes in view.
+//
+////////////////////////////////////////////////////////////////////////////////
+void CityStreamer::enforceBudget()
+{
+    if(m_counters.m_residentBytes <= m_budgetBytes)
+    {
+        return;
+    }
+
+    m_candidates.clear();
+    for(int32_t t = 0; t < int32_t(m_tiles.size()); t++)
+    {
+        if(m_tiles[t].m_state == StateResident && !m_tiles[t].m_pinned)
+        {
+            m_candidates.push_back(t);
+        }
+    }
+    const std::vector<Tile>& tiles = m_tiles;
+    std::sort(m_candidates.begin(), m_candidates.end(), [&tiles](int32_t a, int32_t b) {
+        if(tiles[a].m_lastUsed != tiles[b].m_lastUsed)
+        {
+            return tiles[a].m_lastUsed < tiles[b].m_lastUsed;
+        }
+        return tiles[a].m_distance > tiles[b].m_distance;
+    });
+
+    for(size_t c = 0; c < m_candidates.size() && m_counters.m_residentBytes > m_budgetBytes; c++)
+    {
+        evict(m_candidates[c]);
+        m_counters.m_evictions++;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: CityStreamer::issueReads()
+//
+//    Pinned tiles are always read. A prefetch read is only issued if the
+//    tile, sized like the average tile so far, fits in the budget next to
+//    what is attached and being read; otherwise the prefetch would evict the
+//    tiles it was prefetching and read them again.
+//
+////////////////////////////////////////////////////////////////////////////////
+void CityStreamer::issueReads()
+{
+    uint32_t inFlight = 0;
+    for(uint32_t r = 0; r < MaxReads; r++)
+    {
+        inFlight += m_reads[r].m_tile >= 0 ? 1 : 0;
+    }
+    if(inFlight == MaxReads)
+    {
+        return;
+    }
+
+    m_candidates.clear();
+    for(int32_t t = 0; t < int32_t(m_tiles.size()); t++)
+    {
+        if(m_tiles[t].m_state == StateUnloaded && m_tiles[t].m_wanted)
+        {
+            m_candidates.push_back(t);
+        }
+    }
+    const std::vector<Tile>& tiles = m_tiles;
+    std::sort(m_candidates.begin(), m_candidates.end(), [&tiles](int32_t a, int32_t b) {
+        if(tiles[a].m_pinned != tiles[b].m_pinned)
+        {
+            return tiles[a].m_pinned;
+        }
+        return tiles[a].m_distance < tiles[b].m_distance;
+    });
+
+    const uint64_t estimate = m_counters.m_attached != 0 ? m_attachedBytes / m_counters.m_attached : 0;
+    uint32_t slot = 0;
+    for(size_t c = 0; c < m_candidates.size() && inFlight < MaxReads; c++)
+    {
+        Tile& tile = m_tiles[m_candidates[c]];
+        if(!tile.m_pinned && m_counters.m_residentBytes + (inFlight + 1) * estimate > m_budgetBytes)
+        {
+            break;
+        }
+        while(m_reads[slot].m_tile >= 0)
+        {
+            slot++;
+        }
+
+        Read& read  = m_reads[slot];
+        read.m_tile = m_candidates[c];
+        read.m_done = false;
+        read.m_ok   = false;
+        tile.m_state = StateReading;
+        m_counters.m_reads++;
+        inFlight++;
+
+        if(m_threaded)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_queue.push_back(slot);
+            }
+            m_wake.notify_one();
+        }
+        else
+        {
+            read.m_ok   = m_backend.load(read.m_tile % m_tilesX, read.m_tile / m_tilesX, read.m_data);
+            read.m_done = true;
+        }
+    }
+}
+
+
+void CityStreamer::releaseAll()
+{
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_queue.clear();
+        m_readDone.wait(lock, [this]() { return m_busySlot == MaxReads; });
+    }
+    for(uint32_t r = 0; r < MaxReads; r++)
+    {
+        if(m_reads[r].m_tile >= 0)
+        {
+            m_tiles[m_reads[r].m_tile].m_state = StateUnloaded;
+            m_reads[r].m_tile = -1;
+        }
+    }
+    for(int32_t t = 0; t < int32_t(m_tiles.size()); t++)
+    {
+        if(m_tiles[t].m_state == StateResident)
+        {
+            evict(t);
+        }
+    }
+    m_counters.m_residentTiles = 0;
+    m_counters.m_readingTiles  = 0;
+    m_hasCamera = false;
+}
+
+
+void CityStreamer::evict(int32_t tile)
+{
+    m_backend.detach(tile % m_tilesX, tile / m_tilesX);
+    m_counters.m_residentBytes -= m_tiles[tile].m_bytes;
+    m_tiles[tile].m_bytes = 0;
+    m_tiles[tile].m_state = StateUnloaded;
+}
+
+
+// To the nearest point of the tile, so a large tile counts as close as soon as the camera reaches its edge
+float CityStreamer::getDistance(int32_t tile, float x, float z) const
+{
+    const float minX = m_originX + float(tile % m_tilesX) * m_tileSize;
+    const float minZ = m_originZ + float(tile / m_tilesX) * m_tileSize;
+    const float dx = std::max(std::max(minX - x, x - (minX + m_tileSize)), 0.0f);
+    const float dz = std::max(std::max(minZ - z, z - (minZ + m_tileSize)), 0.0f);
+    return std::sqrt(dx * dx + dz * dz);
+}
+
+
+void CityStreamer::ioMain()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for(;;)
+    {
+        m_wake.wait(lock, [this]() { return m_stop || !m_queue.empty(); });
+        if(m_stop)
+        {
+            return;
+        }
+        const uint32_t slot = m_queue.front();
+        m_queue.pop_front();
+        m_busySlot = slot;
+
+        // The main thread leaves a slot alone until it is done
+        Read& read = m_reads[slot];
+        const int32_t tile = read.m_tile;
+        lock.unlock();
+        const bool ok = m_backend.load(tile % m_tilesX, tile / m_tilesX, read.m_data);
+        lock.lock();
+
+        read.m_ok   = ok;
+        read.m_done = true;
+        m_busySlot  = MaxReads;
+        m_readDone.notify_all();
+    }
+}
@@ -0,0 +1,160 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/CityStreamer.h
+//
+// Keeps the tiles of a city that is too large to hold at once loaded around a
+// moving camera. Every update() classifies the tiles by their distance to the
+// camera: tiles within the visible radius are pinned and must be loaded, tiles
+// within the prefetch radius (of the camera, or of where it is heading) are
+// loaded ahead of need, nearest first. Tiles that are no longer wanted stay
+// attached in LRU order until the memory budget is exceeded.
+//
+// Reads go to one I/O thread that the streamer owns, with only a few of them
+// outstanding, so the order is decided again every frame and a tile the camera
+// has left behind is dropped before it is read. (They are not JobSystem jobs:
+// wait() runs queued jobs on the waiting thread, which would put a blocking
+// read on the frame's critical path.) Attaching and detaching go through a
+// TileBackend on the thread that calls update(), so the policy can be driven
+// headlessly along a simulated camera path with a mock backend.
+//----------------------------------------------------------------------------------
+#ifndef CITY_STREAMER_H
+#define CITY_STREAMER_H
+
+#include "CityTile.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class TileBackend
+{
+public:
+    virtual ~TileBackend() {}
+
+    // On the I/O thread (in update() when the streamer is not threaded); false if the tile cannot be read
+    virtual bool load(int32_t x, int32_t z, CityTile& tile) = 0;
+    // From update(): registers the tile's meshes and reports the memory they take. False when there is
+    // no room; the tile is dropped and asked for again later.
+    virtual bool attach(const CityTile& tile, uint64_t& bytes) = 0;
+    virtual void detach(int32_t x, int32_t z) = 0;
+};
+
+class CityStreamer
+{
+public:
+    struct Counters
+    {
+        uint32_t m_reads;           // reads issued
+        uint32_t m_attached;
+        uint32_t m_failures;        // reads that failed and attaches without room
+        uint32_t m_cancelled;       // reads dropped because the tile went out of range first
+        uint32_t m_evictions;
+        uint32_t m_misses;          // per update, the pinned tiles that were not attached yet
+        uint32_t m_residentTiles;
+        uint32_t m_readingTiles;
+        uint64_t m_residentBytes;
+        uint64_t m_peakResidentBytes;
+    };
+
+    static const uint32_t MaxReads = 4;
+
+    // The world is tilesX by tilesZ tiles of tileSize units, tile (0, 0) starting at (originX, originZ).
+    // When threaded is false the reads run inside update() and complete on the next one, so a
+    // simulated run gives the same result every time.
+    CityStreamer(TileBackend& backend, int32_t tilesX, int32_t tilesZ, float tileSize, float originX, float originZ, uint64_t budgetBytes, bool threaded);
+    ~CityStreamer();
+
+    void     setRadii(float visibleRadius, float prefetchRadius) { m_visibleRadius = visibleRadius; m_prefetchRadius = prefetchRadius; }
+    void     setBudget(uint64_t budgetBytes)                    { m_budgetBytes = budgetBytes; }
+    // Frames of the camera's current motion the prefetch looks ahead
+    void     setLookAhead(float frames)                         { m_lookAhead = frames; }
+    // Attaching registers meshes and queues their uploads, so it is spread over frames
+    void     setMaxAttachesPerUpdate(uint32_t count)            { m_maxAttachesPerUpdate = count; }
+    float    getVisibleRadius() const                           { return m_visibleRadius; }
+    float    getPrefetchRadius() const                          { return m_prefetchRadius; }
+    uint64_t getBudget() const                                  { return m_budgetBytes; }
+
+    // Camera position on the ground plane, in the city's space. Call once per frame.
+    void     update(float cameraX, float cameraZ);
+
+    // Drops the outstanding reads and detaches every tile, e.g. before the meshes are destroyed
+    void     releaseAll();
+
+    bool     isResident(int32_t x, int32_t z) const { return m_tiles[z * m_tilesX + x].m_state == StateResident; }
+    int32_t  getTilesX() const                      { return m_tilesX; }
+    int32_t  getTilesZ() const                      { return m_tilesZ; }
+
+    const Counters& getCounters() const             { return m_counters; }
+
+private:
+    enum State
+    {
+        StateUnloaded,
+        StateReading,
+        StateResident,
+    };
+
+    struct Tile
+    {
+        uint8_t  m_state;
+        bool     m_wanted;          // within the prefetch radius this update
+        bool     m_pinned;          // within the visible radius this update
+        float    m_distance;        // to the camera or its predicted position, whichever is nearer
+        uint64_t m_bytes;
+        uint64_t m_lastUsed;        // update of the last time the tile was wanted
+    };
+
+    // A read slot; the I/O thread only touches a slot between taking it from the queue and setting m_done
+    struct Read
+    {
+        int32_t  m_tile;            // -1 when the slot is free
+        bool     m_done;
+        bool     m_ok;
+        CityTile m_data;
+    };
+
+    CityStreamer(const CityStreamer&);
+    CityStreamer& operator=(const CityStreamer&);
+
+    void  classify(float cameraX, float cameraZ);
+    void  completeReads();
+    void  enforceBudget();
+    void  issueReads();
+    void  evict(int32_t tile);
+    float getDistance(int32_t tile, float x, float z) const;
+    void  ioMain();
+
+    TileBackend&              m_backend;
+    int32_t                   m_tilesX;
+    int32_t                   m_tilesZ;
+    float                     m_tileSize;
+    float                     m_originX;
+    float                     m_originZ;
+    float                     m_visibleRadius;
+    float                     m_prefetchRadius;
+    float                     m_lookAhead;
+    uint64_t                  m_budgetBytes;
+    uint32_t                  m_maxAttachesPerUpdate;
+    uint64_t                  m_update;
+    bool                      m_hasCamera;
+    float                     m_lastCameraX;
+    float                     m_lastCameraZ;
+
+    std::vector<Tile>         m_tiles;
+    std::vector<int32_t>      m_candidates;         // scratch, reserved to the tile count
+    Read                      m_reads[MaxReads];
+    Counters                  m_counters;
+    uint64_t                  m_attachedBytes;      // over all attaches, for the size estimate of a tile not read yet
+
+    bool                      m_threaded;
+    std::thread               m_thread;
+    std::mutex                m_mutex;              // guards m_queue, m_stop and the slots' m_done/m_ok
+    std::condition_variable   m_wake;
+    std::condition_variable   m_readDone;
+    std::deque<uint32_t>      m_queue;              // slots waiting for the I/O thread
+    uint32_t                  m_busySlot;           // slot being read, MaxReads when none
+    bool                      m_stop;
+};
+
+#endif
@@ -0,0 +1,201 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/CityTile.cpp
+//----------------------------------------------------------------------------------
+#include "CityTile.h"
+#include "GeometryCodec.h"
+#include "AtomicFile.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+    const uint32_t TileMagic   = 0x314c5443; // "CTL1"
+    const uint32_t TileVersion = 2;
+
+    struct TileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        int32_t  x;
+        int32_t  z;
+        uint32_t buildingCount;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        uint32_t vertexBytes;       // encoded sizes
+        uint32_t indexBytes;
+        uint32_t reserved;
+    };
+
+    uint64_t payloadBytes(const TileHeader& header)
+    {
+        return uint64_t(header.buildingCount) * sizeof(CityTile::Building) + header.vertexBytes + header.indexBytes;
+    }
+
+    // Also rejects counts the encoded sizes cannot hold (each group of 16 vertices takes at
+    // least a byte per word, each triangle two bits), so what a damaged header can make read()
+    // allocate is bounded by the file size.
+    bool readHeader(std::ifstream& file, int32_t x, int32_t z, TileHeader& header)
+    {
+        if(!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        {
+            return false;
+        }
+        return header.magic == TileMagic && header.version == TileVersion && header.x == x && header.z == z &&
+               uint64_t(header.vertexBytes) >= (uint64_t(header.vertexCount) + 15) / 16 * (sizeof(CityTile::PackedVertex) / 4) &&
+               header.indexCount % 3 == 0 && uint64_t(header.indexBytes) >= (uint64_t(header.indexCount) / 3 + 3) / 4;
+    }
+
+    std::streamoff getFileSize(std::ifstream& file)
+    {
+        file.seekg(0, std::ios::end);
+        const std::streamoff size = file ? std::streamoff(file.tellg()) : 0;
+        file.seekg(0);
+        return size;
+    }
+}
+
+
+void CityTile::clear()
+{
+    m_buildings.clear();
+    m_vertices.clear();
+    m_indices.clear();
+}
+
+
+void CityTile::addBuilding(int32_t i, int32_t k, const PackedVertex* vertices, uint32_t vertexCount, const uint16_t* indices, uint32_t indexCount)
+{
+    Building building = { i, k, uint32_t(m_vertices.size()), vertexCount, uint32_t(m_indices.size()), indexCount };
+    m_buildings.push_back(building);
+    m_vertices.insert(m_vertices.end(), vertices, vertices + vertexCount);
+    m_indices.insert(m_indices.end(), indices, indices + indexCount);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: CityTile::read()
+//
+//    The file comes from disk, so the sizes in the header are checked against
+//    the file's and the building ranges before anyone indexes with them. The
+//    vectors keep their capacity, a tile read into a reused CityTile does not
+//    allocate once it has grown.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool CityTile::read(const std::string& path, int32_t x, int32_t z)
+{
+    clear();
+    std::ifstream file(path.c_str(), std::ios::binary);
+    const std::streamoff size = getFileSize(file);
+    TileHeader header;
+    if(!readHeader(file, x, z, header) || uint64_t(size) != sizeof(header) + payloadBytes(header))
+    {
+        return false;
+    }
+
+    m_x = x;
+    m_z = z;
+    m_buildings.resize(header.buildingCount);
+    m_encoded.resize(size_t(header.vertexBytes) + header.indexBytes);
+    if((header.buildingCount != 0 && !file.read(reinterpret_cast<char*>(&m_buildings[0]), header.buildingCount * sizeof(Building))) ||
+       (!m_encoded.empty() && !file.read(reinterpret_cast<char*>(&m_encoded[0]), m_encoded.size())))
+    {
+        clear();
+        return false;
+    }
+
+    m_vertices.resize(header.vertexCount);
+    m_indices.resize(header.indexCount);
+    m_tileIndices.resize(header.indexCount);
+    bool valid = GeometryCodec::decodeVertices(m_encoded.data(), header.vertexBytes, m_vertices.data(), header.vertexCount, sizeof(PackedVertex)) &&
+                 GeometryCodec::decodeIndices(m_encoded.data() + header.vertexBytes, header.indexBytes, m_tileIndices.data(), header.indexCount);
+    for(size_t b = 0; valid && b < m_buildings.size(); b++)
+    {
+        const Building& building = m_buildings[b];
+        valid = uint64_t(building.m_firstVertex) + building.m_vertexCount <= header.vertexCount &&
+                uint64_t(building.m_firstIndex) + building.m_indexCount <= header.indexCount;
+        for(uint32_t i = 0; valid && i < building.m_indexCount; i++)
+        {
+            const uint32_t index = m_tileIndices[building.m_firstIndex + i] - building.m_firstVertex;
+            valid = index < building.m_vertexCount;
+            m_indices[building.m_firstIndex + i] = uint16_t(index);
+        }
+    }
+    if(!valid)
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: CityTile::write()
+//
+//    Written to a temporary file and renamed into place, like the texture
+//    cache, so a reader never sees half a tile.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool CityTile::write(const std::string& path)
+{
+    m_tileIndices.assign(m_indices.begin(), m_indices.end());
+    for(size_t b = 0; b < m_buildings.size(); b++)
+    {
+        const Building& building = m_buildings[b];
+        for(uint32_t i = 0; i < building.m_indexCount; i++)
+        {
+            m_tileIndices[building.m_firstIndex + i] += building.m_firstVertex;
+        }
+    }
+    std::vector<uint8_t> encodedIndices;
+    GeometryCodec::encodeVertices(m_vertices.data(), m_vertices.size(), sizeof(PackedVertex), m_encoded);
+    GeometryCodec::encodeIndices(m_tileIndices.data(), m_tileIndices.size(), encodedIndices);
+
+    TileHeader header;
+    header.magic         = TileMagic;
+    header.version       = TileVersion;
+    header.x             = m_x;
+    header.z             = m_z;
+    header.buildingCount = uint32_t(m_buildings.size());
+    header.vertexCount   = uint32_t(m_vertices.size());
+    header.indexCount    = uint32_t(m_indices.size());
+    header.vertexBytes   = uint32_t(m_encoded.size());
+    header.indexBytes    = uint32_t(encodedIndices.size());
+    header.reserved      = 0;
+
+    return writeFileAtomic(path, [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if(!m_buildings.empty())
+        {
+            file.write(reinterpret_cast<const char*>(&m_buildings[0]), m_buildings.size() * sizeof(Building));
+        }
+        if(!m_encoded.empty())
+        {
+            file.write(reinterpret_cast<const char*>(&m_encoded[0]), m_encoded.size());
+        }
+        if(!encodedIndices.empty())
+        {
+            file.write(reinterpret_cast<const char*>(&encodedIndices[0]), encodedIndices.size());
+        }
+    });
+}
+
+
+bool CityTile::probe(const std::string& path, int32_t x, int32_t z)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    const std::streamoff size = getFileSize(file);
+    TileHeader header;
+    return readHeader(file, x, z, header) && uint64_t(size) == sizeof(header) + payloadBytes(header);
+}
+
+
+std::string CityTile::getPath(const std::string& dir, int32_t x, int32_t z)
+{
+    std::ostringstream path;
+    path << dir << "/tile_" << x << "_" << z << ".bin";
+    return path.str();
+}
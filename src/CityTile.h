@@ -0,0 +1,63 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/CityTile.h
+//
+// One square block of the streamed city, as it is stored on disk: the buildings
+// of the block's grid cells, each a range of one shared vertex and index array.
+// Vertices keep only position and color; the rest of a Vertex is zero and is
+// filled in when the tile is attached, so a file is a small fraction of the GPU
+// memory the tile turns into. The vertex and index arrays are stored with
+// GeometryCodec, the indices as offsets into the tile's whole vertex array so
+// consecutive buildings continue each other's triangle pattern. Reading does
+// not touch GL, so it can run on any thread.
+//----------------------------------------------------------------------------------
+#ifndef CITY_TILE_H
+#define CITY_TILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CityTile
+{
+public:
+    struct PackedVertex
+    {
+        float   m_position[3];
+        uint8_t m_color[4];
+    };
+
+    struct Building
+    {
+        int32_t  m_i;               // grid cell
+        int32_t  m_k;
+        uint32_t m_firstVertex;
+        uint32_t m_vertexCount;
+        uint32_t m_firstIndex;
+        uint32_t m_indexCount;      // the indices are relative to the building's first vertex
+    };
+
+    int32_t                   m_x;
+    int32_t                   m_z;
+    std::vector<Building>     m_buildings;
+    std::vector<PackedVertex> m_vertices;
+    std::vector<uint16_t>     m_indices;
+
+    // Scratch for read() and write(), kept so a reused tile does not allocate
+    std::vector<uint8_t>      m_encoded;
+    std::vector<uint32_t>     m_tileIndices;
+
+    CityTile() : m_x(0), m_z(0) {}
+
+    void clear();
+    void addBuilding(int32_t i, int32_t k, const PackedVertex* vertices, uint32_t vertexCount, const uint16_t* indices, uint32_t indexCount);
+
+    // Fails on a missing or damaged file, or one that holds another tile
+    bool read(const std::string& path, int32_t x, int32_t z);
+    bool write(const std::string& path);
+
+    // Checks the header only, to tell whether a baked tile can be kept
+    static bool probe(const std::string& path, int32_t x, int32_t z);
+    static std::string getPath(const std::string& dir, int32_t x, int32_t z);
+};
+
+#endif
@@ -0,0 +1,78 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/DirtyRangeTracker.cpp
+//----------------------------------------------------------------------------------
+#include "DirtyRangeTracker.h"
+#include <algorithm>
+#include <cstring>
+
+
+DirtyRangeTracker::DirtyRangeTracker(size_t elementBytes, uint32_t capacity, uint32_t mergeGap)
+    : m_elementBytes(elementBytes)
+    , m_capacity(capacity)
+    , m_mergeGap(mergeGap)
+    , m_shadow(elementBytes * capacity)
+    , m_valid(capacity, 0)
+{
+    // Changed elements more than mergeGap apart start a new run, so there are never more runs than this
+    m_ranges.reserve(capacity / (mergeGap + 1) + 1);
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: DirtyRangeTracker::update()
+//
+//    *** INTERESTING ***
+//    A merged gap is uploaded from the array too; those elements compared
+//    equal to the shadow, so the shadow stays exact.
+//
+////////////////////////////////////////////////////////////////////////////////
+const std::vector<DirtyRangeTracker::Range>& DirtyRangeTracker::update(const void* elements, uint32_t first, uint32_t count)
+{
+    m_ranges.clear();
+    memset(&m_stats, 0, sizeof(m_stats));
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(elements);
+    const uint32_t end   = std::min(first + count, m_capacity);
+    for(uint32_t i = first; i < end; i++)
+    {
+        const uint8_t* element = bytes + i * m_elementBytes;
+        uint8_t*       shadow  = &m_shadow[i * m_elementBytes];
+        if(m_valid[i] && memcmp(element, shadow, m_elementBytes) == 0)
+        {
+            continue;
+        }
+        memcpy(shadow, element, m_elementBytes);
+        m_valid[i] = 1;
+        m_stats.m_changedElements++;
+
+        if(!m_ranges.empty() && i - (m_ranges.back().m_first + m_ranges.back().m_count) <= m_mergeGap)
+        {
+            m_ranges.back().m_count = i + 1 - m_ranges.back().m_first;
+        }
+        else
+        {
+            Range range = { i, 1 };
+            m_ranges.push_back(range);
+        }
+    }
+
+    m_stats.m_ranges = uint32_t(m_ranges.size());
+    for(size_t r = 0; r < m_ranges.size(); r++)
+    {
+        m_stats.m_uploadedElements += m_ranges[r].m_count;
+    }
+    m_stats.m_uploadedBytes = uint64_t(m_stats.m_uploadedElements) * m_elementBytes;
+    return m_ranges;
+}
+
+
+void DirtyRangeTracker::invalidate(uint32_t first, uint32_t count)
+{
+    const uint32_t end = std::min(first + count, m_capacity);
+    for(uint32_t i = first; i < end; i++)
+    {
+        m_valid[i] = 0;
+    }
+}
@@ -0,0 +1,58 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/DirtyRangeTracker.h
+//
+// Finds the parts of an array of fixed size elements that have to be sent to a
+// GPU buffer. The tracker keeps a shadow of what the buffer holds and compares
+// each element against it, so it does not matter who wrote the CPU copy or how
+// many copies there are (the pipelined frames swap two). Changed elements are
+// returned as runs; runs separated by at most mergeGap unchanged elements are
+// merged, since one slightly larger upload is cheaper than two calls.
+//----------------------------------------------------------------------------------
+#ifndef DIRTY_RANGE_TRACKER_H
+#define DIRTY_RANGE_TRACKER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class DirtyRangeTracker
+{
+public:
+    struct Range
+    {
+        uint32_t m_first;
+        uint32_t m_count;
+    };
+
+    // Of the last update()
+    struct Stats
+    {
+        uint32_t m_ranges;
+        uint32_t m_changedElements;
+        uint32_t m_uploadedElements;    // changed plus the merged gaps
+        uint64_t m_uploadedBytes;
+    };
+
+    DirtyRangeTracker(size_t elementBytes, uint32_t capacity, uint32_t mergeGap);
+
+    // Compares elements [first, first + count) of the array against the shadow and takes the changes over;
+    // the caller uploads the returned runs. Does not allocate.
+    const std::vector<Range>& update(const void* elements, uint32_t first, uint32_t count);
+    // The buffer was written behind the tracker's back; these elements are sent by the next update()
+    void invalidate(uint32_t first, uint32_t count);
+    void invalidateAll()                    { invalidate(0, m_capacity); }
+
+    const Stats& getStats() const           { return m_stats; }
+    size_t       getElementBytes() const    { return m_elementBytes; }
+
+private:
+    size_t               m_elementBytes;
+    uint32_t             m_capacity;
+    uint32_t             m_mergeGap;
+    std::vector<uint8_t> m_shadow;
+    std::vector<uint8_t> m_valid;           // per element: the shadow matches the buffer
+    std::vector<Range>   m_ranges;
+    Stats                m_stats;
+};
+
+#endif
@@ -0,0 +1,212 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/FrameArena.cpp
+//----------------------------------------------------------------------------------
+#include "FrameArena.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef FRAME_ARENA_COUNT_HEAP
+namespace
+{
+    // Constant initialized, so allocations made during static initialization are counted too
+    std::atomic<uint64_t> s_heapAllocations(0);
+
+    void* countedAlloc(size_t size)
+    {
+        s_heapAllocations.fetch_add(1, std::memory_order_relaxed);
+        return malloc(size != 0 ? size : 1);
+    }
+}
+
+void* operator new(size_t size)
+{
+    void* p = countedAlloc(size);
+    if(p == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept                          { free(p); }
+void operator delete[](void* p) noexcept                        { free(p); }
+void operator delete(void* p, size_t) noexcept                  { free(p); }
+void operator delete[](void* p, size_t) noexcept                { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept   { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+#endif
+
+
+uint64_t FrameArena::getHeapAllocationCount()
+{
+#ifdef FRAME_ARENA_COUNT_HEAP
+    return s_heapAllocations.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
+
+bool FrameArena::isCountingHeapAllocations()
+{
+#ifdef FRAME_ARENA_COUNT_HEAP
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+FrameArena::FrameArena(size_t bytesPerFrame, uint32_t framesInFlight)
+    : m_blocks(std::max(framesInFlight, 1u))
+    , m_current(0)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    for(size_t i = 0; i < m_blocks.size(); i++)
+    {
+        Block& block = m_blocks[i];
+        block.m_memory        = static_cast<uint8_t*>(::operator new(bytesPerFrame));
+        block.m_capacity      = bytesPerFrame;
+        block.m_used          = 0;
+        block.m_overflowBytes = 0;
+    }
+    m_stats.m_capacityBytes = bytesPerFrame;
+}
+
+
+FrameArena::~FrameArena()
+{
+    for(size_t i = 0; i < m_blocks.size(); i++)
+    {
+        for(size_t j = 0; j < m_blocks[i].m_overflow.size(); j++)
+        {
+            ::operator delete(m_blocks[i].m_overflow[j]);
+        }
+        ::operator delete(m_blocks[i].m_memory);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: FrameArena::beginFrame()
+//
+//    *** INTERESTING ***
+//    The block being rewound is the only one nobody reads any more. If its
+//    last frame did not fit, it is replaced by one of the high water size
+//    now, which is the only time the arena itself allocates after startup.
+//
+////////////////////////////////////////////////////////////////////////////////
+void FrameArena::beginFrame()
+{
+    const Block& finished = m_blocks[m_current];
+    m_stats.m_lastFrameBytes = finished.m_used + finished.m_overflowBytes;
+    m_stats.m_overflowBytes  = finished.m_overflowBytes;
+    m_stats.m_highWaterBytes = std::max(m_stats.m_highWaterBytes, m_stats.m_lastFrameBytes);
+    m_stats.m_frames++;
+
+    m_current = (m_current + 1) % uint32_t(m_blocks.size());
+    Block& block = m_blocks[m_current];
+    for(size_t i = 0; i < block.m_overflow.size(); i++)
+    {
+        ::operator delete(block.m_overflow[i]);
+    }
+    block.m_overflow.clear();
+
+    if(block.m_capacity < m_stats.m_highWaterBytes)
+    {
+        // Some headroom for the alignment padding of a frame that size
+        const size_t capacity = size_t(m_stats.m_highWaterBytes) + size_t(m_stats.m_highWaterBytes) / 8;
+        ::operator delete(block.m_memory);
+        block.m_memory   = static_cast<uint8_t*>(::operator new(capacity));
+        block.m_capacity = capacity;
+        m_stats.m_growths++;
+    }
+    block.m_used          = 0;
+    block.m_overflowBytes = 0;
+
+    m_stats.m_capacityBytes = block.m_capacity;
+    m_stats.m_usedBytes     = 0;
+    m_stats.m_allocations   = 0;
+}
+
+
+void* FrameArena::allocate(size_t bytes, size_t alignment)
+{
+    Block& block = m_blocks[m_current];
+    m_stats.m_allocations++;
+
+    // Aligned as an address, the block itself only has operator new's alignment
+    const uintptr_t base   = reinterpret_cast<uintptr_t>(block.m_memory);
+    const size_t    offset = size_t(((base + block.m_used + alignment - 1) & ~uintptr_t(alignment - 1)) - base);
+    if(offset + bytes > block.m_capacity)
+    {
+        return allocateOverflow(bytes, alignment);
+    }
+    block.m_used        = offset + bytes;
+    m_stats.m_usedBytes = block.m_used + block.m_overflowBytes;
+    return block.m_memory + offset;
+}
+
+
+void* FrameArena::allocateOverflow(size_t bytes, size_t alignment)
+{
+    // operator new is aligned for any fundamental type; larger alignments get padded by hand
+    Block& block = m_blocks[m_current];
+    const size_t padding = (alignment > DefaultAlignment) ? alignment : 0;
+    uint8_t* memory = static_cast<uint8_t*>(::operator new(bytes + padding));
+    block.m_overflow.push_back(memory);
+    block.m_overflowBytes += bytes + padding;
+    m_stats.m_usedBytes = block.m_used + block.m_overflowBytes;
+
+    const uintptr_t address = (reinterpret_cast<uintptr_t>(memory) + alignment - 1) & ~uintptr_t(alignment - 1);
+    return reinterpret_cast<void*>(address);
+}
+
+
+const char* FrameArena::format(const char* fmt, ...)
+{
+    // Formatted straight into the free part of the block when it fits, the common case
+    Block& block = m_blocks[m_current];
+    char*  space = reinterpret_cast<char*>(block.m_memory + block.m_used);
+    const size_t available = block.m_capacity - block.m_used;
+
+    va_list args;
+    va_start(args, fmt);
+    const int length = vsnprintf(space, available, fmt, args);
+    va_end(args);
+    if(length < 0)
+    {
+        return "";
+    }
+    if(size_t(length) < available)
+    {
+        // Byte aligned, so this claims exactly the text just written
+        return static_cast<const char*>(allocate(size_t(length) + 1, 1));
+    }
+
+    char* text = static_cast<char*>(allocate(size_t(length) + 1, 1));
+    va_start(args, fmt);
+    vsnprintf(text, size_t(length) + 1, fmt, args);
+    va_end(args);
+    return text;
+}
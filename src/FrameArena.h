@@ -0,0 +1,135 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/FrameArena.h
+//
+// Linear allocator for data that only lives for a frame (UI strings, upload
+// payloads, scratch lists). Allocation bumps an offset in a preallocated block
+// and nothing is freed individually; beginFrame() rewinds the block of the frame
+// that is framesInFlight frames old, so what was allocated last frame stays
+// valid while this frame is built.
+//
+// A frame that outgrows its block is served from the heap and the block is
+// grown to the high water mark the next time it is rewound, so once the frame
+// sizes have settled the frame path does not touch the heap at all. Objects are
+// never destroyed, only trivially destructible types may be placed in the arena.
+//
+// To check that claim, build FrameArena.cpp with FRAME_ARENA_COUNT_HEAP defined:
+// it then replaces the global operator new with one that counts its calls (see
+// getHeapAllocationCount()). That is meant for tests and benchmark builds, the
+// default build leaves the global allocator alone.
+//----------------------------------------------------------------------------------
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+class FrameArena
+{
+public:
+    struct Stats
+    {
+        uint64_t m_capacityBytes;       // of the current frame's block
+        uint64_t m_usedBytes;           // allocated so far this frame
+        uint64_t m_lastFrameBytes;      // allocated during the previous frame
+        uint64_t m_highWaterBytes;      // largest frame so far
+        uint64_t m_overflowBytes;       // previous frame, served from the heap
+        uint32_t m_allocations;         // this frame
+        uint32_t m_growths;             // blocks regrown to the high water mark
+        uint64_t m_frames;
+    };
+
+    static const size_t DefaultAlignment = 16;
+
+    explicit FrameArena(size_t bytesPerFrame, uint32_t framesInFlight = 2);
+    ~FrameArena();
+
+    void  beginFrame();
+    void* allocate(size_t bytes, size_t alignment = DefaultAlignment);
+
+    // Uninitialized storage for count objects
+    template<typename T>
+    T*    allocateArray(size_t count);
+
+    template<typename T, typename... Args>
+    T*    create(Args&&... args);
+
+    // printf into the arena, valid until the block is rewound
+    const char* format(const char* fmt, ...);
+
+    const Stats& getStats() const { return m_stats; }
+
+    // Calls of the global operator new since startup, from any thread (0 without FRAME_ARENA_COUNT_HEAP)
+    static uint64_t getHeapAllocationCount();
+    static bool     isCountingHeapAllocations();
+
+private:
+    struct Block
+    {
+        uint8_t*           m_memory;
+        size_t             m_capacity;
+        size_t             m_used;
+        size_t             m_overflowBytes;
+        std::vector<void*> m_overflow;      // heap allocations made when the block was full
+    };
+
+    FrameArena(const FrameArena&);
+    FrameArena& operator=(const FrameArena&);
+
+    void* allocateOverflow(size_t bytes, size_t alignment);
+
+    std::vector<Block> m_blocks;
+    uint32_t           m_current;
+    Stats              m_stats;
+};
+
+
+// STL allocator over a FrameArena: deallocate() does nothing, so containers
+// should reserve up front rather than grow (each growth leaves the old storage behind)
+template<typename T>
+class FrameAllocator
+{
+public:
+    typedef T value_type;
+
+    explicit FrameAllocator(FrameArena& arena) : m_arena(&arena) {}
+    template<typename U>
+    FrameAllocator(const FrameAllocator<U>& other) : m_arena(other.getArena()) {}
+
+    T*   allocate(size_t count)   { return static_cast<T*>(m_arena->allocate(count * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t)   {}
+
+    FrameArena* getArena() const  { return m_arena; }
+
+private:
+    FrameArena* m_arena;
+};
+
+template<typename T, typename U>
+bool operator==(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.getArena() == b.getArena(); }
+template<typename T, typename U>
+bool operator!=(const FrameAllocator<T>& a, const FrameAllocator<U>& b) { return a.getArena() != b.getArena(); }
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T> >;
+
+
+template<typename T>
+T* FrameArena::allocateArray(size_t count)
+{
+    static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+    return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+}
+
+
+template<typename T, typename... Args>
+T* FrameArena::create(Args&&... args)
+{
+    static_assert(std::is_trivially_destructible<T>::value, "arena objects are never destroyed");
+    return new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+}
+
+#endif
@@ -0,0 +1,170 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GLBackend.cpp
+//----------------------------------------------------------------------------------
+#include "GLBackend.h"
+#include <cstring>
+
+
+GLint GLDirectBackend::getUniformLocation(GLuint program, const char* name)                 { return glGetUniformLocation(program, name); }
+void  GLDirectBackend::programUniform1i(GLuint program, GLint location, GLint value)        { glProgramUniform1iEXT(program, location, value); }
+void  GLDirectBackend::programUniformui64v(GLuint program, GLint location, GLsizei count, const GLuint64EXT* values) { glProgramUniformui64vNV(program, location, count, values); }
+
+void  GLDirectBackend::enableVertexAttribArray(GLuint index)                                 { glEnableVertexAttribArray(index); }
+void  GLDirectBackend::disableVertexAttribArray(GLuint index)                                { glDisableVertexAttribArray(index); }
+void  GLDirectBackend::enableVertexArrayAttrib(GLuint vao, GLuint index)                     { glEnableVertexArrayAttribEXT(vao, index); }
+void  GLDirectBackend::disableVertexArrayAttrib(GLuint vao, GLuint index)                    { glDisableVertexArrayAttribEXT(vao, index); }
+void  GLDirectBackend::enableClientState(GLenum cap)                                         { glEnableClientState(cap); }
+void  GLDirectBackend::disableClientState(GLenum cap)                                        { glDisableClientState(cap); }
+void  GLDirectBackend::vertexAttribFormat(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride) { glVertexAttribFormatNV(index, size, type, normalized, stride); }
+void  GLDirectBackend::vertexArrayVertexAttribOffset(GLuint vao, GLuint buffer, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset)
+{
+    glVertexArrayVertexAttribOffsetEXT(vao, buffer, index, size, type, normalized, stride, offset);
+}
+void  GLDirectBackend::vertexAttribI2i(GLuint index, GLint x, GLint y)                       { glVertexAttribI2i(index, x, y); }
+
+void  GLDirectBackend::bindBuffer(GLenum target, GLuint buffer)                              { glBindBuffer(target, buffer); }
+void  GLDirectBackend::bindBufferBase(GLenum target, GLuint index, GLuint buffer)            { glBindBufferBase(target, index, buffer); }
+void  GLDirectBackend::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) { glBindBufferRange(target, index, buffer, offset, size); }
+void  GLDirectBackend::namedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage)       { glNamedBufferDataEXT(buffer, size, data, usage); }
+void  GLDirectBackend::namedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) { glNamedBufferSubDataEXT(buffer, offset, size, data); }
+void  GLDirectBackend::bufferAddressRange(GLenum pname, GLuint index, GLuint64EXT address, GLsizeiptr length) { glBufferAddressRangeNV(pname, index, address, length); }
+void  GLDirectBackend::copyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+{
+    glNamedCopyBufferSubDataEXT(readBuffer, writeBuffer, readOffset, writeOffset, size);
+}
+void  GLDirectBackend::compressedTextureSubImage2D(GLuint texture, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, GLintptr unpackOffset)
+{
+    glCompressedTextureSubImage2DEXT(texture, target, level, xoffset, yoffset, width, height, format, imageSize, reinterpret_cast<const void*>(unpackOffset));
+}
+
+void  GLDirectBackend::drawElements(GLenum mode, GLsizei count, GLenum type, GLintptr indexOffset)
+{
+    glDrawElements(mode, count, type, reinterpret_cast<const void*>(indexOffset));
+}
+
+
+
+
+RecordingGLBackend::Call& RecordingGLBackend::record(Op op, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3,
+                                                     uint64_t a4, uint64_t a5, uint64_t a6, uint64_t a7)
+{
+    m_calls.push_back(Call());
+    Call& call = m_calls.back();
+    call.m_op = op;
+    call.m_args[0] = a0; call.m_args[1] = a1; call.m_args[2] = a2; call.m_args[3] = a3;
+    call.m_args[4] = a4; call.m_args[5] = a5; call.m_args[6] = a6; call.m_args[7] = a7;
+    return call;
+}
+
+void RecordingGLBackend::attach(Call& call, const void* data, size_t size)
+{
+    if(m_recordData && data != nullptr && size != 0)
+    {
+        call.m_data.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+    }
+}
+
+size_t RecordingGLBackend::countCalls(Op op) const
+{
+    size_t count = 0;
+    for(size_t i = 0; i < m_calls.size(); i++)
+    {
+        count += (m_calls[i].m_op == op) ? 1 : 0;
+    }
+    return count;
+}
+
+GLint RecordingGLBackend::getUniformLocation(GLuint program, const char* name)
+{
+    GLint location = 0;
+    bool  found = false;
+    for(size_t i = 0; i < m_uniformNames.size() && !found; i++)
+    {
+        if(m_uniformNames[i].m_program == program)
+        {
+            found = (m_uniformNames[i].m_name == name);
+            location += found ? 0 : 1;
+        }
+    }
+    if(!found)
+    {
+        UniformName uniformName = { program, name };
+        m_uniformNames.push_back(uniformName);
+    }
+
+    Call& call = record(OpGetUniformLocation, program, uint64_t(location));
+    call.m_data.assign(name, name + strlen(name) + 1); // names are always kept, replay needs them
+    return location;
+}
+
+void RecordingGLBackend::programUniform1i(GLuint program, GLint location, GLint value)
+{
+    record(OpProgramUniform1i, program, uint64_t(location), uint64_t(value));
+}
+
+void RecordingGLBackend::programUniformui64v(GLuint program, GLint location, GLsizei count, const GLuint64EXT* values)
+{
+    attach(record(OpProgramUniformui64v, program, uint64_t(location), uint64_t(count)), values, sizeof(GLuint64EXT) * count);
+}
+
+void RecordingGLBackend::enableVertexAttribArray(GLuint index)                  { record(OpEnableVertexAttribArray, index); }
+void RecordingGLBackend::disableVertexAttribArray(GLuint index)                 { record(OpDisableVertexAttribArray, index); }
+void RecordingGLBackend::enableVertexArrayAttrib(GLuint vao, GLuint index)      { record(OpEnableVertexArrayAttrib, vao, index); }
+void RecordingGLBackend::disableVertexArrayAttrib(GLuint vao, GLuint index)     { record(OpDisableVertexArrayAttrib, vao, index); }
+void RecordingGLBackend::enableClientState(GLenum cap)                          { record(OpEnableClientState, cap); }
+void RecordingGLBackend::disableClientState(GLenum cap)                         { record(OpDisableClientState, cap); }
+
+void RecordingGLBackend::vertexAttribFormat(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride)
+{
+    record(OpVertexAttribFormat, index, uint64_t(size), type, normalized, uint64_t(stride));
+}
+
+void RecordingGLBackend::vertexArrayVertexAttribOffset(GLuint vao, GLuint buffer, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset)
+{
+    record(OpVertexArrayVertexAttribOffset, vao, buffer, index, uint64_t(size), type, normalized, uint64_t(stride), uint64_t(offset));
+}
+
+void RecordingGLBackend::vertexAttribI2i(GLuint index, GLint x, GLint y)
+{
+    record(OpVertexAttribI2i, index, uint32_t(x), uint32_t(y));
+}
+
+void RecordingGLBackend::bindBuffer(GLenum target, GLuint buffer)                      { record(OpBindBuffer, target, buffer); }
+void RecordingGLBackend::bindBufferBase(GLenum target, GLuint index, GLuint buffer)    { record(OpBindBufferBase, target, index, buffer); }
+
+void RecordingGLBackend::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    record(OpBindBufferRange, target, index, buffer, uint64_t(offset), uint64_t(size));
+}
+
+void RecordingGLBackend::namedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage)
+{
+    attach(record(OpNamedBufferData, buffer, uint64_t(size), usage), data, size_t(size));
+}
+
+void RecordingGLBackend::namedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    attach(record(OpNamedBufferSubData, buffer, uint64_t(offset), uint64_t(size)), data, size_t(size));
+}
+
+void RecordingGLBackend::bufferAddressRange(GLenum pname, GLuint index, GLuint64EXT address, GLsizeiptr length)
+{
+    record(OpBufferAddressRange, pname, index, address, uint64_t(length));
+}
+
+void RecordingGLBackend::copyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+{
+    record(OpCopyNamedBufferSubData, readBuffer, writeBuffer, uint64_t(readOffset), uint64_t(writeOffset), uint64_t(size));
+}
+
+void RecordingGLBackend::compressedTextureSubImage2D(GLuint texture, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, GLintptr unpackOffset)
+{
+    // Offsets and dimensions are packed in pairs to fit the eight arguments; the pixels are in the unpack buffer
+    record(OpCompressedTextureSubImage2D, texture, target, uint64_t(level), (uint64_t(uint32_t(xoffset)) << 32) | uint32_t(yoffset),
+           (uint64_t(uint32_t(width)) << 32) | uint32_t(height), format, uint64_t(imageSize), uint64_t(unpackOffset));
+}
+
+void RecordingGLBackend::drawElements(GLenum mode, GLsizei count, GLenum type, GLintptr indexOffset)
+{
+    record(OpDrawElements, mode, uint64_t(count), type, uint64_t(indexOffset));
+}
@@ -0,0 +1,171 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GLBackend.h
+//
+// The GL calls issued on the per frame path (BindlessApp::draw() and
+// Mesh::renderPrep()/render()/renderFinish()) go through a GLBackend so they can
+// be filtered (GLStateCache), recorded, or replayed without a driver.
+//----------------------------------------------------------------------------------
+#ifndef GL_BACKEND_H
+#define GL_BACKEND_H
+
+#include "cinder/gl/gl.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+class GLBackend
+{
+public:
+    virtual ~GLBackend() {}
+
+    virtual GLint getUniformLocation(GLuint program, const char* name) = 0;
+    virtual void  programUniform1i(GLuint program, GLint location, GLint value) = 0;
+    virtual void  programUniformui64v(GLuint program, GLint location, GLsizei count, const GLuint64EXT* values) = 0;
+
+    virtual void  enableVertexAttribArray(GLuint index) = 0;
+    virtual void  disableVertexAttribArray(GLuint index) = 0;
+    virtual void  enableVertexArrayAttrib(GLuint vao, GLuint index) = 0;
+    virtual void  disableVertexArrayAttrib(GLuint vao, GLuint index) = 0;
+    virtual void  enableClientState(GLenum cap) = 0;
+    virtual void  disableClientState(GLenum cap) = 0;
+    virtual void  vertexAttribFormat(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride) = 0;
+    virtual void  vertexArrayVertexAttribOffset(GLuint vao, GLuint buffer, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset) = 0;
+    virtual void  vertexAttribI2i(GLuint index, GLint x, GLint y) = 0;
+
+    virtual void  bindBuffer(GLenum target, GLuint buffer) = 0;
+    virtual void  bindBufferBase(GLenum target, GLuint index, GLuint buffer) = 0;
+    virtual void  bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) = 0;
+    virtual void  namedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) = 0;
+    virtual void  namedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) = 0;
+    virtual void  bufferAddressRange(GLenum pname, GLuint index, GLuint64EXT address, GLsizeiptr length) = 0;
+    virtual void  copyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) = 0;
+
+    // The image comes from the bound GL_PIXEL_UNPACK_BUFFER, like drawElements() indices come from the element buffer
+    virtual void  compressedTextureSubImage2D(GLuint texture, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, GLintptr unpackOffset) = 0;
+
+    virtual void  drawElements(GLenum mode, GLsizei count, GLenum type, GLintptr indexOffset) = 0;
+};
+
+
+// Forwards straight to the driver
+class GLDirectBackend : public GLBackend
+{
+public:
+    GLint getUniformLocation(GLuint program, const char* name) override;
+    void  programUniform1i(GLuint program, GLint location, GLint value) override;
+    void  programUniformui64v(GLuint program, GLint location, GLsizei count, const GLuint64EXT* values) override;
+
+    void  enableVertexAttribArray(GLuint index) override;
+    void  disableVertexAttribArray(GLuint index) override;
+    void  enableVertexArrayAttrib(GLuint vao, GLuint index) override;
+    void  disableVertexArrayAttrib(GLuint vao, GLuint index) override;
+    void  enableClientState(GLenum cap) override;
+    void  disableClientState(GLenum cap) override;
+    void  vertexAttribFormat(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride) override;
+    void  vertexArrayVertexAttribOffset(GLuint vao, GLuint buffer, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset) override;
+    void  vertexAttribI2i(GLuint index, GLint x, GLint y) override;
+
+    void  bindBuffer(GLenum target, GLuint buffer) override;
+    void  bindBufferBase(GLenum target, GLuint index, GLuint buffer) override;
+    void  bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) override;
+    void  namedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) override;
+    void  namedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) override;
+    void  bufferAddressRange(GLenum pname, GLuint index, GLuint64EXT address, GLsizeiptr length) override;
+    void  copyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) override;
+    void  compressedTextureSubImage2D(GLuint texture, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, GLintptr unpackOffset) override;
+
+    void  drawElements(GLenum mode, GLsizei count, GLenum type, GLintptr indexOffset) override;
+};
+
+
+// Stand-in for the driver: records every call instead of issuing it.
+// Uniform locations are handed out in order of first request per program.
+class RecordingGLBackend : public GLBackend
+{
+public:
+    enum Op
+    {
+        OpGetUniformLocation,
+        OpProgramUniform1i,
+        OpProgramUniformui64v,
+        OpEnableVertexAttribArray,
+        OpDisableVertexAttribArray,
+        OpEnableVertexArrayAttrib,
+        OpDisableVertexArrayAttrib,
+        OpEnableClientState,
+        OpDisableClientState,
+        OpVertexAttribFormat,
+        OpVertexArrayVertexAttribOffset,
+        OpVertexAttribI2i,
+        OpBindBuffer,
+        OpBindBufferBase,
+        OpBindBufferRange,
+        OpNamedBufferData,
+        OpNamedBufferSubData,
+        OpBufferAddressRange,
+        OpCopyNamedBufferSubData,
+        OpCompressedTextureSubImage2D,
+        OpDrawElements,
+        OpCount
+    };
+
+    struct Call
+    {
+        Op                   m_op;
+        uint64_t             m_args[8];
+        std::vector<uint8_t> m_data;        // uniform names, uniform arrays and buffer contents
+    };
+
+    RecordingGLBackend() : m_recordData(true) {}
+
+    GLint getUniformLocation(GLuint program, const char* name) override;
+    void  programUniform1i(GLuint program, GLint location, GLint value) override;
+    void  programUniformui64v(GLuint program, GLint location, GLsizei count, const GLuint64EXT* values) override;
+
+    void  enableVertexAttribArray(GLuint index) override;
+    void  disableVertexAttribArray(GLuint index) override;
+    void  enableVertexArrayAttrib(GLuint vao, GLuint index) override;
+    void  disableVertexArrayAttrib(GLuint vao, GLuint index) override;
+    void  enableClientState(GLenum cap) override;
+    void  disableClientState(GLenum cap) override;
+    void  vertexAttribFormat(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride) override;
+    void  vertexArrayVertexAttribOffset(GLuint vao, GLuint buffer, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset) override;
+    void  vertexAttribI2i(GLuint index, GLint x, GLint y) override;
+
+    void  bindBuffer(GLenum target, GLuint buffer) override;
+    void  bindBufferBase(GLenum target, GLuint index, GLuint buffer) override;
+    void  bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) override;
+    void  namedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) override;
+    void  namedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) override;
+    void  bufferAddressRange(GLenum pname, GLuint index, GLuint64EXT address, GLsizeiptr length) override;
+    void  copyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) override;
+    void  compressedTextureSubImage2D(GLuint texture, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, GLintptr unpackOffset) override;
+
+    void  drawElements(GLenum mode, GLsizei count, GLenum type, GLintptr indexOffset) override;
+
+    // Set to false to drop payloads when only the call stream matters
+    void  setRecordData(bool recordData) { m_recordData = recordData; }
+
+    const std::vector<Call>& getCalls() const { return m_calls; }
+    std::vector<Call>&       getCalls()       { return m_calls; }
+    size_t countCalls(Op op) const;
+    void   clear() { m_calls.clear(); }
+
+protected:
+    Call& record(Op op, uint64_t a0 = 0, uint64_t a1 = 0, uint64_t a2 = 0, uint64_t a3 = 0,
+                 uint64_t a4 = 0, uint64_t a5 = 0, uint64_t a6 = 0, uint64_t a7 = 0);
+    void  attach(Call& call, const void* data, size_t size);
+
+private:
+    struct UniformName
+    {
+        GLuint      m_program;
+        std::string m_name;
+    };
+
+    std::vector<Call>        m_calls;
+    std::vector<UniformName> m_uniformNames;
+    bool                     m_recordData;
+};
+
+#endif
@@ -0,0 +1,272 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GLObjectQueue.cpp
+//----------------------------------------------------------------------------------
+#include "GLObjectQueue.h"
+#include <algorithm>
+#include <cstring>
+
+
+void GLDirectObjectBackend::genBuffers(GLsizei count, GLuint* names)
+{
+    glGenBuffers(count, names);
+}
+
+
+void GLDirectObjectBackend::deleteBuffers(GLsizei count, const GLuint* names)
+{
+    glDeleteBuffers(count, names);
+}
+
+
+void GLDirectObjectBackend::makeBuffersNonResident(GLsizei count, const GLuint* names)
+{
+    for(GLsizei i = 0; i < count; i++)
+    {
+        glMakeNamedBufferNonResidentNV(names[i]);
+    }
+}
+
+
+void GLDirectObjectBackend::genTextures(GLsizei count, GLuint* names)
+{
+    glGenTextures(count, names);
+}
+
+
+void GLDirectObjectBackend::deleteTextures(GLsizei count, const GLuint* names)
+{
+    glDeleteTextures(count, names);
+}
+
+
+GLsync GLDirectObjectBackend::fence()
+{
+    return glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+
+bool GLDirectObjectBackend::isSignaled(GLsync fence)
+{
+    const GLenum result = glClientWaitSync(fence, 0, 0);
+    return result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED;
+}
+
+
+void GLDirectObjectBackend::wait(GLsync fence)
+{
+    // Flushes, so the fence is sure to be reached
+    while(glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull) == GL_TIMEOUT_EXPIRED)
+    {
+    }
+}
+
+
+void GLDirectObjectBackend::deleteFence(GLsync fence)
+{
+    glDeleteSync(fence);
+}
+
+
+GLObjectQueue::GLObjectQueue(GLObjectBackend& backend, uint32_t batchSize)
+    : m_backend(backend)
+    , m_batchSize(std::max(batchSize, 1u))
+    , m_frame(0)
+{
+    memset(&m_counters, 0, sizeof(m_counters));
+}
+
+
+GLObjectQueue::~GLObjectQueue()
+{
+    finish();
+}
+
+
+GLuint GLObjectQueue::create(Kind kind)
+{
+    std::vector<GLuint>& spare = m_spare[kind];
+    if(spare.empty())
+    {
+        // Handed out from the back, so in the order GL generated them
+        spare.resize(m_batchSize);
+        if(kind == KindBuffer)
+        {
+            m_backend.genBuffers(GLsizei(m_batchSize), &spare[0]);
+        }
+        else
+        {
+            m_backend.genTextures(GLsizei(m_batchSize), &spare[0]);
+        }
+        std::reverse(spare.begin(), spare.end());
+        m_counters.m_genCalls++;
+        m_counters.m_spare += m_batchSize;
+    }
+
+    const GLuint name = spare.back();
+    spare.pop_back();
+    m_counters.m_spare--;
+    m_counters.m_created++;
+    return name;
+}
+
+
+void GLObjectQueue::release(Kind kind, GLuint name, bool resident)
+{
+    if(name == 0)
+    {
+        return;
+    }
+    Released released;
+    released.m_name     = name;
+    released.m_resident = resident && kind == KindBuffer;
+    released.m_frame    = m_frame;
+    m_released[kind].push_back(released);
+    m_counters.m_pending++;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GLObjectQueue::endFrame()
+//
+//    *** INTERESTING ***
+//    A frame with releases gets a fence. Fences signal in order, so the ones
+//    that have signaled are a prefix of m_fences and everything released up to
+//    the newest of them is retired with one delete call per kind, however many
+//    frames or meshes that covers. Frames without releases cost nothing.
+//
+////////////////////////////////////////////////////////////////////////////////
+void GLObjectQueue::endFrame()
+{
+    bool released = false;
+    for(int32_t kind = 0; kind < KindCount; kind++)
+    {
+        released |= !m_released[kind].empty() && m_released[kind].back().m_frame == m_frame;
+    }
+    if(released)
+    {
+        Fence fence;
+        fence.m_sync  = m_backend.fence();
+        fence.m_frame = m_frame;
+        m_fences.push_back(fence);
+        m_counters.m_fences++;
+    }
+    m_frame++;
+
+    size_t signaled = 0;
+    while(signaled < m_fences.size() && m_backend.isSignaled(m_fences[signaled].m_sync))
+    {
+        signaled++;
+    }
+    if(signaled == 0)
+    {
+        return;
+    }
+    for(size_t i = 0; i < signaled; i++)
+    {
+        m_backend.deleteFence(m_fences[i].m_sync);
+    }
+    const uint64_t retired = m_fences[signaled - 1].m_frame;
+    m_fences.erase(m_fences.begin(), m_fences.begin() + signaled);
+    deleteUpTo(retired);
+}
+
+
+void GLObjectQueue::finish()
+{
+    for(size_t i = 0; i < m_fences.size(); i++)
+    {
+        m_backend.wait(m_fences[i].m_sync);
+        m_backend.deleteFence(m_fences[i].m_sync);
+    }
+    m_fences.clear();
+    if(m_counters.m_pending != 0)
+    {
+        // Released this frame, not fenced yet
+        const GLsync sync = m_backend.fence();
+        m_backend.wait(sync);
+        m_backend.deleteFence(sync);
+        deleteUpTo(m_frame);
+    }
+
+    for(int32_t kind = 0; kind < KindCount; kind++)
+    {
+        std::vector<GLuint>& spare = m_spare[kind];
+        if(spare.empty()) continue;
+        if(kind == KindBuffer)
+        {
+            m_backend.deleteBuffers(GLsizei(spare.size()), &spare[0]);
+        }
+        else
+        {
+            m_backend.deleteTextures(GLsizei(spare.size()), &spare[0]);
+        }
+        m_counters.m_deleteCalls++;
+        m_counters.m_spare -= uint32_t(spare.size());
+        std::vector<GLuint>().swap(spare);
+    }
+}
+
+
+void GLObjectQueue::deleteUpTo(uint64_t frame)
+{
+    for(int32_t kind = 0; kind < KindCount; kind++)
+    {
+        std::vector<Released>& released = m_released[kind];
+        size_t count = 0;
+        while(count < released.size() && released[count].m_frame <= frame)
+        {
+            count++;
+        }
+        if(count == 0) continue;
+
+        m_scratch.clear();
+        for(size_t i = 0; i < count; i++)
+        {
+            if(released[i].m_resident)
+            {
+                m_scratch.push_back(released[i].m_name);
+            }
+        }
+        if(!m_scratch.empty())
+        {
+            m_backend.makeBuffersNonResident(GLsizei(m_scratch.size()), &m_scratch[0]);
+        }
+
+        m_scratch.clear();
+        for(size_t i = 0; i < count; i++)
+        {
+            m_scratch.push_back(released[i].m_name);
+        }
+        if(kind == KindBuffer)
+        {
+            m_backend.deleteBuffers(GLsizei(count), &m_scratch[0]);
+        }
+        else
+        {
+            m_backend.deleteTextures(GLsizei(count), &m_scratch[0]);
+        }
+        released.erase(released.begin(), released.begin() + count);
+
+        m_counters.m_deleteCalls++;
+        m_counters.m_deleted += count;
+        m_counters.m_pending -= uint32_t(count);
+    }
+}
+
+
+void GLObjectQueue::deleteNow(Kind kind, GLuint name, bool resident)
+{
+    if(kind == KindBuffer)
+    {
+        if(resident)
+        {
+            glMakeNamedBufferNonResidentNV(name);
+        }
+        glDeleteBuffers(1, &name);
+    }
+    else
+    {
+        glDeleteTextures(1, &name);
+    }
+}
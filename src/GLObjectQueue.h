@@ -0,0 +1,226 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GLObjectQueue.h
+//
+// Creates and deletes GL buffers and textures in batches, and owns them through
+// move-only handles.
+//
+// Names are generated a batch at a time (one glGenBuffers for many buffers)
+// and handed out from the spare list. A released name is not deleted on the
+// spot: with bindless the GPU may still read the buffer through its address in
+// a frame that is in flight, which the driver does not track. Releases are
+// queued per frame instead. endFrame() puts a fence behind the frame's releases,
+// and once the GPU has passed a fence, all the names queued before it are made
+// non-resident and deleted with one glDeleteBuffers / glDeleteTextures call.
+//
+// The GL calls go through a GLObjectBackend, so the batching and the lifetime
+// rules can be driven by a mock backend without a GL context.
+//----------------------------------------------------------------------------------
+#ifndef GL_OBJECT_QUEUE_H
+#define GL_OBJECT_QUEUE_H
+
+#include "cinder/gl/gl.h"
+#include <cstdint>
+#include <vector>
+
+class GLObjectBackend
+{
+public:
+    virtual ~GLObjectBackend() {}
+
+    virtual void   genBuffers(GLsizei count, GLuint* names) = 0;
+    virtual void   deleteBuffers(GLsizei count, const GLuint* names) = 0;
+    virtual void   makeBuffersNonResident(GLsizei count, const GLuint* names) = 0;
+    virtual void   genTextures(GLsizei count, GLuint* names) = 0;
+    virtual void   deleteTextures(GLsizei count, const GLuint* names) = 0;
+
+    // A fence behind the commands issued so far; isSignaled() does not block, wait() does
+    virtual GLsync fence() = 0;
+    virtual bool   isSignaled(GLsync fence) = 0;
+    virtual void   wait(GLsync fence) = 0;
+    virtual void   deleteFence(GLsync fence) = 0;
+};
+
+// Issues the calls to GL
+class GLDirectObjectBackend : public GLObjectBackend
+{
+public:
+    void   genBuffers(GLsizei count, GLuint* names) override;
+    void   deleteBuffers(GLsizei count, const GLuint* names) override;
+    void   makeBuffersNonResident(GLsizei count, const GLuint* names) override;
+    void   genTextures(GLsizei count, GLuint* names) override;
+    void   deleteTextures(GLsizei count, const GLuint* names) override;
+    GLsync fence() override;
+    bool   isSignaled(GLsync fence) override;
+    void   wait(GLsync fence) override;
+    void   deleteFence(GLsync fence) override;
+};
+
+class GLObjectQueue
+{
+public:
+    enum Kind
+    {
+        KindBuffer,
+        KindTexture,
+        KindCount
+    };
+
+    struct Counters
+    {
+        uint64_t m_created;         // names handed out
+        uint64_t m_deleted;
+        uint32_t m_genCalls;        // glGen* calls, a batch each
+        uint32_t m_deleteCalls;     // glDelete* calls, one per kind and retired run of frames
+        uint32_t m_fences;
+        uint32_t m_pending;         // released names the GPU may still use
+        uint32_t m_spare;           // generated names not handed out yet
+    };
+
+    // batchSize names of a kind are generated at a time
+    GLObjectQueue(GLObjectBackend& backend, uint32_t batchSize);
+    // Calls finish()
+    ~GLObjectQueue();
+
+    GLuint   create(Kind kind);
+    // Queued until the GPU is done with the current frame; resident buffers are made non-resident first
+    void     release(Kind kind, GLuint name, bool resident);
+
+    // Call once per frame after its commands are submitted: fences the frame's releases and deletes
+    // the names of every frame the GPU has finished
+    void     endFrame();
+    // Waits for the GPU and deletes everything queued, and the spare names
+    void     finish();
+
+    const Counters& getCounters() const { return m_counters; }
+
+    // Deletes a name right away, for handles created without a queue
+    static void deleteNow(Kind kind, GLuint name, bool resident);
+
+private:
+    struct Released
+    {
+        GLuint   m_name;
+        bool     m_resident;
+        uint64_t m_frame;
+    };
+
+    struct Fence
+    {
+        GLsync   m_sync;
+        uint64_t m_frame;           // covers the names released up to and including this frame
+    };
+
+    GLObjectQueue(const GLObjectQueue&) = delete;
+    GLObjectQueue& operator=(const GLObjectQueue&) = delete;
+
+    void     deleteUpTo(uint64_t frame);
+
+    GLObjectBackend&       m_backend;
+    uint32_t               m_batchSize;
+    uint64_t               m_frame;
+    std::vector<GLuint>    m_spare[KindCount];
+    std::vector<Released>  m_released[KindCount];  // in release order, so in frame order
+    std::vector<Fence>     m_fences;                // oldest first
+    std::vector<GLuint>    m_scratch;               // names of one delete call
+    Counters               m_counters;
+};
+
+
+// Move-only owner of a GL name. The name goes back to the queue it came from when the handle is
+// destroyed or reset; a handle made with borrow() only refers to a name someone else owns.
+template<GLObjectQueue::Kind K>
+class GLHandle
+{
+public:
+    GLHandle() : m_queue(nullptr), m_name(0), m_owned(false), m_resident(false) {}
+    ~GLHandle() { reset(); }
+
+    GLHandle(GLHandle&& other) noexcept
+        : m_queue(other.m_queue), m_name(other.m_name), m_owned(other.m_owned), m_resident(other.m_resident)
+    {
+        other.m_name = 0;
+        other.m_owned = other.m_resident = false;
+    }
+
+    GLHandle& operator=(GLHandle&& other) noexcept
+    {
+        if(this != &other)
+        {
+            reset();
+            m_queue = other.m_queue;
+            m_name = other.m_name;
+            m_owned = other.m_owned;
+            m_resident = other.m_resident;
+            other.m_name = 0;
+            other.m_owned = other.m_resident = false;
+        }
+        return *this;
+    }
+
+    // A new name from queue; without a queue it is generated and later deleted on its own
+    static GLHandle create(GLObjectQueue* queue)
+    {
+        GLHandle handle;
+        handle.m_queue = queue;
+        handle.m_owned = true;
+        if(queue != nullptr)
+        {
+            handle.m_name = queue->create(K);
+        }
+        else if(K == GLObjectQueue::KindBuffer)
+        {
+            glGenBuffers(1, &handle.m_name);
+        }
+        else
+        {
+            glGenTextures(1, &handle.m_name);
+        }
+        return handle;
+    }
+
+    static GLHandle borrow(GLuint name)
+    {
+        GLHandle handle;
+        handle.m_name = name;
+        return handle;
+    }
+
+    void reset()
+    {
+        if(m_owned && m_name != 0)
+        {
+            if(m_queue != nullptr)
+            {
+                m_queue->release(K, m_name, m_resident);
+            }
+            else
+            {
+                GLObjectQueue::deleteNow(K, m_name, m_resident);
+            }
+        }
+        m_name = 0;
+        m_owned = m_resident = false;
+    }
+
+    GLuint get() const                  { return m_name; }
+    bool   isOwned() const              { return m_owned; }
+    explicit operator bool() const      { return m_name != 0; }
+
+    // The buffer was made resident; it is made non-resident before it is deleted
+    void   setResident(bool resident)   { m_resident = resident; }
+    bool   isResident() const           { return m_resident; }
+
+private:
+    GLHandle(const GLHandle&) = delete;
+    GLHandle& operator=(const GLHandle&) = delete;
+
+    GLObjectQueue* m_queue;
+    GLuint         m_name;
+    bool           m_owned;
+    bool           m_resident;
+};
+
+typedef GLHandle<GLObjectQueue::KindBuffer>  GLBufferHandle;
+typedef GLHandle<GLObjectQueue::KindTexture> GLTextureHandle;
+
+#endif
@@ -0,0 +1,480 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GLStateCache.cpp
+//----------------------------------------------------------------------------------
+#include "GLStateCache.h"
+#include <cstring>
+
+namespace
+{
+    int32_t clientStateBit(GLenum cap)
+    {
+        switch(cap)
+        {
+        case GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV: return 0;
+        case GL_ELEMENT_ARRAY_UNIFIED_NV:       return 1;
+        default:                                return -1;
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GLStateCache::GLStateCache()
+//
+////////////////////////////////////////////////////////////////////////////////
+GLStateCache::GLStateCache(GLBackend& next)
+    : m_next(next)
+    , m_enabled(true)
+{
+    memset(&m_frameCounters, 0, sizeof(m_frameCounters));
+    memset(&m_lastFrameCounters, 0, sizeof(m_lastFrameCounters));
+    invalidate();
+}
+
+
+void GLStateCache::setEnabled(bool enabled)
+{
+    if(enabled != m_enabled)
+    {
+        flush();
+        m_enabled = enabled;
+        invalidate();
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GLStateCache::beginFrame()
+//
+////////////////////////////////////////////////////////////////////////////////
+void GLStateCache::beginFrame()
+{
+    flush();
+    m_lastFrameCounters = m_frameCounters;
+    memset(&m_frameCounters, 0, sizeof(m_frameCounters));
+    invalidateBindings();
+}
+
+
+void GLStateCache::invalidate()
+{
+    invalidateBindings();
+    m_programs.clear();
+}
+
+
+void GLStateCache::invalidateProgram(GLuint program)
+{
+    for(size_t i = 0; i < m_programs.size(); i++)
+    {
+        if(m_programs[i].m_program == program)
+        {
+            m_programs.erase(m_programs.begin() + i);
+            return;
+        }
+    }
+}
+
+
+void GLStateCache::invalidateBindings()
+{
+    memset(&m_attribs, 0, sizeof(m_attribs));
+    memset(&m_vao0Attribs, 0, sizeof(m_vao0Attribs));
+    memset(&m_clientStates, 0, sizeof(m_clientStates));
+    memset(m_formats, 0, sizeof(m_formats));
+    memset(&m_arrayBuffer, 0, sizeof(m_arrayBuffer));
+    memset(&m_elementArrayBuffer, 0, sizeof(m_elementArrayBuffer));
+    memset(&m_uniformBuffer, 0, sizeof(m_uniformBuffer));
+    memset(m_uniformBindings, 0, sizeof(m_uniformBindings));
+}
+
+
+GLStateCache::ProgramState& GLStateCache::getProgramState(GLuint program)
+{
+    for(size_t i = 0; i < m_programs.size(); i++)
+    {
+        if(m_programs[i].m_program == program)
+        {
+            return m_programs[i];
+        }
+    }
+
+    m_programs.push_back(ProgramState());
+    m_programs.back().m_program = program;
+    return m_programs.back();
+}
+
+
+// Returns true (and remembers the new value) if the uniform has to be uploaded
+bool GLStateCache::uniformChanged(GLuint program, GLint location, const void* bytes, size_t size)
+{
+    if(location < 0)
+    {
+        return false; // GL ignores location -1, so do we
+    }
+
+    ProgramState& state = getProgramState(program);
+    for(size_t i = 0; i < state.m_values.size(); i++)
+    {
+        UniformValue& value = state.m_values[i];
+        if(value.m_location == location)
+        {
+            if(value.m_bytes.size() == size && memcmp(&value.m_bytes[0], bytes, size) == 0)
+            {
+                return false;
+            }
+            value.m_bytes.assign(static_cast<const uint8_t*>(bytes), static_cast<const uint8_t*>(bytes) + size);
+            return true;
+        }
+    }
+
+    state.m_values.push_back(UniformValue());
+    state.m_values.back().m_location = location;
+    state.m_values.back().m_bytes.assign(static_cast<const uint8_t*>(bytes), static_cast<const uint8_t*>(bytes) + size);
+    return true;
+}
+
+
+// Records the wanted state of an enable bit; returns false if the bit is not tracked
+bool GLStateCache::setDeferredBit(DeferredBits& bits, GLuint index, bool enable)
+{
+    if(index >= MaxAttribs)
+    {
+        return false;
+    }
+    const uint32_t bit = 1u << index;
+    bits.m_touched |= bit;
+    bits.m_desired  = enable ? (bits.m_desired | bit) : (bits.m_desired & ~bit);
+    bits.m_pendingCalls++;
+    return true;
+}
+
+
+// Returns true (and marks it applied) if a touched bit differs from the GL state or the GL state is unknown
+bool GLStateCache::needsApply(DeferredBits& bits, uint32_t bit)
+{
+    if((bits.m_touched & bit) == 0 || ((bits.m_known & bit) != 0 && (bits.m_applied & bit) == (bits.m_desired & bit)))
+    {
+        return false;
+    }
+    bits.m_known  |= bit;
+    bits.m_applied = (bits.m_applied & ~bit) | (bits.m_desired & bit);
+    return true;
+}
+
+
+GLStateCache::BufferBinding* GLStateCache::getTargetBinding(GLenum target)
+{
+    switch(target)
+    {
+    case GL_ARRAY_BUFFER:         return &m_arrayBuffer;
+    case GL_ELEMENT_ARRAY_BUFFER: return &m_elementArrayBuffer;
+    case GL_UNIFORM_BUFFER:       return &m_uniformBuffer;
+    default:                      return nullptr;
+    }
+}
+
+
+// Returns true if the binding has to be changed
+bool GLStateCache::setBinding(BufferBinding& binding, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if(binding.m_known && binding.m_buffer == buffer && binding.m_offset == offset && binding.m_size == size)
+    {
+        return false;
+    }
+    binding.m_known  = true;
+    binding.m_buffer = buffer;
+    binding.m_offset = offset;
+    binding.m_size   = size;
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Uniforms
+//
+////////////////////////////////////////////////////////////////////////////////
+GLint GLStateCache::getUniformLocation(GLuint program, const char* name)
+{
+    if(!m_enabled)
+    {
+        m_frameCounters.m_issued++;
+        return m_next.getUniformLocation(program, name);
+    }
+
+    ProgramState& state = getProgramState(program);
+    for(size_t i = 0; i < state.m_locations.size(); i++)
+    {
+        if(state.m_locations[i].m_name == name)
+        {
+            m_frameCounters.m_locationHits++;
+            return state.m_locations[i].m_location;
+        }
+    }
+
+    UniformLocation location;
+    location.m_name     = name;
+    location.m_location = m_next.getUniformLocation(program, name);
+    state.m_locations.push_back(location);
+    m_frameCounters.m_locationMisses++;
+    m_frameCounters.m_issued++;
+    return location.m_location;
+}
+
+void GLStateCache::programUniform1i(GLuint program, GLint location, GLint value)
+{
+    if(m_enabled && !uniformChanged(program, location, &value, sizeof(value)))
+    {
+        m_frameCounters.m_skippedUniforms++;
+        return;
+    }
+    m_frameCounters.m_issued++;
+    m_next.programUniform1i(program, location, value);
+}
+
+void GLStateCache::programUniformui64v(GLuint program, GLint location, GLsizei count, const GLuint64EXT* values)
+{
+    if(m_enabled && !uniformChanged(program, location, values, sizeof(GLuint64EXT) * count))
+    {
+        m_frameCounters.m_skippedUniforms++;
+        return;
+    }
+    m_frameCounters.m_issued++;
+    m_next.programUniformui64v(program, location, count, values);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Vertex attribute and client state
+//
+////////////////////////////////////////////////////////////////////////////////
+void GLStateCache::enableVertexAttribArray(GLuint index)
+{
+    if(m_enabled && setDeferredBit(m_attribs, index, true))
+    {
+        return;
+    }
+    m_frameCounters.m_issued++;
+    m_next.enableVertexAttribArray(index);
+}
+
+void GLStateCache::disableVertexAttribArray(GLuint index)
+{
+    if(m_enabled && setDeferredBit(m_attribs, index, false))
+    {
+        return;
+    }
+    m_frameCounters.m_issued++;
+    m_next.disableVertexAttribArray(index);
+}
+
+void GLStateCache::enableVertexArrayAttrib(GLuint vao, GLuint index)
+{
+    if(m_enabled && vao == 0 && setDeferredBit(m_vao0Attribs, index, true))
+    {
+        return;
+    }
+    m_frameCounters.m_issued++;
+    m_next.enableVertexArrayAttrib(vao, index);
+}
+
+void GLStateCache::disableVertexArrayAttrib(GLuint vao, GLuint index)
+{
+    if(m_enabled && vao == 0 && setDeferredBit(m_vao0Attribs, index, false))
+    {
+        return;
+    }
+    m_frameCounters.m_issued++;
+    m_next.disableVertexArrayAttrib(vao, index);
+}
+
+void GLStateCache::enableClientState(GLenum cap)
+{
+    int32_t bit = clientStateBit(cap);
+    if(m_enabled && bit >= 0 && setDeferredBit(m_clientStates, GLuint(bit), true))
+    {
+        return;
+    }
+    m_frameCounters.m_issued++;
+    m_next.enableClientState(cap);
+}
+
+void GLStateCache::disableClientState(GLenum cap)
+{
+    int32_t bit = clientStateBit(cap);
+    if(m_enabled && bit >= 0 && setDeferredBit(m_clientStates, GLuint(bit), false))
+    {
+        return;
+    }
+    m_frameCounters.m_issued++;
+    m_next.disableClientState(cap);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GLStateCache::flush()
+//
+//    Applies the enable bits that differ from what GL has. An enable followed
+//    by a disable of the same bit between two draws costs nothing.
+//
+////////////////////////////////////////////////////////////////////////////////
+void GLStateCache::flush()
+{
+    uint32_t issued = 0;
+    uint32_t pending = m_attribs.m_pendingCalls + m_vao0Attribs.m_pendingCalls + m_clientStates.m_pendingCalls;
+
+    for(GLuint i = 0; i < MaxAttribs; i++)
+    {
+        const uint32_t bit = 1u << i;
+        if(needsApply(m_attribs, bit))
+        {
+            (m_attribs.m_desired & bit) ? m_next.enableVertexAttribArray(i) : m_next.disableVertexAttribArray(i);
+            issued++;
+        }
+        if(needsApply(m_vao0Attribs, bit))
+        {
+            (m_vao0Attribs.m_desired & bit) ? m_next.enableVertexArrayAttrib(0, i) : m_next.disableVertexArrayAttrib(0, i);
+            issued++;
+        }
+    }
+
+    static const GLenum clientStates[2] = { GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV, GL_ELEMENT_ARRAY_UNIFIED_NV };
+    for(GLuint i = 0; i < 2; i++)
+    {
+        if(needsApply(m_clientStates, 1u << i))
+        {
+            (m_clientStates.m_desired & (1u << i)) ? m_next.enableClientState(clientStates[i]) : m_next.disableClientState(clientStates[i]);
+            issued++;
+        }
+    }
+
+    m_attribs.m_pendingCalls = m_vao0Attribs.m_pendingCalls = m_clientStates.m_pendingCalls = 0;
+    m_frameCounters.m_issued       += issued;
+    m_frameCounters.m_skippedState += (pending > issued) ? pending - issued : 0;
+}
+
+void GLStateCache::vertexAttribFormat(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride)
+{
+    if(m_enabled && index < MaxAttribs)
+    {
+        AttribFormat& format = m_formats[index];
+        if(format.m_known && format.m_size == size && format.m_type == type && format.m_normalized == normalized && format.m_stride == stride)
+        {
+            m_frameCounters.m_skippedState++;
+            return;
+        }
+        format.m_known      = true;
+        format.m_size       = size;
+        format.m_type       = type;
+        format.m_normalized = normalized;
+        format.m_stride     = stride;
+    }
+    m_frameCounters.m_issued++;
+    m_next.vertexAttribFormat(index, size, type, normalized, stride);
+}
+
+void GLStateCache::vertexArrayVertexAttribOffset(GLuint vao, GLuint buffer, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset)
+{
+    // Per mesh state (the buffer differs for every mesh), never redundant
+    m_frameCounters.m_issued++;
+    m_next.vertexArrayVertexAttribOffset(vao, buffer, index, size, type, normalized, stride, offset);
+}
+
+void GLStateCache::vertexAttribI2i(GLuint index, GLint x, GLint y)
+{
+    m_frameCounters.m_issued++;
+    m_next.vertexAttribI2i(index, x, y);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Buffers
+//
+////////////////////////////////////////////////////////////////////////////////
+void GLStateCache::bindBuffer(GLenum target, GLuint buffer)
+{
+    BufferBinding* binding = getTargetBinding(target);
+    if(m_enabled && binding != nullptr && !setBinding(*binding, buffer, 0, -1))
+    {
+        m_frameCounters.m_skippedBinds++;
+        return;
+    }
+    m_frameCounters.m_issued++;
+    m_next.bindBuffer(target, buffer);
+}
+
+void GLStateCache::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    if(m_enabled && target == GL_UNIFORM_BUFFER && index < MaxUniformBindings)
+    {
+        // Binding an indexed target also binds the generic one
+        bool changed = setBinding(m_uniformBindings[index], buffer, 0, -1);
+        changed = setBinding(m_uniformBuffer, buffer, 0, -1) || changed;
+        if(!changed)
+        {
+            m_frameCounters.m_skippedBinds++;
+            return;
+        }
+    }
+    m_frameCounters.m_issued++;
+    m_next.bindBufferBase(target, index, buffer);
+}
+
+void GLStateCache::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    if(m_enabled && target == GL_UNIFORM_BUFFER && index < MaxUniformBindings)
+    {
+        bool changed = setBinding(m_uniformBindings[index], buffer, offset, size);
+        changed = setBinding(m_uniformBuffer, buffer, 0, -1) || changed;
+        if(!changed)
+        {
+            m_frameCounters.m_skippedBinds++;
+            return;
+        }
+    }
+    m_frameCounters.m_issued++;
+    m_next.bindBufferRange(target, index, buffer, offset, size);
+}
+
+void GLStateCache::namedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage)
+{
+    m_frameCounters.m_issued++;
+    m_next.namedBufferData(buffer, size, data, usage);
+}
+
+void GLStateCache::namedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    m_frameCounters.m_issued++;
+    m_next.namedBufferSubData(buffer, offset, size, data);
+}
+
+void GLStateCache::bufferAddressRange(GLenum pname, GLuint index, GLuint64EXT address, GLsizeiptr length)
+{
+    m_frameCounters.m_issued++;
+    m_next.bufferAddressRange(pname, index, address, length);
+}
+
+void GLStateCache::copyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+{
+    m_frameCounters.m_issued++;
+    m_next.copyNamedBufferSubData(readBuffer, writeBuffer, readOffset, writeOffset, size);
+}
+
+void GLStateCache::compressedTextureSubImage2D(GLuint texture, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, GLintptr unpackOffset)
+{
+    m_frameCounters.m_issued++;
+    m_next.compressedTextureSubImage2D(texture, target, level, xoffset, yoffset, width, height, format, imageSize, unpackOffset);
+}
+
+void GLStateCache::drawElements(GLenum mode, GLsizei count, GLenum type, GLintptr indexOffset)
+{
+    flush();
+    m_frameCounters.m_issued++;
+    m_next.drawElements(mode, count, type, indexOffset);
+}
@@ -0,0 +1,151 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GLStateCache.h
+//
+// Shadow copy of the GL state touched on the per frame path. Calls that would not
+// change the state (rebinding the bound buffer, re-uploading an unchanged uniform,
+// setting the same vertex format) are dropped before they reach the next backend,
+// and uniform locations are looked up once per program. Attribute and client state
+// enables are deferred until the next draw (or flush()), so the enable/disable pairs
+// of Mesh::renderPrep()/renderFinish() around every mesh collapse to nothing.
+//
+// Cinder and ImGui change bindings and vertex attribute state behind our back,
+// so beginFrame() forgets that state every frame. Uniform values are per program
+// and only we write to our programs, so those survive across frames.
+//----------------------------------------------------------------------------------
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include "GLBackend.h"
+
+class GLStateCache : public GLBackend
+{
+public:
+    struct Counters
+    {
+        uint32_t m_issued;              // calls forwarded to the next backend
+        uint32_t m_skippedState;        // attribute enables, client states, vertex formats
+        uint32_t m_skippedBinds;        // buffer bindings
+        uint32_t m_skippedUniforms;     // uniform uploads with unchanged values
+        uint32_t m_locationHits;        // getUniformLocation() answered from the cache
+        uint32_t m_locationMisses;
+    };
+
+    explicit GLStateCache(GLBackend& next);
+
+    // When disabled every call is forwarded (and counted), which is useful for comparison
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled; }
+
+    // Call at the start of each frame: publishes the previous frame's counters and
+    // forgets the state other code may have changed in between
+    void beginFrame();
+
+    // Applies deferred enables; call before handing GL to other code (e.g. at the end of draw())
+    void flush();
+
+    // Forgets everything, including uniform locations and values
+    void invalidate();
+    void invalidateProgram(GLuint program);
+
+    const Counters& getFrameCounters() const { return m_lastFrameCounters; }
+
+    GLint getUniformLocation(GLuint program, const char* name) override;
+    void  programUniform1i(GLuint program, GLint location, GLint value) override;
+    void  programUniformui64v(GLuint program, GLint location, GLsizei count, const GLuint64EXT* values) override;
+
+    void  enableVertexAttribArray(GLuint index) override;
+    void  disableVertexAttribArray(GLuint index) override;
+    void  enableVertexArrayAttrib(GLuint vao, GLuint index) override;
+    void  disableVertexArrayAttrib(GLuint vao, GLuint index) override;
+    void  enableClientState(GLenum cap) override;
+    void  disableClientState(GLenum cap) override;
+    void  vertexAttribFormat(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride) override;
+    void  vertexArrayVertexAttribOffset(GLuint vao, GLuint buffer, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset) override;
+    void  vertexAttribI2i(GLuint index, GLint x, GLint y) override;
+
+    void  bindBuffer(GLenum target, GLuint buffer) override;
+    void  bindBufferBase(GLenum target, GLuint index, GLuint buffer) override;
+    void  bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) override;
+    void  namedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) override;
+    void  namedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) override;
+    void  bufferAddressRange(GLenum pname, GLuint index, GLuint64EXT address, GLsizeiptr length) override;
+    void  copyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) override;
+    void  compressedTextureSubImage2D(GLuint texture, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, GLintptr unpackOffset) override;
+
+    void  drawElements(GLenum mode, GLsizei count, GLenum type, GLintptr indexOffset) override;
+
+private:
+    static const GLuint MaxAttribs         = 16;
+    static const GLuint MaxUniformBindings = 16;
+
+    struct AttribFormat
+    {
+        bool      m_known;
+        GLint     m_size;
+        GLenum    m_type;
+        GLboolean m_normalized;
+        GLsizei   m_stride;
+    };
+
+    struct BufferBinding
+    {
+        bool       m_known;
+        GLuint     m_buffer;
+        GLintptr   m_offset;
+        GLsizeiptr m_size;              // -1 for a whole buffer binding
+    };
+
+    struct DeferredBits
+    {
+        uint32_t m_desired;             // bit per attribute (or client state)
+        uint32_t m_touched;             // bits we have an opinion about
+        uint32_t m_applied;             // what GL has, valid where m_known is set
+        uint32_t m_known;
+        uint32_t m_pendingCalls;        // enable/disable calls since the last flush
+    };
+
+    struct UniformValue
+    {
+        GLint                m_location;
+        std::vector<uint8_t> m_bytes;
+    };
+
+    struct UniformLocation
+    {
+        std::string m_name;
+        GLint       m_location;
+    };
+
+    struct ProgramState
+    {
+        GLuint                       m_program;
+        std::vector<UniformLocation> m_locations;
+        std::vector<UniformValue>    m_values;
+    };
+
+    void           invalidateBindings();
+    ProgramState&  getProgramState(GLuint program);
+    bool           uniformChanged(GLuint program, GLint location, const void* bytes, size_t size);
+    bool           setDeferredBit(DeferredBits& bits, GLuint index, bool enable);
+    bool           needsApply(DeferredBits& bits, uint32_t bit);
+    BufferBinding* getTargetBinding(GLenum target);
+    bool           setBinding(BufferBinding& binding, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    GLBackend&                m_next;
+    bool                      m_enabled;
+
+    DeferredBits              m_attribs;              // bound VAO
+    DeferredBits              m_vao0Attribs;          // VAO 0 through the EXT_direct_state_access entry points
+    DeferredBits              m_clientStates;         // bit 0: GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV, bit 1: GL_ELEMENT_ARRAY_UNIFIED_NV
+    AttribFormat              m_formats[MaxAttribs];
+    BufferBinding             m_arrayBuffer;
+    BufferBinding             m_elementArrayBuffer;
+    BufferBinding             m_uniformBuffer;
+    BufferBinding             m_uniformBindings[MaxUniformBindings];
+    std::vector<ProgramState> m_programs;
+
+    Counters                  m_frameCounters;
+    Counters                  m_lastFrameCounters;
+};
+
+#endif
@@ -0,0 +1,883 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GLTrace.cpp
+//----------------------------------------------------------------------------------
+#include "GLTrace.h"
+#include "AtomicFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    const uint32_t TraceMagic   = 0x52544c47; // "GLTR"
+    const uint32_t TraceVersion = 2;        // 1 had no relocations
+    const int32_t  ArgCount     = 8;
+
+    double now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void writeVarint(std::vector<uint8_t>& out, uint64_t value)
+    {
+        while(value >= 0x80)
+        {
+            out.push_back(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(uint8_t(value));
+    }
+
+    void writeBytes(std::vector<uint8_t>& out, const std::vector<uint8_t>& bytes)
+    {
+        writeVarint(out, bytes.size());
+        out.insert(out.end(), bytes.begin(), bytes.end());
+    }
+
+    struct Reader
+    {
+        const uint8_t* m_data;
+        size_t         m_size;
+        size_t         m_pos;
+        bool           m_ok;
+
+        uint64_t varint()
+        {
+            uint64_t value = 0;
+            for(uint32_t shift = 0; shift < 64; shift += 7)
+            {
+                if(m_pos >= m_size)
+                {
+                    break;
+                }
+                const uint8_t byte = m_data[m_pos++];
+                value |= uint64_t(byte & 0x7f) << shift;
+                if((byte & 0x80) == 0)
+                {
+                    return value;
+                }
+            }
+            m_ok = false;
+            return 0;
+        }
+
+        uint8_t byte()
+        {
+            if(m_pos >= m_size)
+            {
+                m_ok = false;
+                return 0;
+            }
+            return m_data[m_pos++];
+        }
+
+        void bytes(std::vector<uint8_t>& out)
+        {
+            const uint64_t size = varint();
+            if(!m_ok || size > m_size - m_pos)
+            {
+                m_ok = false;
+                return;
+            }
+            out.assign(m_data + m_pos, m_data + m_pos + size);
+            m_pos += size_t(size);
+        }
+    };
+
+    bool lessRelocation(const GLTrace::Relocation& a, const GLTrace::Relocation& b)
+    {
+        return a.m_buffer != b.m_buffer ? a.m_buffer < b.m_buffer : a.m_offset < b.m_offset;
+    }
+}
+
+
+void GLTrace::clear()
+{
+    m_buffers.clear();
+    m_relocations.clear();
+    m_frames.clear();
+}
+
+
+uint64_t GLTrace::getCallCount() const
+{
+    uint64_t count = 0;
+    for(size_t i = 0; i < m_frames.size(); i++)
+    {
+        count += m_frames[i].m_calls.size();
+    }
+    return count;
+}
+
+
+void GLTrace::addRelocation(GLuint buffer, uint64_t offset)
+{
+    const Relocation relocation = { buffer, offset };
+    std::vector<Relocation>::iterator it = std::lower_bound(m_relocations.begin(), m_relocations.end(), relocation, lessRelocation);
+    if(it == m_relocations.end() || it->m_buffer != buffer || it->m_offset != offset)
+    {
+        m_relocations.insert(it, relocation);
+    }
+}
+
+
+bool GLTrace::isRelocated(GLuint buffer, uint64_t offset) const
+{
+    const Relocation relocation = { buffer, offset };
+    return std::binary_search(m_relocations.begin(), m_relocations.end(), relocation, lessRelocation);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GLTrace::hasProcessPointers()
+//
+//    Looks at every 8 byte aligned word of the snapshots and of the buffer
+//    writes that is not a relocation for a value inside a resident snapshot
+//    buffer. Data that happens to look like such an address only makes the
+//    check refuse a trace it could have drawn.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool GLTrace::hasProcessPointers() const
+{
+    std::vector<std::pair<uint64_t, uint64_t> > ranges;   // start, end of the resident buffers
+    for(size_t i = 0; i < m_buffers.size(); i++)
+    {
+        if(m_buffers[i].m_address != 0)
+        {
+            ranges.push_back(std::make_pair(uint64_t(m_buffers[i].m_address), uint64_t(m_buffers[i].m_address) + m_buffers[i].m_contents.size()));
+        }
+    }
+    std::sort(ranges.begin(), ranges.end());
+
+    // bufferOffset is where data starts in its buffer, the GPU reads pointers at 8 byte aligned offsets
+    auto holdsPointer = [this, &ranges](const std::vector<uint8_t>& data, uint64_t buffer, uint64_t bufferOffset) {
+        for(size_t i = size_t((8 - bufferOffset % 8) % 8); i + 8 <= data.size(); i += 8)
+        {
+            if(isRelocated(GLuint(buffer), bufferOffset + i))
+            {
+                continue;
+            }
+            uint64_t value;
+            memcpy(&value, &data[i], sizeof(value));
+            std::vector<std::pair<uint64_t, uint64_t> >::const_iterator it =
+                std::upper_bound(ranges.begin(), ranges.end(), std::make_pair(value, ~uint64_t(0)));
+            if(it != ranges.begin() && value < (it - 1)->second)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    for(size_t i = 0; i < m_buffers.size(); i++)
+    {
+        if(holdsPointer(m_buffers[i].m_contents, m_buffers[i].m_name, 0))
+        {
+            return true;
+        }
+    }
+    for(size_t f = 0; f < m_frames.size(); f++)
+    {
+        const std::vector<Call>& calls = m_frames[f].m_calls;
+        for(size_t c = 0; c < calls.size(); c++)
+        {
+            const Call& call = calls[c];
+            if(call.m_op == RecordingGLBackend::OpProgramUniformui64v ||
+               (call.m_op == RecordingGLBackend::OpNamedBufferData && holdsPointer(call.m_data, call.m_args[0], 0)) ||
+               (call.m_op == RecordingGLBackend::OpNamedBufferSubData && holdsPointer(call.m_data, call.m_args[0], call.m_args[1])))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GLTrace::addBuffer()
+//
+//    Reads a buffer back from GL for the snapshot. Needs the context the
+//    buffer lives in; call it once the captured frames are done.
+//
+////////////////////////////////////////////////////////////////////////////////
+void GLTrace::addBuffer(GLuint name, GLuint64EXT address)
+{
+    GLint size = 0;
+    glGetNamedBufferParameterivEXT(name, GL_BUFFER_SIZE, &size);
+
+    m_buffers.push_back(Buffer());
+    Buffer& buffer = m_buffers.back();
+    buffer.m_name    = name;
+    buffer.m_address = address;
+    buffer.m_contents.resize(size_t(size));
+    if(size > 0)
+    {
+        glGetNamedBufferSubDataEXT(name, 0, size, &buffer.m_contents[0]);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GLTrace::encode()
+//
+//    *** INTERESTING ***
+//    Draw loops repeat the same few calls with small arguments and most of
+//    the eight argument slots are zero. Only the non-zero ones are written,
+//    as varints, so the per draw calls shrink from 72+ bytes in memory to
+//    a few bytes on disk.
+//
+////////////////////////////////////////////////////////////////////////////////
+void GLTrace::encode(std::vector<uint8_t>& out) const
+{
+    out.clear();
+    writeVarint(out, TraceMagic);
+    writeVarint(out, TraceVersion);
+    writeVarint(out, m_buffers.size());
+    writeVarint(out, m_frames.size());
+
+    for(size_t i = 0; i < m_buffers.size(); i++)
+    {
+        writeVarint(out, m_buffers[i].m_name);
+        writeVarint(out, m_buffers[i].m_address);
+        writeBytes(out, m_buffers[i].m_contents);
+    }
+
+    writeVarint(out, m_relocations.size());
+    for(size_t i = 0; i < m_relocations.size(); i++)
+    {
+        writeVarint(out, m_relocations[i].m_buffer);
+        writeVarint(out, m_relocations[i].m_offset);
+    }
+
+    for(size_t f = 0; f < m_frames.size(); f++)
+    {
+        const std::vector<Call>& calls = m_frames[f].m_calls;
+        writeVarint(out, calls.size());
+        for(size_t c = 0; c < calls.size(); c++)
+        {
+            const Call& call = calls[c];
+            uint8_t mask = 0;
+            for(int32_t a = 0; a < ArgCount; a++)
+            {
+                mask |= (call.m_args[a] != 0) ? uint8_t(1 << a) : 0;
+            }
+            out.push_back(uint8_t(call.m_op));
+            out.push_back(mask);
+            for(int32_t a = 0; a < ArgCount; a++)
+            {
+                if(mask & (1 << a))
+                {
+                    writeVarint(out, call.m_args[a]);
+                }
+            }
+            writeBytes(out, call.m_data);
+        }
+    }
+}
+
+
+bool GLTrace::decode(const uint8_t* data, size_t size)
+{
+    clear();
+
+    Reader in = { data, size, 0, true };
+    if(in.varint() != TraceMagic)
+    {
+        return false;
+    }
+    const uint64_t version = in.varint();
+    if(version != 1 && version != TraceVersion)
+    {
+        return false;
+    }
+
+    const uint64_t bufferCount = in.varint();
+    const uint64_t frameCount  = in.varint();
+    // Every entry takes at least a byte, which bounds the counts of a corrupt file
+    if(!in.m_ok || bufferCount > size || frameCount > size)
+    {
+        return false;
+    }
+
+    m_buffers.resize(size_t(bufferCount));
+    for(size_t i = 0; i < m_buffers.size() && in.m_ok; i++)
+    {
+        m_buffers[i].m_name    = GLuint(in.varint());
+        m_buffers[i].m_address = in.varint();
+        in.bytes(m_buffers[i].m_contents);
+    }
+
+    const uint64_t relocationCount = version >= 2 ? in.varint() : 0;
+    if(relocationCount > size - in.m_pos)
+    {
+        in.m_ok = false;
+    }
+    for(uint64_t i = 0; i < relocationCount && in.m_ok; i++)
+    {
+        const GLuint   buffer = GLuint(in.varint());
+        const uint64_t offset = in.varint();
+        m_relocations.push_back(Relocation());
+        m_relocations.back().m_buffer = buffer;
+        m_relocations.back().m_offset = offset;
+    }
+    std::sort(m_relocations.begin(), m_relocations.end(), lessRelocation);
+
+    m_frames.resize(size_t(frameCount));
+    for(size_t f = 0; f < m_frames.size() && in.m_ok; f++)
+    {
+        const uint64_t callCount = in.varint();
+        if(callCount > size - in.m_pos)
+        {
+            in.m_ok = false;
+            break;
+        }
+        std::vector<Call>& calls = m_frames[f].m_calls;
+        calls.resize(size_t(callCount));
+        for(size_t c = 0; c < calls.size() && in.m_ok; c++)
+        {
+            Call& call = calls[c];
+            const uint8_t op   = in.byte();
+            const uint8_t mask = in.byte();
+            if(op >= RecordingGLBackend::OpCount)
+            {
+                in.m_ok = false;
+                break;
+            }
+            call.m_op = RecordingGLBackend::Op(op);
+            for(int32_t a = 0; a < ArgCount; a++)
+            {
+                call.m_args[a] = (mask & (1 << a)) ? in.varint() : 0;
+            }
+            in.bytes(call.m_data);
+        }
+    }
+
+    if(!in.m_ok || in.m_pos != size)
+    {
+        clear();
+        return false;
+    }
+    return true;
+}
+
+
+bool GLTrace::write(const std::string& path) const
+{
+    std::vector<uint8_t> data;
+    encode(data);
+
+    // Written next to the destination and swapped in, like the shader and texture caches
+    return writeFileAtomic(path, [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&data[0]), data.size());
+    });
+}
+
+
+bool GLTrace::read(const std::string& path)
+{
+    std::ifstream file(path.c_str(), std::ios::binary | std::ios::ate);
+    if(!file)
+    {
+        return false;
+    }
+    const std::streamoff size = file.tellg();
+    if(size <= 0)
+    {
+        return false;
+    }
+    std::vector<uint8_t> data(static_cast<size_t>(size));
+    file.seekg(0);
+    if(!file.read(reinterpret_cast<char*>(&data[0]), data.size()))
+    {
+        return false;
+    }
+    return decode(&data[0], data.size());
+}
+
+
+
+
+GLCaptureBackend::GLCaptureBackend(GLBackend& next)
+    : m_next(next)
+    , m_remaining(0)
+    , m_capturing(false)
+{
+}
+
+
+void GLCaptureBackend::start(uint32_t frameCount)
+{
+    m_trace.clear();
+    clear();
+    m_remaining = frameCount;
+    m_capturing = false;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GLCaptureBackend::beginFrame()
+//
+//    The GLStateCache looks each uniform location up only once, long before
+//    a capture starts, so the first captured frame begins with the lookups
+//    seen so far. The replay needs their names to find the locations again.
+//
+////////////////////////////////////////////////////////////////////////////////
+void GLCaptureBackend::beginFrame()
+{
+    if(m_remaining == 0 || m_capturing)
+    {
+        return;
+    }
+
+    m_capturing = true;
+    clear();
+    if(m_trace.m_frames.empty())
+    {
+        for(size_t i = 0; i < m_locations.size(); i++)
+        {
+            const UniformLocation& location = m_locations[i];
+            Call& call = record(OpGetUniformLocation, location.m_program, uint64_t(location.m_location));
+            call.m_data.assign(location.m_name.c_str(), location.m_name.c_str() + location.m_name.size() + 1);
+        }
+    }
+}
+
+
+void GLCaptureBackend::endFrame()
+{
+    if(!m_capturing)
+    {
+        return;
+    }
+
+    m_trace.m_frames.push_back(GLTrace::Frame());
+    m_trace.m_frames.back().m_calls.swap(getCalls());
+    clear();
+    m_capturing = (--m_remaining != 0);
+}
+
+
+GLint GLCaptureBackend::getUniformLocation(GLuint program, const char* name)
+{
+    // The real location is recorded, not the one RecordingGLBackend would make up
+    const GLint location = m_next.getUniformLocation(program, name);
+    bool known = false;
+    for(size_t i = 0; i < m_locations.size() && !known; i++)
+    {
+        known = m_locations[i].m_program == program && m_locations[i].m_name == name;
+    }
+    if(!known)
+    {
+        UniformLocation entry = { program, location, name };
+        m_locations.push_back(entry);
+    }
+    if(m_capturing)
+    {
+        Call& call = record(OpGetUniformLocation, program, uint64_t(location));
+        call.m_data.assign(name, name + strlen(name) + 1);
+    }
+    return location;
+}
+
+void GLCaptureBackend::programUniform1i(GLuint program, GLint location, GLint value)
+{
+    m_next.programUniform1i(program, location, value);
+    if(m_capturing) RecordingGLBackend::programUniform1i(program, location, value);
+}
+
+void GLCaptureBackend::programUniformui64v(GLuint program, GLint location, GLsizei count, const GLuint64EXT* values)
+{
+    m_next.programUniformui64v(program, location, count, values);
+    if(m_capturing) RecordingGLBackend::programUniformui64v(program, location, count, values);
+}
+
+void GLCaptureBackend::enableVertexAttribArray(GLuint index)
+{
+    m_next.enableVertexAttribArray(index);
+    if(m_capturing) RecordingGLBackend::enableVertexAttribArray(index);
+}
+
+void GLCaptureBackend::disableVertexAttribArray(GLuint index)
+{
+    m_next.disableVertexAttribArray(index);
+    if(m_capturing) RecordingGLBackend::disableVertexAttribArray(index);
+}
+
+void GLCaptureBackend::enableVertexArrayAttrib(GLuint vao, GLuint index)
+{
+    m_next.enableVertexArrayAttrib(vao, index);
+    if(m_capturing) RecordingGLBackend::enableVertexArrayAttrib(vao, index);
+}
+
+void GLCaptureBackend::disableVertexArrayAttrib(GLuint vao, GLuint index)
+{
+    m_next.disableVertexArrayAttrib(vao, index);
+    if(m_capturing) RecordingGLBackend::disableVertexArrayAttrib(vao, index);
+}
+
+void GLCaptureBackend::enableClientState(GLenum cap)
+{
+    m_next.enableClientState(cap);
+    if(m_capturing) RecordingGLBackend::enableClientState(cap);
+}
+
+void GLCaptureBackend::disableClientState(GLenum cap)
+{
+    m_next.disableClientState(cap);
+    if(m_capturing) RecordingGLBackend::disableClientState(cap);
+}
+
+void GLCaptureBackend::vertexAttribFormat(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride)
+{
+    m_next.vertexAttribFormat(index, size, type, normalized, stride);
+    if(m_capturing) RecordingGLBackend::vertexAttribFormat(index, size, type, normalized, stride);
+}
+
+void GLCaptureBackend::vertexArrayVertexAttribOffset(GLuint vao, GLuint buffer, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset)
+{
+    m_next.vertexArrayVertexAttribOffset(vao, buffer, index, size, type, normalized, stride, offset);
+    if(m_capturing) RecordingGLBackend::vertexArrayVertexAttribOffset(vao, buffer, index, size, type, normalized, stride, offset);
+}
+
+void GLCaptureBackend::vertexAttribI2i(GLuint index, GLint x, GLint y)
+{
+    m_next.vertexAttribI2i(index, x, y);
+    if(m_capturing) RecordingGLBackend::vertexAttribI2i(index, x, y);
+}
+
+void GLCaptureBackend::bindBuffer(GLenum target, GLuint buffer)
+{
+    m_next.bindBuffer(target, buffer);
+    if(m_capturing) RecordingGLBackend::bindBuffer(target, buffer);
+}
+
+void GLCaptureBackend::bindBufferBase(GLenum target, GLuint index, GLuint buffer)
+{
+    m_next.bindBufferBase(target, index, buffer);
+    if(m_capturing) RecordingGLBackend::bindBufferBase(target, index, buffer);
+}
+
+void GLCaptureBackend::bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+    m_next.bindBufferRange(target, index, buffer, offset, size);
+    if(m_capturing) RecordingGLBackend::bindBufferRange(target, index, buffer, offset, size);
+}
+
+void GLCaptureBackend::namedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage)
+{
+    m_next.namedBufferData(buffer, size, data, usage);
+    if(m_capturing) RecordingGLBackend::namedBufferData(buffer, size, data, usage);
+}
+
+void GLCaptureBackend::namedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+{
+    m_next.namedBufferSubData(buffer, offset, size, data);
+    if(m_capturing) RecordingGLBackend::namedBufferSubData(buffer, offset, size, data);
+}
+
+void GLCaptureBackend::bufferAddressRange(GLenum pname, GLuint index, GLuint64EXT address, GLsizeiptr length)
+{
+    m_next.bufferAddressRange(pname, index, address, length);
+    if(m_capturing) RecordingGLBackend::bufferAddressRange(pname, index, address, length);
+}
+
+void GLCaptureBackend::copyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
+{
+    m_next.copyNamedBufferSubData(readBuffer, writeBuffer, readOffset, writeOffset, size);
+    if(m_capturing) RecordingGLBackend::copyNamedBufferSubData(readBuffer, writeBuffer, readOffset, writeOffset, size);
+}
+
+void GLCaptureBackend::compressedTextureSubImage2D(GLuint texture, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, GLintptr unpackOffset)
+{
+    m_next.compressedTextureSubImage2D(texture, target, level, xoffset, yoffset, width, height, format, imageSize, unpackOffset);
+    if(m_capturing) RecordingGLBackend::compressedTextureSubImage2D(texture, target, level, xoffset, yoffset, width, height, format, imageSize, unpackOffset);
+}
+
+void GLCaptureBackend::drawElements(GLenum mode, GLsizei count, GLenum type, GLintptr indexOffset)
+{
+    m_next.drawElements(mode, count, type, indexOffset);
+    if(m_capturing) RecordingGLBackend::drawElements(mode, count, type, indexOffset);
+}
+
+
+
+
+GLTraceReplayer::GLTraceReplayer(const GLTrace& trace)
+    : m_trace(trace)
+    , m_program(0)
+    , m_createdBuffers(false)
+{
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GLTraceReplayer::createBuffers()
+//
+//    *** INTERESTING ***
+//    The snapshot buffers get new names and, where they were resident, new
+//    GPU addresses. Every name and every address inside a snapshot buffer's
+//    range is translated on replay, so the bindless calls (address ranges,
+//    the per mesh uniform pointer attribute) land on the new buffers.
+//    Pointers stored inside buffer contents cannot be told from data; the
+//    ones the app declared as relocations are rewritten in the snapshots and
+//    in every write, any other would be dereferenced at the capturing
+//    process's address, so such a trace gets no buffers and is not drawn.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool GLTraceReplayer::createBuffers()
+{
+    releaseBuffers();
+    if(m_trace.hasProcessPointers())
+    {
+        return false;
+    }
+
+    for(size_t i = 0; i < m_trace.m_buffers.size(); i++)
+    {
+        const GLTrace::Buffer& buffer = m_trace.m_buffers[i];
+        BufferMapping mapping;
+        mapping.m_oldName    = buffer.m_name;
+        mapping.m_oldAddress = buffer.m_address;
+        mapping.m_newAddress = 0;
+        mapping.m_size       = buffer.m_contents.size();
+
+        glGenBuffers(1, &mapping.m_newName);
+        glNamedBufferDataEXT(mapping.m_newName, GLsizeiptr(buffer.m_contents.size()), nullptr, GL_DYNAMIC_DRAW);
+        if(buffer.m_address != 0)
+        {
+            glGetNamedBufferParameterui64vNV(mapping.m_newName, GL_BUFFER_GPU_ADDRESS_NV, &mapping.m_newAddress);
+            glMakeNamedBufferResidentNV(mapping.m_newName, GL_READ_ONLY);
+        }
+        m_buffers.push_back(mapping);
+    }
+    m_createdBuffers = true;
+
+    std::sort(m_buffers.begin(), m_buffers.end(), [](const BufferMapping& a, const BufferMapping& b) { return a.m_oldName < b.m_oldName; });
+    m_addressOrder.clear();
+    for(size_t i = 0; i < m_buffers.size(); i++)
+    {
+        if(m_buffers[i].m_oldAddress != 0)
+        {
+            m_addressOrder.push_back(i);
+        }
+    }
+    const std::vector<BufferMapping>& buffers = m_buffers;
+    std::sort(m_addressOrder.begin(), m_addressOrder.end(), [&buffers](size_t a, size_t b) { return buffers[a].m_oldAddress < buffers[b].m_oldAddress; });
+
+    // Every new address is known now, so the contents go up with their relocations remapped
+    for(size_t i = 0; i < m_trace.m_buffers.size(); i++)
+    {
+        const GLTrace::Buffer& buffer = m_trace.m_buffers[i];
+        if(!buffer.m_contents.empty())
+        {
+            glNamedBufferSubDataEXT(remapBuffer(buffer.m_name), 0, GLsizeiptr(buffer.m_contents.size()),
+                                    relocate(buffer.m_name, 0, &buffer.m_contents[0], buffer.m_contents.size()));
+        }
+    }
+    return true;
+}
+
+
+void GLTraceReplayer::releaseBuffers()
+{
+    if(m_createdBuffers)
+    {
+        for(size_t i = 0; i < m_buffers.size(); i++)
+        {
+            if(m_buffers[i].m_newAddress != 0)
+            {
+                glMakeNamedBufferNonResidentNV(m_buffers[i].m_newName);
+            }
+            glDeleteBuffers(1, &m_buffers[i].m_newName);
+        }
+    }
+    m_buffers.clear();
+    m_addressOrder.clear();
+    m_locations.clear();
+    m_createdBuffers = false;
+}
+
+
+GLuint GLTraceReplayer::remapBuffer(uint64_t name) const
+{
+    std::vector<BufferMapping>::const_iterator it = std::lower_bound(m_buffers.begin(), m_buffers.end(), GLuint(name),
+        [](const BufferMapping& mapping, GLuint n) { return mapping.m_oldName < n; });
+    return (it != m_buffers.end() && it->m_oldName == GLuint(name)) ? it->m_newName : GLuint(name);
+}
+
+
+uint64_t GLTraceReplayer::remapAddress(uint64_t address) const
+{
+    // Last buffer starting at or below the address
+    const std::vector<BufferMapping>& buffers = m_buffers;
+    std::vector<size_t>::const_iterator it = std::upper_bound(m_addressOrder.begin(), m_addressOrder.end(), address,
+        [&buffers](uint64_t a, size_t i) { return a < buffers[i].m_oldAddress; });
+    if(it == m_addressOrder.begin())
+    {
+        return address;
+    }
+    const BufferMapping& mapping = m_buffers[*(it - 1)];
+    return (address - mapping.m_oldAddress < mapping.m_size) ? mapping.m_newAddress + (address - mapping.m_oldAddress) : address;
+}
+
+
+const void* GLTraceReplayer::relocate(uint64_t buffer, uint64_t offset, const void* data, size_t size)
+{
+    // The first relocation of the buffer at or after offset; one the write covers only in part is left alone
+    const std::vector<GLTrace::Relocation>& relocations = m_trace.m_relocations;
+    const GLTrace::Relocation first = { GLuint(buffer), offset };
+    std::vector<GLTrace::Relocation>::const_iterator it = std::lower_bound(relocations.begin(), relocations.end(), first, lessRelocation);
+    if(!m_createdBuffers || data == nullptr || it == relocations.end() || it->m_buffer != GLuint(buffer) || it->m_offset + 8 > offset + size)
+    {
+        return data;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    m_scratch.assign(bytes, bytes + size);
+    for(; it != relocations.end() && it->m_buffer == GLuint(buffer) && it->m_offset + 8 <= offset + size; ++it)
+    {
+        uint64_t address;
+        memcpy(&address, &m_scratch[size_t(it->m_offset - offset)], sizeof(address));
+        address = remapAddress(address);
+        memcpy(&m_scratch[size_t(it->m_offset - offset)], &address, sizeof(address));
+    }
+    return &m_scratch[0];
+}
+
+
+GLint GLTraceReplayer::remapLocation(GLuint program, uint64_t location) const
+{
+    for(size_t i = 0; i < m_locations.size(); i++)
+    {
+        if(m_locations[i].m_program == program && m_locations[i].m_oldLocation == GLint(location))
+        {
+            return m_locations[i].m_newLocation;
+        }
+    }
+    return GLint(location);
+}
+
+
+GLTraceReplayer::Stats GLTraceReplayer::replay(GLBackend& target, uint32_t iterations)
+{
+    Stats stats;
+    memset(&stats, 0, sizeof(stats));
+
+    const double start = now();
+    for(uint32_t i = 0; i < iterations; i++)
+    {
+        for(size_t f = 0; f < m_trace.m_frames.size(); f++)
+        {
+            replayFrame(target, f);
+            stats.m_calls += m_trace.m_frames[f].m_calls.size();
+            stats.m_frames++;
+        }
+    }
+    stats.m_seconds = now() - start;
+    stats.m_callsPerSecond = stats.m_seconds > 0.0 ? double(stats.m_calls) / stats.m_seconds : 0.0;
+    return stats;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GLTraceReplayer::replayFrame()
+//
+//    Issues the calls of one frame, translating buffer names, GPU addresses
+//    (relocated ones in buffer writes too), programs and uniform locations on
+//    the way. Calls recorded without their
+//    payload (RecordingGLBackend::setRecordData(false)) pass a null pointer.
+//
+////////////////////////////////////////////////////////////////////////////////
+void GLTraceReplayer::replayFrame(GLBackend& target, size_t frame)
+{
+    typedef RecordingGLBackend R;
+
+    const std::vector<GLTrace::Call>& calls = m_trace.m_frames[frame].m_calls;
+    for(size_t c = 0; c < calls.size(); c++)
+    {
+        const GLTrace::Call& call = calls[c];
+        const uint64_t* a = call.m_args;
+        const void* data = call.m_data.empty() ? nullptr : &call.m_data[0];
+
+        switch(call.m_op)
+        {
+        case R::OpGetUniformLocation:
+            {
+                const GLuint program = remapProgram(a[0]);
+                const GLint  location = target.getUniformLocation(program, reinterpret_cast<const char*>(data ? data : ""));
+                bool known = false;
+                for(size_t i = 0; i < m_locations.size() && !known; i++)
+                {
+                    known = m_locations[i].m_program == program && m_locations[i].m_oldLocation == GLint(a[1]);
+                }
+                if(!known)
+                {
+                    LocationMapping mapping = { program, GLint(a[1]), location };
+                    m_locations.push_back(mapping);
+                }
+            }
+            break;
+        case R::OpProgramUniform1i:
+            target.programUniform1i(remapProgram(a[0]), remapLocation(remapProgram(a[0]), a[1]), GLint(a[2]));
+            break;
+        case R::OpProgramUniformui64v:
+            // The values are bindless texture handles, which only mean something to the capturing driver
+            target.programUniformui64v(remapProgram(a[0]), remapLocation(remapProgram(a[0]), a[1]), GLsizei(a[2]), static_cast<const GLuint64EXT*>(data));
+            break;
+        case R::OpEnableVertexAttribArray:          target.enableVertexAttribArray(GLuint(a[0])); break;
+        case R::OpDisableVertexAttribArray:         target.disableVertexAttribArray(GLuint(a[0])); break;
+        case R::OpEnableVertexArrayAttrib:          target.enableVertexArrayAttrib(GLuint(a[0]), GLuint(a[1])); break;
+        case R::OpDisableVertexArrayAttrib:         target.disableVertexArrayAttrib(GLuint(a[0]), GLuint(a[1])); break;
+        case R::OpEnableClientState:                target.enableClientState(GLenum(a[0])); break;
+        case R::OpDisableClientState:               target.disableClientState(GLenum(a[0])); break;
+        case R::OpVertexAttribFormat:
+            target.vertexAttribFormat(GLuint(a[0]), GLint(a[1]), GLenum(a[2]), GLboolean(a[3]), GLsizei(a[4]));
+            break;
+        case R::OpVertexArrayVertexAttribOffset:
+            target.vertexArrayVertexAttribOffset(GLuint(a[0]), remapBuffer(a[1]), GLuint(a[2]), GLint(a[3]), GLenum(a[4]), GLboolean(a[5]), GLsizei(a[6]), GLintptr(a[7]));
+            break;
+        case R::OpVertexAttribI2i:
+            {
+                // The app passes GPU pointers as two ints; anything else is outside every buffer and passes through
+                const uint64_t address = remapAddress((a[2] << 32) | (a[1] & 0xffffffff));
+                target.vertexAttribI2i(GLuint(a[0]), GLint(address & 0xffffffff), GLint(address >> 32));
+            }
+            break;
+        case R::OpBindBuffer:                       target.bindBuffer(GLenum(a[0]), remapBuffer(a[1])); break;
+        case R::OpBindBufferBase:                   target.bindBufferBase(GLenum(a[0]), GLuint(a[1]), remapBuffer(a[2])); break;
+        case R::OpBindBufferRange:
+            target.bindBufferRange(GLenum(a[0]), GLuint(a[1]), remapBuffer(a[2]), GLintptr(a[3]), GLsizeiptr(a[4]));
+            break;
+        case R::OpNamedBufferData:
+            target.namedBufferData(remapBuffer(a[0]), GLsizeiptr(a[1]), relocate(a[0], 0, data, call.m_data.size()), GLenum(a[2]));
+            break;
+        case R::OpNamedBufferSubData:
+            target.namedBufferSubData(remapBuffer(a[0]), GLintptr(a[1]), GLsizeiptr(a[2]), relocate(a[0], a[1], data, call.m_data.size()));
+            break;
+        case R::OpBufferAddressRange:
+            target.bufferAddressRange(GLenum(a[0]), GLuint(a[1]), remapAddress(a[2]), GLsizeiptr(a[3]));
+            break;
+        case R::OpCopyNamedBufferSubData:
+            target.copyNamedBufferSubData(remapBuffer(a[0]), remapBuffer(a[1]), GLintptr(a[2]), GLintptr(a[3]), GLsizeiptr(a[4]));
+            break;
+        case R::OpCompressedTextureSubImage2D:
+            target.compressedTextureSubImage2D(GLuint(a[0]), GLenum(a[1]), GLint(a[2]), GLint(a[3] >> 32), GLint(a[3] & 0xffffffff),
+                                               GLsizei(a[4] >> 32), GLsizei(a[4] & 0xffffffff), GLenum(a[5]), GLsizei(a[6]), GLintptr(a[7]));
+            break;
+        case R::OpDrawElements:
+            target.drawElements(GLenum(a[0]), GLsizei(a[1]), GLenum(a[2]), GLintptr(a[3]));
+            break;
+        default:
+            break;
+        }
+    }
+}
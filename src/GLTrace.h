@@ -0,0 +1,198 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GLTrace.h
+//
+// Capture and replay of the per frame GL call stream. GLCaptureBackend sits
+// between the GLStateCache and the driver, so a trace holds exactly the calls
+// that reached GL, with buffer payloads. The app adds a snapshot of the buffers
+// the calls refer to (contents and GPU address), which lets a replay recreate
+// them and remap names and GPU pointers on another machine or driver.
+//
+// File layout (little endian): "GLTR", version, buffer count, frame count, then
+// the buffers, the relocations, and per frame a call count followed by the
+// calls. A call is its op, a byte with one bit per non-zero argument, those
+// arguments as LEB128 varints and a varint length plus payload. Most arguments
+// are small, so a call usually takes a handful of bytes.
+//
+// Names and GPU addresses in call arguments are remapped on replay. GPU
+// addresses stored inside buffer contents cannot be told from data, so the app
+// declares where they are as relocations (the pointers in the transform
+// uniforms); those are remapped in the snapshots and in every write to the
+// buffer. Any other stored address, and bindless texture handles, are only
+// valid in the capturing process. hasProcessPointers() finds them, and such a
+// trace must not be drawn on a driver.
+//----------------------------------------------------------------------------------
+#ifndef GL_TRACE_H
+#define GL_TRACE_H
+
+#include "GLBackend.h"
+#include <string>
+#include <vector>
+
+class GLTrace
+{
+public:
+    typedef RecordingGLBackend::Call Call;
+
+    struct Buffer
+    {
+        GLuint               m_name;
+        GLuint64EXT          m_address;     // 0 if the buffer was not resident
+        std::vector<uint8_t> m_contents;
+    };
+
+    // An 8 byte GPU address at m_offset in buffer m_buffer, in its snapshot and in every write to it
+    struct Relocation
+    {
+        GLuint   m_buffer;
+        uint64_t m_offset;
+    };
+
+    struct Frame
+    {
+        std::vector<Call> m_calls;
+    };
+
+    std::vector<Buffer>     m_buffers;
+    std::vector<Relocation> m_relocations;  // sorted by buffer, then offset
+    std::vector<Frame>      m_frames;
+
+    void     clear();
+    uint64_t getCallCount() const;
+
+    // Snapshots a buffer's current contents from GL; address is its GPU address, or 0
+    void     addBuffer(GLuint name, GLuint64EXT address);
+    void     addRelocation(GLuint buffer, uint64_t offset);
+    bool     isRelocated(GLuint buffer, uint64_t offset) const;
+
+    // True if a snapshot or a buffer write holds the GPU address of a resident snapshot buffer outside
+    // a relocation, or a call sets bindless texture handles. The GPU would dereference those in the
+    // replaying process.
+    bool     hasProcessPointers() const;
+
+    void     encode(std::vector<uint8_t>& out) const;
+    bool     decode(const uint8_t* data, size_t size);
+
+    bool     write(const std::string& path) const;
+    bool     read(const std::string& path);
+};
+
+
+// Forwards every call to 'next' and, while capturing, records it for the trace
+class GLCaptureBackend : public RecordingGLBackend
+{
+public:
+    explicit GLCaptureBackend(GLBackend& next);
+
+    // Captures 'frameCount' frames, starting with the next beginFrame()
+    void  start(uint32_t frameCount);
+    void  beginFrame();
+    void  endFrame();
+    bool  isCapturing() const   { return m_capturing; }
+    bool  isDone() const        { return m_remaining == 0 && !m_trace.m_frames.empty(); }
+
+    GLTrace& getTrace()         { return m_trace; }
+
+    GLint getUniformLocation(GLuint program, const char* name) override;
+    void  programUniform1i(GLuint program, GLint location, GLint value) override;
+    void  programUniformui64v(GLuint program, GLint location, GLsizei count, const GLuint64EXT* values) override;
+
+    void  enableVertexAttribArray(GLuint index) override;
+    void  disableVertexAttribArray(GLuint index) override;
+    void  enableVertexArrayAttrib(GLuint vao, GLuint index) override;
+    void  disableVertexArrayAttrib(GLuint vao, GLuint index) override;
+    void  enableClientState(GLenum cap) override;
+    void  disableClientState(GLenum cap) override;
+    void  vertexAttribFormat(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride) override;
+    void  vertexArrayVertexAttribOffset(GLuint vao, GLuint buffer, GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLintptr offset) override;
+    void  vertexAttribI2i(GLuint index, GLint x, GLint y) override;
+
+    void  bindBuffer(GLenum target, GLuint buffer) override;
+    void  bindBufferBase(GLenum target, GLuint index, GLuint buffer) override;
+    void  bindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) override;
+    void  namedBufferData(GLuint buffer, GLsizeiptr size, const void* data, GLenum usage) override;
+    void  namedBufferSubData(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data) override;
+    void  bufferAddressRange(GLenum pname, GLuint index, GLuint64EXT address, GLsizeiptr length) override;
+    void  copyNamedBufferSubData(GLuint readBuffer, GLuint writeBuffer, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size) override;
+    void  compressedTextureSubImage2D(GLuint texture, GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, GLintptr unpackOffset) override;
+
+    void  drawElements(GLenum mode, GLsizei count, GLenum type, GLintptr indexOffset) override;
+
+private:
+    struct UniformLocation
+    {
+        GLuint      m_program;
+        GLint       m_location;
+        std::string m_name;
+    };
+
+    GLBackend&                   m_next;
+    GLTrace                      m_trace;
+    std::vector<UniformLocation> m_locations;   // every lookup seen, captured or not
+    uint32_t                     m_remaining;
+    bool                         m_capturing;
+};
+
+
+// Re-issues a trace into any GLBackend as fast as it can
+class GLTraceReplayer
+{
+public:
+    struct Stats
+    {
+        uint64_t m_calls;
+        uint32_t m_frames;
+        double   m_seconds;
+        double   m_callsPerSecond;
+    };
+
+    explicit GLTraceReplayer(const GLTrace& trace);
+
+    // For a real driver: recreates the snapshot buffers (needs a GL context) and maps
+    // their names and GPU addresses onto the new ones, relocations included. Refuses,
+    // returning false, when the trace has GPU pointers in buffer contents that are not
+    // relocations (GLTrace::hasProcessPointers()): only a stand-in backend may replay it then.
+    bool  createBuffers();
+    bool  canDraw() const           { return m_createdBuffers; }
+    void  releaseBuffers();
+
+    // Replaces the program of every uniform call (0 keeps the captured one); uniform
+    // locations are looked up again by name where the trace has the name
+    void  setProgram(GLuint program) { m_program = program; }
+
+    Stats replay(GLBackend& target, uint32_t iterations);
+    void  replayFrame(GLBackend& target, size_t frame);
+
+private:
+    struct BufferMapping
+    {
+        GLuint      m_oldName;
+        GLuint      m_newName;
+        GLuint64EXT m_oldAddress;
+        GLuint64EXT m_newAddress;
+        uint64_t    m_size;
+    };
+
+    struct LocationMapping
+    {
+        GLuint m_program;
+        GLint  m_oldLocation;
+        GLint  m_newLocation;
+    };
+
+    GLuint      remapBuffer(uint64_t name) const;
+    uint64_t    remapAddress(uint64_t address) const;
+    GLuint      remapProgram(uint64_t program) const { return m_program != 0 ? m_program : GLuint(program); }
+    GLint       remapLocation(GLuint program, uint64_t location) const;
+    // data written at offset into captured buffer 'buffer' with its relocations remapped; data itself when it has none
+    const void* relocate(uint64_t buffer, uint64_t offset, const void* data, size_t size);
+
+    const GLTrace&               m_trace;
+    GLuint                       m_program;
+    std::vector<BufferMapping>   m_buffers;         // sorted by old name
+    std::vector<size_t>          m_addressOrder;    // resident entries of m_buffers, sorted by old address
+    std::vector<LocationMapping> m_locations;
+    std::vector<uint8_t>         m_scratch;         // a relocated buffer write
+    bool                         m_createdBuffers;
+};
+
+#endif
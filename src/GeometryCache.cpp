@@ -0,0 +1,267 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GeometryCache.cpp
+//----------------------------------------------------------------------------------
+#include "GeometryCache.h"
+#include "UploadQueue.h"
+#include "MemoryTracker.h"
+#include "GLObjectQueue.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    const uint64_t Prime0 = 0x9E3779B185EBCA87ull;
+    const uint64_t Prime1 = 0xC2B2AE3D27D4EB4Full;
+    const uint64_t Prime2 = 0x165667B19E3779F9ull;
+
+    double now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    inline uint64_t rotl(uint64_t x, int32_t r)
+    {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    inline uint64_t load64(const uint8_t* p)
+    {
+        uint64_t value;
+        memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    inline uint64_t round(uint64_t lane, uint64_t input)
+    {
+        return rotl(lane + input * Prime1, 31) * Prime0;
+    }
+
+    inline uint64_t mix(uint64_t h)
+    {
+        h ^= h >> 33;
+        h *= Prime1;
+        h ^= h >> 29;
+        h *= Prime2;
+        h ^= h >> 32;
+        return h;
+    }
+}
+
+
+GeometryCache::GeometryCache(UploadQueue* uploads, GLObjectQueue* objects)
+    : m_uploads(uploads)
+    , m_objects(objects)
+    , m_hashFunction(&GeometryCache::hash)
+{
+    memset(&m_counters, 0, sizeof(m_counters));
+}
+
+
+GeometryCache::~GeometryCache()
+{
+    for(uint32_t i = 0; i < m_entries.size(); i++)
+    {
+        if(m_entries[i].m_references != 0)
+        {
+            destroyEntry(i);
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GeometryCache::hash()
+//
+//    *** INTERESTING ***
+//    Four lanes consume a 32 byte block per iteration without depending on
+//    each other, so the multiplies overlap and hashing runs at several GB/s,
+//    well below the cost of the upload it may save.
+//
+////////////////////////////////////////////////////////////////////////////////
+uint64_t GeometryCache::hash(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* p   = static_cast<const uint8_t*>(data);
+    const uint8_t* end = p + size;
+
+    uint64_t h;
+    if(size >= 32)
+    {
+        uint64_t v0 = seed + Prime0 + Prime1;
+        uint64_t v1 = seed + Prime1;
+        uint64_t v2 = seed;
+        uint64_t v3 = seed - Prime0;
+        for(; p + 32 <= end; p += 32)
+        {
+            v0 = round(v0, load64(p));
+            v1 = round(v1, load64(p + 8));
+            v2 = round(v2, load64(p + 16));
+            v3 = round(v3, load64(p + 24));
+        }
+        h = rotl(v0, 1) + rotl(v1, 7) + rotl(v2, 12) + rotl(v3, 18);
+        h = (h ^ round(0, v0)) * Prime0 + Prime2;
+        h = (h ^ round(0, v1)) * Prime0 + Prime2;
+        h = (h ^ round(0, v2)) * Prime0 + Prime2;
+        h = (h ^ round(0, v3)) * Prime0 + Prime2;
+    }
+    else
+    {
+        h = seed + Prime2;
+    }
+    h += uint64_t(size);
+
+    for(; p + 8 <= end; p += 8)
+    {
+        h = rotl(h ^ round(0, load64(p)), 27) * Prime0 + Prime2;
+    }
+    for(; p < end; p++)
+    {
+        h = rotl(h ^ (uint64_t(*p) * Prime2), 11) * Prime0;
+    }
+    return mix(h);
+}
+
+
+void GeometryCache::acquire(const void* data, size_t size, Buffer& out)
+{
+    const double start = now();
+    const uint64_t key = m_hashFunction(data, size, 0);
+    m_counters.m_hashSeconds += now() - start;
+    m_counters.m_lookups++;
+
+    std::vector<uint32_t>& bucket = m_buckets[key];
+    for(size_t i = 0; i < bucket.size(); i++)
+    {
+        Entry& entry = m_entries[bucket[i]];
+        if(entry.m_contents.size() == size && (size == 0 || memcmp(&entry.m_contents[0], data, size) == 0))
+        {
+            entry.m_references++;
+            m_counters.m_hits++;
+            m_counters.m_referencedBytes += size;
+            out = entry.m_buffer;
+            return;
+        }
+    }
+    if(!bucket.empty())
+    {
+        m_counters.m_collisions++;
+    }
+
+    const uint32_t entry = createEntry(key, data, size);
+    bucket.push_back(entry);
+    out = m_entries[entry].m_buffer;
+}
+
+
+void GeometryCache::release(GLuint buffer)
+{
+    std::unordered_map<GLuint, uint32_t>::iterator it = m_byBuffer.find(buffer);
+    if(it == m_byBuffer.end())
+    {
+        return;
+    }
+
+    Entry& entry = m_entries[it->second];
+    m_counters.m_referencedBytes -= entry.m_contents.size();
+    if(--entry.m_references != 0)
+    {
+        return;
+    }
+
+    const uint32_t index = it->second;
+    std::vector<uint32_t>& bucket = m_buckets[entry.m_hash];
+    bucket.erase(std::find(bucket.begin(), bucket.end(), index));
+    if(bucket.empty())
+    {
+        m_buckets.erase(entry.m_hash);
+    }
+    destroyEntry(index);
+}
+
+
+uint32_t GeometryCache::createEntry(uint64_t key, const void* data, size_t size)
+{
+    uint32_t index;
+    if(!m_freeEntries.empty())
+    {
+        index = m_freeEntries.back();
+        m_freeEntries.pop_back();
+    }
+    else
+    {
+        index = uint32_t(m_entries.size());
+        m_entries.push_back(Entry());
+    }
+
+    Entry& entry = m_entries[index];
+    entry.m_hash       = key;
+    entry.m_references = 1;
+    entry.m_contents.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+
+    Buffer& buffer = entry.m_buffer;
+    buffer.m_size         = GLint(size);
+    buffer.m_uploadTicket = 0;
+    if(m_objects != nullptr)
+    {
+        buffer.m_buffer = m_objects->create(GLObjectQueue::KindBuffer);
+    }
+    else
+    {
+        glGenBuffers(1, &buffer.m_buffer);
+    }
+    if(m_uploads != nullptr)
+    {
+        glNamedBufferDataEXT(buffer.m_buffer, GLsizeiptr(size), nullptr, GL_STATIC_DRAW);
+        buffer.m_uploadTicket = m_uploads->enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, buffer.m_buffer, 0, data, size);
+    }
+    else
+    {
+        glNamedBufferDataEXT(buffer.m_buffer, GLsizeiptr(size), data, GL_STATIC_DRAW);
+    }
+    glGetNamedBufferParameterui64vNV(buffer.m_buffer, GL_BUFFER_GPU_ADDRESS_NV, &buffer.m_address);
+    glMakeNamedBufferResidentNV(buffer.m_buffer, GL_READ_ONLY);
+
+    m_byBuffer[buffer.m_buffer] = index;
+    m_counters.m_entries++;
+    m_counters.m_uniqueBytes     += size;
+    m_counters.m_referencedBytes += size;
+
+    MemoryTracker::track(MemoryTracker::SubsystemGeometry, MemoryTracker::KindBuffer, buffer.m_buffer, size);
+    MemoryTracker::setResident(MemoryTracker::KindBuffer, buffer.m_buffer, true);
+    // Keyed by the data, which unlike the vector itself stays put when m_entries grows
+    if(size != 0)
+    {
+        MemoryTracker::track(MemoryTracker::SubsystemGeometry, entry.m_contents.data(), entry.m_contents.capacity());
+    }
+    return index;
+}
+
+
+void GeometryCache::destroyEntry(uint32_t index)
+{
+    Entry& entry = m_entries[index];
+    MemoryTracker::untrack(MemoryTracker::KindBuffer, entry.m_buffer.m_buffer);
+    if(!entry.m_contents.empty())
+    {
+        MemoryTracker::untrack(entry.m_contents.data());
+    }
+
+    m_byBuffer.erase(entry.m_buffer.m_buffer);
+    if(m_objects != nullptr)
+    {
+        m_objects->release(GLObjectQueue::KindBuffer, entry.m_buffer.m_buffer, true);
+    }
+    else
+    {
+        glMakeNamedBufferNonResidentNV(entry.m_buffer.m_buffer);
+        glDeleteBuffers(1, &entry.m_buffer.m_buffer);
+    }
+
+    m_counters.m_entries--;
+    m_counters.m_uniqueBytes -= entry.m_contents.size();
+
+    entry.m_references = 0;
+    std::vector<uint8_t>().swap(entry.m_contents);
+    m_freeEntries.push_back(index);
+}
@@ -0,0 +1,92 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GeometryCache.h
+//
+// Content addressed store of vertex and index buffers. acquire() hashes the
+// data and, if a buffer with the same bytes exists, hands that buffer out
+// again with its reference count raised; only new content gets a GL buffer
+// (made resident, filled directly or through the UploadQueue). release()
+// drops a reference and deletes the buffer with the last one.
+//
+// Entries keep a copy of their content, so equal hashes are confirmed with a
+// compare and a collision just becomes a second entry in the same bucket.
+// Buffers handed out are shared and must not be written to.
+//----------------------------------------------------------------------------------
+#ifndef GEOMETRY_CACHE_H
+#define GEOMETRY_CACHE_H
+
+#include "cinder/gl/gl.h"
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+class UploadQueue;
+class GLObjectQueue;
+
+class GeometryCache
+{
+public:
+    struct Buffer
+    {
+        GLuint      m_buffer;
+        GLuint64EXT m_address;          // GPU address, the buffer is resident
+        GLint       m_size;
+        uint64_t    m_uploadTicket;     // UploadQueue ticket of the data, 0 if uploaded directly
+    };
+
+    struct Counters
+    {
+        uint64_t m_lookups;
+        uint64_t m_hits;                // lookups answered with an existing buffer
+        uint64_t m_collisions;          // equal hash, different content
+        uint32_t m_entries;
+        uint64_t m_uniqueBytes;         // GPU bytes of the live entries
+        uint64_t m_referencedBytes;     // GPU bytes the holders would use without sharing
+        double   m_hashSeconds;
+    };
+
+    typedef uint64_t (*HashFunction)(const void* data, size_t size, uint64_t seed);
+
+    // uploads may be null, the data is then uploaded when the buffer is created. With objects the
+    // buffers are generated in batches and deleted once the GPU is done with the frame.
+    explicit GeometryCache(UploadQueue* uploads, GLObjectQueue* objects = nullptr);
+    ~GeometryCache();
+
+    void  acquire(const void* data, size_t size, Buffer& out);
+    void  release(GLuint buffer);
+
+    const Counters& getCounters() const { return m_counters; }
+    float getHitRate() const            { return m_counters.m_lookups ? float(m_counters.m_hits) / float(m_counters.m_lookups) : 0.0f; }
+    uint64_t getBytesSaved() const      { return m_counters.m_referencedBytes - m_counters.m_uniqueBytes; }
+
+    // 64 bit content hash, four independent lanes over 32 byte blocks
+    static uint64_t hash(const void* data, size_t size, uint64_t seed = 0);
+    // Keys the lookups with another function, e.g. a constant one that makes every buffer collide.
+    // Set it while the cache is empty.
+    void  setHashFunction(HashFunction function) { m_hashFunction = function; }
+
+private:
+    struct Entry
+    {
+        uint64_t             m_hash;
+        uint32_t             m_references;
+        Buffer               m_buffer;
+        std::vector<uint8_t> m_contents;
+    };
+
+    GeometryCache(const GeometryCache&);
+    GeometryCache& operator=(const GeometryCache&);
+
+    uint32_t createEntry(uint64_t key, const void* data, size_t size);
+    void     destroyEntry(uint32_t entry);
+
+    UploadQueue*                                           m_uploads;
+    GLObjectQueue*                                         m_objects;
+    HashFunction                                           m_hashFunction;
+    std::vector<Entry>                                     m_entries;
+    std::vector<uint32_t>                                  m_freeEntries;
+    std::unordered_map<uint64_t, std::vector<uint32_t> >   m_buckets;      // hash -> entries
+    std::unordered_map<GLuint, uint32_t>                   m_byBuffer;     // buffer -> entry
+    Counters                                               m_counters;
+};
+
+#endif
@@ -0,0 +1,505 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GeometryCodec.cpp
+//----------------------------------------------------------------------------------
+#include "GeometryCodec.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GEOMETRY_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const size_t   GroupVertices = 16;
+    const size_t   MaxWords      = GeometryCodec::MaxVertexStride / 4;
+    const size_t   MaxWordBytes  = 1 + 4 * GroupVertices;
+
+    // Payload bytes of a plane for each of the two bit modes: zero, 2, 4 and 8 bits a byte
+    const uint32_t PlaneBytes[4] = { 0, 4, 8, 16 };
+
+    enum TriangleCode
+    {
+        CodeNew,                    // next, next + 1, next + 2
+        CodeFan,                    // previous first, previous third, next
+        CodeEdge,                   // previous third, previous second, next
+        CodeExplicit,               // three varints
+    };
+
+    uint32_t zigzag(uint32_t v)
+    {
+        return (v << 1) ^ uint32_t(int32_t(v) >> 31);
+    }
+
+    uint32_t unzigzag(uint32_t v)
+    {
+        return (v >> 1) ^ (0u - (v & 1));
+    }
+
+    // Per mode byte, where the word's planes start and how many bytes the word takes. Looked up
+    // rather than summed, so the planes' loads and the next word's do not wait on each other.
+    struct WordLayouts
+    {
+        uint8_t m_offsets[256][4];
+        uint8_t m_bytes[256];
+
+        WordLayouts()
+        {
+            for(uint32_t modes = 0; modes < 256; modes++)
+            {
+                uint32_t offset = 1;
+                for(uint32_t plane = 0; plane < 4; plane++)
+                {
+                    m_offsets[modes][plane] = uint8_t(offset);
+                    offset += PlaneBytes[(modes >> (plane * 2)) & 3];
+                }
+                m_bytes[modes] = uint8_t(offset);
+            }
+        }
+    };
+
+    const WordLayouts& wordLayouts()
+    {
+        static const WordLayouts layouts;
+        return layouts;
+    }
+
+    // The word at p, or 0 when the data ends inside it. Near the end the word is copied to
+    // padded, so it can be decoded with full 16 byte loads whatever its planes' modes.
+    const uint8_t* takeWord(const WordLayouts& layouts, const uint8_t*& p, const uint8_t* end, uint8_t padded[MaxWordBytes])
+    {
+        if(p == end || size_t(end - p) < layouts.m_bytes[*p])
+        {
+            return 0;
+        }
+        const uint8_t* word = p;
+        const size_t   size = layouts.m_bytes[*p];
+        if(size_t(end - p) < MaxWordBytes)
+        {
+            memset(padded, 0, MaxWordBytes);
+            memcpy(padded, p, size);
+            word = padded;
+        }
+        p += size;
+        return word;
+    }
+
+    void putVarint(std::vector<uint8_t>& out, uint32_t v)
+    {
+        while(v >= 0x80)
+        {
+            out.push_back(uint8_t(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(uint8_t(v));
+    }
+
+    bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& v)
+    {
+        v = 0;
+        for(uint32_t shift = 0; shift < 35 && p != end; shift += 7)
+        {
+            const uint8_t byte = *p++;
+            v |= uint32_t(byte & 0x7f) << shift;
+            if(!(byte & 0x80))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+#ifdef GEOMETRY_CODEC_SSE2
+    // Per plane mode, the masks that pick the 2, 4 or 8 bit expansion
+    const uint32_t SelectMasks[4][3][4] =
+    {
+        { { 0, 0, 0, 0 },                 { 0, 0, 0, 0 },                 { 0, 0, 0, 0 } },
+        { { ~0u, ~0u, ~0u, ~0u },         { 0, 0, 0, 0 },                 { 0, 0, 0, 0 } },
+        { { 0, 0, 0, 0 },                 { ~0u, ~0u, ~0u, ~0u },         { 0, 0, 0, 0 } },
+        { { 0, 0, 0, 0 },                 { 0, 0, 0, 0 },                 { ~0u, ~0u, ~0u, ~0u } },
+    };
+
+    // All three expansions are computed and the one of the mode kept: the modes of position
+    // data are close to random, and a branch per plane would mispredict most of the time.
+    // Reads 16 bytes whatever the mode.
+    inline __m128i loadPlane(const uint8_t* p, uint32_t mode)
+    {
+        const __m128i v      = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i mask2  = _mm_set1_epi8(3);
+        const __m128i mask4  = _mm_set1_epi8(0x0f);
+        const __m128i a      = _mm_and_si128(v, mask2);
+        const __m128i b      = _mm_and_si128(_mm_srli_epi16(v, 2), mask2);
+        const __m128i c      = _mm_and_si128(_mm_srli_epi16(v, 4), mask2);
+        const __m128i d      = _mm_and_si128(_mm_srli_epi16(v, 6), mask2);
+        const __m128i bits2  = _mm_unpacklo_epi16(_mm_unpacklo_epi8(a, b), _mm_unpacklo_epi8(c, d));
+        const __m128i bits4  = _mm_unpacklo_epi8(_mm_and_si128(v, mask4), _mm_and_si128(_mm_srli_epi16(v, 4), mask4));
+
+        const uint32_t (*select)[4] = SelectMasks[mode];
+        return _mm_or_si128(_mm_or_si128(_mm_and_si128(bits2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(select[0]))),
+                                         _mm_and_si128(bits4, _mm_loadu_si128(reinterpret_cast<const __m128i*>(select[1])))),
+                            _mm_and_si128(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(select[2]))));
+    }
+
+    // One word of a group: out[i] holds the word of vertices 4i to 4i + 3. carry holds the
+    // word of the previous vertex in every lane.
+    inline void decodeWord(const WordLayouts& layouts, const uint8_t* p, __m128i& carry, __m128i out[4])
+    {
+        const uint8_t modes = *p;
+        if(modes == 0)
+        {
+            // Unchanged over the group, like the zero attributes of a Vertex
+            out[0] = out[1] = out[2] = out[3] = carry;
+            return;
+        }
+
+        const uint8_t* offsets = layouts.m_offsets[modes];
+        const __m128i  plane0  = loadPlane(p + offsets[0], modes & 3);
+        const __m128i  plane1  = loadPlane(p + offsets[1], (modes >> 2) & 3);
+        const __m128i  plane2  = loadPlane(p + offsets[2], (modes >> 4) & 3);
+        const __m128i  plane3  = loadPlane(p + offsets[3], modes >> 6);
+
+        const __m128i low01  = _mm_unpacklo_epi8(plane0, plane1);
+        const __m128i high01 = _mm_unpackhi_epi8(plane0, plane1);
+        const __m128i low23  = _mm_unpacklo_epi8(plane2, plane3);
+        const __m128i high23 = _mm_unpackhi_epi8(plane2, plane3);
+        out[0] = _mm_unpacklo_epi16(low01, low23);
+        out[1] = _mm_unpackhi_epi16(low01, low23);
+        out[2] = _mm_unpacklo_epi16(high01, high23);
+        out[3] = _mm_unpackhi_epi16(high01, high23);
+
+        const __m128i one = _mm_set1_epi32(1);
+        for(int32_t i = 0; i < 4; i++)
+        {
+            __m128i x = _mm_xor_si128(_mm_srli_epi32(out[i], 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(out[i], one)));
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi32(x, carry);
+            carry = _mm_shuffle_epi32(x, 0xff);
+            out[i] = x;
+        }
+    }
+#else
+    void decodeWord(const uint8_t* p, uint32_t& last, uint32_t out[GroupVertices])
+    {
+        const uint8_t modes = *p++;
+        memset(out, 0, GroupVertices * sizeof(uint32_t));
+        for(uint32_t plane = 0; plane < 4; plane++)
+        {
+            const uint32_t shift = plane * 8;
+            switch((modes >> (plane * 2)) & 3)
+            {
+            case 1:
+                for(size_t v = 0; v < GroupVertices; v++)
+                {
+                    out[v] |= uint32_t((p[v / 4] >> ((v % 4) * 2)) & 3) << shift;
+                }
+                p += 4;
+                break;
+            case 2:
+                for(size_t v = 0; v < GroupVertices; v++)
+                {
+                    out[v] |= uint32_t((p[v / 2] >> ((v % 2) * 4)) & 15) << shift;
+                }
+                p += 8;
+                break;
+            case 3:
+                for(size_t v = 0; v < GroupVertices; v++)
+                {
+                    out[v] |= uint32_t(p[v]) << shift;
+                }
+                p += 16;
+                break;
+            }
+        }
+        for(size_t v = 0; v < GroupVertices; v++)
+        {
+            last += unzigzag(out[v]);
+            out[v] = last;
+        }
+    }
+#endif
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GeometryCodec::encodeVertices()
+//
+//    Per group of 16 vertices, per word: a byte with the modes of the four
+//    planes, low byte first, then their payloads. The last group is padded
+//    with copies of the last vertex, whose differences are zero and cost
+//    nothing.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool GeometryCodec::encodeVertices(const void* vertices, size_t count, size_t stride, std::vector<uint8_t>& out)
+{
+    out.clear();
+    if(stride == 0 || stride % 4 != 0 || stride > MaxVertexStride)
+    {
+        return false;
+    }
+
+    const uint8_t* src   = static_cast<const uint8_t*>(vertices);
+    const size_t   words = stride / 4;
+    uint32_t       last[MaxWords] = {};
+    uint32_t       deltas[GroupVertices];
+    uint8_t        bytes[GroupVertices];
+    for(size_t first = 0; first < count; first += GroupVertices)
+    {
+        const size_t n = std::min(GroupVertices, count - first);
+        for(size_t w = 0; w < words; w++)
+        {
+            for(size_t v = 0; v < GroupVertices; v++)
+            {
+                uint32_t word = last[w];
+                if(v < n)
+                {
+                    memcpy(&word, src + (first + v) * stride + w * 4, 4);
+                }
+                deltas[v] = zigzag(word - last[w]);
+                last[w]   = word;
+            }
+
+            const size_t modes = out.size();
+            out.push_back(0);
+            for(uint32_t plane = 0; plane < 4; plane++)
+            {
+                uint8_t bits = 0;
+                for(size_t v = 0; v < GroupVertices; v++)
+                {
+                    bytes[v] = uint8_t(deltas[v] >> (plane * 8));
+                    bits |= bytes[v];
+                }
+                const uint32_t mode = (bits == 0) ? 0 : (bits < 4) ? 1 : (bits < 16) ? 2 : 3;
+                out[modes] |= uint8_t(mode << (plane * 2));
+                switch(mode)
+                {
+                case 1:
+                    for(size_t v = 0; v < GroupVertices; v += 4)
+                    {
+                        out.push_back(uint8_t(bytes[v] | (bytes[v + 1] << 2) | (bytes[v + 2] << 4) | (bytes[v + 3] << 6)));
+                    }
+                    break;
+                case 2:
+                    for(size_t v = 0; v < GroupVertices; v += 2)
+                    {
+                        out.push_back(uint8_t(bytes[v] | (bytes[v + 1] << 4)));
+                    }
+                    break;
+                case 3:
+                    out.insert(out.end(), bytes, bytes + GroupVertices);
+                    break;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GeometryCodec::decodeVertices()
+//
+//    The data may come from disk, so every word's size is checked against
+//    what is left before it is read. With SSE2 the words are decoded four at
+//    a time and transposed, so each vertex gets 16 byte stores instead of
+//    one store per word.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool GeometryCodec::decodeVertices(const uint8_t* data, size_t size, void* vertices, size_t count, size_t stride)
+{
+    if(stride == 0 || stride % 4 != 0 || stride > MaxVertexStride)
+    {
+        return false;
+    }
+
+    const uint8_t* p     = data;
+    const uint8_t* end   = data + size;
+    uint8_t*       dst   = static_cast<uint8_t*>(vertices);
+    const size_t   words = stride / 4;
+#ifdef GEOMETRY_CODEC_SSE2
+    __m128i carry[MaxWords];
+    for(size_t w = 0; w < words; w++)
+    {
+        carry[w] = _mm_setzero_si128();
+    }
+#else
+    uint32_t last[MaxWords] = {};
+    uint32_t values[GroupVertices];
+#endif
+    uint8_t padded[MaxWordBytes];
+    const WordLayouts& layouts = wordLayouts();
+
+    for(size_t first = 0; first < count; first += GroupVertices)
+    {
+        const size_t n     = std::min(GroupVertices, count - first);
+        uint8_t*     group = dst + first * stride;
+        size_t       w     = 0;
+#ifdef GEOMETRY_CODEC_SSE2
+        for(; w + 4 <= words; w += 4)
+        {
+            __m128i columns[4][4];
+            for(size_t k = 0; k < 4; k++)
+            {
+                const uint8_t* word = takeWord(layouts, p, end, padded);
+                if(!word)
+                {
+                    return false;
+                }
+                decodeWord(layouts, word, carry[w + k], columns[k]);
+            }
+            for(size_t c = 0; c * 4 < n; c++)
+            {
+                const __m128i t0 = _mm_unpacklo_epi32(columns[0][c], columns[1][c]);
+                const __m128i t1 = _mm_unpacklo_epi32(columns[2][c], columns[3][c]);
+                const __m128i t2 = _mm_unpackhi_epi32(columns[0][c], columns[1][c]);
+                const __m128i t3 = _mm_unpackhi_epi32(columns[2][c], columns[3][c]);
+                const __m128i rows[4] = { _mm_unpacklo_epi64(t0, t1), _mm_unpackhi_epi64(t0, t1), _mm_unpacklo_epi64(t2, t3), _mm_unpackhi_epi64(t2, t3) };
+                for(size_t r = 0; r < 4 && c * 4 + r < n; r++)
+                {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(group + (c * 4 + r) * stride + w * 4), rows[r]);
+                }
+            }
+        }
+#endif
+        for(; w < words; w++)
+        {
+            const uint8_t* word = takeWord(layouts, p, end, padded);
+            if(!word)
+            {
+                return false;
+            }
+#ifdef GEOMETRY_CODEC_SSE2
+            __m128i  column[4];
+            uint32_t values[GroupVertices];
+            decodeWord(layouts, word, carry[w], column);
+            for(size_t c = 0; c < 4; c++)
+            {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(values + c * 4), column[c]);
+            }
+#else
+            decodeWord(word, last[w], values);
+#endif
+            for(size_t v = 0; v < n; v++)
+            {
+                memcpy(group + v * stride + w * 4, &values[v], 4);
+            }
+        }
+    }
+    return p == end;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: GeometryCodec::encodeIndices()
+//
+//    The two bit codes of all triangles come first, four to a byte, then
+//    the varints of the explicit ones: each index as the zigzagged
+//    difference to the index written before it. "next" is one past the
+//    highest index seen, so a mesh whose triangles bring in their vertices
+//    in order, like the quads of generateBuilding(), needs no varints.
+//
+////////////////////////////////////////////////////////////////////////////////
+void GeometryCodec::encodeIndices(const uint32_t* indices, size_t count, std::vector<uint8_t>& out)
+{
+    const size_t triangles = count / 3;
+    out.assign((triangles + 3) / 4, 0);
+
+    uint32_t next = 0, last = 0;
+    uint32_t prev[3] = { 0, 0, 0 };
+    for(size_t t = 0; t < triangles; t++)
+    {
+        const uint32_t* tri = indices + t * 3;
+        uint32_t code;
+        if(tri[0] == next && tri[1] == next + 1 && tri[2] == next + 2)
+        {
+            code = CodeNew;
+        }
+        else if(tri[0] == prev[0] && tri[1] == prev[2] && tri[2] == next)
+        {
+            code = CodeFan;
+        }
+        else if(tri[0] == prev[2] && tri[1] == prev[1] && tri[2] == next)
+        {
+            code = CodeEdge;
+        }
+        else
+        {
+            code = CodeExplicit;
+            for(int32_t k = 0; k < 3; k++)
+            {
+                putVarint(out, zigzag(tri[k] - last));
+                last = tri[k];
+            }
+        }
+        out[t / 4] |= uint8_t(code << ((t % 4) * 2));
+
+        for(int32_t k = 0; k < 3; k++)
+        {
+            next = std::max(next, tri[k] + 1);
+            prev[k] = tri[k];
+        }
+        last = tri[2];
+    }
+}
+
+
+bool GeometryCodec::decodeIndices(const uint8_t* data, size_t size, uint32_t* indices, size_t count)
+{
+    const size_t triangles = count / 3;
+    const size_t codeBytes = (triangles + 3) / 4;
+    if(count % 3 != 0 || size < codeBytes)
+    {
+        return false;
+    }
+
+    const uint8_t* p    = data + codeBytes;
+    const uint8_t* end  = data + size;
+    uint32_t       next = 0, last = 0;
+    uint32_t       prev[3] = { 0, 0, 0 };
+    for(size_t t = 0; t < triangles; t++)
+    {
+        uint32_t* tri = indices + t * 3;
+        switch((data[t / 4] >> ((t % 4) * 2)) & 3)
+        {
+        case CodeNew:
+            tri[0] = next;
+            tri[1] = next + 1;
+            tri[2] = next + 2;
+            break;
+        case CodeFan:
+            tri[0] = prev[0];
+            tri[1] = prev[2];
+            tri[2] = next;
+            break;
+        case CodeEdge:
+            tri[0] = prev[2];
+            tri[1] = prev[1];
+            tri[2] = next;
+            break;
+        default:
+            for(int32_t k = 0; k < 3; k++)
+            {
+                uint32_t delta;
+                if(!getVarint(p, end, delta))
+                {
+                    return false;
+                }
+                tri[k] = last + unzigzag(delta);
+                last   = tri[k];
+            }
+            break;
+        }
+
+        for(int32_t k = 0; k < 3; k++)
+        {
+            next = std::max(next, tri[k] + 1);
+            prev[k] = tri[k];
+        }
+        last = tri[2];
+    }
+    return p == end;
+}
@@ -0,0 +1,46 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/GeometryCodec.h
+//
+// Lossless compression for vertex and index buffers, fast enough to decode at
+// load time.
+//
+// Vertices are treated as rows of 32 bit words. Each word is replaced by its
+// difference to the same word of the previous vertex (zigzag coded, so small
+// negative differences stay small), then the vertices are cut into groups of
+// 16 and every byte position of every word becomes a 16 byte plane. Repeated
+// colors, zero attributes and the high bytes of nearby floats turn into planes
+// of zeros or small values, which are stored with 0, 2, 4 or 8 bits a byte.
+// Decoding unpacks the planes and undoes the differences with SSE2, four words
+// at a time, and writes whole vertex rows.
+//
+// Indices are coded per triangle with two bits for the common cases: three
+// vertices not referenced before, or a triangle sharing an edge with the
+// previous one (a fan around its first vertex, or the edge opposite its first
+// vertex) plus one new vertex. Other triangles are stored as varint differences.
+//
+// The streams carry no sizes; the caller stores the vertex and index counts.
+//----------------------------------------------------------------------------------
+#ifndef GEOMETRY_CODEC_H
+#define GEOMETRY_CODEC_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class GeometryCodec
+{
+public:
+    static const size_t MaxVertexStride = 256;
+
+    // stride must be a multiple of 4, up to MaxVertexStride bytes. Returns false if it is not.
+    static bool encodeVertices(const void* vertices, size_t count, size_t stride, std::vector<uint8_t>& out);
+    // Fails if the data is not exactly count vertices of this stride
+    static bool decodeVertices(const uint8_t* data, size_t size, void* vertices, size_t count, size_t stride);
+
+    // count is a multiple of 3
+    static void encodeIndices(const uint32_t* indices, size_t count, std::vector<uint8_t>& out);
+    // The indices are not checked against a vertex count
+    static bool decodeIndices(const uint8_t* data, size_t size, uint32_t* indices, size_t count);
+};
+
+#endif
@@ -0,0 +1,238 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/JobSystem.cpp
+//----------------------------------------------------------------------------------
+#include "JobSystem.h"
+#include <algorithm>
+
+namespace
+{
+    const uint32_t InitialQueueSize = 256;
+    const uint32_t SpinCount        = 64;       // empty searches before a worker blocks
+
+    // Queue of the calling thread in the job system it works for
+    thread_local const JobSystem* t_owner = nullptr;
+    thread_local uint32_t         t_queue = 0;
+}
+
+
+JobSystem::JobSystem(uint32_t threadCount)
+    : m_queuedJobs(0)
+    , m_sleepers(0)
+    , m_stop(false)
+    , m_jobsRun(0)
+    , m_steals(0)
+    , m_sleeps(0)
+{
+    threadCount = threadCount != 0 ? threadCount : std::max(1u, std::thread::hardware_concurrency());
+    const uint32_t workerCount = std::max(1u, threadCount - 1);
+
+    for(uint32_t i = 0; i < workerCount + 1; i++)
+    {
+        m_queues.push_back(std::unique_ptr<Queue>(new Queue()));
+        m_queues[i]->m_jobs.resize(InitialQueueSize);
+        m_queues[i]->m_head = m_queues[i]->m_tail = 0;
+    }
+    for(uint32_t i = 0; i < workerCount; i++)
+    {
+        m_workers.push_back(std::thread(&JobSystem::workerMain, this, i + 1));
+    }
+}
+
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for(size_t i = 0; i < m_workers.size(); i++)
+    {
+        m_workers[i].join();
+    }
+}
+
+
+uint32_t JobSystem::getQueue() const
+{
+    return (t_owner == this) ? t_queue : 0;
+}
+
+
+void JobSystem::submit(Function function, void* context, uint32_t begin, uint32_t end, Counter* counter)
+{
+    if(counter != nullptr)
+    {
+        counter->fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Queue& queue = *m_queues[getQueue()];
+    {
+        std::lock_guard<std::mutex> lock(queue.m_mutex);
+        const uint64_t size = queue.m_jobs.size();
+        if(queue.m_tail - queue.m_head == size)
+        {
+            // Full: unroll into one twice the size
+            std::vector<Job> jobs(size * 2);
+            for(uint64_t i = queue.m_head; i < queue.m_tail; i++)
+            {
+                jobs[i - queue.m_head] = queue.m_jobs[i & (size - 1)];
+            }
+            queue.m_jobs.swap(jobs);
+            queue.m_tail -= queue.m_head;
+            queue.m_head = 0;
+        }
+        Job& job = queue.m_jobs[queue.m_tail & (queue.m_jobs.size() - 1)];
+        job.m_function = function;
+        job.m_context  = context;
+        job.m_begin    = begin;
+        job.m_end      = end;
+        job.m_counter  = counter;
+        queue.m_tail++;
+        // Counted under the lock, so no thief can take the job before it is counted
+        m_queuedJobs.fetch_add(1);
+    }
+
+    // *** INTERESTING ***
+    // Sleepers register before they check m_queuedJobs, and this checks m_sleepers after publishing
+    // the job, so one side always sees the other and a wakeup cannot be lost; without sleepers
+    // submitting does not touch the shared mutex.
+    if(m_sleepers.load() != 0)
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_wake.notify_one();
+    }
+}
+
+
+void JobSystem::submitRange(Function function, void* context, uint32_t count, uint32_t grain, Counter* counter)
+{
+    grain = std::max(grain, 1u);
+    for(uint32_t begin = 0; begin < count; begin += grain)
+    {
+        submit(function, context, begin, std::min(count, begin + grain), counter);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: JobSystem::findJob()
+//
+//    Own queue first, newest job; then the other queues, oldest job, starting
+//    after our own so the thieves spread out instead of all hitting queue 0.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool JobSystem::findJob(uint32_t queueIndex, Job& job)
+{
+    if(m_queuedJobs.load(std::memory_order_relaxed) == 0)
+    {
+        return false;
+    }
+
+    {
+        Queue& queue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.m_mutex);
+        if(queue.m_tail != queue.m_head)
+        {
+            queue.m_tail--;
+            job = queue.m_jobs[queue.m_tail & (queue.m_jobs.size() - 1)];
+            m_queuedJobs.fetch_sub(1);
+            return true;
+        }
+    }
+
+    const uint32_t queueCount = uint32_t(m_queues.size());
+    for(uint32_t i = 1; i < queueCount; i++)
+    {
+        Queue& victim = *m_queues[(queueIndex + i) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.m_mutex);
+        if(victim.m_tail != victim.m_head)
+        {
+            job = victim.m_jobs[victim.m_head & (victim.m_jobs.size() - 1)];
+            victim.m_head++;
+            m_queuedJobs.fetch_sub(1);
+            m_steals.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void JobSystem::run(const Job& job)
+{
+    job.m_function(job.m_context, job.m_begin, job.m_end);
+    m_jobsRun.fetch_add(1, std::memory_order_relaxed);
+    if(job.m_counter != nullptr)
+    {
+        job.m_counter->fetch_sub(1, std::memory_order_release);
+    }
+}
+
+
+void JobSystem::wait(const Counter& counter)
+{
+    const uint32_t queue = getQueue();
+    Job job;
+    while(counter.load(std::memory_order_acquire) != 0)
+    {
+        if(findJob(queue, job))
+        {
+            run(job);
+        }
+        else
+        {
+            // The last jobs are running elsewhere
+            std::this_thread::yield();
+        }
+    }
+}
+
+
+void JobSystem::workerMain(uint32_t queue)
+{
+    t_owner = this;
+    t_queue = queue;
+
+    Job job;
+    uint32_t idle = 0;
+    for(;;)
+    {
+        if(findJob(queue, job))
+        {
+            run(job);
+            idle = 0;
+            continue;
+        }
+        if(++idle < SpinCount)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_sleepers.fetch_add(1);
+        if(!m_stop && m_queuedJobs.load() == 0)
+        {
+            m_sleeps.fetch_add(1, std::memory_order_relaxed);
+            m_wake.wait(lock, [this]() { return m_stop || m_queuedJobs.load() != 0; });
+        }
+        m_sleepers.fetch_sub(1);
+        if(m_stop)
+        {
+            return;
+        }
+        idle = 0;
+    }
+}
+
+
+JobSystem::Stats JobSystem::getStats() const
+{
+    Stats stats;
+    stats.m_jobsRun = m_jobsRun.load(std::memory_order_relaxed);
+    stats.m_steals  = m_steals.load(std::memory_order_relaxed);
+    stats.m_sleeps  = m_sleeps.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,109 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/JobSystem.h
+//
+// Work stealing job scheduler. Every worker thread owns a queue: it pushes and
+// pops its own jobs at the back (most recent first, the data is still in cache)
+// and, when that runs dry, steals the oldest job from the front of another
+// queue. Threads that are not workers (the main thread) share one more queue.
+// A job is a plain function pointer with a context and an index range, so
+// submitting one does not allocate once the queues have grown.
+//
+// Completion is tracked with counters: submit() increments the counter passed
+// in, the job decrements it once it has run, and wait() runs queued jobs itself
+// until the counter reaches zero, so a waiting thread is never idle while there
+// is work.
+//----------------------------------------------------------------------------------
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class JobSystem
+{
+public:
+    typedef void (*Function)(void* context, uint32_t begin, uint32_t end);
+    typedef std::atomic<uint32_t> Counter;
+
+    struct Stats
+    {
+        uint64_t m_jobsRun;
+        uint64_t m_steals;          // jobs taken from another thread's queue
+        uint64_t m_sleeps;          // times a worker found nothing and blocked
+    };
+
+    // threadCount includes the threads that call wait(); at least one worker is started
+    // so launched work makes progress while the caller does something else
+    explicit JobSystem(uint32_t threadCount = 0);
+    ~JobSystem();
+
+    void submit(Function function, void* context, uint32_t begin, uint32_t end, Counter* counter);
+    // [0, count) as jobs of grain items
+    void submitRange(Function function, void* context, uint32_t count, uint32_t grain, Counter* counter);
+    void wait(const Counter& counter);
+
+    // Blocks until body(begin, end) has run for all of [0, count)
+    template<typename Body>
+    void parallelFor(uint32_t count, uint32_t grain, const Body& body);
+
+    uint32_t getThreadCount() const { return uint32_t(m_workers.size()) + 1; }
+    Stats    getStats() const;
+
+private:
+    struct Job
+    {
+        Function m_function;
+        void*    m_context;
+        uint32_t m_begin;
+        uint32_t m_end;
+        Counter* m_counter;
+    };
+
+    // Ring buffer; the owner works at the back, thieves at the front
+    struct Queue
+    {
+        std::mutex       m_mutex;
+        std::vector<Job> m_jobs;            // power of two size
+        uint64_t         m_head;
+        uint64_t         m_tail;
+    };
+
+    JobSystem(const JobSystem&);
+    JobSystem& operator=(const JobSystem&);
+
+    void workerMain(uint32_t queue);
+    bool findJob(uint32_t queue, Job& job);
+    void run(const Job& job);
+    uint32_t getQueue() const;
+
+    template<typename Body>
+    static void callBody(void* context, uint32_t begin, uint32_t end) { (*static_cast<const Body*>(context))(begin, end); }
+
+    std::vector<std::unique_ptr<Queue> > m_queues;  // 0 is shared by non worker threads
+    std::vector<std::thread>  m_workers;
+    std::atomic<uint32_t>     m_queuedJobs;
+    std::atomic<uint32_t>     m_sleepers;
+    std::mutex                m_sleepMutex;
+    std::condition_variable   m_wake;
+    bool                      m_stop;
+
+    std::atomic<uint64_t>     m_jobsRun;
+    std::atomic<uint64_t>     m_steals;
+    std::atomic<uint64_t>     m_sleeps;
+};
+
+
+template<typename Body>
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, const Body& body)
+{
+    Counter counter(0);
+    submitRange(&callBody<Body>, const_cast<Body*>(&body), count, grain, &counter);
+    wait(counter);
+}
+
+#endif
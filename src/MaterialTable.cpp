@@ -0,0 +1,105 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/MaterialTable.cpp
+//----------------------------------------------------------------------------------
+#include "MaterialTable.h"
+#include <algorithm>
+#include <cstring>
+
+
+MaterialTable::MaterialTable(uint32_t materialCapacity, uint32_t handleCapacity, uint32_t mergeGap)
+    : m_materials(materialCapacity == 0 ? 1 : materialCapacity < MaxMaterials ? materialCapacity : MaxMaterials)
+    , m_handles(std::max(handleCapacity, 1u), 0)
+    , m_materialCount(0)
+    , m_handleCount(0)
+    , m_materialsDirty(sizeof(Material), uint32_t(m_materials.size()), mergeGap)
+    , m_handlesDirty(sizeof(uint64_t), uint32_t(m_handles.size()), mergeGap)
+{
+    memset(&m_materials[0], 0, m_materials.size() * sizeof(Material));
+}
+
+
+uint32_t MaterialTable::addHandles(const uint64_t* handles, uint32_t count)
+{
+    if(count > m_handles.size() - m_handleCount)
+    {
+        return InvalidId;
+    }
+    const uint32_t first = m_handleCount;
+    std::copy(handles, handles + count, m_handles.begin() + first);
+    m_handleCount += count;
+    return first;
+}
+
+
+bool MaterialTable::setHandle(uint32_t index, uint64_t handle)
+{
+    if(index >= m_handleCount)
+    {
+        return false;
+    }
+    m_handles[index] = handle;
+    return true;
+}
+
+
+uint32_t MaterialTable::add(const Material& material)
+{
+    if(m_materialCount == m_materials.size() || !isValid(material))
+    {
+        return InvalidId;
+    }
+    m_materials[m_materialCount] = material;
+    return m_materialCount++;
+}
+
+
+bool MaterialTable::set(uint32_t id, const Material& material)
+{
+    if(id >= m_materialCount || !isValid(material))
+    {
+        return false;
+    }
+    m_materials[id] = material;
+    return true;
+}
+
+
+bool MaterialTable::isValid(const Material& material) const
+{
+    return material.m_frameCount != 0 &&
+           uint64_t(material.m_firstTexture) + material.m_frameCount <= m_handleCount &&
+           uint64_t(material.m_firstDisplacement) + material.m_frameCount <= m_handleCount;
+}
+
+
+uint64_t MaterialTable::getTexture(uint32_t id, uint32_t frame) const
+{
+    const Material& material = m_materials[id];
+    return m_handles[material.m_firstTexture + getFrame(material, frame)];
+}
+
+
+uint64_t MaterialTable::getDisplacement(uint32_t id, uint32_t frame) const
+{
+    const Material& material = m_materials[id];
+    return m_handles[material.m_firstDisplacement + getFrame(material, frame)];
+}
+
+
+const std::vector<DirtyRangeTracker::Range>& MaterialTable::updateMaterials()
+{
+    return m_materialsDirty.update(&m_materials[0], 0, m_materialCount);
+}
+
+
+const std::vector<DirtyRangeTracker::Range>& MaterialTable::updateHandles()
+{
+    return m_handlesDirty.update(&m_handles[0], 0, m_handleCount);
+}
+
+
+void MaterialTable::invalidate()
+{
+    m_materialsDirty.invalidateAll();
+    m_handlesDirty.invalidateAll();
+}
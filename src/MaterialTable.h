@@ -0,0 +1,89 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/MaterialTable.h
+//
+// The materials meshes are drawn with, laid out the way the vertex shader reads
+// them from two resident buffers: an array of bindless texture handles, and an
+// array of materials that each name a run of those handles (one per animation
+// frame) and the parameters to sample them with. A mesh picks its material by
+// ID, so any number of meshes can use different textures and animation phases
+// without a texture bind or a uniform per frame.
+//
+// The table is the CPU copy of both buffers. It knows nothing about GL; the
+// caller uploads the runs that update() reports changed, which is nothing on a
+// frame where no material or handle was edited.
+//----------------------------------------------------------------------------------
+#ifndef MATERIAL_TABLE_H
+#define MATERIAL_TABLE_H
+
+#include "DirtyRangeTracker.h"
+#include <cstdint>
+#include <vector>
+
+class MaterialTable
+{
+public:
+    // Keep in step with struct Material in simple_vertex.glsl
+    struct Material
+    {
+        uint32_t m_firstTexture;        // color handles of the frames, from here in the handle array
+        uint32_t m_firstDisplacement;   // displacement handles of the frames
+        uint32_t m_frameCount;          // 1 for a still texture
+        uint32_t m_phase;               // frames the material runs ahead of the global animation
+        uint32_t m_tint;                // unorm8 x4, multiplied into the sampled color
+        float    m_displacementScale;
+        uint32_t m_reserved[2];
+    };
+
+    static const uint32_t InvalidId    = 0xffffffff;
+    static const uint32_t MaxMaterials = 0x10000;   // the ID is 16 bits in the per mesh uniforms
+
+    MaterialTable(uint32_t materialCapacity, uint32_t handleCapacity, uint32_t mergeGap);
+
+    // Appends count handles and returns the index of the first, InvalidId when they do not fit
+    uint32_t addHandles(const uint64_t* handles, uint32_t count);
+    bool     setHandle(uint32_t index, uint64_t handle);
+
+    // Returns the new material's ID, InvalidId when the table is full or the material is not valid
+    uint32_t add(const Material& material);
+    // Leaves the entry as it was and returns false if the material is not valid
+    bool     set(uint32_t id, const Material& material);
+    // At least one frame, and all its frames' handles in the array, so the shader never reads past it
+    bool     isValid(const Material& material) const;
+
+    const Material& getMaterial(uint32_t id) const      { return m_materials[id]; }
+    uint64_t getHandle(uint32_t index) const            { return m_handles[index]; }
+    uint32_t getMaterialCount() const                   { return m_materialCount; }
+    uint32_t getHandleCount() const                     { return m_handleCount; }
+    uint32_t getMaterialCapacity() const                { return uint32_t(m_materials.size()); }
+    uint32_t getHandleCapacity() const                  { return uint32_t(m_handles.size()); }
+
+    // The frame of its handles a material samples while the global animation is at frame, as the shader computes it
+    static uint32_t getFrame(const Material& material, uint32_t frame) { return (frame + material.m_phase) % material.m_frameCount; }
+    uint64_t getTexture(uint32_t id, uint32_t frame) const;
+    uint64_t getDisplacement(uint32_t id, uint32_t frame) const;
+
+    // The runs of each array that changed since the last call; the caller uploads them from
+    // getMaterials()/getHandles(). Does not allocate.
+    const std::vector<DirtyRangeTracker::Range>& updateMaterials();
+    const std::vector<DirtyRangeTracker::Range>& updateHandles();
+    const DirtyRangeTracker::Stats& getMaterialStats() const { return m_materialsDirty.getStats(); }
+    const DirtyRangeTracker::Stats& getHandleStats() const   { return m_handlesDirty.getStats(); }
+    // The buffers were recreated; everything is sent again
+    void     invalidate();
+
+    const Material* getMaterials() const                { return &m_materials[0]; }
+    const uint64_t* getHandles() const                  { return &m_handles[0]; }
+    // The buffers are sized for the capacity, so adding never moves them
+    size_t   getMaterialBufferBytes() const             { return m_materials.size() * sizeof(Material); }
+    size_t   getHandleBufferBytes() const               { return m_handles.size() * sizeof(uint64_t); }
+
+private:
+    std::vector<Material> m_materials;      // capacity entries, the first m_materialCount in use
+    std::vector<uint64_t> m_handles;
+    uint32_t              m_materialCount;
+    uint32_t              m_handleCount;
+    DirtyRangeTracker     m_materialsDirty;
+    DirtyRangeTracker     m_handlesDirty;
+};
+
+#endif
@@ -0,0 +1,227 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/MemoryTracker.cpp
+//----------------------------------------------------------------------------------
+#include "MemoryTracker.h"
+#include "cinder/app/App.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+namespace
+{
+    struct Allocation
+    {
+        MemoryTracker::Subsystem m_subsystem;
+        uint64_t                 m_bytes;
+        bool                     m_resident;
+    };
+
+    struct State
+    {
+        std::mutex                             m_mutex;
+        std::unordered_map<uint64_t, Allocation> m_allocations[MemoryTracker::KindCount];
+        MemoryTracker::Counters                m_counters[MemoryTracker::SubsystemCount];
+
+        State() { memset(m_counters, 0, sizeof(m_counters)); }
+    };
+
+    // Constructed on first use, so allocations made during static initialization are counted too
+    State& state()
+    {
+        static State s;
+        return s;
+    }
+
+    void add(MemoryTracker::Counters& counters, MemoryTracker::Kind kind, uint64_t bytes)
+    {
+        if(kind == MemoryTracker::KindHost)
+        {
+            counters.m_cpuBytes += bytes;
+            counters.m_cpuPeakBytes = std::max(counters.m_cpuPeakBytes, counters.m_cpuBytes);
+        }
+        else
+        {
+            counters.m_gpuBytes += bytes;
+            counters.m_gpuPeakBytes = std::max(counters.m_gpuPeakBytes, counters.m_gpuBytes);
+        }
+    }
+
+    void remove(MemoryTracker::Counters& counters, MemoryTracker::Kind kind, uint64_t bytes)
+    {
+        uint64_t& current = (kind == MemoryTracker::KindHost) ? counters.m_cpuBytes : counters.m_gpuBytes;
+        current -= std::min(current, bytes);
+    }
+}
+
+
+void MemoryTracker::track(Subsystem subsystem, Kind kind, uint64_t id, uint64_t bytes)
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+
+    std::unordered_map<uint64_t, Allocation>::iterator it = s.m_allocations[kind].find(id);
+    if(it != s.m_allocations[kind].end())
+    {
+        // Resized (e.g. a buffer respecified with glNamedBufferData); may also move between subsystems
+        Allocation& allocation = it->second;
+        remove(s.m_counters[allocation.m_subsystem], kind, allocation.m_bytes);
+        if(allocation.m_subsystem != subsystem)
+        {
+            s.m_counters[allocation.m_subsystem].m_objects--;
+            s.m_counters[subsystem].m_objects++;
+            if(allocation.m_resident)
+            {
+                s.m_counters[allocation.m_subsystem].m_residentHandles--;
+                s.m_counters[subsystem].m_residentHandles++;
+            }
+        }
+        allocation.m_subsystem = subsystem;
+        allocation.m_bytes     = bytes;
+        add(s.m_counters[subsystem], kind, bytes);
+        return;
+    }
+
+    Allocation allocation = { subsystem, bytes, false };
+    s.m_allocations[kind][id] = allocation;
+    s.m_counters[subsystem].m_objects++;
+    add(s.m_counters[subsystem], kind, bytes);
+}
+
+
+void MemoryTracker::untrack(Kind kind, uint64_t id)
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+
+    std::unordered_map<uint64_t, Allocation>::iterator it = s.m_allocations[kind].find(id);
+    if(it == s.m_allocations[kind].end())
+    {
+        return;
+    }
+    Counters& counters = s.m_counters[it->second.m_subsystem];
+    remove(counters, kind, it->second.m_bytes);
+    counters.m_objects--;
+    if(it->second.m_resident)
+    {
+        counters.m_residentHandles--;
+    }
+    s.m_allocations[kind].erase(it);
+}
+
+
+void MemoryTracker::setResident(Kind kind, uint64_t id, bool resident)
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+
+    std::unordered_map<uint64_t, Allocation>::iterator it = s.m_allocations[kind].find(id);
+    if(it == s.m_allocations[kind].end() || it->second.m_resident == resident)
+    {
+        return;
+    }
+    it->second.m_resident = resident;
+    if(resident)
+    {
+        s.m_counters[it->second.m_subsystem].m_residentHandles++;
+    }
+    else
+    {
+        s.m_counters[it->second.m_subsystem].m_residentHandles--;
+    }
+}
+
+
+void MemoryTracker::addResidentHandles(Subsystem subsystem, int32_t count)
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+    s.m_counters[subsystem].m_residentHandles = uint32_t(int64_t(s.m_counters[subsystem].m_residentHandles) + count);
+}
+
+
+MemoryTracker::Counters MemoryTracker::getCounters(Subsystem subsystem)
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+    return s.m_counters[subsystem];
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: MemoryTracker::getTotal()
+//
+//    The peaks of the subsystems may have been reached at different times, so
+//    the total peak is an upper bound of the real one.
+//
+////////////////////////////////////////////////////////////////////////////////
+MemoryTracker::Counters MemoryTracker::getTotal()
+{
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+
+    Counters total;
+    memset(&total, 0, sizeof(total));
+    for(int32_t i = 0; i < SubsystemCount; i++)
+    {
+        total.m_gpuBytes        += s.m_counters[i].m_gpuBytes;
+        total.m_gpuPeakBytes    += s.m_counters[i].m_gpuPeakBytes;
+        total.m_cpuBytes        += s.m_counters[i].m_cpuBytes;
+        total.m_cpuPeakBytes    += s.m_counters[i].m_cpuPeakBytes;
+        total.m_objects         += s.m_counters[i].m_objects;
+        total.m_residentHandles += s.m_counters[i].m_residentHandles;
+    }
+    return total;
+}
+
+
+const char* MemoryTracker::getName(Subsystem subsystem)
+{
+    static const char* names[SubsystemCount] = { "geometry", "textures", "uniforms", "transforms", "uploads" };
+    return (subsystem >= 0 && subsystem < SubsystemCount) ? names[subsystem] : "unknown";
+}
+
+
+size_t MemoryTracker::reportLeaks()
+{
+    static const char* kindNames[KindCount] = { "buffer", "texture", "host allocation" };
+
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.m_mutex);
+
+    // A leak per mesh would flood the log; the first few identify the culprit
+    const size_t maxListed = 32;
+
+    size_t leaks = 0;
+    for(int32_t kind = 0; kind < KindCount; kind++)
+    {
+        std::unordered_map<uint64_t, Allocation>::const_iterator it = s.m_allocations[kind].begin();
+        for(; it != s.m_allocations[kind].end(); ++it, ++leaks)
+        {
+            if(leaks < maxListed)
+            {
+                ci::app::console() << "leak: " << getName(it->second.m_subsystem) << " " << kindNames[kind] << " " << std::hex
+                                   << it->first << std::dec << ", " << it->second.m_bytes << " bytes" << std::endl;
+            }
+        }
+    }
+    if(leaks > maxListed)
+    {
+        ci::app::console() << "... " << leaks - maxListed << " more leaks" << std::endl;
+    }
+    for(int32_t i = 0; i < SubsystemCount; i++)
+    {
+        const Counters& counters = s.m_counters[i];
+        if(counters.m_objects != 0)
+        {
+            ci::app::console() << "leaked by " << getName(Subsystem(i)) << ": " << counters.m_objects << " allocations, "
+                               << counters.m_gpuBytes << " GPU bytes, " << counters.m_cpuBytes << " CPU bytes" << std::endl;
+        }
+    }
+    if(leaks == 0)
+    {
+        ci::app::console() << "memory: no leaks" << std::endl;
+    }
+    return leaks;
+}
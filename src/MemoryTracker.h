@@ -0,0 +1,71 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/MemoryTracker.h
+//
+// Bookkeeping of what the app allocates, by subsystem. Every GL buffer and
+// texture and the larger CPU side allocations are registered where they are
+// created (with their size, which may change later) and unregistered where
+// they are freed. Per subsystem it keeps current and peak GPU and CPU bytes,
+// the number of live objects and the number of resident buffers and bindless
+// handles. Whatever is still registered at shutdown is reported as a leak.
+//
+// Only sizes are recorded; nothing is allocated through the tracker. It is
+// safe to call from several threads.
+//----------------------------------------------------------------------------------
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include <cstdint>
+#include <cstddef>
+
+class MemoryTracker
+{
+public:
+    enum Subsystem
+    {
+        SubsystemGeometry,      // mesh vertex and index buffers
+        SubsystemTextures,      // animation frames and their handle arrays
+        SubsystemUniforms,      // transform and per mesh uniform buffers
+        SubsystemTransforms,    // model matrices
+        SubsystemUploads,       // staging buffer and queued upload data
+        SubsystemCount
+    };
+
+    // Objects of different kinds may share an id (buffer 5 and texture 5)
+    enum Kind
+    {
+        KindBuffer,             // GL buffer name, GPU memory
+        KindTexture,            // GL texture name, GPU memory
+        KindHost,               // address of a CPU allocation
+        KindCount
+    };
+
+    struct Counters
+    {
+        uint64_t m_gpuBytes;
+        uint64_t m_gpuPeakBytes;
+        uint64_t m_cpuBytes;
+        uint64_t m_cpuPeakBytes;
+        uint32_t m_objects;
+        uint32_t m_residentHandles;     // resident buffers and bindless texture handles
+    };
+
+    // Registers an allocation, or updates the size of one already registered
+    static void track(Subsystem subsystem, Kind kind, uint64_t id, uint64_t bytes);
+    static void untrack(Kind kind, uint64_t id);
+    static void track(Subsystem subsystem, const void* pointer, uint64_t bytes) { track(subsystem, KindHost, uint64_t(reinterpret_cast<uintptr_t>(pointer)), bytes); }
+    static void untrack(const void* pointer)                                    { untrack(KindHost, uint64_t(reinterpret_cast<uintptr_t>(pointer))); }
+
+    // For registered buffers made (non-)resident; calling it twice counts once
+    static void setResident(Kind kind, uint64_t id, bool resident);
+    // For bindless texture handles, which are not registered objects themselves
+    static void addResidentHandles(Subsystem subsystem, int32_t count);
+
+    static Counters    getCounters(Subsystem subsystem);
+    static Counters    getTotal();
+    static const char* getName(Subsystem subsystem);
+
+    // Logs every allocation still registered and returns their number
+    static size_t      reportLeaks();
+};
+
+#endif
@@ -32,15 +32,27 @@
 //
 //----------------------------------------------------------------------------------
 #include "Mesh.h"
+#include "GLBackend.h"
+#include "UploadQueue.h"
+#include "MemoryTracker.h"
+#include "GeometryCache.h"
 //#include <NvAssert.h>
 #include "cinder/app/App.h"
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 
 bool      Mesh::m_enableVBUM = true;
 bool      Mesh::m_setVertexFormatOnEveryDrawCall = false;
 bool      Mesh::m_useHeavyVertexFormat = false;
 uint32_t  Mesh::m_drawCallsPerState = 1;
 
+static GLDirectBackend s_directBackend;
+GLBackend* Mesh::m_gl = &s_directBackend;
+UploadQueue* Mesh::m_uploads = nullptr;
+GeometryCache* Mesh::m_geometryCache = nullptr;
+GLObjectQueue* Mesh::m_objects = nullptr;
+
 
 ////////////////////////////////////////////////////////////////////////////////
 //
@@ -55,38 +67,110 @@ uint32_t  Mesh::m_drawCallsPerState = 1;
 ////////////////////////////////////////////////////////////////////////////////
 void Mesh::update(std::vector<Vertex>& vertices, std::vector<uint16_t>& indices)
 {
-    if(m_vertexBuffer == 0)
+    // The sphere around the box of the positions, for culling
+    float low[3] = { vertices[0].m_position[0], vertices[0].m_position[1], vertices[0].m_position[2] };
+    float high[3] = { low[0], low[1], low[2] };
+    for(size_t i = 1; i < vertices.size(); i++)
+    {
+        for(int32_t k = 0; k < 3; k++)
+        {
+            low[k] = std::min(low[k], vertices[i].m_position[k]);
+            high[k] = std::max(high[k], vertices[i].m_position[k]);
+        }
+    }
+    float radius = 0.0f;
+    for(int32_t k = 0; k < 3; k++)
+    {
+        m_bounds[k] = 0.5f * (low[k] + high[k]);
+        radius += (high[k] - m_bounds[k]) * (high[k] - m_bounds[k]);
+    }
+    m_bounds[3] = std::sqrt(radius);
+
+    if(m_geometryCache != nullptr)
+    {
+        // *** INTERESTING ***
+        // Identical vertex or index data (e.g. every box shaped building has the same
+        // indices) is uploaded once; the cache hands out the resident buffer it already has.
+        // Acquired before the old buffers are released so an unchanged update keeps them alive.
+        GeometryCache::Buffer vertexBuffer;
+        GeometryCache::Buffer indexBuffer;
+        m_geometryCache->acquire(&vertices[0], sizeof(vertices[0]) * vertices.size(), vertexBuffer);
+        m_geometryCache->acquire(&indices[0], sizeof(indices[0]) * indices.size(), indexBuffer);
+        releaseGeometry();
+
+        // Borrowed, the cache deletes them
+        m_vertexBuffer = GLBufferHandle::borrow(vertexBuffer.m_buffer);
+        m_vertexBufferSize = vertexBuffer.m_size;
+        m_vertexBufferGPUPtr = vertexBuffer.m_address;
+        m_indexBuffer = GLBufferHandle::borrow(indexBuffer.m_buffer);
+        m_indexBufferSize = indexBuffer.m_size;
+        m_indexBufferGPUPtr = indexBuffer.m_address;
+        m_uploadTicket = std::max(vertexBuffer.m_uploadTicket, indexBuffer.m_uploadTicket);
+        m_uploadPending = (m_uploadTicket != 0);
+        m_sharedGeometry = m_geometryCache;
+
+        m_vertexCount = int32_t(vertices.size());
+        m_indexCount = int32_t(indices.size());
+        return;
+    }
+
+    if(m_sharedGeometry != nullptr)
     {
-        glGenBuffers(1, &m_vertexBuffer);
+        releaseGeometry();
     }
 
-    if(m_indexCount == 0)
+    if(!m_vertexBuffer)
     {
-        glGenBuffers(1, &m_indexBuffer);
+        m_vertexBuffer = GLBufferHandle::create(m_objects);
+    }
+
+    if(!m_indexBuffer)
+    {
+        m_indexBuffer = GLBufferHandle::create(m_objects);
     }
     
     // Stick the data for the vertices and indices in their respective buffers
-    glNamedBufferDataEXT(m_vertexBuffer, sizeof(vertices[0]) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
-    glNamedBufferDataEXT(m_indexBuffer, sizeof(indices[0]) * indices.size(), &indices[0], GL_STATIC_DRAW);
+    if(m_uploads != nullptr)
+    {
+        // Only the storage is allocated now (the GPU pointers need it); the data follows within the upload budget
+        glNamedBufferDataEXT(m_vertexBuffer.get(), sizeof(vertices[0]) * vertices.size(), nullptr, GL_STATIC_DRAW);
+        glNamedBufferDataEXT(m_indexBuffer.get(), sizeof(indices[0]) * indices.size(), nullptr, GL_STATIC_DRAW);
+        m_uploads->enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, m_vertexBuffer.get(), 0, &vertices[0], sizeof(vertices[0]) * vertices.size());
+        m_uploadTicket = m_uploads->enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, m_indexBuffer.get(), 0, &indices[0], sizeof(indices[0]) * indices.size());
+        m_uploadPending = true;
+    }
+    else
+    {
+        glNamedBufferDataEXT(m_vertexBuffer.get(), sizeof(vertices[0]) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+        glNamedBufferDataEXT(m_indexBuffer.get(), sizeof(indices[0]) * indices.size(), &indices[0], GL_STATIC_DRAW);
+        m_uploadPending = false;
+    }
 
     // *** INTERESTING ***
     // get the GPU pointer for the vertex buffer and make the vertex buffer resident on the GPU
-    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer.get());
     glGetBufferParameterui64vNV(GL_ARRAY_BUFFER, GL_BUFFER_GPU_ADDRESS_NV, &m_vertexBufferGPUPtr); 
     glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &m_vertexBufferSize);
     glMakeBufferResidentNV(GL_ARRAY_BUFFER, GL_READ_ONLY);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    m_vertexBuffer.setResident(true);
 
     // *** INTERESTING ***
     // get the GPU pointer for the index buffer and make the index buffer resident on the GPU
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer.get());
     glGetBufferParameterui64vNV(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_GPU_ADDRESS_NV, &m_indexBufferGPUPtr); 
     glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &m_indexBufferSize);
     glMakeBufferResidentNV(GL_ELEMENT_ARRAY_BUFFER, GL_READ_ONLY);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    m_indexBuffer.setResident(true);
 
     m_vertexCount = int32_t(vertices.size());
     m_indexCount = int32_t(indices.size());
+
+    MemoryTracker::track(MemoryTracker::SubsystemGeometry, MemoryTracker::KindBuffer, m_vertexBuffer.get(), sizeof(vertices[0]) * vertices.size());
+    MemoryTracker::track(MemoryTracker::SubsystemGeometry, MemoryTracker::KindBuffer, m_indexBuffer.get(), sizeof(indices[0]) * indices.size());
+    MemoryTracker::setResident(MemoryTracker::KindBuffer, m_vertexBuffer.get(), true);
+    MemoryTracker::setResident(MemoryTracker::KindBuffer, m_indexBuffer.get(), true);
 }
 
 
@@ -103,50 +187,50 @@ void Mesh::renderPrep()
     if(m_enableVBUM)
     {
         // Specify the vertex format
-        glVertexAttribFormatNV(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex));          // Position in attribute 0 that is 3 floats
-        glVertexAttribFormatNV(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex));   // Color in attribute 1 that is 4 unsigned bytes
+        m_gl->vertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex));          // Position in attribute 0 that is 3 floats
+        m_gl->vertexAttribFormat(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex));   // Color in attribute 1 that is 4 unsigned bytes
 
         // Enable the relevent attributes
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
+        m_gl->enableVertexAttribArray(0);
+        m_gl->enableVertexAttribArray(1);
 
         // Enable a bunch of other attributes if we're using the heavy vertex format option
         if(m_useHeavyVertexFormat == true)
         {
-            glVertexAttribFormatNV(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex));
-            glVertexAttribFormatNV(4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex));
-            glVertexAttribFormatNV(5, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex));
-            glVertexAttribFormatNV(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex));
-            glVertexAttribFormatNV(7, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex));
-
-
-            glEnableVertexAttribArray(3);
-            glEnableVertexAttribArray(4);
-            glEnableVertexAttribArray(5);
-            glEnableVertexAttribArray(6);
-            glEnableVertexAttribArray(7);
+            m_gl->vertexAttribFormat(3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex));
+            m_gl->vertexAttribFormat(4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex));
+            m_gl->vertexAttribFormat(5, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex));
+            m_gl->vertexAttribFormat(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex));
+            m_gl->vertexAttribFormat(7, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex));
+
+
+            m_gl->enableVertexAttribArray(3);
+            m_gl->enableVertexAttribArray(4);
+            m_gl->enableVertexAttribArray(5);
+            m_gl->enableVertexAttribArray(6);
+            m_gl->enableVertexAttribArray(7);
         }
 
         // Enable Vertex Buffer Unified Memory (VBUM) for the vertex attributes
-        glEnableClientState(GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV);
+        m_gl->enableClientState(GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV);
         
         // Enable Vertex Buffer Unified Memory (VBUM) for the indices
-        glEnableClientState(GL_ELEMENT_ARRAY_UNIFIED_NV);
+        m_gl->enableClientState(GL_ELEMENT_ARRAY_UNIFIED_NV);
     }
     else
     {
         // For Vertex Array Objects (VAO), enable the vertex attributes
-        glEnableVertexArrayAttribEXT(0, 0);
-        glEnableVertexArrayAttribEXT(0, 1);
+        m_gl->enableVertexArrayAttrib(0, 0);
+        m_gl->enableVertexArrayAttrib(0, 1);
 
         // Enable a bunch of other attributes if we're using the heavy vertex format option
         if(m_useHeavyVertexFormat == true)
         {
-            glEnableVertexArrayAttribEXT(0, 3);
-            glEnableVertexArrayAttribEXT(0, 4);
-            glEnableVertexArrayAttribEXT(0, 5);
-            glEnableVertexArrayAttribEXT(0, 6);
-            glEnableVertexArrayAttribEXT(0, 7);
+            m_gl->enableVertexArrayAttrib(0, 3);
+            m_gl->enableVertexArrayAttrib(0, 4);
+            m_gl->enableVertexArrayAttrib(0, 5);
+            m_gl->enableVertexArrayAttrib(0, 6);
+            m_gl->enableVertexArrayAttrib(0, 7);
         }
 
     }
@@ -166,8 +250,18 @@ void Mesh::render(void)
 {
    // NV_ASSERT(m_vertexBuffer != 0);
    // NV_ASSERT(m_indexBuffer != 0);
-	if (m_vertexBuffer == 0) { ci::app::console() << "NV_ASSERT m_vertexBuffer empty" << std::endl; return; }
-	if (m_indexBuffer == 0) { ci::app::console() <<"NV_ASSERT m_indexBuffer empty" << std::endl;  return; }
+	if (!m_vertexBuffer) { ci::app::console() << "NV_ASSERT m_vertexBuffer empty" << std::endl; return; }
+	if (!m_indexBuffer) { ci::app::console() <<"NV_ASSERT m_indexBuffer empty" << std::endl;  return; }
+
+    // Jobs of one priority are issued in order, so the index data (queued last) arriving means the vertices did too
+    if(m_uploadPending)
+    {
+        if(!m_uploads->isIssued(m_uploadTicket))
+        {
+            return;
+        }
+        m_uploadPending = false;
+    }
     
     if(m_enableVBUM)
     {
@@ -180,31 +274,31 @@ void Mesh::render(void)
         // *** INTERESTING ***
         // Set up the pointers in GPU memory to the vertex attributes.
         // The GPU pointer to the vertex buffer was stored in Mesh::update() after the buffer was filled
-        glBufferAddressRangeNV(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 0, 
+        m_gl->bufferAddressRange(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 0, 
             m_vertexBufferGPUPtr + Vertex::PositionOffset, 
             m_vertexBufferSize - Vertex::PositionOffset);
-        glBufferAddressRangeNV(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 1, 
+        m_gl->bufferAddressRange(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 1, 
             m_vertexBufferGPUPtr + Vertex::ColorOffset,
             m_vertexBufferSize - Vertex::ColorOffset);
 
         // Set a bunch of other attributes if we're using the heavy vertex format option
         if(m_useHeavyVertexFormat == true)
         {
-            glBufferAddressRangeNV(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 3, m_vertexBufferGPUPtr + Vertex::Attrib1Offset, m_vertexBufferSize - Vertex::Attrib1Offset);
-            glBufferAddressRangeNV(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 4, m_vertexBufferGPUPtr + Vertex::Attrib2Offset, m_vertexBufferSize - Vertex::Attrib2Offset);
-            glBufferAddressRangeNV(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 5, m_vertexBufferGPUPtr + Vertex::Attrib3Offset, m_vertexBufferSize - Vertex::Attrib3Offset);
-            glBufferAddressRangeNV(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 6, m_vertexBufferGPUPtr + Vertex::Attrib4Offset, m_vertexBufferSize - Vertex::Attrib4Offset);
-            glBufferAddressRangeNV(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 7, m_vertexBufferGPUPtr + Vertex::Attrib5Offset, m_vertexBufferSize - Vertex::Attrib5Offset);
+            m_gl->bufferAddressRange(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 3, m_vertexBufferGPUPtr + Vertex::Attrib1Offset, m_vertexBufferSize - Vertex::Attrib1Offset);
+            m_gl->bufferAddressRange(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 4, m_vertexBufferGPUPtr + Vertex::Attrib2Offset, m_vertexBufferSize - Vertex::Attrib2Offset);
+            m_gl->bufferAddressRange(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 5, m_vertexBufferGPUPtr + Vertex::Attrib3Offset, m_vertexBufferSize - Vertex::Attrib3Offset);
+            m_gl->bufferAddressRange(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 6, m_vertexBufferGPUPtr + Vertex::Attrib4Offset, m_vertexBufferSize - Vertex::Attrib4Offset);
+            m_gl->bufferAddressRange(GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 7, m_vertexBufferGPUPtr + Vertex::Attrib5Offset, m_vertexBufferSize - Vertex::Attrib5Offset);
         }
 
         // *** INTERESTING ***
         // Set up the pointer in GPU memory to the index buffer
-        glBufferAddressRangeNV(GL_ELEMENT_ARRAY_ADDRESS_NV, 0, m_indexBufferGPUPtr, m_indexBufferSize);
+        m_gl->bufferAddressRange(GL_ELEMENT_ARRAY_ADDRESS_NV, 0, m_indexBufferGPUPtr, m_indexBufferSize);
 
         // Do the actual drawing
         for(uint32_t i=0; i<m_drawCallsPerState; i++)
         {
-            glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_SHORT, 0);
+            m_gl->drawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_SHORT, 0);
         }
     }
     else
@@ -216,28 +310,28 @@ void Mesh::render(void)
         ////////////////////////////////////////////////////////////////////////////////
 
         // Set up attribute 0 for the position (3 floats) 
-        glVertexArrayVertexAttribOffsetEXT(0, m_vertexBuffer, 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::PositionOffset);//iPos
+        m_gl->vertexArrayVertexAttribOffset(0, m_vertexBuffer.get(), 0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::PositionOffset);//iPos
 
         // Set up attribute 1 for the color (4 unsigned bytes) 
-        glVertexArrayVertexAttribOffsetEXT(0, m_vertexBuffer, 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), Vertex::ColorOffset);//iColor
+        m_gl->vertexArrayVertexAttribOffset(0, m_vertexBuffer.get(), 1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), Vertex::ColorOffset);//iColor
 
         // Set up a bunch of other attributes if we're using the heavy vertex format option
         if(m_useHeavyVertexFormat == true)
         {
-            glVertexArrayVertexAttribOffsetEXT(0, m_vertexBuffer, 3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::Attrib1Offset);//iAttrib3
-            glVertexArrayVertexAttribOffsetEXT(0, m_vertexBuffer, 4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::Attrib2Offset);//iAttrib4
-            glVertexArrayVertexAttribOffsetEXT(0, m_vertexBuffer, 5, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::Attrib3Offset);//iAttrib5
-            glVertexArrayVertexAttribOffsetEXT(0, m_vertexBuffer, 6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::Attrib4Offset);//iAttrib6
-            glVertexArrayVertexAttribOffsetEXT(0, m_vertexBuffer, 7, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::Attrib5Offset);//iAttrib7
+            m_gl->vertexArrayVertexAttribOffset(0, m_vertexBuffer.get(), 3, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::Attrib1Offset);//iAttrib3
+            m_gl->vertexArrayVertexAttribOffset(0, m_vertexBuffer.get(), 4, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::Attrib2Offset);//iAttrib4
+            m_gl->vertexArrayVertexAttribOffset(0, m_vertexBuffer.get(), 5, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::Attrib3Offset);//iAttrib5
+            m_gl->vertexArrayVertexAttribOffset(0, m_vertexBuffer.get(), 6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::Attrib4Offset);//iAttrib6
+            m_gl->vertexArrayVertexAttribOffset(0, m_vertexBuffer.get(), 7, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), Vertex::Attrib5Offset);//iAttrib7
         }
 
         // Set up the indices
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+        m_gl->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer.get());
 
         // Do the actual drawing
         for(uint32_t i=0; i<m_drawCallsPerState; i++)
         {
-            glDrawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_SHORT, 0);
+            m_gl->drawElements(GL_TRIANGLES, m_indexCount, GL_UNSIGNED_SHORT, 0);
         }
     }
 }
@@ -257,42 +351,42 @@ void Mesh::renderFinish()
     if(m_enableVBUM)
     {
         // Reset state
-        glDisableVertexAttribArray(0);
-        glDisableVertexAttribArray(1);
-        glDisableVertexAttribArray(2);
+        m_gl->disableVertexAttribArray(0);
+        m_gl->disableVertexAttribArray(1);
+        m_gl->disableVertexAttribArray(2);
 
         // Disable a bunch of other attributes if we're using the heavy vertex format option
         if(m_useHeavyVertexFormat == true)
         {
-            glDisableVertexAttribArray(3);
-            glDisableVertexAttribArray(4);
-            glDisableVertexAttribArray(5);
-            glDisableVertexAttribArray(6);
-            glDisableVertexAttribArray(7);
+            m_gl->disableVertexAttribArray(3);
+            m_gl->disableVertexAttribArray(4);
+            m_gl->disableVertexAttribArray(5);
+            m_gl->disableVertexAttribArray(6);
+            m_gl->disableVertexAttribArray(7);
         }
 
-        glDisableClientState(GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV);
-        glDisableClientState(GL_ELEMENT_ARRAY_UNIFIED_NV);
+        m_gl->disableClientState(GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV);
+        m_gl->disableClientState(GL_ELEMENT_ARRAY_UNIFIED_NV);
     }
     else
     {
         // Rendering with Vertex Array Objects (VAO)
 
         // Reset state
-        glDisableVertexArrayAttribEXT(0, 0);
-        glDisableVertexArrayAttribEXT(0, 1);
+        m_gl->disableVertexArrayAttrib(0, 0);
+        m_gl->disableVertexArrayAttrib(0, 1);
 
         // Disable a bunch of other attributes if we're using the heavy vertex format option
         if(m_useHeavyVertexFormat == true)
         {
-            glDisableVertexArrayAttribEXT(0, 3);
-            glDisableVertexArrayAttribEXT(0, 4);
-            glDisableVertexArrayAttribEXT(0, 5);
-            glDisableVertexArrayAttribEXT(0, 6);
-            glDisableVertexArrayAttribEXT(0, 7);
+            m_gl->disableVertexArrayAttrib(0, 3);
+            m_gl->disableVertexArrayAttrib(0, 4);
+            m_gl->disableVertexArrayAttrib(0, 5);
+            m_gl->disableVertexArrayAttrib(0, 6);
+            m_gl->disableVertexArrayAttrib(0, 7);
         }
 
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        m_gl->bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
     }
 }
 
@@ -306,9 +400,6 @@ void Mesh::renderFinish()
 ////////////////////////////////////////////////////////////////////////////////
 Mesh::Mesh(void)
 {
-    m_vertexBuffer = 0;
-    m_indexBuffer = 0;
-
     m_vertexCount = 0;
     m_indexCount = 0;
 
@@ -317,6 +408,11 @@ Mesh::Mesh(void)
 
     m_vertexBufferGPUPtr = 0;
     m_indexBufferGPUPtr = 0;
+
+    m_uploadTicket = 0;
+    m_uploadPending = false;
+    m_sharedGeometry = nullptr;
+    memset(m_bounds, 0, sizeof(m_bounds));
 }
 
 
@@ -330,17 +426,88 @@ Mesh::Mesh(void)
 ////////////////////////////////////////////////////////////////////////////////
 Mesh::~Mesh(void)
 {
-    if(m_vertexBuffer != 0)
+    releaseGeometry();
+}
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: Mesh::releaseGeometry()
+//
+//    Deletes the buffers, or hands them back to the GeometryCache they came from.
+//    With m_objects the deletion waits until the GPU is done with the frame.
+//
+////////////////////////////////////////////////////////////////////////////////
+void Mesh::releaseGeometry()
+{
+    if(m_sharedGeometry != nullptr)
     {
-        glDeleteBuffers(1, &m_vertexBuffer);
+        m_sharedGeometry->release(m_vertexBuffer.get());
+        m_sharedGeometry->release(m_indexBuffer.get());
+    }
+    else
+    {
+        if(m_vertexBuffer)
+        {
+            MemoryTracker::untrack(MemoryTracker::KindBuffer, m_vertexBuffer.get());
+        }
+
+        if(m_indexBuffer)
+        {
+            MemoryTracker::untrack(MemoryTracker::KindBuffer, m_indexBuffer.get());
+        }
     }
-    m_vertexBuffer = 0;
+    m_vertexBuffer.reset();
+    m_indexBuffer.reset();
+    m_vertexCount = 0;
+    m_indexCount = 0;
+    m_sharedGeometry = nullptr;
+}
+
+
+
 
-    if(m_indexBuffer != 0)
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: Mesh::Mesh(Mesh&&)
+//
+//    Takes over the buffer objects; 'other' is left empty
+//
+////////////////////////////////////////////////////////////////////////////////
+Mesh::Mesh(Mesh&& other) noexcept
+    : Mesh()
+{
+    *this = std::move(other);
+}
+
+
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: Mesh::operator=(Mesh&&)
+//
+////////////////////////////////////////////////////////////////////////////////
+Mesh& Mesh::operator=(Mesh&& other) noexcept
+{
+    if(this != &other)
     {
-        glDeleteBuffers(1, &m_indexBuffer);
+        std::swap(m_vertexBuffer, other.m_vertexBuffer);
+        std::swap(m_indexBuffer, other.m_indexBuffer);
+        std::swap(m_vertexCount, other.m_vertexCount);
+        std::swap(m_indexCount, other.m_indexCount);
+        std::swap(m_vertexBufferSize, other.m_vertexBufferSize);
+        std::swap(m_indexBufferSize, other.m_indexBufferSize);
+        std::swap(m_vertexBufferGPUPtr, other.m_vertexBufferGPUPtr);
+        std::swap(m_indexBufferGPUPtr, other.m_indexBufferGPUPtr);
+        std::swap(m_uploadTicket, other.m_uploadTicket);
+        std::swap(m_uploadPending, other.m_uploadPending);
+        std::swap(m_sharedGeometry, other.m_sharedGeometry);
+        std::swap(m_bounds, other.m_bounds);
     }
-    m_indexBuffer = 0;
+    return *this;
 }
 
 
@@ -360,6 +527,16 @@ Vertex::Vertex(float x, float y, float z, float r, float g, float b, float a)
     m_color[1] = (uint8_t)(std::max(std::min(g, 1.0f), 0.0f) * 255.5f);
     m_color[2] = (uint8_t)(std::max(std::min(b, 1.0f), 0.0f) * 255.5f);
     m_color[3] = (uint8_t)(std::max(std::min(a, 1.0f), 0.0f) * 255.5f);
+
+    // The extra attributes only feed the heavy vertex format, but they are part of the
+    // bytes the GeometryCache compares, so they must not be left uninitialized
+    memset(m_attrib0, 0, sizeof(m_attrib0));
+    memset(m_attrib1, 0, sizeof(m_attrib1));
+    memset(m_attrib2, 0, sizeof(m_attrib2));
+    memset(m_attrib3, 0, sizeof(m_attrib3));
+    memset(m_attrib4, 0, sizeof(m_attrib4));
+    memset(m_attrib5, 0, sizeof(m_attrib5));
+    memset(m_attrib6, 0, sizeof(m_attrib6));
 }
 
 
@@ -39,6 +39,7 @@
 //#include "cinder/app/App.h"
 //#include "cinder/app/RendererGl.h"
 #include "cinder/gl/gl.h"
+#include "GLObjectQueue.h"
 
 //#include <NV/NvPlatformGL.h>
 #include <vector>
@@ -70,34 +71,52 @@ public:
 };
 
 
+class GLBackend;
+class UploadQueue;
+class GeometryCache;
+
 class Mesh
 {
 public:
     int32_t         m_vertexCount;            // Number of vertices in mesh
     int32_t         m_indexCount;             // Number of indices in mesh
-    GLuint          m_vertexBuffer;           // vertex buffer object for vertices
-    GLuint          m_indexBuffer;            // vertex buffer object for indices
+    GLBufferHandle  m_vertexBuffer;           // vertex buffer object for vertices
+    GLBufferHandle  m_indexBuffer;            // vertex buffer object for indices
     GLuint          m_paramsBuffer;           // uniform buffer object for params
     GLint           m_vertexBufferSize; 
     GLint           m_indexBufferSize;
     GLuint64EXT     m_vertexBufferGPUPtr;     // GPU pointer to m_vertexBuffer data
     GLuint64EXT     m_indexBufferGPUPtr;      // GPU pointer to m_indexBuffer data
+    uint64_t        m_uploadTicket;           // last upload job of the data, when m_uploads is used
+    bool            m_uploadPending;          // not drawn until the data has been uploaded
+    GeometryCache*  m_sharedGeometry;         // cache the buffers belong to, null if the mesh owns them
+    float           m_bounds[4];              // bounding sphere of the vertices in model space: center, radius
 
     static bool     m_enableVBUM;
     static bool     m_setVertexFormatOnEveryDrawCall;
     static bool     m_useHeavyVertexFormat;
     static uint32_t m_drawCallsPerState;
+    static GLBackend* m_gl;                   // per frame GL calls go through this (e.g. a GLStateCache)
+    static UploadQueue* m_uploads;            // if set, update() queues the vertex/index data instead of uploading it
+    static GeometryCache* m_geometryCache;    // if set, update() shares buffers with meshes of identical data
+    static GLObjectQueue* m_objects;          // if set, buffers are generated and deleted in batches through it
 
     Mesh(void);
     ~Mesh(void);
 
-    // TODO should NV_ASSERT in copy constructor since it can incorrectly delete the OpenGL buffer objects on copy
+    // The buffer handles are move only, and so are meshes
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+    Mesh(Mesh&& other) noexcept;
+    Mesh& operator=(Mesh&& other) noexcept;
     
     static void renderPrep();
     static void renderFinish();
 
     void render(void);
     void update(std::vector<Vertex>& vertices, std::vector<uint16_t>& indices);
+    // Leaves the mesh empty; see the .cpp
+    void releaseGeometry();
 };
 
 #endif
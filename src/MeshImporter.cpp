@@ -0,0 +1,1394 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/MeshImporter.cpp
+//----------------------------------------------------------------------------------
+#include "MeshImporter.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const uint32_t GlbMagic     = 0x46546C67; // "glTF"
+    const uint32_t GlbVersion   = 2;
+    const uint32_t GlbChunkJson = 0x4E4F534A; // "JSON"
+    const uint32_t GlbChunkBin  = 0x004E4942; // "BIN\0"
+
+    // OBJ text is cut into chunks of about this size, several per thread for balance
+    const size_t   ObjChunkBytes = 256 * 1024;
+
+    const uint8_t  DefaultColor[4] = { 191, 191, 191, 255 };
+
+    double now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    uint8_t toUnorm8(float value)
+    {
+        // Same rounding as the Vertex constructor
+        return uint8_t(std::max(std::min(value, 1.0f), 0.0f) * 255.5f);
+    }
+
+    // Read only view of a whole file
+    class MappedFile
+    {
+    public:
+        MappedFile()
+            : m_data(nullptr)
+            , m_size(0)
+#if defined(_WIN32)
+            , m_file(INVALID_HANDLE_VALUE)
+            , m_mapping(nullptr)
+#else
+            , m_fd(-1)
+#endif
+        {
+        }
+
+        ~MappedFile()
+        {
+#if defined(_WIN32)
+            if(m_data != nullptr) UnmapViewOfFile(m_data);
+            if(m_mapping != nullptr) CloseHandle(m_mapping);
+            if(m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+#else
+            if(m_data != nullptr) munmap(const_cast<char*>(m_data), m_size);
+            if(m_fd >= 0) close(m_fd);
+#endif
+        }
+
+        bool open(const std::string& path)
+        {
+#if defined(_WIN32)
+            m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            LARGE_INTEGER size;
+            if(m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &size))
+            {
+                return false;
+            }
+            m_size = size_t(size.QuadPart);
+            if(m_size == 0)
+            {
+                return true;
+            }
+            m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if(m_mapping == nullptr)
+            {
+                return false;
+            }
+            m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+            return m_data != nullptr;
+#else
+            m_fd = ::open(path.c_str(), O_RDONLY);
+            struct stat info;
+            if(m_fd < 0 || fstat(m_fd, &info) != 0)
+            {
+                return false;
+            }
+            m_size = size_t(info.st_size);
+            if(m_size == 0)
+            {
+                return true;
+            }
+            void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+            if(data == MAP_FAILED)
+            {
+                return false;
+            }
+            madvise(data, m_size, MADV_SEQUENTIAL);
+            m_data = static_cast<const char*>(data);
+            return true;
+#endif
+        }
+
+        const char* getData() const { return m_data; }
+        size_t      getSize() const { return m_size; }
+
+    private:
+        MappedFile(const MappedFile&);
+        MappedFile& operator=(const MappedFile&);
+
+        const char* m_data;
+        size_t      m_size;
+#if defined(_WIN32)
+        HANDLE      m_file;
+        HANDLE      m_mapping;
+#else
+        int         m_fd;
+#endif
+    };
+
+    inline bool isDigit(char c)
+    {
+        return c >= '0' && c <= '9';
+    }
+
+    inline bool isEndOfStatement(char c)
+    {
+        return c == '\n' || c == '\r' || c == '#';
+    }
+
+    inline const char* skipSpaces(const char* p, const char* end)
+    {
+        while(p < end && (*p == ' ' || *p == '\t'))
+        {
+            p++;
+        }
+        return p;
+    }
+
+    inline const char* skipLine(const char* p, const char* end)
+    {
+        const char* eol = static_cast<const char*>(memchr(p, '\n', size_t(end - p)));
+        return eol != nullptr ? eol + 1 : end;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  parseDecimal()
+    //
+    //    *** INTERESTING ***
+    //    The digits are gathered into one 64 bit integer and scaled by an exact
+    //    power of ten from a table, one multiply or divide instead of the digit
+    //    by digit floating point work (and locale lookups) of strtod. Exact for
+    //    up to 15 significant digits, within an ulp of double beyond that.
+    //
+    ////////////////////////////////////////////////////////////////////////////////
+    bool parseDecimal(const char*& p, const char* end, double& value)
+    {
+        static const double powers[] =
+        {
+            1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        const char* s = p;
+        bool negative = false;
+        if(s < end && (*s == '-' || *s == '+'))
+        {
+            negative = (*s == '-');
+            s++;
+        }
+
+        uint64_t mantissa    = 0;
+        int32_t  exponent    = 0;
+        int32_t  significant = 0;
+        bool     digits      = false;
+        for(; s < end && isDigit(*s); s++)
+        {
+            digits = true;
+            if(significant < 19)
+            {
+                mantissa = mantissa * 10 + uint64_t(*s - '0');
+                significant += (mantissa != 0) ? 1 : 0;
+            }
+            else
+            {
+                exponent++;
+            }
+        }
+        if(s < end && *s == '.')
+        {
+            for(s++; s < end && isDigit(*s); s++)
+            {
+                digits = true;
+                if(significant < 19)
+                {
+                    mantissa = mantissa * 10 + uint64_t(*s - '0');
+                    significant += (mantissa != 0) ? 1 : 0;
+                    exponent--;
+                }
+            }
+        }
+        if(!digits)
+        {
+            return false;
+        }
+
+        if(s < end && (*s == 'e' || *s == 'E'))
+        {
+            const char* e = s + 1;
+            bool negativeExponent = false;
+            if(e < end && (*e == '-' || *e == '+'))
+            {
+                negativeExponent = (*e == '-');
+                e++;
+            }
+            if(e < end && isDigit(*e))
+            {
+                int32_t value = 0;
+                for(; e < end && isDigit(*e); e++)
+                {
+                    value = std::min(value * 10 + (*e - '0'), 100000);
+                }
+                exponent += negativeExponent ? -value : value;
+                s = e;
+            }
+        }
+
+        double result = double(mantissa);
+        if(mantissa == 0)
+        {
+            result = 0.0;
+        }
+        else if(exponent >= 0 && exponent <= 22)
+        {
+            result *= powers[exponent];
+        }
+        else if(exponent < 0 && exponent >= -22)
+        {
+            result /= powers[-exponent];
+        }
+        else
+        {
+            result *= std::pow(10.0, double(exponent));
+        }
+        value = negative ? -result : result;
+        p = s;
+        return true;
+    }
+
+    bool parseInt(const char*& p, const char* end, int32_t& value)
+    {
+        const char* s = p;
+        const bool negative = (s < end && *s == '-');
+        if(s < end && (*s == '-' || *s == '+'))
+        {
+            s++;
+        }
+        if(s >= end || !isDigit(*s))
+        {
+            return false;
+        }
+        int64_t result = 0;
+        for(; s < end && isDigit(*s); s++)
+        {
+            result = std::min<int64_t>(result * 10 + (*s - '0'), 0x7FFFFFFF);
+        }
+        value = int32_t(negative ? -result : result);
+        p = s;
+        return true;
+    }
+
+    // What one thread makes of its piece of an OBJ file. Negative (relative) face
+    // indices can only be resolved once the vertex counts of the earlier chunks are known.
+    struct ObjChunk
+    {
+        std::vector<float>    m_positions;
+        std::vector<uint8_t>  m_colors;
+        std::vector<int32_t>  m_corners;    // absolute, or relative to the chunk's first position
+        std::vector<uint32_t> m_relative;   // which corners are relative
+    };
+
+    bool parseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+    {
+        // Polygon corners: index and whether it is chunk relative
+        std::vector<std::pair<int32_t, bool> > polygon;
+
+        while(p < end)
+        {
+            p = skipSpaces(p, end);
+            if(p + 1 < end && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+            {
+                // v x y z [w] or v x y z r g b
+                p += 2;
+                float values[7];
+                int32_t count = 0;
+                for(;;)
+                {
+                    p = skipSpaces(p, end);
+                    if(p >= end || isEndOfStatement(*p) || count == 7)
+                    {
+                        break;
+                    }
+                    double value;
+                    if(!parseDecimal(p, end, value))
+                    {
+                        return false;
+                    }
+                    values[count++] = float(value);
+                }
+                if(count < 3)
+                {
+                    return false;
+                }
+                chunk.m_positions.insert(chunk.m_positions.end(), values, values + 3);
+                if(count >= 6)
+                {
+                    chunk.m_colors.push_back(toUnorm8(values[3]));
+                    chunk.m_colors.push_back(toUnorm8(values[4]));
+                    chunk.m_colors.push_back(toUnorm8(values[5]));
+                    chunk.m_colors.push_back(255);
+                }
+                else
+                {
+                    chunk.m_colors.insert(chunk.m_colors.end(), DefaultColor, DefaultColor + 4);
+                }
+            }
+            else if(p + 1 < end && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+            {
+                // f v[/vt[/vn]] ..., a convex polygon that is split into a triangle fan
+                p += 2;
+                polygon.clear();
+                const int32_t localCount = int32_t(chunk.m_positions.size() / 3);
+                for(;;)
+                {
+                    p = skipSpaces(p, end);
+                    if(p >= end || isEndOfStatement(*p))
+                    {
+                        break;
+                    }
+                    int32_t index;
+                    if(!parseInt(p, end, index) || index == 0)
+                    {
+                        return false;
+                    }
+                    while(p < end && *p != ' ' && *p != '\t' && !isEndOfStatement(*p))
+                    {
+                        p++;
+                    }
+                    polygon.push_back(index > 0 ? std::make_pair(index - 1, false) : std::make_pair(localCount + index, true));
+                }
+                for(size_t i = 2; i < polygon.size(); i++)
+                {
+                    const size_t corners[3] = { 0, i - 1, i };
+                    for(int32_t c = 0; c < 3; c++)
+                    {
+                        if(polygon[corners[c]].second)
+                        {
+                            chunk.m_relative.push_back(uint32_t(chunk.m_corners.size()));
+                        }
+                        chunk.m_corners.push_back(polygon[corners[c]].first);
+                    }
+                }
+            }
+            // Everything else (vt, vn, g, o, s, usemtl, comments...) is skipped
+            p = skipLine(p, end);
+        }
+        return true;
+    }
+
+    // Just enough JSON for a glTF header: no validation of things the importer does not read
+    struct JsonValue
+    {
+        enum Type { Null, Bool, Number, String, Array, Object };
+
+        Type                     m_type;
+        double                   m_number;
+        std::string              m_string;
+        std::vector<JsonValue>   m_elements;    // array elements, or object values
+        std::vector<std::string> m_keys;        // object keys, parallel to m_elements
+
+        JsonValue() : m_type(Null), m_number(0.0) {}
+
+        const JsonValue* find(const char* key) const
+        {
+            for(size_t i = 0; i < m_keys.size(); i++)
+            {
+                if(m_keys[i] == key)
+                {
+                    return &m_elements[i];
+                }
+            }
+            return nullptr;
+        }
+
+        const JsonValue* at(size_t index) const
+        {
+            return (m_type == Array && index < m_elements.size()) ? &m_elements[index] : nullptr;
+        }
+
+        double getNumber(const char* key, double fallback) const
+        {
+            const JsonValue* value = find(key);
+            return (value != nullptr && value->m_type == Number) ? value->m_number : fallback;
+        }
+
+        std::string getString(const char* key) const
+        {
+            const JsonValue* value = find(key);
+            return (value != nullptr && value->m_type == String) ? value->m_string : std::string();
+        }
+    };
+
+    class JsonParser
+    {
+    public:
+        JsonParser(const char* data, size_t size) : m_p(data), m_end(data + size) {}
+
+        bool parse(JsonValue& value)
+        {
+            return parseValue(value, 0) && skipWhitespace() == m_end;
+        }
+
+    private:
+        const char* skipWhitespace()
+        {
+            while(m_p < m_end && (*m_p == ' ' || *m_p == '\t' || *m_p == '\n' || *m_p == '\r'))
+            {
+                m_p++;
+            }
+            return m_p;
+        }
+
+        bool literal(const char* text)
+        {
+            const size_t length = strlen(text);
+            if(size_t(m_end - m_p) < length || memcmp(m_p, text, length) != 0)
+            {
+                return false;
+            }
+            m_p += length;
+            return true;
+        }
+
+        bool parseString(std::string& out)
+        {
+            if(m_p >= m_end || *m_p != '"')
+            {
+                return false;
+            }
+            for(m_p++; m_p < m_end && *m_p != '"'; m_p++)
+            {
+                if(*m_p != '\\')
+                {
+                    out += *m_p;
+                    continue;
+                }
+                if(++m_p >= m_end)
+                {
+                    return false;
+                }
+                switch(*m_p)
+                {
+                case 'n': out += '\n'; break;
+                case 't': out += '\t'; break;
+                case 'r': out += '\r'; break;
+                case 'b': out += '\b'; break;
+                case 'f': out += '\f'; break;
+                case 'u':
+                    // Names only matter for comparisons against ASCII keys
+                    if(m_end - m_p < 5)
+                    {
+                        return false;
+                    }
+                    m_p += 4;
+                    out += '?';
+                    break;
+                default:  out += *m_p; break;
+                }
+            }
+            if(m_p >= m_end)
+            {
+                return false;
+            }
+            m_p++;
+            return true;
+        }
+
+        bool parseValue(JsonValue& value, int32_t depth)
+        {
+            if(depth > 64 || skipWhitespace() == m_end)
+            {
+                return false;
+            }
+            switch(*m_p)
+            {
+            case '{':
+                value.m_type = JsonValue::Object;
+                m_p++;
+                if(skipWhitespace() < m_end && *m_p == '}')
+                {
+                    m_p++;
+                    return true;
+                }
+                for(;;)
+                {
+                    value.m_keys.push_back(std::string());
+                    value.m_elements.push_back(JsonValue());
+                    skipWhitespace();
+                    if(!parseString(value.m_keys.back()) || skipWhitespace() == m_end || *m_p++ != ':' ||
+                       !parseValue(value.m_elements.back(), depth + 1) || skipWhitespace() == m_end)
+                    {
+                        return false;
+                    }
+                    const char c = *m_p++;
+                    if(c == '}')
+                    {
+                        return true;
+                    }
+                    if(c != ',')
+                    {
+                        return false;
+                    }
+                }
+            case '[':
+                value.m_type = JsonValue::Array;
+                m_p++;
+                if(skipWhitespace() < m_end && *m_p == ']')
+                {
+                    m_p++;
+                    return true;
+                }
+                for(;;)
+                {
+                    value.m_elements.push_back(JsonValue());
+                    if(!parseValue(value.m_elements.back(), depth + 1) || skipWhitespace() == m_end)
+                    {
+                        return false;
+                    }
+                    const char c = *m_p++;
+                    if(c == ']')
+                    {
+                        return true;
+                    }
+                    if(c != ',')
+                    {
+                        return false;
+                    }
+                }
+            case '"':
+                value.m_type = JsonValue::String;
+                return parseString(value.m_string);
+            case 't':
+                value.m_type = JsonValue::Bool;
+                value.m_number = 1.0;
+                return literal("true");
+            case 'f':
+                value.m_type = JsonValue::Bool;
+                return literal("false");
+            case 'n':
+                return literal("null");
+            default:
+                value.m_type = JsonValue::Number;
+                return parseDecimal(m_p, m_end, value.m_number);
+            }
+        }
+
+        const char* m_p;
+        const char* m_end;
+    };
+
+    // Typed view of a glTF accessor inside the BIN chunk
+    struct Accessor
+    {
+        const uint8_t* m_data;
+        size_t         m_stride;
+        uint32_t       m_count;
+        int32_t        m_componentType;
+        int32_t        m_components;
+        bool           m_normalized;
+
+        float getFloat(uint32_t element, int32_t component) const
+        {
+            const uint8_t* p = m_data + m_stride * element;
+            switch(m_componentType)
+            {
+            case 5120: { int8_t v;   memcpy(&v, p + component, 1);     return m_normalized ? std::max(float(v) / 127.0f, -1.0f) : float(v); }
+            case 5121: { uint8_t v;  memcpy(&v, p + component, 1);     return m_normalized ? float(v) / 255.0f : float(v); }
+            case 5122: { int16_t v;  memcpy(&v, p + component * 2, 2); return m_normalized ? std::max(float(v) / 32767.0f, -1.0f) : float(v); }
+            case 5123: { uint16_t v; memcpy(&v, p + component * 2, 2); return m_normalized ? float(v) / 65535.0f : float(v); }
+            case 5125: { uint32_t v; memcpy(&v, p + component * 4, 4); return float(v); }
+            default:   { float v;    memcpy(&v, p + component * 4, 4); return v; }
+            }
+        }
+
+        uint32_t getIndex(uint32_t element) const
+        {
+            const uint8_t* p = m_data + m_stride * element;
+            switch(m_componentType)
+            {
+            case 5121: return *p;
+            case 5123: { uint16_t v; memcpy(&v, p, 2); return v; }
+            default:   { uint32_t v; memcpy(&v, p, 4); return v; }
+            }
+        }
+    };
+
+    bool getAccessor(const JsonValue& root, const uint8_t* bin, size_t binSize, const JsonValue* indexValue, Accessor& out)
+    {
+        const JsonValue* accessors   = root.find("accessors");
+        const JsonValue* bufferViews = root.find("bufferViews");
+        if(indexValue == nullptr || indexValue->m_type != JsonValue::Number || accessors == nullptr || bufferViews == nullptr)
+        {
+            return false;
+        }
+        const JsonValue* accessor = accessors->at(size_t(indexValue->m_number));
+        if(accessor == nullptr || accessor->find("sparse") != nullptr)
+        {
+            return false;
+        }
+        const JsonValue* view = bufferViews->at(size_t(accessor->getNumber("bufferView", -1.0)));
+        if(view == nullptr || view->getNumber("buffer", 0.0) != 0.0)
+        {
+            return false;
+        }
+
+        static const char* types[] = { "SCALAR", "VEC2", "VEC3", "VEC4" };
+        const std::string type = accessor->getString("type");
+        out.m_components = 0;
+        for(int32_t i = 0; i < 4; i++)
+        {
+            out.m_components = (type == types[i]) ? i + 1 : out.m_components;
+        }
+        out.m_componentType = int32_t(accessor->getNumber("componentType", 0.0));
+        out.m_count         = uint32_t(accessor->getNumber("count", 0.0));
+        out.m_normalized    = false;
+        const JsonValue* normalized = accessor->find("normalized");
+        if(normalized != nullptr && normalized->m_type == JsonValue::Bool)
+        {
+            out.m_normalized = normalized->m_number != 0.0;
+        }
+
+        size_t componentBytes = 0;
+        switch(out.m_componentType)
+        {
+        case 5120: case 5121: componentBytes = 1; break;
+        case 5122: case 5123: componentBytes = 2; break;
+        case 5125: case 5126: componentBytes = 4; break;
+        }
+        if(out.m_components == 0 || componentBytes == 0)
+        {
+            return false;
+        }
+
+        const size_t elementBytes = componentBytes * size_t(out.m_components);
+        const size_t viewOffset   = size_t(view->getNumber("byteOffset", 0.0));
+        const size_t viewLength   = size_t(view->getNumber("byteLength", 0.0));
+        const size_t offset       = size_t(accessor->getNumber("byteOffset", 0.0));
+        out.m_stride = size_t(view->getNumber("byteStride", double(elementBytes)));
+        if(viewOffset > binSize || viewLength > binSize - viewOffset ||
+           (out.m_count != 0 && (offset > viewLength || (out.m_count - 1) * out.m_stride + elementBytes > viewLength - offset)))
+        {
+            return false;
+        }
+        out.m_data = bin + viewOffset + offset;
+        return true;
+    }
+
+    // Column major 4x4 matrices, as glTF stores them
+    void multiply(const float* a, const float* b, float* out)
+    {
+        float result[16];
+        for(int32_t c = 0; c < 4; c++)
+        {
+            for(int32_t r = 0; r < 4; r++)
+            {
+                result[c * 4 + r] = a[r] * b[c * 4] + a[4 + r] * b[c * 4 + 1] + a[8 + r] * b[c * 4 + 2] + a[12 + r] * b[c * 4 + 3];
+            }
+        }
+        memcpy(out, result, sizeof(result));
+    }
+
+    bool getFloats(const JsonValue& node, const char* key, float* out, size_t count)
+    {
+        const JsonValue* value = node.find(key);
+        if(value == nullptr || value->m_type != JsonValue::Array || value->m_elements.size() != count)
+        {
+            return false;
+        }
+        for(size_t i = 0; i < count; i++)
+        {
+            out[i] = float(value->m_elements[i].m_number);
+        }
+        return true;
+    }
+
+    void getLocalMatrix(const JsonValue& node, float* matrix)
+    {
+        if(getFloats(node, "matrix", matrix, 16))
+        {
+            return;
+        }
+        float t[3] = { 0.0f, 0.0f, 0.0f };
+        float q[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+        float s[3] = { 1.0f, 1.0f, 1.0f };
+        getFloats(node, "translation", t, 3);
+        getFloats(node, "rotation", q, 4);
+        getFloats(node, "scale", s, 3);
+
+        // T * R * S
+        const float x = q[0], y = q[1], z = q[2], w = q[3];
+        const float rotation[9] =
+        {
+            1.0f - 2.0f * (y * y + z * z), 2.0f * (x * y + z * w),        2.0f * (x * z - y * w),
+            2.0f * (x * y - z * w),        1.0f - 2.0f * (x * x + z * z), 2.0f * (y * z + x * w),
+            2.0f * (x * z + y * w),        2.0f * (y * z - x * w),        1.0f - 2.0f * (x * x + y * y)
+        };
+        for(int32_t c = 0; c < 3; c++)
+        {
+            for(int32_t r = 0; r < 3; r++)
+            {
+                matrix[c * 4 + r] = rotation[c * 3 + r] * s[c];
+            }
+            matrix[c * 4 + 3] = 0.0f;
+        }
+        matrix[12] = t[0];
+        matrix[13] = t[1];
+        matrix[14] = t[2];
+        matrix[15] = 1.0f;
+    }
+
+    // A primitive to decode, with the transform of the node that places it
+    struct GlbDraw
+    {
+        const JsonValue* m_primitive;
+        float            m_matrix[16];
+        uint32_t         m_firstPosition;
+        uint32_t         m_firstCorner;
+        uint32_t         m_cornerCount;
+        Accessor         m_positions;
+    };
+
+    void collectNode(const JsonValue& root, size_t nodeIndex, const float* parent, int32_t depth, std::vector<GlbDraw>& draws)
+    {
+        const JsonValue* nodes = root.find("nodes");
+        const JsonValue* node  = nodes != nullptr ? nodes->at(nodeIndex) : nullptr;
+        if(node == nullptr || depth > 64)
+        {
+            return;
+        }
+        float local[16];
+        float world[16];
+        getLocalMatrix(*node, local);
+        multiply(parent, local, world);
+
+        const JsonValue* meshes = root.find("meshes");
+        const JsonValue* mesh   = (meshes != nullptr && node->find("mesh") != nullptr) ? meshes->at(size_t(node->getNumber("mesh", 0.0))) : nullptr;
+        const JsonValue* primitives = mesh != nullptr ? mesh->find("primitives") : nullptr;
+        for(size_t i = 0; primitives != nullptr && i < primitives->m_elements.size(); i++)
+        {
+            GlbDraw draw;
+            draw.m_primitive = &primitives->m_elements[i];
+            memcpy(draw.m_matrix, world, sizeof(world));
+            draws.push_back(draw);
+        }
+
+        const JsonValue* children = node->find("children");
+        for(size_t i = 0; children != nullptr && i < children->m_elements.size(); i++)
+        {
+            collectNode(root, size_t(children->m_elements[i].m_number), world, depth + 1, draws);
+        }
+    }
+
+    void getBaseColor(const JsonValue& root, const JsonValue& primitive, uint8_t* color)
+    {
+        memcpy(color, DefaultColor, 4);
+        const JsonValue* materials = root.find("materials");
+        const JsonValue* material  = (materials != nullptr && primitive.find("material") != nullptr) ? materials->at(size_t(primitive.getNumber("material", 0.0))) : nullptr;
+        const JsonValue* pbr       = material != nullptr ? material->find("pbrMetallicRoughness") : nullptr;
+        float factor[4];
+        if(pbr != nullptr && getFloats(*pbr, "baseColorFactor", factor, 4))
+        {
+            for(int32_t i = 0; i < 4; i++)
+            {
+                color[i] = toUnorm8(factor[i]);
+            }
+        }
+    }
+
+    // 16 byte weld key: position bits and color
+    struct WeldKey
+    {
+        float   m_position[3];
+        uint8_t m_color[4];
+    };
+
+    inline uint64_t hashKey(const WeldKey& key)
+    {
+        uint64_t a, b;
+        memcpy(&a, &key, 8);
+        memcpy(&b, reinterpret_cast<const uint8_t*>(&key) + 8, 8);
+        uint64_t h = a * 0x9E3779B185EBCA87ull ^ (b + 0xC2B2AE3D27D4EB4Full) * 0x165667B19E3779F9ull;
+        h ^= h >> 29;
+        h *= 0xBF58476D1CE4E5B9ull;
+        h ^= h >> 32;
+        return h;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: MeshImporter::MeshImporter()
+//
+////////////////////////////////////////////////////////////////////////////////
+MeshImporter::MeshImporter(JobSystem& jobs)
+    : m_jobs(jobs)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+
+bool MeshImporter::parseFloat(const char*& p, const char* end, float& value)
+{
+    double result;
+    if(!parseDecimal(p, end, result))
+    {
+        return false;
+    }
+    value = float(result);
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: MeshImporter::load()
+//
+////////////////////////////////////////////////////////////////////////////////
+bool MeshImporter::load(const std::string& path, std::vector<Part>& parts)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.m_threadCount = m_jobs.getThreadCount();
+    parts.clear();
+
+    const double start = now();
+    MappedFile file;
+    if(!file.open(path))
+    {
+        return false;
+    }
+    m_stats.m_fileBytes = file.getSize();
+
+    std::string extension = path.substr(std::min(path.size(), path.rfind('.') + 1));
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+    Geometry geometry;
+    bool ok = false;
+    if(extension == "obj")
+    {
+        ok = parseObj(file.getData(), file.getSize(), geometry);
+    }
+    else if(extension == "glb")
+    {
+        ok = parseGlb(file.getData(), file.getSize(), geometry);
+    }
+    if(!ok)
+    {
+        return false;
+    }
+
+    const double parsed = now();
+    m_stats.m_parseSeconds = parsed - start;
+    weldAndSplit(geometry, parts);
+    m_stats.m_weldSeconds  = now() - parsed;
+    m_stats.m_totalSeconds = now() - start;
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: MeshImporter::parseObj()
+//
+//    *** INTERESTING ***
+//    OBJ lines are independent except for the running vertex count that
+//    negative face indices refer to, so the text is cut at line breaks and the
+//    chunks are parsed concurrently; the counts are summed up afterwards and the
+//    chunks copied into place (again in parallel) with their indices rebased.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool MeshImporter::parseObj(const char* data, size_t size, Geometry& geometry)
+{
+    const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(size / ObjChunkBytes, size_t(m_jobs.getThreadCount()) * 8));
+    std::vector<size_t> starts(chunkCount + 1, size);
+    starts[0] = 0;
+    for(size_t i = 1; i < chunkCount; i++)
+    {
+        const size_t from = std::max(starts[i - 1], size * i / chunkCount);
+        starts[i] = size_t(skipLine(data + from, data + size) - data);
+    }
+
+    std::vector<ObjChunk> chunks(chunkCount);
+    std::atomic<bool> ok(true);
+    m_jobs.parallelFor(uint32_t(chunkCount), 1, [&](uint32_t begin, uint32_t end)
+    {
+        for(uint32_t i = begin; i < end; i++)
+        {
+            if(!parseObjChunk(data + starts[i], data + starts[i + 1], chunks[i]))
+            {
+                ok = false;
+            }
+        }
+    });
+    if(!ok)
+    {
+        return false;
+    }
+
+    std::vector<size_t> firstPosition(chunkCount + 1, 0);
+    std::vector<size_t> firstCorner(chunkCount + 1, 0);
+    for(size_t i = 0; i < chunkCount; i++)
+    {
+        firstPosition[i + 1] = firstPosition[i] + chunks[i].m_positions.size() / 3;
+        firstCorner[i + 1]   = firstCorner[i] + chunks[i].m_corners.size();
+    }
+    const size_t positionCount = firstPosition[chunkCount];
+    if(positionCount > 0xFFFFFFFFu)
+    {
+        return false;
+    }
+
+    geometry.m_positions.resize(positionCount * 3);
+    geometry.m_colors.resize(positionCount * 4);
+    geometry.m_corners.resize(firstCorner[chunkCount]);
+    m_jobs.parallelFor(uint32_t(chunkCount), 1, [&](uint32_t begin, uint32_t end)
+    {
+        for(uint32_t i = begin; i < end; i++)
+        {
+            ObjChunk& chunk = chunks[i];
+            std::copy(chunk.m_positions.begin(), chunk.m_positions.end(), geometry.m_positions.begin() + firstPosition[i] * 3);
+            std::copy(chunk.m_colors.begin(), chunk.m_colors.end(), geometry.m_colors.begin() + firstPosition[i] * 4);
+            for(size_t r = 0; r < chunk.m_relative.size(); r++)
+            {
+                chunk.m_corners[chunk.m_relative[r]] += int32_t(firstPosition[i]);
+            }
+            // data(): a file with vertices but no faces has no corners
+            uint32_t* corners = geometry.m_corners.data() + firstCorner[i];
+            for(size_t c = 0; c < chunk.m_corners.size(); c++)
+            {
+                if(chunk.m_corners[c] < 0 || size_t(chunk.m_corners[c]) >= positionCount)
+                {
+                    ok = false;
+                    break;
+                }
+                corners[c] = uint32_t(chunk.m_corners[c]);
+            }
+            std::vector<float>().swap(chunk.m_positions);
+        }
+    });
+    return ok;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: MeshImporter::parseGlb()
+//
+//    Triangle primitives of the default scene (or of every mesh, if the file
+//    has no scenes), transformed by their nodes. Each primitive is decoded on
+//    its own thread straight into its place in the geometry.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool MeshImporter::parseGlb(const char* data, size_t size, Geometry& geometry)
+{
+    uint32_t header[5];
+    if(size < sizeof(header))
+    {
+        return false;
+    }
+    memcpy(header, data, sizeof(header));
+    if(header[0] != GlbMagic || header[1] != GlbVersion || header[2] > size || header[4] != GlbChunkJson || header[3] > size - sizeof(header))
+    {
+        return false;
+    }
+    size = header[2];
+
+    JsonValue root;
+    JsonParser parser(data + sizeof(header), header[3]);
+    if(!parser.parse(root) || root.m_type != JsonValue::Object)
+    {
+        return false;
+    }
+
+    const uint8_t* bin     = nullptr;
+    size_t         binSize = 0;
+    const size_t   binHeader = sizeof(header) + ((header[3] + 3) & ~3u);
+    if(binHeader + 8 <= size)
+    {
+        uint32_t chunk[2];
+        memcpy(chunk, data + binHeader, sizeof(chunk));
+        if(chunk[1] == GlbChunkBin && chunk[0] <= size - binHeader - 8)
+        {
+            bin     = reinterpret_cast<const uint8_t*>(data + binHeader + 8);
+            binSize = chunk[0];
+        }
+    }
+
+    const float identity[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    std::vector<GlbDraw> draws;
+    const JsonValue* scenes = root.find("scenes");
+    const JsonValue* scene  = scenes != nullptr ? scenes->at(size_t(root.getNumber("scene", 0.0))) : nullptr;
+    if(scene != nullptr)
+    {
+        const JsonValue* nodes = scene->find("nodes");
+        for(size_t i = 0; nodes != nullptr && i < nodes->m_elements.size(); i++)
+        {
+            collectNode(root, size_t(nodes->m_elements[i].m_number), identity, 0, draws);
+        }
+    }
+    else if(root.find("meshes") != nullptr)
+    {
+        const JsonValue& meshes = *root.find("meshes");
+        for(size_t m = 0; m < meshes.m_elements.size(); m++)
+        {
+            const JsonValue* primitives = meshes.m_elements[m].find("primitives");
+            for(size_t i = 0; primitives != nullptr && i < primitives->m_elements.size(); i++)
+            {
+                GlbDraw draw;
+                draw.m_primitive = &primitives->m_elements[i];
+                memcpy(draw.m_matrix, identity, sizeof(identity));
+                draws.push_back(draw);
+            }
+        }
+    }
+
+    // Sizes first, so every primitive knows where its data goes
+    size_t positionCount = 0;
+    size_t cornerCount   = 0;
+    for(size_t i = 0; i < draws.size(); )
+    {
+        GlbDraw& draw = draws[i];
+        const JsonValue* attributes = draw.m_primitive->find("attributes");
+        Accessor indices;
+        const bool hasIndices = (draw.m_primitive->find("indices") != nullptr);
+        if(draw.m_primitive->getNumber("mode", 4.0) != 4.0 || attributes == nullptr ||
+           !getAccessor(root, bin, binSize, attributes->find("POSITION"), draw.m_positions) || draw.m_positions.m_components != 3 ||
+           (hasIndices && (!getAccessor(root, bin, binSize, draw.m_primitive->find("indices"), indices) || indices.m_components != 1 ||
+                           (indices.m_componentType != 5121 && indices.m_componentType != 5123 && indices.m_componentType != 5125))))
+        {
+            // Points, lines and strips are not drawn by the app; malformed primitives are skipped too
+            draws.erase(draws.begin() + i);
+            continue;
+        }
+        draw.m_firstPosition = uint32_t(positionCount);
+        draw.m_firstCorner   = uint32_t(cornerCount);
+        draw.m_cornerCount   = ((hasIndices ? indices.m_count : draw.m_positions.m_count) / 3) * 3;
+        positionCount += draw.m_positions.m_count;
+        cornerCount   += draw.m_cornerCount;
+        if(positionCount > 0xFFFFFFFFu || cornerCount > 0xFFFFFFFFu)
+        {
+            return false;
+        }
+        i++;
+    }
+
+    geometry.m_positions.resize(positionCount * 3);
+    geometry.m_colors.resize(positionCount * 4);
+    geometry.m_corners.resize(cornerCount);
+    std::atomic<bool> ok(true);
+    m_jobs.parallelFor(uint32_t(draws.size()), 1, [&](uint32_t begin, uint32_t end)
+    {
+        for(uint32_t d = begin; d < end; d++)
+        {
+            const GlbDraw& draw = draws[d];
+            const JsonValue* attributes = draw.m_primitive->find("attributes");
+            const float* m = draw.m_matrix;
+
+            float*   positions = &geometry.m_positions[0] + size_t(draw.m_firstPosition) * 3;
+            uint8_t* colors    = &geometry.m_colors[0] + size_t(draw.m_firstPosition) * 4;
+            for(uint32_t i = 0; i < draw.m_positions.m_count; i++)
+            {
+                const float x = draw.m_positions.getFloat(i, 0);
+                const float y = draw.m_positions.getFloat(i, 1);
+                const float z = draw.m_positions.getFloat(i, 2);
+                positions[i * 3 + 0] = m[0] * x + m[4] * y + m[8] * z + m[12];
+                positions[i * 3 + 1] = m[1] * x + m[5] * y + m[9] * z + m[13];
+                positions[i * 3 + 2] = m[2] * x + m[6] * y + m[10] * z + m[14];
+            }
+
+            Accessor vertexColors;
+            if(getAccessor(root, bin, binSize, attributes->find("COLOR_0"), vertexColors) && vertexColors.m_components >= 3 && vertexColors.m_count >= draw.m_positions.m_count)
+            {
+                for(uint32_t i = 0; i < draw.m_positions.m_count; i++)
+                {
+                    for(int32_t c = 0; c < 4; c++)
+                    {
+                        colors[i * 4 + c] = (c < vertexColors.m_components) ? toUnorm8(vertexColors.getFloat(i, c)) : 255;
+                    }
+                }
+            }
+            else
+            {
+                uint8_t color[4];
+                getBaseColor(root, *draw.m_primitive, color);
+                for(uint32_t i = 0; i < draw.m_positions.m_count; i++)
+                {
+                    memcpy(colors + i * 4, color, 4);
+                }
+            }
+
+            uint32_t* corners = geometry.m_corners.data() + draw.m_firstCorner;
+            Accessor indices;
+            if(getAccessor(root, bin, binSize, draw.m_primitive->find("indices"), indices))
+            {
+                for(uint32_t i = 0; i < draw.m_cornerCount; i++)
+                {
+                    const uint32_t index = indices.getIndex(i);
+                    if(index >= draw.m_positions.m_count)
+                    {
+                        ok = false;
+                        break;
+                    }
+                    corners[i] = draw.m_firstPosition + index;
+                }
+            }
+            else
+            {
+                for(uint32_t i = 0; i < draw.m_cornerCount; i++)
+                {
+                    corners[i] = draw.m_firstPosition + i;
+                }
+            }
+        }
+    });
+    return ok;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: MeshImporter::weldAndSplit()
+//
+//    *** INTERESTING ***
+//    Welding goes through an open addressing table over the 16 bytes that
+//    make a vertex unique here (position and color), so a file that repeats
+//    shared corners per face (glTF, OBJ exports without shared vertices) ends
+//    up with each vertex once. The triangles are then dealt out to parts in
+//    order: a part is closed as soon as the next triangle would bring in a
+//    65537th vertex, so neighbouring triangles stay together and each part is
+//    addressable with 16 bit indices.
+//
+////////////////////////////////////////////////////////////////////////////////
+void MeshImporter::weldAndSplit(const Geometry& geometry, std::vector<Part>& parts)
+{
+    const size_t positionCount = geometry.m_positions.size() / 3;
+    m_stats.m_positions = positionCount;
+
+    std::vector<WeldKey> keys(positionCount);
+    for(int32_t c = 0; c < 3; c++)
+    {
+        m_stats.m_boundsMin[c] = positionCount ? geometry.m_positions[c] : 0.0f;
+        m_stats.m_boundsMax[c] = positionCount ? geometry.m_positions[c] : 0.0f;
+    }
+    for(size_t i = 0; i < positionCount; i++)
+    {
+        memcpy(keys[i].m_position, &geometry.m_positions[i * 3], sizeof(keys[i].m_position));
+        memcpy(keys[i].m_color, &geometry.m_colors[i * 4], sizeof(keys[i].m_color));
+        for(int32_t c = 0; c < 3; c++)
+        {
+            m_stats.m_boundsMin[c] = std::min(m_stats.m_boundsMin[c], keys[i].m_position[c]);
+            m_stats.m_boundsMax[c] = std::max(m_stats.m_boundsMax[c], keys[i].m_position[c]);
+        }
+    }
+
+    // Table of welded vertex ids, at most half full
+    size_t capacity = 16;
+    while(capacity < positionCount * 2)
+    {
+        capacity *= 2;
+    }
+    const uint32_t empty = 0xFFFFFFFF;
+    std::vector<uint32_t> table(capacity, empty);
+    std::vector<uint32_t> remap(positionCount);
+    std::vector<uint32_t> unique;                   // welded id -> first position with that key
+    for(size_t i = 0; i < positionCount; i++)
+    {
+        size_t slot = size_t(hashKey(keys[i])) & (capacity - 1);
+        for(;;)
+        {
+            if(table[slot] == empty)
+            {
+                table[slot] = uint32_t(unique.size());
+                unique.push_back(uint32_t(i));
+                break;
+            }
+            if(memcmp(&keys[unique[table[slot]]], &keys[i], sizeof(WeldKey)) == 0)
+            {
+                break;
+            }
+            slot = (slot + 1) & (capacity - 1);
+        }
+        remap[i] = table[slot];
+    }
+    std::vector<uint32_t>().swap(table);
+    m_stats.m_vertices = unique.size();
+
+    // Part local index of each welded vertex; stamp says which part it is valid for
+    std::vector<uint32_t> local(unique.size());
+    std::vector<uint32_t> stamp(unique.size(), empty);
+    Part* part = nullptr;
+    for(size_t t = 0; t + 2 < geometry.m_corners.size(); t += 3)
+    {
+        const uint32_t v[3] = { remap[geometry.m_corners[t]], remap[geometry.m_corners[t + 1]], remap[geometry.m_corners[t + 2]] };
+        if(v[0] == v[1] || v[1] == v[2] || v[0] == v[2])
+        {
+            m_stats.m_degenerateTriangles++;
+            continue;
+        }
+
+        const uint32_t partIndex = uint32_t(parts.size()) - 1;
+        const size_t added = size_t(stamp[v[0]] != partIndex) + size_t(stamp[v[1]] != partIndex) + size_t(stamp[v[2]] != partIndex);
+        if(part == nullptr || part->m_vertices.size() + added > MaxPartVertices)
+        {
+            parts.push_back(Part());
+            part = &parts.back();
+            part->m_vertices.reserve(std::min<size_t>(MaxPartVertices, unique.size()));
+        }
+
+        const uint32_t current = uint32_t(parts.size()) - 1;
+        for(int32_t c = 0; c < 3; c++)
+        {
+            if(stamp[v[c]] != current)
+            {
+                const WeldKey& key = keys[unique[v[c]]];
+                stamp[v[c]] = current;
+                local[v[c]] = uint32_t(part->m_vertices.size());
+                part->m_vertices.push_back(Vertex(key.m_position[0], key.m_position[1], key.m_position[2], 0.0f, 0.0f, 0.0f, 0.0f));
+                memcpy(part->m_vertices.back().m_color, key.m_color, sizeof(key.m_color));
+            }
+            part->m_indices.push_back(uint16_t(local[v[c]]));
+        }
+        m_stats.m_triangles++;
+    }
+    if(!parts.empty())
+    {
+        // The others are (nearly) full
+        std::vector<Vertex>(parts.back().m_vertices).swap(parts.back().m_vertices);
+    }
+    m_stats.m_parts = uint32_t(parts.size());
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: MeshImporter::writeTestFile()
+//
+//    (gridSize + 1)^2 colored vertices on a gentle wave and gridSize^2 quads,
+//    as OBJ (quads, some with v//vn corners and relative indices) or as glTF
+//    binary (indexed triangles, RGBA8 colors).
+//
+////////////////////////////////////////////////////////////////////////////////
+bool MeshImporter::writeTestFile(const std::string& path, uint32_t gridSize)
+{
+    const uint32_t side = gridSize + 1;
+    std::vector<float>   positions(size_t(side) * side * 3);
+    std::vector<uint8_t> colors(size_t(side) * side * 4);
+    for(uint32_t z = 0; z < side; z++)
+    {
+        for(uint32_t x = 0; x < side; x++)
+        {
+            const size_t i = size_t(z) * side + x;
+            const float  h = 0.1f * sinf(float(x) * 0.05f) * cosf(float(z) * 0.07f);
+            positions[i * 3 + 0] = float(x) / float(gridSize) - 0.5f;
+            positions[i * 3 + 1] = h;
+            positions[i * 3 + 2] = float(z) / float(gridSize) - 0.5f;
+            colors[i * 4 + 0] = toUnorm8(0.5f + 4.0f * h);
+            colors[i * 4 + 1] = toUnorm8(float(x) / float(gridSize));
+            colors[i * 4 + 2] = toUnorm8(float(z) / float(gridSize));
+            colors[i * 4 + 3] = 255;
+        }
+    }
+
+    std::string extension = path.substr(std::min(path.size(), path.rfind('.') + 1));
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    std::ofstream file(path.c_str(), std::ios::binary | std::ios::trunc);
+    if(!file)
+    {
+        return false;
+    }
+
+    if(extension == "obj")
+    {
+        std::string text;
+        char line[160];
+        for(size_t i = 0; i < positions.size() / 3; i++)
+        {
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f %.4f %.4f %.4f\n", positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2],
+                     float(colors[i * 4]) / 255.0f, float(colors[i * 4 + 1]) / 255.0f, float(colors[i * 4 + 2]) / 255.0f);
+            text += line;
+        }
+        const int64_t count = int64_t(positions.size() / 3);
+        for(uint32_t z = 0; z < gridSize; z++)
+        {
+            for(uint32_t x = 0; x < gridSize; x++)
+            {
+                const int64_t a = int64_t(z) * side + x + 1;
+                const int64_t b = a + 1;
+                const int64_t c = a + side + 1;
+                const int64_t d = a + side;
+                if(z % 3 == 2)
+                {
+                    snprintf(line, sizeof(line), "f %lld %lld %lld %lld\n", (long long)(a - count - 1), (long long)(d - count - 1), (long long)(c - count - 1), (long long)(b - count - 1));
+                }
+                else if(z % 3 == 1)
+                {
+                    snprintf(line, sizeof(line), "f %lld//1 %lld//1 %lld//1 %lld//1\n", (long long)a, (long long)d, (long long)c, (long long)b);
+                }
+                else
+                {
+                    snprintf(line, sizeof(line), "f %lld %lld %lld %lld\n", (long long)a, (long long)d, (long long)c, (long long)b);
+                }
+                text += line;
+            }
+        }
+        file.write(text.data(), std::streamsize(text.size()));
+        return bool(file);
+    }
+
+    if(extension != "glb")
+    {
+        return false;
+    }
+
+    std::vector<uint32_t> indices;
+    indices.reserve(size_t(gridSize) * gridSize * 6);
+    for(uint32_t z = 0; z < gridSize; z++)
+    {
+        for(uint32_t x = 0; x < gridSize; x++)
+        {
+            const uint32_t a = z * side + x;
+            const uint32_t quad[6] = { a, a + side, a + side + 1, a, a + side + 1, a + 1 };
+            indices.insert(indices.end(), quad, quad + 6);
+        }
+    }
+
+    const size_t positionBytes = positions.size() * sizeof(float);
+    const size_t colorBytes    = colors.size();
+    const size_t indexBytes    = indices.size() * sizeof(uint32_t);
+    const size_t vertexCount   = positions.size() / 3;
+
+    std::ostringstream json;
+    json << "{\"asset\":{\"version\":\"2.0\"},\"scene\":0,\"scenes\":[{\"nodes\":[0]}],\"nodes\":[{\"mesh\":0}],"
+         << "\"meshes\":[{\"primitives\":[{\"attributes\":{\"POSITION\":0,\"COLOR_0\":1},\"indices\":2}]}],"
+         << "\"buffers\":[{\"byteLength\":" << positionBytes + colorBytes + indexBytes << "}],"
+         << "\"bufferViews\":["
+         << "{\"buffer\":0,\"byteOffset\":0,\"byteLength\":" << positionBytes << "},"
+         << "{\"buffer\":0,\"byteOffset\":" << positionBytes << ",\"byteLength\":" << colorBytes << "},"
+         << "{\"buffer\":0,\"byteOffset\":" << positionBytes + colorBytes << ",\"byteLength\":" << indexBytes << "}],"
+         << "\"accessors\":["
+         << "{\"bufferView\":0,\"componentType\":5126,\"count\":" << vertexCount << ",\"type\":\"VEC3\"},"
+         << "{\"bufferView\":1,\"componentType\":5121,\"normalized\":true,\"count\":" << vertexCount << ",\"type\":\"VEC4\"},"
+         << "{\"bufferView\":2,\"componentType\":5125,\"count\":" << indices.size() << ",\"type\":\"SCALAR\"}]}";
+    std::string text = json.str();
+    text.resize((text.size() + 3) & ~size_t(3), ' ');
+
+    const uint32_t binSize  = uint32_t(positionBytes + colorBytes + indexBytes);
+    const uint32_t header[5] = { GlbMagic, GlbVersion, uint32_t(20 + text.size() + 8 + binSize), uint32_t(text.size()), GlbChunkJson };
+    const uint32_t binHeader[2] = { binSize, GlbChunkBin };
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(text.data(), std::streamsize(text.size()));
+    file.write(reinterpret_cast<const char*>(binHeader), sizeof(binHeader));
+    file.write(reinterpret_cast<const char*>(positions.data()), std::streamsize(positionBytes));
+    file.write(reinterpret_cast<const char*>(colors.data()), std::streamsize(colorBytes));
+    file.write(reinterpret_cast<const char*>(indices.data()), std::streamsize(indexBytes));
+    return bool(file);
+}
@@ -0,0 +1,81 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/MeshImporter.h
+//
+// Loads Wavefront OBJ and binary glTF (.glb) files into the Vertex / 16 bit index
+// layout Mesh::update() takes. The file is memory mapped; OBJ text is cut into
+// chunks at line breaks that are parsed as JobSystem jobs, glTF primitives are
+// decoded in parallel. Vertices with the same position and color are welded, and
+// the result is split into parts of at most 65536 vertices so every part can be
+// drawn with GL_UNSIGNED_SHORT indices.
+//
+// Only positions and colors are kept (OBJ "v x y z [r g b]", glTF POSITION and
+// COLOR_0); normals, texture coordinates and materials are skipped.
+//----------------------------------------------------------------------------------
+#ifndef MESH_IMPORTER_H
+#define MESH_IMPORTER_H
+
+#include "JobSystem.h"
+#include "Mesh.h"
+#include <string>
+#include <vector>
+
+class MeshImporter
+{
+public:
+    // Ready for Mesh::update()
+    struct Part
+    {
+        std::vector<Vertex>   m_vertices;
+        std::vector<uint16_t> m_indices;
+    };
+
+    struct Stats
+    {
+        uint64_t m_fileBytes;
+        uint64_t m_positions;               // vertices in the file
+        uint64_t m_vertices;                // after welding
+        uint64_t m_triangles;               // emitted triangles
+        uint64_t m_degenerateTriangles;     // dropped, two corners welded together
+        uint32_t m_parts;
+        uint32_t m_threadCount;
+        double   m_parseSeconds;
+        double   m_weldSeconds;             // welding and splitting
+        double   m_totalSeconds;
+        float    m_boundsMin[3];
+        float    m_boundsMax[3];
+    };
+
+    static const uint32_t MaxPartVertices = 65536;
+
+    // The chunks and primitives are spread over the jobs' threads
+    explicit MeshImporter(JobSystem& jobs);
+
+    // Format by extension (.obj or .glb); parts is replaced. Returns false on errors.
+    bool load(const std::string& path, std::vector<Part>& parts);
+
+    const Stats& getStats() const { return m_stats; }
+
+    // Text to float without locale or strtod; advances p past the number
+    static bool parseFloat(const char*& p, const char* end, float& value);
+
+    // A gridSize x gridSize wavy grid in the given format, for the benchmark
+    static bool writeTestFile(const std::string& path, uint32_t gridSize);
+
+private:
+    // Both formats are first brought to this
+    struct Geometry
+    {
+        std::vector<float>    m_positions;  // xyz
+        std::vector<uint8_t>  m_colors;     // rgba8 per position
+        std::vector<uint32_t> m_corners;    // three position indices per triangle
+    };
+
+    bool parseObj(const char* data, size_t size, Geometry& geometry);
+    bool parseGlb(const char* data, size_t size, Geometry& geometry);
+    void weldAndSplit(const Geometry& geometry, std::vector<Part>& parts);
+
+    JobSystem& m_jobs;
+    Stats      m_stats;
+};
+
+#endif
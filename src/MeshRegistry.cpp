@@ -0,0 +1,142 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/MeshRegistry.cpp
+//----------------------------------------------------------------------------------
+#include "MeshRegistry.h"
+#include <utility>
+
+const MeshRegistry::Handle MeshRegistry::InvalidHandle = { MeshRegistry::InvalidIndex, 0 };
+
+
+MeshRegistry::MeshRegistry(uint32_t capacity)
+    : m_slots(capacity)
+    , m_freeHead(capacity ? 0 : InvalidIndex)
+    , m_version(0)
+{
+    for(uint32_t i = 0; i < capacity; i++)
+    {
+        m_slots[i].m_generation = 0;
+        m_slots[i].m_dense      = InvalidIndex;
+        m_slots[i].m_nextFree   = (i + 1 < capacity) ? i + 1 : InvalidIndex;
+    }
+    m_meshes.reserve(capacity);
+    m_denseSlots.reserve(capacity);
+    m_freeGeometry.reserve(capacity);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: MeshRegistry::insert()
+//
+//    The most recently freed slot is handed out first, so a remove followed by
+//    an insert keeps using the same per mesh uniform slot.
+//
+////////////////////////////////////////////////////////////////////////////////
+MeshRegistry::Handle MeshRegistry::insert()
+{
+    if(m_freeHead == InvalidIndex)
+    {
+        return InvalidHandle;
+    }
+
+    const uint32_t index = m_freeHead;
+    Slot& slot = m_slots[index];
+    m_freeHead = slot.m_nextFree;
+    slot.m_nextFree = InvalidIndex;
+    slot.m_dense    = uint32_t(m_meshes.size());
+
+    if(!m_freeGeometry.empty())
+    {
+        m_meshes.push_back(std::move(m_freeGeometry.back()));
+        m_freeGeometry.pop_back();
+    }
+    else
+    {
+        m_meshes.emplace_back();
+    }
+    m_denseSlots.push_back(index);
+    m_version++;
+
+    Handle handle = { index, slot.m_generation };
+    return handle;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: MeshRegistry::remove()
+//
+//    Swap-removes from the dense array: the last mesh moves into the hole, its
+//    slot (and so its uniform slot and GPU pointers) stays the same.
+//    Only meshes that own their buffers are pooled. Buffers from the geometry
+//    cache are released right away: a pooled mesh would hold its references,
+//    and the cache would never free them, whatever data the next insert has.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool MeshRegistry::remove(Handle handle)
+{
+    if(!isValid(handle))
+    {
+        return false;
+    }
+
+    Slot& slot = m_slots[handle.m_index];
+    const uint32_t dense = slot.m_dense;
+    const uint32_t last  = uint32_t(m_meshes.size()) - 1;
+
+    Mesh& removed = m_meshes[dense];
+    if(removed.m_sharedGeometry != nullptr)
+    {
+        removed.releaseGeometry();
+    }
+    else
+    {
+        m_freeGeometry.push_back(std::move(removed));
+    }
+    if(dense != last)
+    {
+        m_meshes[dense]     = std::move(m_meshes[last]);
+        m_denseSlots[dense] = m_denseSlots[last];
+        m_slots[m_denseSlots[dense]].m_dense = dense;
+    }
+    m_meshes.pop_back();
+    m_denseSlots.pop_back();
+    m_version++;
+
+    slot.m_generation++;
+    slot.m_dense    = InvalidIndex;
+    slot.m_nextFree = m_freeHead;
+    m_freeHead = handle.m_index;
+    return true;
+}
+
+
+bool MeshRegistry::isValid(Handle handle) const
+{
+    return handle.m_index < m_slots.size()
+        && m_slots[handle.m_index].m_dense != InvalidIndex
+        && m_slots[handle.m_index].m_generation == handle.m_generation;
+}
+
+
+void MeshRegistry::clear()
+{
+    while(!m_meshes.empty())
+    {
+        remove(getHandle(0));
+    }
+}
+
+
+Mesh* MeshRegistry::get(Handle handle)
+{
+    return isValid(handle) ? &m_meshes[m_slots[handle.m_index].m_dense] : nullptr;
+}
+
+
+MeshRegistry::Handle MeshRegistry::getHandle(uint32_t i) const
+{
+    const uint32_t index = m_denseSlots[i];
+    Handle handle = { index, m_slots[index].m_generation };
+    return handle;
+}
@@ -0,0 +1,76 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/MeshRegistry.h
+//
+// Owns the meshes of the scene and lets them come and go at runtime. A mesh is
+// referred to by a generational handle: the index part is its slot, which is
+// also its per mesh uniform (and transform) slot, so the GPU pointers computed
+// from it stay valid for the mesh's lifetime. Removing a mesh bumps the slot's
+// generation, which invalidates stale handles, and returns the slot to a free
+// list. The meshes themselves are kept densely packed for the draw loop (the
+// last one is moved into the hole on removal), and the GL buffers of removed
+// meshes are pooled and reused by later inserts. Buffers shared through the
+// GeometryCache are not pooled, they go back to the cache on removal.
+//
+// Insert and remove are O(1) and do not touch GL; fill a new mesh with
+// Mesh::update().
+//----------------------------------------------------------------------------------
+#ifndef MESH_REGISTRY_H
+#define MESH_REGISTRY_H
+
+#include "Mesh.h"
+#include <vector>
+
+class MeshRegistry
+{
+public:
+    struct Handle
+    {
+        uint32_t m_index;       // slot, also the per mesh uniform slot
+        uint32_t m_generation;
+
+        bool operator==(const Handle& other) const { return m_index == other.m_index && m_generation == other.m_generation; }
+        bool operator!=(const Handle& other) const { return !(*this == other); }
+    };
+
+    static const uint32_t InvalidIndex = 0xffffffff;
+    static const Handle   InvalidHandle;
+
+    // capacity bounds the number of live meshes, and with it the size of the per mesh uniform buffer
+    explicit MeshRegistry(uint32_t capacity);
+
+    // Returns InvalidHandle when full. The mesh is empty or holds the buffers of a removed mesh.
+    Handle   insert();
+    bool     remove(Handle handle);
+    bool     isValid(Handle handle) const;
+    void     clear();
+
+    Mesh*    get(Handle handle);
+
+    // Dense access for the draw loop
+    uint32_t size() const                    { return uint32_t(m_meshes.size()); }
+    Mesh&    getMesh(uint32_t i)             { return m_meshes[i]; }
+    uint32_t getSlot(uint32_t i) const       { return m_denseSlots[i]; }
+    Handle   getHandle(uint32_t i) const;
+
+    uint32_t getCapacity() const             { return uint32_t(m_slots.size()); }
+    // Changes with every insert and remove, so lists derived from the dense order can tell they are stale
+    uint32_t getVersion() const              { return m_version; }
+    uint32_t getPooledCount() const          { return uint32_t(m_freeGeometry.size()); }
+
+private:
+    struct Slot
+    {
+        uint32_t m_generation;
+        uint32_t m_dense;       // index into m_meshes, InvalidIndex when free
+        uint32_t m_nextFree;
+    };
+
+    std::vector<Slot>     m_slots;
+    uint32_t              m_freeHead;
+    uint32_t              m_version;
+    std::vector<Mesh>     m_meshes;         // dense, reserved to capacity so it never reallocates
+    std::vector<uint32_t> m_denseSlots;     // slot of each dense entry
+    std::vector<Mesh>     m_freeGeometry;   // meshes of removed entries, buffers kept for reuse
+};
+
+#endif
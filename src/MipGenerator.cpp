@@ -0,0 +1,286 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/MipGenerator.cpp
+//----------------------------------------------------------------------------------
+#include "MipGenerator.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const float Pi          = 3.14159265358979f;
+    const float KaiserWidth = 3.0f;     // radius in destination texels
+    const float KaiserAlpha = 4.0f;
+
+    // The texels of one axis that contribute to each destination texel
+    struct Kernel
+    {
+        std::vector<uint32_t> m_first;  // per destination texel, into m_indices/m_weights; one extra entry ends the last
+        std::vector<int32_t>  m_indices;
+        std::vector<float>    m_weights;
+    };
+
+    // sRGB decode per byte value, and the linear values halfway between consecutive codes for the encode
+    struct SrgbTables
+    {
+        float m_toLinear[256];
+        float m_thresholds[255];
+
+        SrgbTables()
+        {
+            for(int32_t i = 0; i < 256; i++)
+            {
+                m_toLinear[i] = decode(float(i) / 255.0f);
+            }
+            for(int32_t i = 0; i < 255; i++)
+            {
+                m_thresholds[i] = decode((float(i) + 0.5f) / 255.0f);
+            }
+        }
+
+        static float decode(float c)
+        {
+            return (c <= 0.04045f) ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+    };
+
+    const SrgbTables& srgbTables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    // Zeroth order modified Bessel function of the first kind
+    float bessel0(float x)
+    {
+        float sum = 1.0f, term = 1.0f;
+        for(int32_t k = 1; k < 32 && term > sum * 1e-8f; k++)
+        {
+            const float half = x / (2.0f * float(k));
+            term *= half * half;
+            sum  += term;
+        }
+        return sum;
+    }
+
+    float kaiser(float x)
+    {
+        if(std::fabs(x) >= KaiserWidth)
+        {
+            return 0.0f;
+        }
+        const float t    = x / KaiserWidth;
+        const float sinc = (x == 0.0f) ? 1.0f : std::sin(Pi * x) / (Pi * x);
+        return sinc * bessel0(KaiserAlpha * std::sqrt(1.0f - t * t)) / bessel0(KaiserAlpha);
+    }
+
+    int32_t wrap(int32_t i, int32_t size)
+    {
+        return ((i % size) + size) % size;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  *** INTERESTING ***
+    //  Weights are computed once per axis and level, not per texel. The box
+    //  weights are the overlap of each source texel with the destination
+    //  footprint; the Kaiser taps are spaced in destination texels so the
+    //  kernel widens with the scale and removes what the smaller level cannot
+    //  represent.
+    //
+    ////////////////////////////////////////////////////////////////////////////////
+    void buildKernel(int32_t srcSize, int32_t dstSize, MipGenerator::Filter filter, Kernel& kernel)
+    {
+        const float scale   = float(srcSize) / float(dstSize);
+        const float stretch = std::max(scale, 1.0f);
+
+        kernel.m_first.resize(dstSize + 1);
+        kernel.m_indices.clear();
+        kernel.m_weights.clear();
+        for(int32_t x = 0; x < dstSize; x++)
+        {
+            const size_t first = kernel.m_weights.size();
+            kernel.m_first[x] = uint32_t(first);
+            if(filter == MipGenerator::FilterBox)
+            {
+                const float lo = float(x) * scale, hi = float(x + 1) * scale;
+                for(int32_t i = int32_t(std::floor(lo)); float(i) < hi; i++)
+                {
+                    const float weight = std::min(hi, float(i + 1)) - std::max(lo, float(i));
+                    if(weight > 0.0f)
+                    {
+                        kernel.m_indices.push_back(wrap(i, srcSize));
+                        kernel.m_weights.push_back(weight);
+                    }
+                }
+            }
+            else
+            {
+                const float center = (float(x) + 0.5f) * scale;
+                const float radius = KaiserWidth * stretch;
+                for(int32_t i = int32_t(std::floor(center - radius)); i <= int32_t(std::ceil(center + radius)); i++)
+                {
+                    const float weight = kaiser((float(i) + 0.5f - center) / stretch);
+                    if(weight != 0.0f)
+                    {
+                        kernel.m_indices.push_back(wrap(i, srcSize));
+                        kernel.m_weights.push_back(weight);
+                    }
+                }
+            }
+
+            float sum = 0.0f;
+            for(size_t t = first; t < kernel.m_weights.size(); t++)
+            {
+                sum += kernel.m_weights[t];
+            }
+            for(size_t t = first; t < kernel.m_weights.size(); t++)
+            {
+                kernel.m_weights[t] /= sum;
+            }
+        }
+        kernel.m_first[dstSize] = uint32_t(kernel.m_weights.size());
+    }
+
+    void decodeTexels(const uint8_t* rgba, size_t texelCount, uint32_t srgbChannels, float* out)
+    {
+        const float* toLinear = srgbTables().m_toLinear;
+        for(size_t i = 0; i < texelCount * 4; i++)
+        {
+            out[i] = (srgbChannels & (1u << (i & 3))) ? toLinear[rgba[i]] : float(rgba[i]) * (1.0f / 255.0f);
+        }
+    }
+
+    void encodeTexels(const float* texels, size_t texelCount, uint32_t srgbChannels, uint8_t* out)
+    {
+        for(size_t i = 0; i < texelCount * 4; i++)
+        {
+            // Kaiser lobes overshoot at hard edges
+            const float value = std::min(std::max(texels[i], 0.0f), 1.0f);
+            out[i] = (srgbChannels & (1u << (i & 3))) ? MipGenerator::linearToSrgb(value) : uint8_t(value * 255.0f + 0.5f);
+        }
+    }
+
+    // dst += weight * src over count RGBA texels
+    void accumulate(float* dst, const float* src, float weight, int32_t count)
+    {
+#ifdef MIP_GENERATOR_SSE2
+        const __m128 w = _mm_set1_ps(weight);
+        for(int32_t x = 0; x < count; x++)
+        {
+            _mm_storeu_ps(dst + x * 4, _mm_add_ps(_mm_loadu_ps(dst + x * 4), _mm_mul_ps(w, _mm_loadu_ps(src + x * 4))));
+        }
+#else
+        for(int32_t i = 0; i < count * 4; i++)
+        {
+            dst[i] += weight * src[i];
+        }
+#endif
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////
+    //
+    //  Horizontal pass into scratch, then a vertical pass that adds whole rows,
+    //  so both passes read memory in order.
+    //
+    ////////////////////////////////////////////////////////////////////////////////
+    void resampleTexels(const float* src, int32_t srcWidth, int32_t srcHeight, float* dst, int32_t dstWidth, int32_t dstHeight,
+                        MipGenerator::Filter filter, std::vector<float>& scratch)
+    {
+        Kernel kernelX, kernelY;
+        buildKernel(srcWidth, dstWidth, filter, kernelX);
+        buildKernel(srcHeight, dstHeight, filter, kernelY);
+
+        scratch.assign(size_t(dstWidth) * srcHeight * 4, 0.0f);
+        for(int32_t y = 0; y < srcHeight; y++)
+        {
+            const float* row = src + size_t(y) * srcWidth * 4;
+            float*       out = &scratch[size_t(y) * dstWidth * 4];
+            for(int32_t x = 0; x < dstWidth; x++, out += 4)
+            {
+                for(uint32_t t = kernelX.m_first[x]; t < kernelX.m_first[x + 1]; t++)
+                {
+                    accumulate(out, row + kernelX.m_indices[t] * 4, kernelX.m_weights[t], 1);
+                }
+            }
+        }
+
+        std::fill(dst, dst + size_t(dstWidth) * dstHeight * 4, 0.0f);
+        for(int32_t y = 0; y < dstHeight; y++)
+        {
+            float* out = dst + size_t(y) * dstWidth * 4;
+            for(uint32_t t = kernelY.m_first[y]; t < kernelY.m_first[y + 1]; t++)
+            {
+                accumulate(out, &scratch[size_t(kernelY.m_indices[t]) * dstWidth * 4], kernelY.m_weights[t], dstWidth);
+            }
+        }
+    }
+}
+
+
+float MipGenerator::srgbToLinear(uint8_t value)
+{
+    return srgbTables().m_toLinear[value];
+}
+
+
+uint8_t MipGenerator::linearToSrgb(float value)
+{
+    // The code whose interval holds the value, i.e. round(encode(value) * 255)
+    const float* thresholds = srgbTables().m_thresholds;
+    return uint8_t(std::upper_bound(thresholds, thresholds + 255, value) - thresholds);
+}
+
+
+int32_t MipGenerator::getLevelCount(int32_t width, int32_t height)
+{
+    int32_t levels = 1;
+    for(int32_t size = std::max(width, height); size > 1; size >>= 1)
+    {
+        levels++;
+    }
+    return levels;
+}
+
+
+void MipGenerator::resample(const uint8_t* src, int32_t srcWidth, int32_t srcHeight, uint8_t* dst, int32_t dstWidth, int32_t dstHeight, Filter filter, uint32_t srgbChannels)
+{
+    std::vector<float> source(size_t(srcWidth) * srcHeight * 4), result(size_t(dstWidth) * dstHeight * 4), scratch;
+    decodeTexels(src, size_t(srcWidth) * srcHeight, srgbChannels, &source[0]);
+    resampleTexels(&source[0], srcWidth, srcHeight, &result[0], dstWidth, dstHeight, filter, scratch);
+    encodeTexels(&result[0], size_t(dstWidth) * dstHeight, srgbChannels, dst);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: MipGenerator::generateChain()
+//
+//    Each level is filtered from the float copy of the level above it, only
+//    the output is rounded to 8 bits.
+//
+////////////////////////////////////////////////////////////////////////////////
+void MipGenerator::generateChain(const uint8_t* rgba, int32_t width, int32_t height, Filter filter, uint32_t srgbChannels, std::vector<Level>& levels)
+{
+    const int32_t levelCount = getLevelCount(width, height);
+    levels.resize(levelCount - 1);
+
+    std::vector<float> current(size_t(width) * height * 4), next, scratch;
+    decodeTexels(rgba, size_t(width) * height, srgbChannels, &current[0]);
+    for(int32_t l = 1; l < levelCount; l++)
+    {
+        Level& level = levels[l - 1];
+        level.m_width  = getLevelSize(width, l);
+        level.m_height = getLevelSize(height, l);
+        level.m_rgba.resize(size_t(level.m_width) * level.m_height * 4);
+
+        next.resize(level.m_rgba.size());
+        resampleTexels(&current[0], getLevelSize(width, l - 1), getLevelSize(height, l - 1), &next[0], level.m_width, level.m_height, filter, scratch);
+        encodeTexels(&next[0], size_t(level.m_width) * level.m_height, srgbChannels, &level.m_rgba[0]);
+        current.swap(next);
+    }
+}
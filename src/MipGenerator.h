@@ -0,0 +1,55 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/MipGenerator.h
+//
+// CPU mip chain generation for RGBA8 images. Each level is resampled from the
+// one above it with a separable filter: a box (area weighted, so odd sizes such
+// as 25 -> 12 stay exact) or a Kaiser windowed sinc, which keeps more detail in
+// the small levels. Filtering is done on float texels, four channels to an SSE
+// register, and the levels are kept in float until they are written out, so the
+// chain does not accumulate rounding. Channels flagged as sRGB are converted to
+// linear before filtering and back afterwards; averaging sRGB values directly
+// darkens high contrast detail as the levels get smaller.
+//
+// Texture coordinates repeat, so the filters wrap around the image edges.
+//----------------------------------------------------------------------------------
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include <cstdint>
+#include <vector>
+
+class MipGenerator
+{
+public:
+    enum Filter
+    {
+        FilterBox,
+        FilterKaiser,
+    };
+
+    // One mip level, tightly packed RGBA8
+    struct Level
+    {
+        int32_t              m_width;
+        int32_t              m_height;
+        std::vector<uint8_t> m_rgba;
+
+        Level() : m_width(0), m_height(0) {}
+    };
+
+    static const uint32_t SrgbColor = 0x7;      // srgbChannels: .rgb are sRGB, alpha is linear
+
+    // Levels below the base (levels[0] is the first half size level), down to 1x1
+    static void generateChain(const uint8_t* rgba, int32_t width, int32_t height, Filter filter, uint32_t srgbChannels, std::vector<Level>& levels);
+    // One resampling step between arbitrary sizes
+    static void resample(const uint8_t* src, int32_t srcWidth, int32_t srcHeight, uint8_t* dst, int32_t dstWidth, int32_t dstHeight, Filter filter, uint32_t srgbChannels);
+
+    // Including the base level
+    static int32_t getLevelCount(int32_t width, int32_t height);
+    static int32_t getLevelSize(int32_t size, int32_t level) { return (size >> level) > 0 ? (size >> level) : 1; }
+
+    static float   srgbToLinear(uint8_t value);
+    static uint8_t linearToSrgb(float value);
+};
+
+#endif
@@ -0,0 +1,344 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/ProgramBinaryCache.cpp
+//----------------------------------------------------------------------------------
+#include "ProgramBinaryCache.h"
+#include "AtomicFile.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    const uint32_t CacheMagic   = 0x31434250; // "PBC1"
+    const uint32_t CacheVersion = 1;
+
+    struct CacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+        uint32_t binaryFormat;
+        uint32_t binarySize;
+        uint64_t checksum;
+    };
+
+    bool startsWith(const std::string& s, size_t pos, const char* prefix)
+    {
+        return s.compare(pos, strlen(prefix), prefix) == 0;
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: ProgramBinaryCache::ProgramBinaryCache()
+//
+////////////////////////////////////////////////////////////////////////////////
+ProgramBinaryCache::ProgramBinaryCache(const std::string& directory, const std::string& driverIdentity)
+    : m_directory(directory)
+    , m_driverIdentity(driverIdentity)
+{
+    memset(&m_counters, 0, sizeof(m_counters));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: ProgramBinaryCache::hash()
+//
+//    64 bit FNV-1a, chainable through 'seed'
+//
+////////////////////////////////////////////////////////////////////////////////
+uint64_t ProgramBinaryCache::hash(const void* data, size_t size, uint64_t seed)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t h = seed;
+    for(size_t i = 0; i < size; i++)
+    {
+        h ^= bytes[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: ProgramBinaryCache::computeKey()
+//
+//    Each part is hashed with its length so that moving text from one part to
+//    the next cannot produce the same key.
+//
+////////////////////////////////////////////////////////////////////////////////
+uint64_t ProgramBinaryCache::computeKey(const std::string& vertexSource, const std::string& fragmentSource, const std::string& defines) const
+{
+    const std::string* parts[4] = { &vertexSource, &fragmentSource, &defines, &m_driverIdentity };
+    uint64_t key = hash(&CacheVersion, sizeof(CacheVersion));
+    for(int32_t i = 0; i < 4; i++)
+    {
+        uint64_t length = parts[i]->size();
+        key = hash(&length, sizeof(length), key);
+        key = hash(parts[i]->data(), parts[i]->size(), key);
+    }
+    return key;
+}
+
+
+std::string ProgramBinaryCache::getPath(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+    return m_directory + "/" + name;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: ProgramBinaryCache::load()
+//
+////////////////////////////////////////////////////////////////////////////////
+bool ProgramBinaryCache::load(uint64_t key, GLenum& binaryFormat, std::vector<uint8_t>& binary) const
+{
+    if(m_directory.empty())
+    {
+        return false;
+    }
+
+    std::ifstream file(getPath(key).c_str(), std::ios::binary);
+    CacheHeader header;
+    if(!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        return false;
+    }
+    if(header.magic != CacheMagic || header.version != CacheVersion || header.key != key || header.binarySize == 0)
+    {
+        return false;
+    }
+
+    binary.resize(header.binarySize);
+    if(!file.read(reinterpret_cast<char*>(&binary[0]), binary.size()) || hash(&binary[0], binary.size()) != header.checksum)
+    {
+        binary.clear();
+        return false;
+    }
+
+    binaryFormat = GLenum(header.binaryFormat);
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: ProgramBinaryCache::store()
+//
+//    Written to a temporary file and renamed into place, so a concurrent
+//    reader or a crash never leaves a truncated entry behind.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool ProgramBinaryCache::store(uint64_t key, GLenum binaryFormat, const std::vector<uint8_t>& binary) const
+{
+    if(m_directory.empty() || binary.empty())
+    {
+        return false;
+    }
+
+    CacheHeader header;
+    header.magic        = CacheMagic;
+    header.version      = CacheVersion;
+    header.key          = key;
+    header.binaryFormat = uint32_t(binaryFormat);
+    header.binarySize   = uint32_t(binary.size());
+    header.checksum     = hash(&binary[0], binary.size());
+
+    return writeFileAtomic(getPath(key), [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&binary[0]), binary.size());
+    });
+}
+
+
+void ProgramBinaryCache::remove(uint64_t key) const
+{
+    if(!m_directory.empty())
+    {
+        std::remove(getPath(key).c_str());
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: ProgramBinaryCache::injectDefines()
+//
+//    GLSL requires #version (and #extension) to come first, so the defines go
+//    right after the last directive of the preamble. Leading comments, like the
+//    license block of our shaders, are skipped.
+//
+////////////////////////////////////////////////////////////////////////////////
+std::string ProgramBinaryCache::injectDefines(const std::string& source, const std::string& defines)
+{
+    if(defines.empty())
+    {
+        return source;
+    }
+
+    size_t insertAt = 0;
+    size_t pos = 0;
+    while(pos < source.size())
+    {
+        size_t end  = source.find('\n', pos);
+        size_t next = (end == std::string::npos) ? source.size() : end + 1;
+        size_t text = source.find_first_not_of(" \t\r", pos);
+
+        if(text < next && source[text] != '\n' && !startsWith(source, text, "//"))
+        {
+            if(!startsWith(source, text, "#version") && !startsWith(source, text, "#extension"))
+            {
+                break;
+            }
+            insertAt = next;
+        }
+        pos = next;
+    }
+
+    std::string result = source.substr(0, insertAt);
+    if(!result.empty() && result[result.size() - 1] != '\n')
+    {
+        result += '\n';
+    }
+    result += defines;
+    if(defines[defines.size() - 1] != '\n')
+    {
+        result += '\n';
+    }
+    result += source.substr(insertAt);
+    return result;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: ProgramBinaryCache::compileShader()
+//
+////////////////////////////////////////////////////////////////////////////////
+GLuint ProgramBinaryCache::compileShader(GLenum type, const std::string& source, std::string& log)
+{
+    GLuint shader = glCreateShader(type);
+    const GLchar* text = source.c_str();
+    glShaderSource(shader, 1, &text, nullptr);
+    glCompileShader(shader);
+
+    GLint status = GL_FALSE, length = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    if(length > 1)
+    {
+        std::vector<GLchar> info(length);
+        glGetShaderInfoLog(shader, length, nullptr, &info[0]);
+        log += (type == GL_VERTEX_SHADER) ? "vertex shader: " : "fragment shader: ";
+        log += &info[0];
+    }
+
+    if(status != GL_TRUE)
+    {
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: ProgramBinaryCache::linkProgram()
+//
+////////////////////////////////////////////////////////////////////////////////
+GLuint ProgramBinaryCache::linkProgram(GLuint vertexShader, GLuint fragmentShader, std::string& log)
+{
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+    glDetachShader(program, vertexShader);
+    glDetachShader(program, fragmentShader);
+
+    GLint status = GL_FALSE, length = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &status);
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    if(length > 1)
+    {
+        std::vector<GLchar> info(length);
+        glGetProgramInfoLog(program, length, nullptr, &info[0]);
+        log += "link: ";
+        log += &info[0];
+    }
+
+    if(status != GL_TRUE)
+    {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: ProgramBinaryCache::createProgram()
+//
+//    *** INTERESTING ***
+//    A cached binary skips the GLSL compiler and linker entirely. The driver
+//    may still refuse a binary (e.g. after an update that kept the version
+//    string), so a failed glProgramBinary() falls back to compiling and
+//    replaces the stale entry.
+//
+////////////////////////////////////////////////////////////////////////////////
+GLuint ProgramBinaryCache::createProgram(const std::string& vertexSource, const std::string& fragmentSource, const std::string& defines, std::string& log)
+{
+    const uint64_t key = computeKey(vertexSource, fragmentSource, defines);
+
+    GLenum               binaryFormat = 0;
+    std::vector<uint8_t> binary;
+    if(load(key, binaryFormat, binary))
+    {
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, binaryFormat, &binary[0], GLsizei(binary.size()));
+
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if(status == GL_TRUE)
+        {
+            m_counters.m_hits++;
+            return program;
+        }
+
+        glDeleteProgram(program);
+        remove(key);
+        m_counters.m_rejected++;
+    }
+
+    m_counters.m_misses++;
+    GLuint vertexShader   = compileShader(GL_VERTEX_SHADER, injectDefines(vertexSource, defines), log);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, injectDefines(fragmentSource, defines), log);
+    GLuint program        = 0;
+    if(vertexShader != 0 && fragmentShader != 0)
+    {
+        program = linkProgram(vertexShader, fragmentShader, log);
+    }
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    if(program != 0 && !m_directory.empty())
+    {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if(length > 0)
+        {
+            binary.resize(length);
+            glGetProgramBinary(program, length, nullptr, &binaryFormat, &binary[0]);
+            store(key, binaryFormat, binary);
+        }
+    }
+    return program;
+}
@@ -0,0 +1,58 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/ProgramBinaryCache.h
+//
+// On-disk cache of linked program binaries (GL_ARB_get_program_binary). Entries
+// are keyed by a hash of the shader sources, the injected defines and the driver
+// identity (GL_RENDERER + GL_VERSION), so a driver update or an edited shader
+// simply misses. Keying and file handling do not touch GL; only createProgram()
+// needs a context.
+//----------------------------------------------------------------------------------
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+
+#include "cinder/gl/gl.h"
+#include <string>
+#include <vector>
+
+class ProgramBinaryCache
+{
+public:
+    struct Counters
+    {
+        uint32_t m_hits;        // programs created from a cached binary
+        uint32_t m_misses;      // programs compiled from source
+        uint32_t m_rejected;    // cached binaries the driver refused (stale entry, removed)
+    };
+
+    // directory may be empty to disable the cache (programs are then always compiled)
+    ProgramBinaryCache(const std::string& directory, const std::string& driverIdentity);
+
+    uint64_t    computeKey(const std::string& vertexSource, const std::string& fragmentSource, const std::string& defines) const;
+    std::string getPath(uint64_t key) const;
+
+    // File handling. load() validates the header and payload checksum; store() writes
+    // to a temporary file and renames it into place.
+    bool        load(uint64_t key, GLenum& binaryFormat, std::vector<uint8_t>& binary) const;
+    bool        store(uint64_t key, GLenum binaryFormat, const std::vector<uint8_t>& binary) const;
+    void        remove(uint64_t key) const;
+
+    // Returns a linked program, from the cache when possible. Returns 0 and fills
+    // log if compiling or linking fails.
+    GLuint      createProgram(const std::string& vertexSource, const std::string& fragmentSource, const std::string& defines, std::string& log);
+
+    const Counters& getCounters() const { return m_counters; }
+
+    // Inserts 'defines' after the #version/#extension preamble of a GLSL source
+    static std::string injectDefines(const std::string& source, const std::string& defines);
+    static uint64_t    hash(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ULL);
+
+private:
+    static GLuint compileShader(GLenum type, const std::string& source, std::string& log);
+    static GLuint linkProgram(GLuint vertexShader, GLuint fragmentShader, std::string& log);
+
+    std::string m_directory;
+    std::string m_driverIdentity;
+    Counters    m_counters;
+};
+
+#endif
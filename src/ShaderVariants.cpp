@@ -0,0 +1,148 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/ShaderVariants.cpp
+//----------------------------------------------------------------------------------
+#include "ShaderVariants.h"
+#include "cinder/app/App.h"
+
+
+namespace
+{
+    struct FeatureInfo
+    {
+        ShaderVariants::Feature m_feature;
+        const char*             m_define;
+        const char*             m_name;
+    };
+
+    const FeatureInfo Features[ShaderVariants::FeatureCount] =
+    {
+        { ShaderVariants::FeatureBindlessUniforms, "USE_BINDLESS_UNIFORMS", "bindless uniforms" },
+        { ShaderVariants::FeatureBindlessTextures, "USE_BINDLESS_TEXTURES", "bindless textures" },
+    };
+}
+
+
+ShaderVariants::ShaderVariants(ProgramBinaryCache& cache, const std::string& vertexSource, const std::string& fragmentSource)
+    : m_cache(cache)
+    , m_vertexSource(vertexSource)
+    , m_fragmentSource(fragmentSource)
+{
+    for(Key key = 0; key < KeyCount; key++)
+    {
+        m_variants[key].m_built   = false;
+        m_variants[key].m_program = 0;
+    }
+}
+
+
+ShaderVariants::~ShaderVariants()
+{
+    release();
+}
+
+
+ShaderVariants::Key ShaderVariants::makeKey(bool bindlessUniforms, bool bindlessTextures)
+{
+    return (bindlessUniforms ? FeatureBindlessUniforms : 0) | (bindlessTextures ? FeatureBindlessTextures : 0);
+}
+
+
+std::string ShaderVariants::getDefines(Key key)
+{
+    std::string defines;
+    for(int32_t i = 0; i < FeatureCount; i++)
+    {
+        if(key & Features[i].m_feature)
+        {
+            defines += "#define ";
+            defines += Features[i].m_define;
+            defines += "\n";
+        }
+    }
+    return defines;
+}
+
+
+std::string ShaderVariants::getName(Key key)
+{
+    std::string name;
+    for(int32_t i = 0; i < FeatureCount; i++)
+    {
+        if(key & Features[i].m_feature)
+        {
+            name += name.empty() ? "" : " + ";
+            name += Features[i].m_name;
+        }
+    }
+    return name.empty() ? "base" : name;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: ShaderVariants::getProgram()
+//
+//    Called every frame with the key of the active toggles. Only the first
+//    request for a variant that compilePending() has not reached yet stalls.
+//
+////////////////////////////////////////////////////////////////////////////////
+GLuint ShaderVariants::getProgram(Key key)
+{
+    if(key >= KeyCount)
+    {
+        return 0;
+    }
+    if(!m_variants[key].m_built)
+    {
+        build(key);
+    }
+    return m_variants[key].m_program;
+}
+
+
+uint32_t ShaderVariants::compilePending(uint32_t maxCount)
+{
+    uint32_t count = 0;
+    for(Key key = 0; key < KeyCount && count < maxCount; key++)
+    {
+        if(!m_variants[key].m_built)
+        {
+            build(key);
+            count++;
+        }
+    }
+    return count;
+}
+
+
+void ShaderVariants::release()
+{
+    for(Key key = 0; key < KeyCount; key++)
+    {
+        if(m_variants[key].m_program != 0)
+        {
+            glDeleteProgram(m_variants[key].m_program);
+        }
+        m_variants[key].m_built   = false;
+        m_variants[key].m_program = 0;
+    }
+}
+
+
+bool ShaderVariants::build(Key key)
+{
+    std::string log;
+    GLuint program = m_cache.createProgram(m_vertexSource, m_fragmentSource, getDefines(key), log);
+    if(!log.empty())
+    {
+        ci::app::console() << "shader variant '" << getName(key) << "': " << log << std::endl;
+    }
+    if(program == 0)
+    {
+        ci::app::console() << "failed to build shader variant '" << getName(key) << "'" << std::endl;
+    }
+
+    m_variants[key].m_built   = true;
+    m_variants[key].m_program = program;
+    return program != 0;
+}
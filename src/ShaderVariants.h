@@ -0,0 +1,62 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/ShaderVariants.h
+//
+// Specialized programs built from one pair of shader sources. Each render mode
+// toggle that changes shader behaviour is a feature bit of the variant key; the
+// matching #defines are injected after the #version/#extension preamble, so the
+// GPU only runs the code for the active mode instead of branching per vertex.
+// Variants are compiled on first use, and compilePending() warms the remaining
+// ones a few at a time. Keys and defines do not touch GL.
+//----------------------------------------------------------------------------------
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include "ProgramBinaryCache.h"
+#include <string>
+#include <vector>
+
+class ShaderVariants
+{
+public:
+    enum Feature
+    {
+        FeatureBindlessUniforms = 1 << 0,   // USE_BINDLESS_UNIFORMS: per mesh uniforms through a GPU pointer attribute
+        FeatureBindlessTextures = 1 << 1,   // USE_BINDLESS_TEXTURES: color and displacement from bindless handles
+        FeatureCount            = 2
+    };
+
+    typedef uint32_t Key;
+    static const Key KeyCount = 1u << FeatureCount;
+
+    ShaderVariants(ProgramBinaryCache& cache, const std::string& vertexSource, const std::string& fragmentSource);
+    ~ShaderVariants();
+
+    static Key         makeKey(bool bindlessUniforms, bool bindlessTextures);
+    static std::string getDefines(Key key);
+    static std::string getName(Key key);
+
+    // Returns the program for 'key', compiling it now if needed; 0 if it failed to build
+    GLuint getProgram(Key key);
+    bool   isBuilt(Key key) const { return key < KeyCount && m_variants[key].m_built; }
+
+    // Builds up to 'maxCount' variants that have not been requested yet. Returns the number built.
+    uint32_t compilePending(uint32_t maxCount);
+
+    void release();
+
+private:
+    struct Variant
+    {
+        bool   m_built;     // set after the first attempt, successful or not
+        GLuint m_program;
+    };
+
+    bool build(Key key);
+
+    ProgramBinaryCache& m_cache;
+    std::string         m_vertexSource;
+    std::string         m_fragmentSource;
+    Variant             m_variants[KeyCount];
+};
+
+#endif
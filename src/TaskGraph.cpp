@@ -0,0 +1,156 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/TaskGraph.cpp
+//----------------------------------------------------------------------------------
+#include "TaskGraph.h"
+#include <algorithm>
+#include <chrono>
+
+namespace
+{
+    double now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+
+TaskGraph::TaskGraph(JobSystem& jobs)
+    : m_jobs(jobs)
+    , m_pendingJobs(0)
+    , m_finished(0)
+    , m_launched(false)
+    , m_launchTime(0.0)
+    , m_seconds(0.0)
+{
+}
+
+
+TaskGraph::~TaskGraph()
+{
+    // The jobs point at our tasks
+    wait();
+}
+
+
+TaskGraph::TaskId TaskGraph::add(const char* name, Function function, void* context, uint32_t count, uint32_t grain)
+{
+    std::unique_ptr<Task> task(new Task());
+    task->m_graph        = this;
+    task->m_name         = name;
+    task->m_function     = function;
+    task->m_context      = context;
+    task->m_count        = count;
+    task->m_grain        = std::max(grain, 1u);
+    task->m_predecessors = 0;
+    task->m_waitingFor   = 0;
+    task->m_runningJobs  = 0;
+    task->m_finishOrder  = 0;
+    m_tasks.push_back(std::move(task));
+    return TaskId(m_tasks.size() - 1);
+}
+
+
+void TaskGraph::precede(TaskId before, TaskId after)
+{
+    m_tasks[before]->m_successors.push_back(m_tasks[after].get());
+    m_tasks[after]->m_predecessors++;
+}
+
+
+void TaskGraph::setCount(TaskId task, uint32_t count)
+{
+    m_tasks[task]->m_count = count;
+}
+
+
+void TaskGraph::clear()
+{
+    wait();
+    m_tasks.clear();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TaskGraph::launch()
+//
+//    *** INTERESTING ***
+//    Every job of the run is submitted against the same counter, and a task's
+//    successors are submitted before the job that finished it counts itself
+//    done, so the counter only reaches zero once the whole graph has run.
+//
+////////////////////////////////////////////////////////////////////////////////
+void TaskGraph::launch()
+{
+    wait();
+    m_launched   = true;
+    m_launchTime = now();
+    m_finished   = 0;
+    for(size_t i = 0; i < m_tasks.size(); i++)
+    {
+        m_tasks[i]->m_waitingFor.store(m_tasks[i]->m_predecessors, std::memory_order_relaxed);
+    }
+
+    // Held while the roots go out, so a root that finishes at once cannot make the count hit zero early
+    m_pendingJobs.fetch_add(1);
+    for(size_t i = 0; i < m_tasks.size(); i++)
+    {
+        if(m_tasks[i]->m_predecessors == 0)
+        {
+            start(*m_tasks[i]);
+        }
+    }
+    m_pendingJobs.fetch_sub(1, std::memory_order_release);
+}
+
+
+void TaskGraph::wait()
+{
+    if(!m_launched)
+    {
+        return;
+    }
+    m_jobs.wait(m_pendingJobs);
+    m_launched = false;
+    m_seconds  = now() - m_launchTime;
+}
+
+
+void TaskGraph::start(Task& task)
+{
+    const uint32_t jobCount = (task.m_count + task.m_grain - 1) / task.m_grain;
+    if(jobCount == 0)
+    {
+        finish(task);
+        return;
+    }
+
+    // Set before the first job goes out, it may finish before the loop does
+    task.m_runningJobs.store(jobCount, std::memory_order_relaxed);
+    m_jobs.submitRange(&TaskGraph::runSlice, &task, task.m_count, task.m_grain, &m_pendingJobs);
+}
+
+
+void TaskGraph::runSlice(void* context, uint32_t begin, uint32_t end)
+{
+    Task& task = *static_cast<Task*>(context);
+    task.m_function(task.m_context, begin, end);
+    if(task.m_runningJobs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        task.m_graph->finish(task);
+    }
+}
+
+
+void TaskGraph::finish(Task& task)
+{
+    task.m_finishOrder = m_finished.fetch_add(1, std::memory_order_relaxed);
+    for(size_t i = 0; i < task.m_successors.size(); i++)
+    {
+        Task& successor = *task.m_successors[i];
+        if(successor.m_waitingFor.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            start(successor);
+        }
+    }
+}
@@ -0,0 +1,82 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/TaskGraph.h
+//
+// A set of tasks with explicit "runs before" edges, executed on a JobSystem.
+// The graph is built once and launched every frame: a task becomes ready when
+// all of its predecessors have finished, and a task over count items is split
+// into jobs of grain items that run in parallel. Launching does not allocate.
+//
+// launch() returns right away, so the calling thread can do something else (the
+// app submits GL for the current frame) while the workers run the graph; wait()
+// then helps with whatever is left. Tasks only see their own context, so as long
+// as they write disjoint data the result does not depend on the thread count or
+// the order the jobs happened to run in.
+//----------------------------------------------------------------------------------
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include "JobSystem.h"
+#include <memory>
+#include <vector>
+
+class TaskGraph
+{
+public:
+    typedef uint32_t TaskId;
+    typedef JobSystem::Function Function;
+
+    explicit TaskGraph(JobSystem& jobs);
+    ~TaskGraph();
+
+    // function(context, begin, end) is called for slices of [0, count); count 1 is a serial task
+    TaskId add(const char* name, Function function, void* context, uint32_t count = 1, uint32_t grain = 1);
+    // after starts once before has finished; the graph must stay acyclic
+    void   precede(TaskId before, TaskId after);
+    void   setCount(TaskId task, uint32_t count);
+    void   clear();
+
+    void   launch();
+    void   wait();
+    void   run()                        { launch(); wait(); }
+    bool   isLaunched() const           { return m_launched; }
+
+    uint32_t    getTaskCount() const            { return uint32_t(m_tasks.size()); }
+    const char* getName(TaskId task) const      { return m_tasks[task]->m_name; }
+    // Position of the task among the finished tasks of the last run
+    uint32_t    getFinishOrder(TaskId task) const { return m_tasks[task]->m_finishOrder; }
+    // launch() to the end of wait()
+    double      getSeconds() const              { return m_seconds; }
+
+private:
+    struct Task
+    {
+        TaskGraph*            m_graph;
+        const char*           m_name;
+        Function              m_function;
+        void*                 m_context;
+        uint32_t              m_count;
+        uint32_t              m_grain;
+        std::vector<Task*>    m_successors;
+        uint32_t              m_predecessors;
+        std::atomic<uint32_t> m_waitingFor;     // predecessors still running in this run
+        std::atomic<uint32_t> m_runningJobs;
+        uint32_t              m_finishOrder;
+    };
+
+    TaskGraph(const TaskGraph&);
+    TaskGraph& operator=(const TaskGraph&);
+
+    static void runSlice(void* context, uint32_t begin, uint32_t end);
+    void start(Task& task);
+    void finish(Task& task);
+
+    JobSystem&                          m_jobs;
+    std::vector<std::unique_ptr<Task> > m_tasks;
+    JobSystem::Counter                  m_pendingJobs;
+    std::atomic<uint32_t>               m_finished;
+    bool                                m_launched;
+    double                              m_launchTime;
+    double                              m_seconds;
+};
+
+#endif
@@ -0,0 +1,789 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/TextureCompressor.cpp
+//----------------------------------------------------------------------------------
+#include "TextureCompressor.h"
+#include "AtomicFile.h"
+#include "cinder/app/App.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TEXTURE_COMPRESSOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const uint32_t CacheMagic   = 0x31584342; // "BCX1"
+    const uint32_t CacheVersion = 2;
+
+    struct CacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        int32_t  width;
+        int32_t  height;
+        uint64_t sourceHash;
+        uint32_t bc1Size;
+        uint32_t bc4Size;
+        float    psnrBC1;
+        float    psnrBC4;
+        uint32_t mipSettings;
+        int32_t  mipLevels;
+        uint32_t mipBytes;
+    };
+
+    int32_t maskShift(uint32_t mask)
+    {
+        int32_t shift = 0;
+        while(mask != 0 && (mask & 1) == 0)
+        {
+            mask >>= 1;
+            shift++;
+        }
+        return shift;
+    }
+
+    uint16_t packRGB565(int32_t r, int32_t g, int32_t b)
+    {
+        return uint16_t(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+    }
+
+    void unpackRGB565(uint16_t c, int32_t rgb[3])
+    {
+        int32_t r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+        rgb[0] = (r << 3) | (r >> 2);
+        rgb[1] = (g << 2) | (g >> 4);
+        rgb[2] = (b << 3) | (b >> 2);
+    }
+
+    // Copies a 4x4 block into a tightly packed 64 byte RGBA buffer, replicating edge texels
+    void gatherBlock(const uint8_t* rgba, int32_t width, int32_t height, int32_t bx, int32_t by, uint8_t block[64])
+    {
+        for(int32_t y = 0; y < 4; y++)
+        {
+            int32_t sy = std::min(by * 4 + y, height - 1);
+            for(int32_t x = 0; x < 4; x++)
+            {
+                int32_t sx = std::min(bx * 4 + x, width - 1);
+                memcpy(&block[(y * 4 + x) * 4], &rgba[(size_t(sy) * width + sx) * 4], 4);
+            }
+        }
+    }
+
+    std::string cachePathFor(const std::string& cacheDir, const std::string& sourcePath)
+    {
+        size_t slash = sourcePath.find_last_of("/\\");
+        std::string stem = (slash == std::string::npos) ? sourcePath : sourcePath.substr(slash + 1);
+        size_t dot = stem.find_last_of('.');
+        if(dot != std::string::npos)
+        {
+            stem.resize(dot);
+        }
+        return cacheDir + "/" + stem + ".bcx";
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::TextureCompressor()
+//
+////////////////////////////////////////////////////////////////////////////////
+TextureCompressor::TextureCompressor(JobSystem& jobs)
+    : m_jobs(jobs)
+{
+    m_mipmaps         = true;
+    m_mipFilter       = MipGenerator::FilterKaiser;
+    m_mipSrgbChannels = MipGenerator::SrgbColor;
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+
+void TextureCompressor::setMipmaps(bool enabled, MipGenerator::Filter filter, uint32_t srgbChannels)
+{
+    m_mipmaps         = enabled;
+    m_mipFilter       = filter;
+    m_mipSrgbChannels = srgbChannels;
+}
+
+
+// Zero without mipmaps, so the cache entries of a single level bake stay distinct from every chain
+uint32_t TextureCompressor::getMipSettings() const
+{
+    return m_mipmaps ? (1u | uint32_t(m_mipFilter) << 8 | m_mipSrgbChannels << 16) : 0u;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::loadDds()
+//
+//    Reads an uncompressed RGB/RGBA .dds file (the format of the NV*.dds
+//    animation frames) and expands it to RGBA8.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool TextureCompressor::loadDds(const std::string& path, Image& image)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if(!file)
+    {
+        return false;
+    }
+
+    uint32_t header[32];
+    if(!file.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != 0x20534444 || header[1] != 124)
+    {
+        return false;
+    }
+
+    const uint32_t pixelFlags = header[20];
+    const uint32_t bitCount   = header[22];
+    const uint32_t masks[4]   = { header[23], header[24], header[25], (pixelFlags & 0x1) ? header[26] : 0u };
+    if((pixelFlags & 0x40) == 0 || (bitCount != 24 && bitCount != 32))
+    {
+        return false; // only uncompressed DDPF_RGB surfaces are supported
+    }
+
+    image.m_height = int32_t(header[3]);
+    image.m_width  = int32_t(header[4]);
+    const size_t bytesPerPixel = bitCount / 8;
+    const size_t pitch         = size_t(image.m_width) * bytesPerPixel;
+
+    std::vector<uint8_t> texels(pitch * image.m_height);
+    if(texels.empty() || !file.read(reinterpret_cast<char*>(&texels[0]), texels.size()))
+    {
+        return false;
+    }
+
+    int32_t shifts[4];
+    for(int32_t c = 0; c < 4; c++)
+    {
+        shifts[c] = maskShift(masks[c]);
+    }
+
+    image.m_rgba.resize(size_t(image.m_width) * image.m_height * 4);
+    for(int32_t y = 0; y < image.m_height; y++)
+    {
+        const uint8_t* src = &texels[pitch * y];
+        uint8_t*       dst = &image.m_rgba[size_t(y) * image.m_width * 4];
+        for(int32_t x = 0; x < image.m_width; x++, src += bytesPerPixel, dst += 4)
+        {
+            uint32_t texel = uint32_t(src[0]) | uint32_t(src[1]) << 8 | uint32_t(src[2]) << 16 | (bytesPerPixel == 4 ? uint32_t(src[3]) << 24 : 0u);
+            for(int32_t c = 0; c < 4; c++)
+            {
+                dst[c] = masks[c] ? uint8_t((texel & masks[c]) >> shifts[c]) : 255;
+            }
+        }
+    }
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::compressBC1Block()
+//
+//    Bounding box BC1 encoder (van Waveren, "Real-Time DXT Compression").
+//    The min/max search is done with SSE2 where available; the indices are
+//    chosen by projecting each texel onto the endpoint axis.
+//
+////////////////////////////////////////////////////////////////////////////////
+void TextureCompressor::compressBC1Block(const uint8_t* rgba, int32_t stride, uint8_t* out)
+{
+    uint8_t minColor[4], maxColor[4];
+
+#ifdef TEXTURE_COMPRESSOR_SSE2
+    __m128i rows[4];
+    for(int32_t y = 0; y < 4; y++)
+    {
+        rows[y] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + y * stride));
+    }
+    __m128i lo = _mm_min_epu8(_mm_min_epu8(rows[0], rows[1]), _mm_min_epu8(rows[2], rows[3]));
+    __m128i hi = _mm_max_epu8(_mm_max_epu8(rows[0], rows[1]), _mm_max_epu8(rows[2], rows[3]));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 8));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 8));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+    uint32_t packedMin = uint32_t(_mm_cvtsi128_si32(lo));
+    uint32_t packedMax = uint32_t(_mm_cvtsi128_si32(hi));
+    memcpy(minColor, &packedMin, 4);
+    memcpy(maxColor, &packedMax, 4);
+#else
+    memset(minColor, 255, 4);
+    memset(maxColor, 0, 4);
+    for(int32_t y = 0; y < 4; y++)
+    {
+        for(int32_t i = 0; i < 16; i++)
+        {
+            minColor[i & 3] = std::min(minColor[i & 3], rgba[y * stride + i]);
+            maxColor[i & 3] = std::max(maxColor[i & 3], rgba[y * stride + i]);
+        }
+    }
+#endif
+
+    // Inset the bounding box by 1/16th of its size to reduce the error at the extremes
+    for(int32_t c = 0; c < 3; c++)
+    {
+        int32_t inset = (maxColor[c] - minColor[c]) >> 4;
+        minColor[c] = uint8_t(minColor[c] + inset);
+        maxColor[c] = uint8_t(maxColor[c] - inset);
+    }
+
+    uint16_t color0 = packRGB565(maxColor[0], maxColor[1], maxColor[2]);
+    uint16_t color1 = packRGB565(minColor[0], minColor[1], minColor[2]);
+    uint32_t indices = 0;
+
+    if(color0 < color1)
+    {
+        std::swap(color0, color1);
+    }
+
+    if(color0 != color1)
+    {
+        int32_t c0[3], c1[3], dir[3];
+        unpackRGB565(color0, c0);
+        unpackRGB565(color1, c1);
+        dir[0] = c0[0] - c1[0];
+        dir[1] = c0[1] - c1[1];
+        dir[2] = c0[2] - c1[2];
+        const int32_t lengthSq = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+
+        // Position along c1 -> c0 in thirds, mapped to the BC1 palette order {c0, c1, 2/3 c0, 1/3 c0}
+        static const uint32_t remap[4] = { 1, 3, 2, 0 };
+        for(int32_t i = 0; i < 16; i++)
+        {
+            const uint8_t* p = rgba + (i >> 2) * stride + (i & 3) * 4;
+            int32_t dot = (p[0] - c1[0]) * dir[0] + (p[1] - c1[1]) * dir[1] + (p[2] - c1[2]) * dir[2];
+            int32_t t   = (dot * 3 + lengthSq / 2) / lengthSq;
+            t = std::max(0, std::min(3, t));
+            indices |= remap[t] << (i * 2);
+        }
+    }
+
+    out[0] = uint8_t(color0);
+    out[1] = uint8_t(color0 >> 8);
+    out[2] = uint8_t(color1);
+    out[3] = uint8_t(color1 >> 8);
+    out[4] = uint8_t(indices);
+    out[5] = uint8_t(indices >> 8);
+    out[6] = uint8_t(indices >> 16);
+    out[7] = uint8_t(indices >> 24);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::compressBC4Block()
+//
+//    Encodes one channel of a 4x4 RGBA block in the 8 value BC4 mode
+//
+////////////////////////////////////////////////////////////////////////////////
+void TextureCompressor::compressBC4Block(const uint8_t* rgba, int32_t stride, int32_t channel, uint8_t* out)
+{
+    uint8_t values[16];
+    for(int32_t i = 0; i < 16; i++)
+    {
+        values[i] = rgba[(i >> 2) * stride + (i & 3) * 4 + channel];
+    }
+
+#ifdef TEXTURE_COMPRESSOR_SSE2
+    __m128i v  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+    __m128i lo = _mm_min_epu8(v, _mm_srli_si128(v, 8));
+    __m128i hi = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 4));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 4));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 2));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 2));
+    lo = _mm_min_epu8(lo, _mm_srli_si128(lo, 1));
+    hi = _mm_max_epu8(hi, _mm_srli_si128(hi, 1));
+    const int32_t minValue = _mm_cvtsi128_si32(lo) & 0xFF;
+    const int32_t maxValue = _mm_cvtsi128_si32(hi) & 0xFF;
+#else
+    int32_t minValue = 255, maxValue = 0;
+    for(int32_t i = 0; i < 16; i++)
+    {
+        minValue = std::min<int32_t>(minValue, values[i]);
+        maxValue = std::max<int32_t>(maxValue, values[i]);
+    }
+#endif
+
+    uint64_t indices = 0;
+    if(maxValue != minValue)
+    {
+        // Position along min -> max in sevenths, mapped to the BC4 palette order {a0, a1, 6/7 a0, ..., 1/7 a0}
+        const int32_t range = maxValue - minValue;
+        for(int32_t i = 0; i < 16; i++)
+        {
+            int32_t t = ((values[i] - minValue) * 7 + range / 2) / range;
+            uint64_t index = (t == 7) ? 0 : (t == 0) ? 1 : uint64_t(8 - t);
+            indices |= index << (i * 3);
+        }
+    }
+
+    out[0] = uint8_t(maxValue);
+    out[1] = uint8_t(minValue);
+    for(int32_t i = 0; i < 6; i++)
+    {
+        out[2 + i] = uint8_t(indices >> (i * 8));
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::decodeBC1()
+//
+//    Decodes BC1 blocks back to RGBA8; used for the quality metrics
+//
+////////////////////////////////////////////////////////////////////////////////
+void TextureCompressor::decodeBC1(const uint8_t* blocks, int32_t width, int32_t height, uint8_t* rgba)
+{
+    const int32_t blocksX = (width + 3) / 4;
+    for(int32_t by = 0; by < (height + 3) / 4; by++)
+    {
+        for(int32_t bx = 0; bx < blocksX; bx++, blocks += 8)
+        {
+            uint16_t color0 = uint16_t(blocks[0] | blocks[1] << 8);
+            uint16_t color1 = uint16_t(blocks[2] | blocks[3] << 8);
+            uint32_t indices = uint32_t(blocks[4]) | uint32_t(blocks[5]) << 8 | uint32_t(blocks[6]) << 16 | uint32_t(blocks[7]) << 24;
+
+            int32_t palette[4][4];
+            unpackRGB565(color0, palette[0]);
+            unpackRGB565(color1, palette[1]);
+            palette[0][3] = palette[1][3] = palette[2][3] = 255;
+            for(int32_t c = 0; c < 3; c++)
+            {
+                if(color0 > color1)
+                {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+                else
+                {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                    palette[3][c] = 0;
+                }
+            }
+            palette[3][3] = (color0 > color1) ? 255 : 0;
+
+            for(int32_t i = 0; i < 16; i++)
+            {
+                int32_t x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+                if(x < width && y < height)
+                {
+                    const int32_t* p = palette[(indices >> (i * 2)) & 3];
+                    uint8_t* dst = &rgba[(size_t(y) * width + x) * 4];
+                    dst[0] = uint8_t(p[0]); dst[1] = uint8_t(p[1]); dst[2] = uint8_t(p[2]); dst[3] = uint8_t(p[3]);
+                }
+            }
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::decodeBC4()
+//
+//    Decodes BC4 blocks to one byte per texel
+//
+////////////////////////////////////////////////////////////////////////////////
+void TextureCompressor::decodeBC4(const uint8_t* blocks, int32_t width, int32_t height, uint8_t* values)
+{
+    const int32_t blocksX = (width + 3) / 4;
+    for(int32_t by = 0; by < (height + 3) / 4; by++)
+    {
+        for(int32_t bx = 0; bx < blocksX; bx++, blocks += 8)
+        {
+            int32_t palette[8];
+            palette[0] = blocks[0];
+            palette[1] = blocks[1];
+            for(int32_t i = 2; i < 8; i++)
+            {
+                palette[i] = (palette[0] > palette[1]) ? ((8 - i) * palette[0] + (i - 1) * palette[1]) / 7
+                           : (i < 6) ? ((6 - i) * palette[0] + (i - 1) * palette[1]) / 5
+                           : (i == 6) ? 0 : 255;
+            }
+
+            uint64_t indices = 0;
+            for(int32_t i = 0; i < 6; i++)
+            {
+                indices |= uint64_t(blocks[2 + i]) << (i * 8);
+            }
+
+            for(int32_t i = 0; i < 16; i++)
+            {
+                int32_t x = bx * 4 + (i & 3), y = by * 4 + (i >> 2);
+                if(x < width && y < height)
+                {
+                    values[size_t(y) * width + x] = uint8_t(palette[(indices >> (i * 3)) & 7]);
+                }
+            }
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::computePsnr()
+//
+//    Peak signal to noise ratio over the first 'channels' bytes of 'count'
+//    texels. Identical inputs report 99 dB.
+//
+////////////////////////////////////////////////////////////////////////////////
+float TextureCompressor::computePsnr(const uint8_t* a, int32_t strideA, const uint8_t* b, int32_t strideB, int32_t count, int32_t channels)
+{
+    uint64_t squaredError = 0;
+    for(int32_t i = 0; i < count; i++)
+    {
+        for(int32_t c = 0; c < channels; c++)
+        {
+            int32_t d = int32_t(a[i * strideA + c]) - int32_t(b[i * strideB + c]);
+            squaredError += uint64_t(d * d);
+        }
+    }
+
+    if(squaredError == 0)
+    {
+        return 99.0f;
+    }
+    double mse = double(squaredError) / double(count * channels);
+    return float(10.0 * log10(255.0 * 255.0 / mse));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::hashBytes()
+//
+//    64 bit FNV-1a
+//
+////////////////////////////////////////////////////////////////////////////////
+uint64_t TextureCompressor::hashBytes(const uint8_t* data, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < size; i++)
+    {
+        hash ^= data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::compressFrame()
+//
+//    Compresses a whole frame to BC1 + BC4 and measures the quality loss
+//
+////////////////////////////////////////////////////////////////////////////////
+void TextureCompressor::compressFrame(const Image& image, CompressedFrame& frame)
+{
+    const int32_t blocksX = (image.m_width + 3) / 4;
+    const int32_t blocksY = (image.m_height + 3) / 4;
+
+    frame.m_width  = image.m_width;
+    frame.m_height = image.m_height;
+    frame.m_bc1.resize(blockBytes(image.m_width, image.m_height, 8));
+    frame.m_bc4.resize(blockBytes(image.m_width, image.m_height, 8));
+
+    uint8_t block[64];
+    for(int32_t by = 0; by < blocksY; by++)
+    {
+        for(int32_t bx = 0; bx < blocksX; bx++)
+        {
+            size_t offset = (size_t(by) * blocksX + bx) * 8;
+            gatherBlock(&image.m_rgba[0], image.m_width, image.m_height, bx, by, block);
+            compressBC1Block(block, 16, &frame.m_bc1[offset]);
+            compressBC4Block(block, 16, DisplacementChannel, &frame.m_bc4[offset]);
+        }
+    }
+
+    const int32_t texelCount = image.m_width * image.m_height;
+    std::vector<uint8_t> decoded(size_t(texelCount) * 4);
+    decodeBC1(&frame.m_bc1[0], image.m_width, image.m_height, &decoded[0]);
+    frame.m_psnrBC1 = computePsnr(&image.m_rgba[0], 4, &decoded[0], 4, texelCount, 3);
+    decodeBC4(&frame.m_bc4[0], image.m_width, image.m_height, &decoded[0]);
+    frame.m_psnrBC4 = computePsnr(&image.m_rgba[DisplacementChannel], 4, &decoded[0], 1, texelCount, 1);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::compressMips()
+//
+//    *** INTERESTING ***
+//    The chain is filtered from the RGBA source, not from the BC1 base level,
+//    so the block artifacts of one level are not averaged into the next.
+//
+////////////////////////////////////////////////////////////////////////////////
+void TextureCompressor::compressMips(const Image& image, MipGenerator::Filter filter, uint32_t srgbChannels, CompressedFrame& frame)
+{
+    std::vector<MipGenerator::Level> levels;
+    MipGenerator::generateChain(&image.m_rgba[0], image.m_width, image.m_height, filter, srgbChannels, levels);
+
+    frame.m_mipLevels = int32_t(levels.size()) + 1;
+    frame.m_bc1Mips.resize(mipChainBytes(image.m_width, image.m_height, frame.m_mipLevels, 8));
+
+    uint8_t block[64];
+    size_t  offset = 0;
+    for(size_t l = 0; l < levels.size(); l++)
+    {
+        const MipGenerator::Level& level = levels[l];
+        for(int32_t by = 0; by < (level.m_height + 3) / 4; by++)
+        {
+            for(int32_t bx = 0; bx < (level.m_width + 3) / 4; bx++, offset += 8)
+            {
+                gatherBlock(&level.m_rgba[0], level.m_width, level.m_height, bx, by, block);
+                compressBC1Block(block, 16, &frame.m_bc1Mips[offset]);
+            }
+        }
+    }
+}
+
+
+size_t TextureCompressor::mipChainBytes(int32_t width, int32_t height, int32_t levels, int32_t bytesPerBlock)
+{
+    size_t bytes = 0;
+    for(int32_t l = 1; l < levels; l++)
+    {
+        bytes += blockBytes(MipGenerator::getLevelSize(width, l), MipGenerator::getLevelSize(height, l), bytesPerBlock);
+    }
+    return bytes;
+}
+
+
+void TextureCompressor::compress(const Image& image, CompressedFrame& frame) const
+{
+    compressFrame(image, frame);
+    frame.m_mipLevels = 1;
+    frame.m_bc1Mips.clear();
+    if(m_mipmaps)
+    {
+        compressMips(image, m_mipFilter, m_mipSrgbChannels, frame);
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::readCache()
+//
+////////////////////////////////////////////////////////////////////////////////
+bool TextureCompressor::readCache(const std::string& path, uint64_t sourceHash, uint32_t mipSettings, CompressedFrame& frame)
+{
+    std::ifstream file(path.c_str(), std::ios::binary);
+    CacheHeader header;
+    if(!file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    {
+        return false;
+    }
+
+    if(header.magic != CacheMagic || header.version != CacheVersion || header.sourceHash != sourceHash ||
+       header.bc1Size != blockBytes(header.width, header.height, 8) || header.bc4Size != blockBytes(header.width, header.height, 8) ||
+       header.mipSettings != mipSettings || header.mipLevels != (mipSettings ? MipGenerator::getLevelCount(header.width, header.height) : 1) ||
+       header.mipBytes != mipChainBytes(header.width, header.height, header.mipLevels, 8))
+    {
+        return false;
+    }
+
+    frame.m_width      = header.width;
+    frame.m_height     = header.height;
+    frame.m_sourceHash = header.sourceHash;
+    frame.m_psnrBC1    = header.psnrBC1;
+    frame.m_psnrBC4    = header.psnrBC4;
+    frame.m_mipLevels  = header.mipLevels;
+    frame.m_bc1.resize(header.bc1Size);
+    frame.m_bc4.resize(header.bc4Size);
+    frame.m_bc1Mips.resize(header.mipBytes);
+    return file.read(reinterpret_cast<char*>(&frame.m_bc1[0]), header.bc1Size) &&
+           file.read(reinterpret_cast<char*>(&frame.m_bc4[0]), header.bc4Size) &&
+           (header.mipBytes == 0 || file.read(reinterpret_cast<char*>(&frame.m_bc1Mips[0]), header.mipBytes));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::writeCache()
+//
+//    Writes to a temporary file and renames it into place so a crash or a
+//    second instance never sees a partially written entry.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool TextureCompressor::writeCache(const std::string& path, uint32_t mipSettings, const CompressedFrame& frame)
+{
+    CacheHeader header;
+    header.magic      = CacheMagic;
+    header.version    = CacheVersion;
+    header.width      = frame.m_width;
+    header.height     = frame.m_height;
+    header.sourceHash = frame.m_sourceHash;
+    header.bc1Size    = uint32_t(frame.m_bc1.size());
+    header.bc4Size    = uint32_t(frame.m_bc4.size());
+    header.psnrBC1    = frame.m_psnrBC1;
+    header.psnrBC4    = frame.m_psnrBC4;
+    header.mipSettings = mipSettings;
+    header.mipLevels   = frame.m_mipLevels;
+    header.mipBytes    = uint32_t(frame.m_bc1Mips.size());
+
+    return writeFileAtomic(path, [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&frame.m_bc1[0]), frame.m_bc1.size());
+        file.write(reinterpret_cast<const char*>(&frame.m_bc4[0]), frame.m_bc4.size());
+        if(!frame.m_bc1Mips.empty())
+        {
+            file.write(reinterpret_cast<const char*>(&frame.m_bc1Mips[0]), frame.m_bc1Mips.size());
+        }
+    });
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::bake()
+//
+//    Loads the source frames and fills 'frames' with their compressed form.
+//    Frames with a valid cache entry are read back; the rest are compressed,
+//    mip chain included, as JobSystem jobs and written to the cache.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool TextureCompressor::bake(const std::vector<std::string>& sourcePaths, const std::string& cacheDir, std::vector<CompressedFrame>& frames)
+{
+    const int32_t frameCount = int32_t(sourcePaths.size());
+    std::vector<Image>   images(frameCount);
+    std::vector<int32_t> misses;
+    std::atomic<bool>    failed(false);
+
+    memset(&m_stats, 0, sizeof(m_stats));
+    m_stats.m_frameCount  = frameCount;
+    m_stats.m_threadCount = int32_t(m_jobs.getThreadCount());
+    frames.assign(frameCount, CompressedFrame());
+
+    // Load and hash the sources in parallel, then check the cache
+    m_jobs.parallelFor(uint32_t(frameCount), 1, [&](uint32_t begin, uint32_t end)
+    {
+        for(uint32_t i = begin; i < end; i++)
+        {
+            if(!loadDds(sourcePaths[i], images[i]))
+            {
+                ci::app::console() << "TextureCompressor: failed to load " << sourcePaths[i] << std::endl;
+                failed = true;
+                continue;
+            }
+            frames[i].m_sourceHash = hashBytes(&images[i].m_rgba[0], images[i].m_rgba.size());
+        }
+    });
+    if(failed)
+    {
+        return false;
+    }
+
+    for(int32_t i = 0; i < frameCount; i++)
+    {
+        if(!cacheDir.empty() && readCache(cachePathFor(cacheDir, sourcePaths[i]), frames[i].m_sourceHash, getMipSettings(), frames[i]))
+        {
+            m_stats.m_cacheHits++;
+        }
+        else
+        {
+            misses.push_back(i);
+        }
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    m_jobs.parallelFor(uint32_t(misses.size()), 1, [&](uint32_t begin, uint32_t end)
+    {
+        for(uint32_t m = begin; m < end; m++)
+        {
+            const int32_t i = misses[m];
+            compress(images[i], frames[i]);
+            if(!cacheDir.empty() && !writeCache(cachePathFor(cacheDir, sourcePaths[i]), getMipSettings(), frames[i]))
+            {
+                ci::app::console() << "TextureCompressor: failed to write cache entry for " << sourcePaths[i] << std::endl;
+            }
+        }
+    });
+    m_stats.m_compressSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+    m_stats.m_minPsnrBC1 = m_stats.m_minPsnrBC4 = 99.0f;
+    for(int32_t i = 0; i < frameCount; i++)
+    {
+        m_stats.m_sourceBytes     += uint64_t(frames[i].m_width) * frames[i].m_height * 4;
+        m_stats.m_compressedBytes += frames[i].m_bc1.size() + frames[i].m_bc4.size() + frames[i].m_bc1Mips.size();
+        m_stats.m_mipBytes        += frames[i].m_bc1Mips.size();
+        m_stats.m_minPsnrBC1       = std::min(m_stats.m_minPsnrBC1, frames[i].m_psnrBC1);
+        m_stats.m_minPsnrBC4       = std::min(m_stats.m_minPsnrBC4, frames[i].m_psnrBC4);
+        m_stats.m_avgPsnrBC1      += frames[i].m_psnrBC1 / float(frameCount);
+        m_stats.m_avgPsnrBC4      += frames[i].m_psnrBC4 / float(frameCount);
+    }
+    return true;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureCompressor::benchmark()
+//
+//    Reports compression throughput (source RGBA MB/s, mip chains included) for
+//    increasing thread counts, each on a JobSystem of its own; one thread runs
+//    the frames in a plain loop on the caller
+//
+////////////////////////////////////////////////////////////////////////////////
+void TextureCompressor::benchmark(const std::vector<Image>& images, int32_t iterations) const
+{
+    if(images.empty())
+    {
+        return;
+    }
+
+    double sourceMB = 0.0;
+    for(size_t i = 0; i < images.size(); i++)
+    {
+        sourceMB += double(images[i].m_rgba.size()) / (1024.0 * 1024.0);
+    }
+
+    std::vector<CompressedFrame> frames(images.size());
+    const uint32_t threadCount = m_jobs.getThreadCount();
+    for(uint32_t threads = 1; ; threads = std::min(threads * 2, threadCount))
+    {
+        std::unique_ptr<JobSystem> jobs(threads > 1 ? new JobSystem(threads) : nullptr);
+        double best = 1e30;
+        for(int32_t it = 0; it < iterations; it++)
+        {
+            auto start = std::chrono::high_resolution_clock::now();
+            if(jobs)
+            {
+                jobs->parallelFor(uint32_t(images.size()), 1, [&](uint32_t begin, uint32_t end)
+                {
+                    for(uint32_t i = begin; i < end; i++)
+                    {
+                        compress(images[i], frames[i]);
+                    }
+                });
+            }
+            else
+            {
+                for(size_t i = 0; i < images.size(); i++)
+                {
+                    compress(images[i], frames[i]);
+                }
+            }
+            best = std::min(best, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count());
+        }
+        ci::app::console() << "TextureCompressor benchmark: " << threads << " threads, " << images.size() << " frames, "
+                           << best * 1000.0 << " ms, " << sourceMB / best << " MB/s" << std::endl;
+        if(threads == threadCount)
+        {
+            break;
+        }
+    }
+}
@@ -0,0 +1,110 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/TextureCompressor.h
+//
+// CPU block compression of the animation frames. Color goes to BC1 (DXT1) and the
+// displacement channel the vertex shader samples goes to BC4 (RGTC1), cutting the
+// 40 KB RGBA frames down to 5 KB each. The color texture also gets a BC1 mip chain,
+// filtered on the CPU by MipGenerator; the vertex shader only reads the base level
+// of the displacement, so that one stays a single level. Results are cached on disk
+// next to the app.
+//----------------------------------------------------------------------------------
+#ifndef TEXTURE_COMPRESSOR_H
+#define TEXTURE_COMPRESSOR_H
+
+#include "JobSystem.h"
+#include "MipGenerator.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TextureCompressor
+{
+public:
+    // Uncompressed source frame, always expanded to RGBA8
+    struct Image
+    {
+        int32_t              m_width;
+        int32_t              m_height;
+        std::vector<uint8_t> m_rgba;
+
+        Image() : m_width(0), m_height(0) {}
+    };
+
+    // One baked frame: BC1 color blocks plus BC4 displacement blocks
+    struct CompressedFrame
+    {
+        int32_t              m_width;
+        int32_t              m_height;
+        uint64_t             m_sourceHash;      // hash of the source texels, used to validate the cache
+        std::vector<uint8_t> m_bc1;
+        std::vector<uint8_t> m_bc4;
+        int32_t              m_mipLevels;       // of the color texture, including the base
+        std::vector<uint8_t> m_bc1Mips;         // BC1 levels 1 .. m_mipLevels - 1, back to back
+        float                m_psnrBC1;         // dB vs source RGB
+        float                m_psnrBC4;         // dB vs source displacement channel
+
+        CompressedFrame() : m_width(0), m_height(0), m_sourceHash(0), m_mipLevels(1), m_psnrBC1(0.0f), m_psnrBC4(0.0f) {}
+    };
+
+    struct Stats
+    {
+        int32_t  m_frameCount;
+        int32_t  m_cacheHits;
+        int32_t  m_threadCount;
+        uint64_t m_sourceBytes;                 // RGBA8 bytes the frames would occupy on the GPU
+        uint64_t m_compressedBytes;             // BC1 + BC4 bytes, mip levels included
+        uint64_t m_mipBytes;                    // BC1 bytes below the base level
+        double   m_compressSeconds;             // wall time spent compressing (cache misses only)
+        float    m_minPsnrBC1;
+        float    m_avgPsnrBC1;
+        float    m_minPsnrBC4;
+        float    m_avgPsnrBC4;
+    };
+
+    static const int32_t DisplacementChannel = 1; // the vertex shader displaces by .g
+
+    // Frames are loaded and compressed as jobs on the given JobSystem
+    explicit TextureCompressor(JobSystem& jobs);
+
+    // Color mip chain settings, part of the cache key; mipmaps are on (Kaiser, sRGB color) by default
+    void setMipmaps(bool enabled, MipGenerator::Filter filter, uint32_t srgbChannels);
+
+    // Loads every source frame, compressing the ones whose cache entry is missing or stale.
+    // cacheDir may be empty to disable the on-disk cache.
+    bool bake(const std::vector<std::string>& sourcePaths, const std::string& cacheDir, std::vector<CompressedFrame>& frames);
+
+    // Times compression of the given frames with 1..jobs.getThreadCount() threads and prints MB/s per thread count
+    void benchmark(const std::vector<Image>& images, int32_t iterations) const;
+
+    const Stats& getStats() const { return m_stats; }
+
+    // Building blocks, exposed for tools and the benchmark
+    static bool     loadDds(const std::string& path, Image& image);
+    static void     compressFrame(const Image& image, CompressedFrame& frame);
+    static void     compressMips(const Image& image, MipGenerator::Filter filter, uint32_t srgbChannels, CompressedFrame& frame);
+    static void     compressBC1Block(const uint8_t* rgba, int32_t stride, uint8_t* out);
+    static void     compressBC4Block(const uint8_t* rgba, int32_t stride, int32_t channel, uint8_t* out);
+    static void     decodeBC1(const uint8_t* blocks, int32_t width, int32_t height, uint8_t* rgba);
+    static void     decodeBC4(const uint8_t* blocks, int32_t width, int32_t height, uint8_t* values);
+    static float    computePsnr(const uint8_t* a, int32_t strideA, const uint8_t* b, int32_t strideB, int32_t count, int32_t channels);
+    static uint64_t hashBytes(const uint8_t* data, size_t size);
+
+    static size_t   blockBytes(int32_t width, int32_t height, int32_t bytesPerBlock) { return size_t((width + 3) / 4) * size_t((height + 3) / 4) * bytesPerBlock; }
+    // Levels 1 .. levels - 1
+    static size_t   mipChainBytes(int32_t width, int32_t height, int32_t levels, int32_t bytesPerBlock);
+
+private:
+    static bool     readCache(const std::string& path, uint64_t sourceHash, uint32_t mipSettings, CompressedFrame& frame);
+    static bool     writeCache(const std::string& path, uint32_t mipSettings, const CompressedFrame& frame);
+
+    uint32_t        getMipSettings() const;
+    void            compress(const Image& image, CompressedFrame& frame) const;
+
+    JobSystem&      m_jobs;
+    bool            m_mipmaps;
+    MipGenerator::Filter m_mipFilter;
+    uint32_t        m_mipSrgbChannels;
+    Stats           m_stats;
+};
+
+#endif
@@ -0,0 +1,210 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/TextureResidency.cpp
+//----------------------------------------------------------------------------------
+#include "TextureResidency.h"
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <cstring>
+
+
+void GLResidencyBackend::makeResident(const GLuint64EXT* handles, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        glMakeTextureHandleResidentNV(handles[i]);
+    }
+    MemoryTracker::addResidentHandles(MemoryTracker::SubsystemTextures, int32_t(count));
+}
+
+void GLResidencyBackend::makeNonResident(const GLuint64EXT* handles, size_t count)
+{
+    for(size_t i = 0; i < count; i++)
+    {
+        glMakeTextureHandleNonResidentNV(handles[i]);
+    }
+    MemoryTracker::addResidentHandles(MemoryTracker::SubsystemTextures, -int32_t(count));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureResidencyManager::TextureResidencyManager()
+//
+////////////////////////////////////////////////////////////////////////////////
+TextureResidencyManager::TextureResidencyManager(ResidencyBackend& backend, int32_t windowBehind, int32_t windowAhead, uint64_t budgetBytes)
+    : m_backend(backend)
+    , m_windowBehind(windowBehind)
+    , m_windowAhead(windowAhead)
+    , m_budgetBytes(budgetBytes)
+    , m_frameIndex(0)
+{
+    memset(&m_frameCounters, 0, sizeof(m_frameCounters));
+    memset(&m_totalCounters, 0, sizeof(m_totalCounters));
+}
+
+TextureResidencyManager::~TextureResidencyManager()
+{
+    releaseAll();
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureResidencyManager::addEntry()
+//
+////////////////////////////////////////////////////////////////////////////////
+int32_t TextureResidencyManager::addEntry(const GLuint64EXT* handles, uint32_t handleCount, uint64_t bytes)
+{
+    Entry entry;
+    entry.m_firstHandle = uint32_t(m_handles.size());
+    entry.m_handleCount = handleCount;
+    entry.m_bytes       = bytes;
+    entry.m_lastUsed    = 0;
+    entry.m_resident    = false;
+    entry.m_needed      = false;
+
+    m_handles.insert(m_handles.end(), handles, handles + handleCount);
+    m_entries.push_back(entry);
+    return int32_t(m_entries.size()) - 1;
+}
+
+
+void TextureResidencyManager::touch(int32_t entry)
+{
+    m_entries[entry].m_needed = true;
+}
+
+
+void TextureResidencyManager::queue(std::vector<GLuint64EXT>& batch, const Entry& entry)
+{
+    batch.insert(batch.end(), m_handles.begin() + entry.m_firstHandle, m_handles.begin() + entry.m_firstHandle + entry.m_handleCount);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureResidencyManager::update()
+//
+//    Needed entries (window + touched) are always made resident, even if that
+//    alone exceeds the budget. Other resident entries are evicted least
+//    recently used first until the resident bytes fit in the budget.
+//
+////////////////////////////////////////////////////////////////////////////////
+void TextureResidencyManager::update(int32_t currentFrame)
+{
+    const int32_t entryCount = int32_t(m_entries.size());
+    if(entryCount == 0)
+    {
+        return;
+    }
+
+    m_frameIndex++;
+    memset(&m_frameCounters, 0, sizeof(m_frameCounters));
+    m_makeResident.clear();
+    m_makeNonResident.clear();
+    m_evictionCandidates.clear();
+
+    // Pin the window; the animation loops so the window wraps around
+    const int32_t windowSize = std::min(m_windowBehind + m_windowAhead + 1, entryCount);
+    for(int32_t i = 0; i < windowSize; i++)
+    {
+        int32_t entry = ((currentFrame - m_windowBehind + i) % entryCount + entryCount) % entryCount;
+        m_entries[entry].m_needed = true;
+    }
+
+    uint64_t residentBytes = 0;
+    for(int32_t i = 0; i < entryCount; i++)
+    {
+        Entry& entry = m_entries[i];
+        if(entry.m_needed)
+        {
+            entry.m_lastUsed = m_frameIndex;
+            if(entry.m_resident)
+            {
+                m_frameCounters.m_hits++;
+            }
+            else
+            {
+                m_frameCounters.m_misses++;
+                entry.m_resident = true;
+                queue(m_makeResident, entry);
+            }
+        }
+        else if(entry.m_resident)
+        {
+            m_evictionCandidates.push_back(i);
+        }
+
+        if(entry.m_resident)
+        {
+            residentBytes += entry.m_bytes;
+        }
+        entry.m_needed = false;
+    }
+
+    // Evict the least recently used unpinned entries until we are back under budget
+    if(residentBytes > m_budgetBytes)
+    {
+        std::sort(m_evictionCandidates.begin(), m_evictionCandidates.end(), [this](int32_t a, int32_t b)
+        {
+            return m_entries[a].m_lastUsed < m_entries[b].m_lastUsed;
+        });
+
+        for(size_t i = 0; i < m_evictionCandidates.size() && residentBytes > m_budgetBytes; i++)
+        {
+            Entry& entry = m_entries[m_evictionCandidates[i]];
+            entry.m_resident = false;
+            residentBytes -= entry.m_bytes;
+            queue(m_makeNonResident, entry);
+            m_frameCounters.m_evictions++;
+        }
+    }
+
+    // Issue the frame's changes as two batches; evict first to keep the peak down
+    if(!m_makeNonResident.empty())
+    {
+        m_backend.makeNonResident(&m_makeNonResident[0], m_makeNonResident.size());
+    }
+    if(!m_makeResident.empty())
+    {
+        m_backend.makeResident(&m_makeResident[0], m_makeResident.size());
+    }
+
+    m_frameCounters.m_residentBytes = residentBytes;
+    for(int32_t i = 0; i < entryCount; i++)
+    {
+        m_frameCounters.m_residentCount += m_entries[i].m_resident ? 1 : 0;
+    }
+
+    m_totalCounters.m_hits         += m_frameCounters.m_hits;
+    m_totalCounters.m_misses       += m_frameCounters.m_misses;
+    m_totalCounters.m_evictions    += m_frameCounters.m_evictions;
+    m_totalCounters.m_residentCount = m_frameCounters.m_residentCount;
+    m_totalCounters.m_residentBytes = m_frameCounters.m_residentBytes;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TextureResidencyManager::releaseAll()
+//
+////////////////////////////////////////////////////////////////////////////////
+void TextureResidencyManager::releaseAll()
+{
+    m_makeNonResident.clear();
+    for(size_t i = 0; i < m_entries.size(); i++)
+    {
+        if(m_entries[i].m_resident)
+        {
+            m_entries[i].m_resident = false;
+            queue(m_makeNonResident, m_entries[i]);
+        }
+    }
+
+    if(!m_makeNonResident.empty())
+    {
+        m_backend.makeNonResident(&m_makeNonResident[0], m_makeNonResident.size());
+    }
+    m_frameCounters.m_residentCount = m_totalCounters.m_residentCount = 0;
+    m_frameCounters.m_residentBytes = m_totalCounters.m_residentBytes = 0;
+}
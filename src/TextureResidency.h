@@ -0,0 +1,101 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/TextureResidency.h
+//
+// Keeps bindless texture handles resident only while they are needed: the frames
+// in a window around the current animation frame are pinned, everything else that
+// was recently used stays resident in LRU order until a byte budget is exceeded.
+// All residency changes are collected and handed to a ResidencyBackend once per
+// frame, so the policy can be driven by a mock backend without a GL context.
+//----------------------------------------------------------------------------------
+#ifndef TEXTURE_RESIDENCY_H
+#define TEXTURE_RESIDENCY_H
+
+#include "cinder/gl/gl.h"
+#include <cstddef>
+#include <vector>
+
+class ResidencyBackend
+{
+public:
+    virtual ~ResidencyBackend() {}
+
+    virtual void makeResident(const GLuint64EXT* handles, size_t count) = 0;
+    virtual void makeNonResident(const GLuint64EXT* handles, size_t count) = 0;
+};
+
+// Issues the batch through GL_NV_bindless_texture
+class GLResidencyBackend : public ResidencyBackend
+{
+public:
+    void makeResident(const GLuint64EXT* handles, size_t count) override;
+    void makeNonResident(const GLuint64EXT* handles, size_t count) override;
+};
+
+class TextureResidencyManager
+{
+public:
+    struct Counters
+    {
+        uint32_t m_hits;            // needed entries that were already resident
+        uint32_t m_misses;          // needed entries that had to be made resident
+        uint32_t m_evictions;       // entries made non-resident to stay under budget
+        uint32_t m_residentCount;
+        uint64_t m_residentBytes;
+    };
+
+    TextureResidencyManager(ResidencyBackend& backend, int32_t windowBehind, int32_t windowAhead, uint64_t budgetBytes);
+    ~TextureResidencyManager();
+
+    // Registers an entry (e.g. one animation frame) made of one or more handles sharing a lifetime.
+    // Returns the entry index; entries start out non-resident.
+    int32_t addEntry(const GLuint64EXT* handles, uint32_t handleCount, uint64_t bytes);
+
+    void    setWindow(int32_t windowBehind, int32_t windowAhead) { m_windowBehind = windowBehind; m_windowAhead = windowAhead; }
+    void    setBudget(uint64_t budgetBytes)                       { m_budgetBytes = budgetBytes; }
+    int32_t getWindowBehind() const                               { return m_windowBehind; }
+    int32_t getWindowAhead() const                                { return m_windowAhead; }
+
+    // Marks an entry outside the window as needed this frame
+    void    touch(int32_t entry);
+
+    // Pins the window around currentFrame (wrapping, since the animation loops), applies the
+    // budget and issues the batched residency changes. Call once per frame before drawing.
+    void    update(int32_t currentFrame);
+
+    // Makes everything non-resident, e.g. before the textures are destroyed
+    void    releaseAll();
+
+    bool    isResident(int32_t entry) const { return m_entries[entry].m_resident; }
+    int32_t getEntryCount() const           { return int32_t(m_entries.size()); }
+
+    const Counters& getFrameCounters() const { return m_frameCounters; }
+    const Counters& getTotalCounters() const { return m_totalCounters; }
+
+private:
+    struct Entry
+    {
+        uint32_t m_firstHandle;
+        uint32_t m_handleCount;
+        uint64_t m_bytes;
+        uint64_t m_lastUsed;        // m_frameIndex of the last frame this entry was needed
+        bool     m_resident;
+        bool     m_needed;          // in the window or touched this frame
+    };
+
+    void queue(std::vector<GLuint64EXT>& batch, const Entry& entry);
+
+    ResidencyBackend&        m_backend;
+    std::vector<Entry>       m_entries;
+    std::vector<GLuint64EXT> m_handles;
+    std::vector<GLuint64EXT> m_makeResident;     // batches, reused across frames
+    std::vector<GLuint64EXT> m_makeNonResident;
+    std::vector<int32_t>     m_evictionCandidates;
+    int32_t                  m_windowBehind;
+    int32_t                  m_windowAhead;
+    uint64_t                 m_budgetBytes;
+    uint64_t                 m_frameIndex;
+    Counters                 m_frameCounters;
+    Counters                 m_totalCounters;
+};
+
+#endif
@@ -0,0 +1,301 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/TransformHierarchy.cpp
+//----------------------------------------------------------------------------------
+#include "TransformHierarchy.h"
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TRANSFORM_HIERARCHY_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const float Identity[16] =
+    {
+        1.0f, 0.0f, 0.0f, 0.0f,
+        0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f,
+        0.0f, 0.0f, 0.0f, 1.0f,
+    };
+}
+
+
+TransformHierarchy::TransformHierarchy()
+    : m_pendingDirty(0)
+    , m_changedBegin(0)
+    , m_changedEnd(0)
+{
+}
+
+
+uint32_t TransformHierarchy::createNode(uint32_t parent)
+{
+    const uint32_t node = uint32_t(m_parent.size());
+    if(parent >= node)
+    {
+        parent = InvalidNode;
+    }
+
+    const uint32_t depth = (parent == InvalidNode) ? 0 : m_depth[parent] + 1;
+    m_parent.push_back(parent);
+    m_depth.push_back(depth);
+    m_dirty.push_back(1);
+    for(int32_t e = 0; e < 16; e++)
+    {
+        m_local[e].push_back(Identity[e]);
+        m_world[e].push_back(Identity[e]);
+    }
+    m_worldAoS.insert(m_worldAoS.end(), Identity, Identity + 16);
+
+    if(m_levelWork.size() <= depth)
+    {
+        m_levelWork.resize(depth + 1);
+    }
+    m_pendingDirty++;
+    return node;
+}
+
+
+void TransformHierarchy::clear()
+{
+    m_parent.clear();
+    m_depth.clear();
+    m_dirty.clear();
+    for(int32_t e = 0; e < 16; e++)
+    {
+        m_local[e].clear();
+        m_world[e].clear();
+    }
+    m_worldAoS.clear();
+    m_levelWork.clear();
+    m_pendingDirty = 0;
+    m_changedBegin = m_changedEnd = 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TransformHierarchy::setLocal()
+//
+//    *** INTERESTING ***
+//    Moving an object is 64 bytes written here and, after update(), 64 bytes
+//    uploaded per affected node; the vertex buffers are never touched.
+//
+////////////////////////////////////////////////////////////////////////////////
+void TransformHierarchy::setLocal(uint32_t node, const float* matrix)
+{
+    for(int32_t e = 0; e < 16; e++)
+    {
+        m_local[e][node] = matrix[e];
+    }
+    if(!m_dirty[node])
+    {
+        m_dirty[node] = 1;
+        m_pendingDirty++;
+    }
+}
+
+
+void TransformHierarchy::getLocal(uint32_t node, float* matrix) const
+{
+    for(int32_t e = 0; e < 16; e++)
+    {
+        matrix[e] = m_local[e][node];
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TransformHierarchy::update()
+//
+//    Parents precede their children, so one forward pass propagates the dirty
+//    flags. The dirty nodes are then bucketed by depth: every node of a level
+//    only depends on the level above, which is complete by then, so a level
+//    can be multiplied in batches of four in any order.
+//
+////////////////////////////////////////////////////////////////////////////////
+uint32_t TransformHierarchy::update()
+{
+    if(m_pendingDirty == 0)
+    {
+        return 0;
+    }
+
+    const uint32_t nodeCount = getNodeCount();
+    uint32_t first = nodeCount, last = 0, updated = 0;
+    for(uint32_t i = 0; i < nodeCount; i++)
+    {
+        const uint32_t parent = m_parent[i];
+        if(!m_dirty[i] && parent != InvalidNode && m_dirty[parent])
+        {
+            m_dirty[i] = 1;
+        }
+        if(m_dirty[i])
+        {
+            m_levelWork[m_depth[i]].push_back(i);
+            first = std::min(first, i);
+            last  = i;
+            updated++;
+        }
+    }
+
+    for(size_t level = 0; level < m_levelWork.size(); level++)
+    {
+        std::vector<uint32_t>& work = m_levelWork[level];
+        if(!work.empty())
+        {
+            multiplyBatch(&work[0], uint32_t(work.size()));
+            work.clear();
+        }
+    }
+
+    std::fill(m_dirty.begin(), m_dirty.end(), uint8_t(0));
+    m_pendingDirty = 0;
+
+    if(updated != 0)
+    {
+        m_changedBegin = (m_changedBegin == m_changedEnd) ? first : std::min(m_changedBegin, first);
+        m_changedEnd   = std::max(m_changedEnd, last + 1);
+    }
+    return updated;
+}
+
+
+bool TransformHierarchy::getChangedRange(uint32_t& firstNode, uint32_t& nodeCount) const
+{
+    firstNode = m_changedBegin;
+    nodeCount = m_changedEnd - m_changedBegin;
+    return nodeCount != 0;
+}
+
+
+void TransformHierarchy::clearChangedRange()
+{
+    m_changedBegin = m_changedEnd = 0;
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TransformHierarchy::multiplyOne()
+//
+//    world = parentWorld * local, column major
+//
+////////////////////////////////////////////////////////////////////////////////
+void TransformHierarchy::multiplyOne(uint32_t node)
+{
+    const uint32_t parent = m_parent[node];
+    float parentWorld[16];
+    for(int32_t e = 0; e < 16; e++)
+    {
+        parentWorld[e] = (parent == InvalidNode) ? Identity[e] : m_world[e][parent];
+    }
+
+    float* aos = &m_worldAoS[size_t(node) * 16];
+    for(int32_t c = 0; c < 4; c++)
+    {
+        for(int32_t r = 0; r < 4; r++)
+        {
+            float sum = 0.0f;
+            for(int32_t k = 0; k < 4; k++)
+            {
+                sum += parentWorld[k * 4 + r] * m_local[c * 4 + k][node];
+            }
+            m_world[c * 4 + r][node] = sum;
+            aos[c * 4 + r] = sum;
+        }
+    }
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: TransformHierarchy::multiplyBatch()
+//
+//    *** INTERESTING ***
+//    Four nodes per iteration, one SSE lane per node. Siblings created together
+//    (e.g. all buildings under the city node) are contiguous and share a parent,
+//    so their SoA elements load directly and the parent's elements broadcast;
+//    other batches gather. The results are transposed into the AoS copy with
+//    _MM_TRANSPOSE4_PS, one column of four nodes at a time.
+//
+////////////////////////////////////////////////////////////////////////////////
+void TransformHierarchy::multiplyBatch(const uint32_t* nodes, uint32_t count)
+{
+    uint32_t i = 0;
+#ifdef TRANSFORM_HIERARCHY_SSE2
+    for(; i + 4 <= count; i += 4)
+    {
+        const uint32_t* n = nodes + i;
+        const bool contiguous = (n[1] == n[0] + 1) && (n[2] == n[0] + 2) && (n[3] == n[0] + 3);
+        const uint32_t p[4] = { m_parent[n[0]], m_parent[n[1]], m_parent[n[2]], m_parent[n[3]] };
+        const bool sameParent = (p[0] == p[1]) && (p[0] == p[2]) && (p[0] == p[3]);
+
+        __m128 local[16], parent[16], world[16];
+        for(int32_t e = 0; e < 16; e++)
+        {
+            const float* l = &m_local[e][0];
+            local[e] = contiguous ? _mm_loadu_ps(l + n[0]) : _mm_setr_ps(l[n[0]], l[n[1]], l[n[2]], l[n[3]]);
+
+            if(sameParent)
+            {
+                parent[e] = _mm_set1_ps((p[0] == InvalidNode) ? Identity[e] : m_world[e][p[0]]);
+            }
+            else
+            {
+                float v[4];
+                for(int32_t lane = 0; lane < 4; lane++)
+                {
+                    v[lane] = (p[lane] == InvalidNode) ? Identity[e] : m_world[e][p[lane]];
+                }
+                parent[e] = _mm_loadu_ps(v);
+            }
+        }
+
+        for(int32_t c = 0; c < 4; c++)
+        {
+            for(int32_t r = 0; r < 4; r++)
+            {
+                __m128 sum = _mm_mul_ps(parent[r], local[c * 4]);
+                sum = _mm_add_ps(sum, _mm_mul_ps(parent[4 + r],  local[c * 4 + 1]));
+                sum = _mm_add_ps(sum, _mm_mul_ps(parent[8 + r],  local[c * 4 + 2]));
+                sum = _mm_add_ps(sum, _mm_mul_ps(parent[12 + r], local[c * 4 + 3]));
+                world[c * 4 + r] = sum;
+            }
+        }
+
+        for(int32_t e = 0; e < 16; e++)
+        {
+            if(contiguous)
+            {
+                _mm_storeu_ps(&m_world[e][n[0]], world[e]);
+            }
+            else
+            {
+                float v[4];
+                _mm_storeu_ps(v, world[e]);
+                for(int32_t lane = 0; lane < 4; lane++)
+                {
+                    m_world[e][n[lane]] = v[lane];
+                }
+            }
+        }
+
+        for(int32_t c = 0; c < 4; c++)
+        {
+            __m128 r0 = world[c * 4], r1 = world[c * 4 + 1], r2 = world[c * 4 + 2], r3 = world[c * 4 + 3];
+            _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+            _mm_storeu_ps(&m_worldAoS[size_t(n[0]) * 16 + c * 4], r0);
+            _mm_storeu_ps(&m_worldAoS[size_t(n[1]) * 16 + c * 4], r1);
+            _mm_storeu_ps(&m_worldAoS[size_t(n[2]) * 16 + c * 4], r2);
+            _mm_storeu_ps(&m_worldAoS[size_t(n[3]) * 16 + c * 4], r3);
+        }
+    }
+#endif
+    for(; i < count; i++)
+    {
+        multiplyOne(nodes[i]);
+    }
+}
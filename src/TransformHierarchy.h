@@ -0,0 +1,69 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/TransformHierarchy.h
+//
+// Per object model matrices with a parent/child hierarchy. Local and world
+// matrices are kept SoA (one array per matrix element) so four nodes are
+// multiplied at once with SSE. Changing a local matrix marks the node dirty;
+// update() pushes the flag down to the children and recomputes only the dirty
+// subtrees, level by level. The world matrices are also kept AoS (16 floats,
+// column major) in node order, which is the layout the shader reads, and the
+// range that changed is reported so only those bytes are uploaded.
+//
+// Nodes are never reparented and a parent is always created before its
+// children, so node order is a valid top-down order.
+//----------------------------------------------------------------------------------
+#ifndef TRANSFORM_HIERARCHY_H
+#define TRANSFORM_HIERARCHY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class TransformHierarchy
+{
+public:
+    static const uint32_t InvalidNode = 0xffffffff;
+    static const size_t   MatrixBytes = 16 * sizeof(float);
+
+    TransformHierarchy();
+
+    // Returns the new node; its local matrix is identity and it starts out dirty
+    uint32_t createNode(uint32_t parent = InvalidNode);
+    void     clear();
+
+    // Column major, like GL and glm
+    void     setLocal(uint32_t node, const float* matrix);
+    void     getLocal(uint32_t node, float* matrix) const;
+    const float* getWorld(uint32_t node) const { return &m_worldAoS[size_t(node) * 16]; }
+
+    uint32_t getParent(uint32_t node) const    { return m_parent[node]; }
+    uint32_t getNodeCount() const              { return uint32_t(m_parent.size()); }
+
+    // Recomputes the world matrices of dirty nodes and their descendants. Returns the number recomputed.
+    uint32_t update();
+
+    // AoS world matrices of all nodes, for the GPU buffer
+    const float* getWorldMatrices() const      { return m_worldAoS.empty() ? nullptr : &m_worldAoS[0]; }
+
+    // Nodes whose world matrix changed since the last clearChangedRange(); false if none
+    bool     getChangedRange(uint32_t& firstNode, uint32_t& nodeCount) const;
+    void     clearChangedRange();
+
+private:
+    void     multiplyBatch(const uint32_t* nodes, uint32_t count);
+    void     multiplyOne(uint32_t node);
+
+    std::vector<uint32_t> m_parent;
+    std::vector<uint32_t> m_depth;
+    std::vector<uint8_t>  m_dirty;
+    std::vector<float>    m_local[16];      // SoA: m_local[element][node]
+    std::vector<float>    m_world[16];      // SoA: m_world[element][node]
+    std::vector<float>    m_worldAoS;       // node * 16 + element
+
+    std::vector<std::vector<uint32_t> > m_levelWork;    // dirty nodes per depth, reused by update()
+    uint32_t              m_pendingDirty;
+    uint32_t              m_changedBegin;
+    uint32_t              m_changedEnd;
+};
+
+#endif
@@ -0,0 +1,43 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/UniformSlotLayout.cpp
+//----------------------------------------------------------------------------------
+#include "UniformSlotLayout.h"
+#include <cstring>
+
+
+UniformSlotLayout::UniformSlotLayout()
+    : m_elementBytes(0)
+    , m_stride(0)
+    , m_count(0)
+{
+}
+
+
+UniformSlotLayout::UniformSlotLayout(size_t elementBytes, size_t offsetAlignment, uint32_t count)
+    : m_elementBytes(elementBytes)
+    , m_stride(alignUp(elementBytes != 0 ? elementBytes : 1, offsetAlignment))
+    , m_count(count)
+{
+}
+
+
+void UniformSlotLayout::scatter(const void* elements, uint32_t first, uint32_t count, void* padded) const
+{
+    const uint8_t* src = static_cast<const uint8_t*>(elements) + size_t(first) * m_elementBytes;
+    uint8_t*       dst = static_cast<uint8_t*>(padded) + getOffset(first);
+    for(uint32_t i = 0; i < count; i++, src += m_elementBytes, dst += m_stride)
+    {
+        memcpy(dst, src, m_elementBytes);
+    }
+}
+
+
+// The alignment is not required to be a power of two
+size_t UniformSlotLayout::alignUp(size_t value, size_t alignment)
+{
+    if(alignment <= 1)
+    {
+        return value;
+    }
+    return (value + alignment - 1) / alignment * alignment;
+}
@@ -0,0 +1,42 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/UniformSlotLayout.h
+//
+// Places an array of uniform structs in a buffer so that every element can be
+// bound on its own with glBindBufferRange: each element starts at a multiple of
+// GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT (often 256 bytes), the rest of the stride
+// is padding. Elements are scattered from the tightly packed CPU array into a
+// padded copy with the same layout, which is what gets uploaded.
+//----------------------------------------------------------------------------------
+#ifndef UNIFORM_SLOT_LAYOUT_H
+#define UNIFORM_SLOT_LAYOUT_H
+
+#include <cstddef>
+#include <cstdint>
+
+class UniformSlotLayout
+{
+public:
+    UniformSlotLayout();
+    // offsetAlignment is the GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT of the driver; 0 is taken as 1
+    UniformSlotLayout(size_t elementBytes, size_t offsetAlignment, uint32_t count);
+
+    size_t   getElementBytes() const        { return m_elementBytes; }
+    size_t   getStride() const              { return m_stride; }
+    uint32_t getCount() const               { return m_count; }
+    size_t   getOffset(uint32_t slot) const { return size_t(slot) * m_stride; }
+    // From the first byte of the first of count consecutive slots to the last byte of the last
+    size_t   getSpanBytes(uint32_t count) const { return count != 0 ? size_t(count - 1) * m_stride + m_elementBytes : 0; }
+    size_t   getBufferBytes() const         { return getSpanBytes(m_count); }
+
+    // Copies elements [first, first + count) of a tightly packed array to their offsets in padded
+    void     scatter(const void* elements, uint32_t first, uint32_t count, void* padded) const;
+
+    static size_t alignUp(size_t value, size_t alignment);
+
+private:
+    size_t   m_elementBytes;
+    size_t   m_stride;
+    uint32_t m_count;
+};
+
+#endif
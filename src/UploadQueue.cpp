@@ -0,0 +1,385 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/UploadQueue.cpp
+//----------------------------------------------------------------------------------
+#include "UploadQueue.h"
+#include "FrameArena.h"
+#include "MemoryTracker.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace
+{
+    const size_t StagingAlignment = 16;
+
+    double now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    size_t alignUp(size_t value)
+    {
+        return (value + StagingAlignment - 1) & ~(StagingAlignment - 1);
+    }
+}
+
+
+UploadQueue::UploadQueue(GLBackend& gl, GLuint stagingBuffer, uint64_t budgetBytes, double budgetSeconds)
+    : m_gl(gl)
+    , m_stagingBuffer(stagingBuffer)
+    , m_budgetBytes(budgetBytes)
+    , m_budgetSeconds(budgetSeconds)
+    , m_bytesPerSecond(0.0)
+    , m_arena(nullptr)
+    , m_nextTicket(1)
+    , m_frame(0)
+{
+    memset(&m_frameCounters, 0, sizeof(m_frameCounters));
+    memset(&m_lastFrameCounters, 0, sizeof(m_lastFrameCounters));
+    for(int32_t p = 0; p < PriorityCount; p++)
+    {
+        m_queues[p].m_head = 0;
+    }
+}
+
+
+UploadQueue::~UploadQueue()
+{
+    // The staging buffer belongs to the caller, the queued data to us
+    MemoryTracker::untrack(this);
+}
+
+
+UploadQueue::Ticket UploadQueue::push(Priority priority, Job& job, const void* data, size_t size)
+{
+    job.m_ticket       = m_nextTicket++;
+    job.m_enqueueFrame = m_frame;
+    job.m_enqueueTime  = now();
+    job.m_size         = size;
+    if(m_arena != nullptr && priority == PriorityImmediate)
+    {
+        uint8_t* bytes = static_cast<uint8_t*>(m_arena->allocate(size));
+        if(size != 0)
+        {
+            memcpy(bytes, data, size);
+        }
+        job.m_bytes = bytes;
+    }
+    else
+    {
+        job.m_data.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+        job.m_bytes = job.m_data.data();
+    }
+
+    // Drop the drained front once it is half the queue, so a queue that never runs empty stays bounded
+    Queue& queue = m_queues[priority];
+    if(queue.m_head != 0 && queue.m_head * 2 >= queue.m_jobs.size())
+    {
+        queue.m_jobs.erase(queue.m_jobs.begin(), queue.m_jobs.begin() + queue.m_head);
+        queue.m_head = 0;
+    }
+    queue.m_jobs.push_back(Job());
+    std::swap(queue.m_jobs.back(), job);
+    return queue.m_jobs.back().m_ticket;
+}
+
+
+UploadQueue::Ticket UploadQueue::enqueueBuffer(Kind kind, Priority priority, GLuint buffer, GLintptr offset, const void* data, size_t size)
+{
+    Job job;
+    job.m_kind   = kind;
+    job.m_target = buffer;
+    job.m_offset = offset;
+    job.m_level  = 0;
+    job.m_width  = job.m_height = 0;
+    job.m_format = 0;
+    return push(priority, job, data, size);
+}
+
+
+UploadQueue::Ticket UploadQueue::enqueueCompressedTexture(Priority priority, GLuint texture, GLint level, GLsizei width, GLsizei height, GLenum format, const void* data, size_t size)
+{
+    Job job;
+    job.m_kind   = KindTexture;
+    job.m_target = texture;
+    job.m_offset = 0;
+    job.m_level  = level;
+    job.m_width  = width;
+    job.m_height = height;
+    job.m_format = format;
+    return push(priority, job, data, size);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: UploadQueue::isIssued()
+//
+//    Tickets grow with every enqueue and each priority is drained from the
+//    front, so every queue stays sorted and a binary search per queue finds
+//    a pending ticket.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool UploadQueue::isIssued(Ticket ticket) const
+{
+    for(int32_t p = 0; p < PriorityCount; p++)
+    {
+        const Queue& queue = m_queues[p];
+        if(queue.m_head == queue.m_jobs.size() || ticket < queue.m_jobs[queue.m_head].m_ticket || ticket > queue.m_jobs.back().m_ticket)
+        {
+            continue;
+        }
+        std::vector<Job>::const_iterator it = std::lower_bound(queue.m_jobs.begin() + queue.m_head, queue.m_jobs.end(), ticket,
+            [](const Job& job, Ticket t) { return job.m_ticket < t; });
+        if(it != queue.m_jobs.end() && it->m_ticket == ticket)
+        {
+            return false;
+        }
+    }
+    return ticket < m_nextTicket;
+}
+
+
+bool UploadQueue::isEmpty() const
+{
+    for(int32_t p = 0; p < PriorityCount; p++)
+    {
+        if(m_queues[p].m_head != m_queues[p].m_jobs.size())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void UploadQueue::drain()
+{
+    drain(false);
+}
+
+
+void UploadQueue::flush()
+{
+    drain(true);
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: UploadQueue::drain()
+//
+//    *** INTERESTING ***
+//    Selection stops at the first job that does not fit rather than skipping
+//    ahead to smaller ones: later jobs never overtake earlier jobs of the same
+//    or a higher priority, so a burst is spread over frames in order. A job
+//    larger than the whole budget still goes out, alone, so nothing starves.
+//
+////////////////////////////////////////////////////////////////////////////////
+void UploadQueue::drain(bool ignoreBudget)
+{
+    const double start = now();
+    m_frame++;
+
+    uint64_t budget = m_budgetBytes;
+    if(m_budgetSeconds > 0.0 && m_bytesPerSecond > 0.0)
+    {
+        budget = std::min(budget, uint64_t(m_budgetSeconds * m_bytesPerSecond));
+    }
+
+    m_selected.clear();
+    uint64_t selectedBytes = 0;
+    bool     full = false;
+    for(int32_t p = 0; p < PriorityCount && !full; p++)
+    {
+        Queue& queue = m_queues[p];
+        while(queue.m_head != queue.m_jobs.size())
+        {
+            Job& front = queue.m_jobs[queue.m_head];
+            const uint64_t size = front.m_size;
+            if(!ignoreBudget && p != PriorityImmediate && selectedBytes != 0 && selectedBytes + size > budget)
+            {
+                full = true;
+                break;
+            }
+            m_selected.push_back(Job());
+            std::swap(m_selected.back(), front);
+            queue.m_head++;
+            selectedBytes += size;
+        }
+        if(queue.m_head == queue.m_jobs.size())
+        {
+            queue.m_jobs.clear();
+            queue.m_head = 0;
+        }
+    }
+
+    uint32_t latencySum = 0;
+    for(size_t i = 0; i < m_selected.size(); i++)
+    {
+        const Job& job = m_selected[i];
+        const uint32_t latency = m_frame - 1 - job.m_enqueueFrame;
+        latencySum += latency;
+        m_frameCounters.m_maxLatencyFrames  = std::max(m_frameCounters.m_maxLatencyFrames, latency);
+        m_frameCounters.m_maxLatencySeconds = std::max(m_frameCounters.m_maxLatencySeconds, start - job.m_enqueueTime);
+        m_frameCounters.m_bytesByKind[job.m_kind] += job.m_size;
+    }
+    m_frameCounters.m_jobsIssued  = uint32_t(m_selected.size());
+    m_frameCounters.m_bytesIssued = selectedBytes;
+    m_frameCounters.m_avgLatencyFrames = m_selected.empty() ? 0.0f : float(latencySum) / float(m_selected.size());
+
+    if(!m_selected.empty())
+    {
+        issue();
+    }
+
+    for(int32_t p = 0; p < PriorityCount; p++)
+    {
+        const Queue& queue = m_queues[p];
+        m_frameCounters.m_queuedJobs += uint32_t(queue.m_jobs.size() - queue.m_head);
+        for(size_t i = queue.m_head; i < queue.m_jobs.size(); i++)
+        {
+            m_frameCounters.m_queuedBytes += queue.m_jobs[i].m_size;
+        }
+    }
+
+    // Queued job data and the staging copy are the CPU memory of the queue
+    MemoryTracker::track(MemoryTracker::SubsystemUploads, this, m_frameCounters.m_queuedBytes + m_staging.capacity());
+
+    const double elapsed = now() - start;
+    m_frameCounters.m_drainSeconds = elapsed;
+    if(selectedBytes >= 64 * 1024 && elapsed > 0.0)
+    {
+        // Small drains are dominated by fixed costs and would overestimate the time per byte
+        const double bytesPerSecond = double(selectedBytes) / elapsed;
+        m_bytesPerSecond = (m_bytesPerSecond == 0.0) ? bytesPerSecond : 0.9 * m_bytesPerSecond + 0.1 * bytesPerSecond;
+    }
+
+    m_lastFrameCounters = m_frameCounters;
+    memset(&m_frameCounters, 0, sizeof(m_frameCounters));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: UploadQueue::issue()
+//
+//    Buffer jobs are sorted by destination and merged into runs of adjacent or
+//    overlapping ranges. Within a run the jobs are written to the staging copy
+//    in enqueue order, so where they overlap the newest data wins. The packed
+//    staging data reaches the driver with a single call.
+//
+////////////////////////////////////////////////////////////////////////////////
+void UploadQueue::issue()
+{
+    m_order.clear();
+    m_runs.clear();
+    for(size_t i = 0; i < m_selected.size(); i++)
+    {
+        if(m_selected[i].m_kind != KindTexture)
+        {
+            m_order.push_back(i);
+        }
+    }
+
+    const std::vector<Job>& jobs = m_selected;
+    std::sort(m_order.begin(), m_order.end(), [&jobs](size_t a, size_t b)
+    {
+        if(jobs[a].m_target != jobs[b].m_target) return jobs[a].m_target < jobs[b].m_target;
+        if(jobs[a].m_offset != jobs[b].m_offset) return jobs[a].m_offset < jobs[b].m_offset;
+        return jobs[a].m_ticket < jobs[b].m_ticket;
+    });
+
+    size_t stagingSize = 0;
+    for(size_t i = 0; i < m_order.size(); i++)
+    {
+        const Job& job = jobs[m_order[i]];
+        const GLintptr end = job.m_offset + GLintptr(job.m_size);
+        if(!m_runs.empty() && m_runs.back().m_buffer == job.m_target && job.m_offset <= m_runs.back().m_end)
+        {
+            m_runs.back().m_end = std::max(m_runs.back().m_end, end);
+            m_runs.back().m_jobCount++;
+            m_frameCounters.m_jobsCoalesced++;
+            continue;
+        }
+        if(!m_runs.empty())
+        {
+            stagingSize += alignUp(size_t(m_runs.back().m_end - m_runs.back().m_begin));
+        }
+        Run run = { job.m_target, job.m_offset, end, i, 1, stagingSize };
+        m_runs.push_back(run);
+    }
+    if(!m_runs.empty())
+    {
+        stagingSize += alignUp(size_t(m_runs.back().m_end - m_runs.back().m_begin));
+    }
+
+    m_textureOffsets.clear();
+    for(size_t i = 0; i < m_selected.size(); i++)
+    {
+        if(m_selected[i].m_kind == KindTexture)
+        {
+            m_textureOffsets.push_back(stagingSize);
+            stagingSize += alignUp(m_selected[i].m_size);
+        }
+    }
+
+    m_staging.resize(stagingSize);
+    for(size_t r = 0; r < m_runs.size(); r++)
+    {
+        const Run& run = m_runs[r];
+        std::sort(m_order.begin() + run.m_firstJob, m_order.begin() + run.m_firstJob + run.m_jobCount, [&jobs](size_t a, size_t b)
+        {
+            return jobs[a].m_ticket < jobs[b].m_ticket;
+        });
+        for(size_t j = run.m_firstJob; j < run.m_firstJob + run.m_jobCount; j++)
+        {
+            const Job& job = jobs[m_order[j]];
+            if(job.m_size != 0)
+            {
+                memcpy(&m_staging[run.m_stagingOffset + size_t(job.m_offset - run.m_begin)], job.m_bytes, job.m_size);
+            }
+        }
+    }
+    for(size_t i = 0, t = 0; i < m_selected.size(); i++)
+    {
+        const Job& job = m_selected[i];
+        if(job.m_kind == KindTexture && job.m_size != 0)
+        {
+            memcpy(&m_staging[m_textureOffsets[t++]], job.m_bytes, job.m_size);
+        }
+    }
+
+    if(stagingSize == 0)
+    {
+        return;
+    }
+
+    // *** INTERESTING ***
+    // One upload for everything, orphaning last frame's staging storage; the rest are GPU side copies
+    m_gl.namedBufferData(m_stagingBuffer, GLsizeiptr(stagingSize), &m_staging[0], GL_STREAM_DRAW);
+    MemoryTracker::track(MemoryTracker::SubsystemUploads, MemoryTracker::KindBuffer, m_stagingBuffer, stagingSize);
+
+    for(size_t r = 0; r < m_runs.size(); r++)
+    {
+        const Run& run = m_runs[r];
+        m_gl.copyNamedBufferSubData(m_stagingBuffer, run.m_buffer, GLintptr(run.m_stagingOffset), run.m_begin, run.m_end - run.m_begin);
+        m_frameCounters.m_copies++;
+    }
+
+    if(!m_textureOffsets.empty())
+    {
+        m_gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, m_stagingBuffer);
+        for(size_t i = 0, t = 0; i < m_selected.size(); i++)
+        {
+            const Job& job = m_selected[i];
+            if(job.m_kind == KindTexture)
+            {
+                m_gl.compressedTextureSubImage2D(job.m_target, GL_TEXTURE_2D, job.m_level, 0, 0, job.m_width, job.m_height,
+                                                 job.m_format, GLsizei(job.m_size), GLintptr(m_textureOffsets[t++]));
+                m_frameCounters.m_copies++;
+            }
+        }
+        m_gl.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+}
@@ -0,0 +1,154 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/UploadQueue.h
+//
+// Buffer and texture uploads are queued instead of being issued where they are
+// produced, and drained once per frame under a budget. drain() takes jobs in
+// priority order (FIFO within a priority) until the byte budget is used up,
+// packs them into one staging buffer upload and then copies from there on the
+// GPU: buffer jobs that touch adjacent or overlapping ranges of the same buffer
+// become a single copy, textures are read from the staging buffer as a pixel
+// unpack buffer. A time budget is turned into bytes with the throughput measured
+// on previous frames. PriorityImmediate jobs (data needed by this frame's draws)
+// are always drained and count against the budget of the others.
+//
+// All GL calls go through a GLBackend, so the scheduling can be checked against
+// RecordingGLBackend.
+//
+// With a FrameArena set, PriorityImmediate data is copied into the arena instead
+// of a heap block per job; it is issued within the frame, long before the arena
+// is rewound. The queues are vectors that keep their storage, so the per-frame
+// uniform uploads do not touch the heap once their sizes have settled.
+//----------------------------------------------------------------------------------
+#ifndef UPLOAD_QUEUE_H
+#define UPLOAD_QUEUE_H
+
+#include "GLBackend.h"
+#include <vector>
+
+class FrameArena;
+
+class UploadQueue
+{
+public:
+    enum Kind
+    {
+        KindGeometry,
+        KindUniform,
+        KindTexture,
+        KindCount
+    };
+
+    enum Priority
+    {
+        PriorityImmediate,      // drained this frame regardless of the budget
+        PriorityHigh,
+        PriorityNormal,
+        PriorityLow,
+        PriorityCount
+    };
+
+    typedef uint64_t Ticket;
+
+    struct Counters
+    {
+        uint32_t m_jobsIssued;
+        uint32_t m_jobsCoalesced;       // jobs merged into another job's copy
+        uint32_t m_copies;              // buffer copies and texture uploads issued from the staging buffer
+        uint64_t m_bytesIssued;
+        uint64_t m_bytesByKind[KindCount];
+        uint32_t m_queuedJobs;          // still waiting after the drain
+        uint64_t m_queuedBytes;
+        uint32_t m_maxLatencyFrames;    // drains between enqueue and issue
+        float    m_avgLatencyFrames;
+        double   m_maxLatencySeconds;
+        double   m_drainSeconds;
+    };
+
+    // stagingBuffer is a buffer object the queue may respecify every frame
+    UploadQueue(GLBackend& gl, GLuint stagingBuffer, uint64_t budgetBytes, double budgetSeconds);
+    ~UploadQueue();
+
+    // The data is copied, the caller's memory can go away right after
+    Ticket enqueueBuffer(Kind kind, Priority priority, GLuint buffer, GLintptr offset, const void* data, size_t size);
+    Ticket enqueueCompressedTexture(Priority priority, GLuint texture, GLint level, GLsizei width, GLsizei height, GLenum format, const void* data, size_t size);
+
+    // Once per frame, before the draws that need the data
+    void   drain();
+    // Issues everything that is queued, ignoring the budget (e.g. before shutdown)
+    void   flush();
+
+    bool   isIssued(Ticket ticket) const;
+    bool   isEmpty() const;
+
+    // Immediate job data goes to the arena (null: the heap, as for the other priorities)
+    void     setFrameArena(FrameArena* arena) { m_arena = arena; }
+
+    void     setBudget(uint64_t budgetBytes, double budgetSeconds) { m_budgetBytes = budgetBytes; m_budgetSeconds = budgetSeconds; }
+    uint64_t getBudgetBytes() const         { return m_budgetBytes; }
+    double   getBudgetSeconds() const       { return m_budgetSeconds; }
+    double   getMeasuredBytesPerSecond() const { return m_bytesPerSecond; }
+
+    const Counters& getFrameCounters() const { return m_lastFrameCounters; }
+
+private:
+    struct Job
+    {
+        Ticket               m_ticket;
+        Kind                 m_kind;
+        GLuint               m_target;          // buffer or texture
+        GLintptr             m_offset;          // buffers: destination offset
+        GLint                m_level;           // textures
+        GLsizei              m_width;
+        GLsizei              m_height;
+        GLenum               m_format;
+        uint32_t             m_enqueueFrame;
+        double               m_enqueueTime;
+        const uint8_t*       m_bytes;           // into m_data or the frame arena
+        size_t               m_size;
+        std::vector<uint8_t> m_data;
+    };
+
+    // Drained from m_head; the storage is kept when the queue runs empty
+    struct Queue
+    {
+        std::vector<Job> m_jobs;
+        size_t           m_head;
+    };
+
+    struct Run
+    {
+        GLuint   m_buffer;
+        GLintptr m_begin;
+        GLintptr m_end;
+        size_t   m_firstJob;                    // into m_order
+        size_t   m_jobCount;
+        size_t   m_stagingOffset;
+    };
+
+    void   drain(bool ignoreBudget);
+    void   issue();
+    Ticket push(Priority priority, Job& job, const void* data, size_t size);
+
+    GLBackend&          m_gl;
+    GLuint              m_stagingBuffer;
+    uint64_t            m_budgetBytes;
+    double              m_budgetSeconds;
+    double              m_bytesPerSecond;       // measured, 0 until the first drain
+
+    FrameArena*         m_arena;
+    Queue               m_queues[PriorityCount];
+    Ticket              m_nextTicket;
+    uint32_t            m_frame;
+
+    // Reused by drain()
+    std::vector<Job>    m_selected;
+    std::vector<size_t> m_order;
+    std::vector<Run>    m_runs;
+    std::vector<size_t> m_textureOffsets;
+    std::vector<uint8_t> m_staging;
+
+    Counters            m_frameCounters;
+    Counters            m_lastFrameCounters;
+};
+
+#endif
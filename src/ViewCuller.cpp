@@ -0,0 +1,313 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/ViewCuller.cpp
+//----------------------------------------------------------------------------------
+#include "ViewCuller.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VIEW_CULLER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    // Relative to the extent of the frusta, what the containment test lets a corner stick out
+    const float ContainmentTolerance = 1.0e-4f;
+
+    uint32_t countBits(uint32_t bits)
+    {
+        uint32_t count = 0;
+        for(; bits != 0; bits &= bits - 1)
+        {
+            count++;
+        }
+        return count;
+    }
+
+    // Gauss-Jordan with partial pivoting, column major like the input. False if m is singular.
+    bool invert(const float* m, double* inverse)
+    {
+        double a[4][8];
+        for(int32_t r = 0; r < 4; r++)
+        {
+            for(int32_t c = 0; c < 4; c++)
+            {
+                a[r][c] = m[c * 4 + r];
+                a[r][c + 4] = (r == c) ? 1.0 : 0.0;
+            }
+        }
+        for(int32_t c = 0; c < 4; c++)
+        {
+            int32_t pivot = c;
+            for(int32_t r = c + 1; r < 4; r++)
+            {
+                if(std::fabs(a[r][c]) > std::fabs(a[pivot][c])) pivot = r;
+            }
+            if(std::fabs(a[pivot][c]) < 1.0e-30)
+            {
+                return false;
+            }
+            for(int32_t k = 0; k < 8; k++)
+            {
+                std::swap(a[c][k], a[pivot][k]);
+            }
+            const double scale = 1.0 / a[c][c];
+            for(int32_t k = 0; k < 8; k++)
+            {
+                a[c][k] *= scale;
+            }
+            for(int32_t r = 0; r < 4; r++)
+            {
+                if(r == c) continue;
+                const double f = a[r][c];
+                for(int32_t k = 0; k < 8; k++)
+                {
+                    a[r][k] -= f * a[c][k];
+                }
+            }
+        }
+        for(int32_t r = 0; r < 4; r++)
+        {
+            for(int32_t c = 0; c < 4; c++)
+            {
+                inverse[c * 4 + r] = a[r][c + 4];
+            }
+        }
+        return true;
+    }
+
+    // The eight corners of the frustum in world space; false if one of them is at infinity
+    bool getCorners(const float* viewProjection, float corners[8][3])
+    {
+        double inverse[16];
+        if(!invert(viewProjection, inverse))
+        {
+            return false;
+        }
+        for(int32_t i = 0; i < 8; i++)
+        {
+            const double ndc[4] = { (i & 1) ? 1.0 : -1.0, (i & 2) ? 1.0 : -1.0, (i & 4) ? 1.0 : -1.0, 1.0 };
+            double p[4];
+            for(int32_t r = 0; r < 4; r++)
+            {
+                p[r] = inverse[r] * ndc[0] + inverse[4 + r] * ndc[1] + inverse[8 + r] * ndc[2] + inverse[12 + r] * ndc[3];
+            }
+            if(!(p[3] > 1.0e-9 * (std::fabs(p[0]) + std::fabs(p[1]) + std::fabs(p[2]))))
+            {
+                return false;
+            }
+            for(int32_t k = 0; k < 3; k++)
+            {
+                corners[i][k] = float(p[k] / p[3]);
+            }
+        }
+        return true;
+    }
+}
+
+
+ViewCuller::ViewCuller()
+    : m_viewCount(0)
+    , m_tolerance(0.0f)
+{
+    memset(m_planes, 0, sizeof(m_planes));
+    memset(m_contains, 0, sizeof(m_contains));
+    memset(m_containedBy, 0, sizeof(m_containedBy));
+    memset(m_order, 0, sizeof(m_order));
+}
+
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  Method: ViewCuller::setViews()
+//
+//    Extracts the planes of every view (rows of the matrix, normalized so the
+//    distances are in world units) and finds which frusta contain which from
+//    their corners. The containment test allows a small tolerance so equal
+//    frusta contain each other; every sphere is tested with that much extra
+//    radius, so what a containing view rejects is never visible in the view
+//    inside it.
+//
+////////////////////////////////////////////////////////////////////////////////
+bool ViewCuller::setViews(const float* viewProjections, uint32_t count)
+{
+    m_viewCount = 0;
+    if(count == 0 || count > MaxViews)
+    {
+        return false;
+    }
+
+    float corners[MaxViews][8][3];
+    bool bounded[MaxViews];
+    float extent = 1.0f;
+    for(uint32_t v = 0; v < count; v++)
+    {
+        const float* m = viewProjections + v * 16;
+        Planes& planes = m_planes[v];
+        for(int32_t p = 0; p < 8; p++)
+        {
+            // Left, right, bottom, top, near, far: row 3 plus or minus row 0, 1 or 2
+            float x = 0.0f, y = 0.0f, z = 0.0f, w = 1.0f;
+            if(p < 6)
+            {
+                const int32_t row = p / 2;
+                const float sign = (p & 1) ? -1.0f : 1.0f;
+                x = m[3] + sign * m[row];
+                y = m[7] + sign * m[4 + row];
+                z = m[11] + sign * m[8 + row];
+                w = m[15] + sign * m[12 + row];
+                const float length = std::sqrt(x * x + y * y + z * z);
+                if(length > 1.0e-20f)
+                {
+                    x /= length;
+                    y /= length;
+                    z /= length;
+                    w /= length;
+                }
+                else
+                {
+                    // The far plane of an infinite projection
+                    x = y = z = 0.0f;
+                    w = 1.0f;
+                }
+            }
+            planes.m_x[p] = x;
+            planes.m_y[p] = y;
+            planes.m_z[p] = z;
+            planes.m_w[p] = w;
+        }
+
+        bounded[v] = getCorners(m, corners[v]);
+        for(int32_t i = 0; i < 8 && bounded[v]; i++)
+        {
+            for(int32_t k = 0; k < 3; k++)
+            {
+                extent = std::max(extent, std::fabs(corners[v][i][k]));
+            }
+        }
+    }
+    m_tolerance = ContainmentTolerance * extent;
+
+    // *** INTERESTING ***
+    // A convex frustum is inside another when all of its corners are
+    for(uint32_t v = 0; v < count; v++)
+    {
+        m_contains[v] = m_containedBy[v] = 1u << v;
+    }
+    for(uint32_t inner = 0; inner < count; inner++)
+    {
+        if(!bounded[inner]) continue;
+        for(uint32_t outer = 0; outer < count; outer++)
+        {
+            if(outer == inner) continue;
+            const Planes& planes = m_planes[outer];
+            bool inside = true;
+            for(int32_t i = 0; i < 8 && inside; i++)
+            {
+                for(int32_t p = 0; p < 6 && inside; p++)
+                {
+                    const float distance = planes.m_x[p] * corners[inner][i][0] + planes.m_y[p] * corners[inner][i][1] +
+                                           planes.m_z[p] * corners[inner][i][2] + planes.m_w[p];
+                    inside = distance >= -m_tolerance;
+                }
+            }
+            if(inside)
+            {
+                m_contains[outer] |= 1u << inner;
+                m_containedBy[inner] |= 1u << outer;
+            }
+        }
+    }
+
+    // A rejection by a view that contains others answers the most tests
+    for(uint32_t v = 0; v < count; v++)
+    {
+        m_order[v] = v;
+    }
+    const uint32_t* contains = m_contains;
+    std::stable_sort(m_order, m_order + count, [contains](uint32_t a, uint32_t b) {
+        return countBits(contains[a]) > countBits(contains[b]);
+    });
+
+    m_viewCount = count;
+    return true;
+}
+
+
+bool ViewCuller::touches(const Planes& planes, const Sphere& sphere) const
+{
+    const float limit = -(sphere.m_radius + m_tolerance);
+#ifdef VIEW_CULLER_SSE2
+    const __m128 cx = _mm_set1_ps(sphere.m_center[0]);
+    const __m128 cy = _mm_set1_ps(sphere.m_center[1]);
+    const __m128 cz = _mm_set1_ps(sphere.m_center[2]);
+    const __m128 l = _mm_set1_ps(limit);
+    for(int32_t p = 0; p < 8; p += 4)
+    {
+        __m128 d = _mm_mul_ps(_mm_loadu_ps(planes.m_x + p), cx);
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(planes.m_y + p), cy));
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(planes.m_z + p), cz));
+        d = _mm_add_ps(d, _mm_loadu_ps(planes.m_w + p));
+        if(_mm_movemask_ps(_mm_cmplt_ps(d, l)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+#else
+    for(int32_t p = 0; p < 6; p++)
+    {
+        const float d = planes.m_x[p] * sphere.m_center[0] + planes.m_y[p] * sphere.m_center[1] +
+                        planes.m_z[p] * sphere.m_center[2] + planes.m_w[p];
+        if(d < limit)
+        {
+            return false;
+        }
+    }
+    return true;
+#endif
+}
+
+
+uint32_t ViewCuller::cull(const Sphere* spheres, uint32_t count, uint32_t* masks) const
+{
+    uint32_t tests = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        // Views whose answer is known, and the ones the sphere is visible in
+        uint32_t known = 0;
+        uint32_t visible = 0;
+        for(uint32_t o = 0; o < m_viewCount; o++)
+        {
+            const uint32_t v = m_order[o];
+            if(known & (1u << v)) continue;
+            tests++;
+            if(touches(m_planes[v], spheres[i]))
+            {
+                visible |= m_containedBy[v];
+                known |= m_containedBy[v];
+            }
+            else
+            {
+                known |= m_contains[v];
+            }
+        }
+        masks[i] = visible;
+    }
+    return tests;
+}
+
+
+uint32_t ViewCuller::compact(const uint32_t* masks, uint32_t count, uint32_t view, uint32_t* visible)
+{
+    // Written unconditionally, the count only moves on for visible items
+    uint32_t n = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        visible[n] = i;
+        n += (masks[i] >> view) & 1;
+    }
+    return n;
+}
@@ -0,0 +1,73 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/ViewCuller.h
+//
+// Culls bounding spheres against the frusta of several views in one pass, so
+// the scene can be drawn from more than one viewpoint (main camera, overview,
+// shadow style passes) without walking the meshes once per view. Every sphere
+// gets a mask with a bit per view it may be visible in; compact() turns the
+// masks into the list of items one view draws.
+//
+// Views share tests where their frusta overlap. setViews() works out which
+// frusta contain which (every corner of one inside all planes of the other).
+// A sphere outside a frustum is then outside all the frusta inside it, and a
+// sphere touching a frustum touches all the frusta around it, so those views
+// are not tested again. Views with the same matrix contain each other and cost
+// one test. The six planes of a view are tested four at a time with SSE2.
+//
+// The matrices are view-projection matrices in the GL convention (clip space z
+// in [-w, w]), column major. Frusta must be finite: a view with an infinite far
+// plane is culled correctly but shares no tests.
+//----------------------------------------------------------------------------------
+#ifndef VIEW_CULLER_H
+#define VIEW_CULLER_H
+
+#include <cstdint>
+
+class ViewCuller
+{
+public:
+    static const uint32_t MaxViews = 32;
+
+    struct Sphere
+    {
+        float m_center[3];
+        float m_radius;
+    };
+
+    ViewCuller();
+
+    // count views of 16 floats each. Returns false, and culls everything, if there are none or more than MaxViews.
+    bool     setViews(const float* viewProjections, uint32_t count);
+    uint32_t getViewCount() const                       { return m_viewCount; }
+    // Views whose frustum lies inside the frustum of view, view included
+    uint32_t getContainedViews(uint32_t view) const     { return m_contains[view]; }
+
+    // masks[i] gets bit v set if spheres[i] may be visible in view v. Returns the number of
+    // sphere-frustum tests run, at most count * getViewCount(). Disjoint ranges can be culled
+    // on different threads.
+    uint32_t cull(const Sphere* spheres, uint32_t count, uint32_t* masks) const;
+
+    // Writes the indices of the masks with the view's bit to visible and returns how many there are
+    static uint32_t compact(const uint32_t* masks, uint32_t count, uint32_t view, uint32_t* visible);
+
+private:
+    // SoA, planes 6 and 7 never reject
+    struct Planes
+    {
+        float m_x[8];
+        float m_y[8];
+        float m_z[8];
+        float m_w[8];
+    };
+
+    bool     touches(const Planes& planes, const Sphere& sphere) const;
+
+    uint32_t m_viewCount;
+    Planes   m_planes[MaxViews];
+    uint32_t m_contains[MaxViews];       // views inside this one, itself included
+    uint32_t m_containedBy[MaxViews];    // views around this one, itself included
+    uint32_t m_order[MaxViews];          // views containing the most others are tested first
+    float    m_tolerance;                // world units the containment test allows, added to every radius
+};
+
+#endif
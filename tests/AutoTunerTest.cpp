@@ -0,0 +1,121 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/AutoTunerTest.cpp
+//
+// The submission sweep driven with synthetic frame times: candidates, the
+// winner despite outlier frames, the tie break, and the profile file (a
+// profile written by an older sweep is measured again).
+//
+//   g++ -std=c++14 -O2 -Isrc tests/AutoTunerTest.cpp src/AutoTuner.cpp src/AtomicFile.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "AutoTuner.h"
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+    const char* const ProfilePath = "AutoTunerTest_profile.txt";
+
+    void testEnumerate()
+    {
+        std::vector<AutoTuner::Config> configs;
+        AutoTuner::enumerate(true, true, configs);
+        CHECK(configs.size() == 8);
+        CHECK(configs[0].m_vbum && configs[0].m_bindlessUniforms && !configs[0].m_vertexFormatPerDraw);
+
+        AutoTuner::enumerate(false, false, configs);
+        CHECK(configs.size() == 2);
+        for(size_t i = 0; i < configs.size(); i++)
+        {
+            CHECK(!configs[i].m_vbum && !configs[i].m_bindlessUniforms);
+        }
+    }
+
+    void testSweep()
+    {
+        AutoTuner tuner(2, 5);
+        tuner.start(true, true);
+        CHECK(tuner.isRunning() && tuner.getConfigCount() == 8);
+
+        uint32_t frames = 0;
+        while(tuner.isRunning())
+        {
+            const AutoTuner::Config& config = tuner.getConfig();
+            double seconds = 0.004;
+            if(!config.m_vbum)                  seconds *= 2.0;
+            if(config.m_vertexFormatPerDraw)    seconds *= 1.5;
+            if(!config.m_bindlessUniforms)      seconds *= 0.8;
+            // Outliers, which the median ignores
+            if(frames % 7 == 0)                 seconds *= 10.0;
+            tuner.addFrame(seconds);
+            frames++;
+            CHECK(frames < 1000);
+        }
+        CHECK(frames == 8 * 7);
+        CHECK(tuner.getResults().size() == 8);
+
+        const AutoTuner::Config& best = tuner.getConfig();
+        CHECK(best.m_vbum && !best.m_bindlessUniforms && !best.m_vertexFormatPerDraw);
+    }
+
+    void testSelect()
+    {
+        std::vector<AutoTuner::Result> results(3);
+        for(size_t i = 0; i < results.size(); i++)
+        {
+            results[i].m_frames = 1;
+        }
+        results[0].m_secondsPerFrame = 1.02;
+        results[1].m_secondsPerFrame = 1.0;
+        results[2].m_secondsPerFrame = 0.5;
+        CHECK(AutoTuner::select(results) == 2);
+
+        // Within the tolerance of the cheapest, the earliest wins
+        results[2].m_secondsPerFrame = 0.995;
+        CHECK(AutoTuner::select(results) == 0);
+
+        results[0].m_frames = 0;
+        CHECK(AutoTuner::select(results) == 1);
+        CHECK(AutoTuner::select(std::vector<AutoTuner::Result>()) == 0);
+    }
+
+    void testProfile()
+    {
+        remove(ProfilePath);
+        AutoTuner::Config loaded;
+        CHECK(!AutoTuner::loadProfile(ProfilePath, "A|1", loaded));
+
+        const AutoTuner::Config first  = { true, false, false };
+        const AutoTuner::Config second = { false, true, true };
+        CHECK(AutoTuner::storeProfile(ProfilePath, "A|1", first));
+        CHECK(AutoTuner::storeProfile(ProfilePath, "B|2", first));
+        CHECK(AutoTuner::storeProfile(ProfilePath, "A|1", second));
+
+        CHECK(AutoTuner::loadProfile(ProfilePath, "A|1", loaded));
+        CHECK(!loaded.m_vbum && loaded.m_bindlessUniforms && loaded.m_vertexFormatPerDraw);
+        CHECK(AutoTuner::loadProfile(ProfilePath, "B|2", loaded));
+        CHECK(loaded.m_vbum && !loaded.m_bindlessUniforms && !loaded.m_vertexFormatPerDraw);
+        CHECK(!AutoTuner::loadProfile(ProfilePath, "A|", loaded));
+
+        // A line of the older format, which also held per mesh uniforms and draw calls per state
+        {
+            std::ofstream file(ProfilePath);
+            file << "C|3\t1 1 1 0 5\n";
+        }
+        CHECK(!AutoTuner::loadProfile(ProfilePath, "C|3", loaded));
+        CHECK(AutoTuner::storeProfile(ProfilePath, "C|3", first));
+        CHECK(AutoTuner::loadProfile(ProfilePath, "C|3", loaded));
+        CHECK(loaded.m_vbum && !loaded.m_bindlessUniforms);
+        remove(ProfilePath);
+    }
+}
+
+
+int main()
+{
+    testEnumerate();
+    testSweep();
+    testSelect();
+    testProfile();
+    return Check::result("AutoTunerTest");
+}
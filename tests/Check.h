@@ -0,0 +1,43 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/Check.h
+//
+// Checks for the standalone tests in this directory. Every test is one source
+// file with its own main() that builds against src/ without Cinder or a GL
+// context; the command line is at the top of each file, run from the
+// repository root. A test prints the checks that failed and returns non-zero.
+//
+// Tests that include GL headers put tests/stubs on the include path (a stand-in
+// for the Cinder headers) and link tests/GLStubs.cpp, which records buffer
+// creation and deletion instead of calling a driver.
+//----------------------------------------------------------------------------------
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <cstdio>
+
+namespace Check
+{
+    inline int& failures()
+    {
+        static int count = 0;
+        return count;
+    }
+
+    inline int result(const char* test)
+    {
+        printf("%s: %s\n", test, failures() == 0 ? "passed" : "FAILED");
+        return failures() == 0 ? 0 : 1;
+    }
+}
+
+#define CHECK(condition)                                                            \
+    do                                                                              \
+    {                                                                               \
+        if(!(condition))                                                            \
+        {                                                                           \
+            printf("%s(%d): check failed: %s\n", __FILE__, __LINE__, #condition);   \
+            Check::failures()++;                                                    \
+        }                                                                           \
+    } while(0)
+
+#endif
@@ -0,0 +1,324 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/CityStreamerTest.cpp
+//
+// The streaming policy driven headlessly: a mock TileBackend stands in for the
+// tile files and the mesh registry, and the camera follows scripted paths. The
+// budget holds whenever the pinned tiles fit in it, pinned tiles are never
+// detached (not even when they alone exceed the budget), attaches without room
+// are retried, and reads of tiles the camera left behind are cancelled, both
+// queued ones on the I/O thread and finished ones that were not attached yet.
+//
+//   g++ -std=c++14 -O2 -pthread -Isrc tests/CityStreamerTest.cpp src/CityStreamer.cpp src/CityTile.cpp
+//       src/GeometryCodec.cpp src/AtomicFile.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "CityStreamer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <utility>
+
+namespace
+{
+    // 20 x 20 tiles of one unit, the city centered on the origin
+    const int32_t TileCount = 20;
+    const float   TileSize  = 1.0f;
+    const float   Origin    = -10.0f;
+    const float   Visible   = 1.5f;
+    const float   Prefetch  = 2.5f;
+
+    float getDistance(int32_t x, int32_t z, float cameraX, float cameraZ)
+    {
+        const float minX = Origin + float(x) * TileSize;
+        const float minZ = Origin + float(z) * TileSize;
+        const float dx = std::max(std::max(minX - cameraX, cameraX - (minX + TileSize)), 0.0f);
+        const float dz = std::max(std::max(minZ - cameraZ, cameraZ - (minZ + TileSize)), 0.0f);
+        return std::sqrt(dx * dx + dz * dz);
+    }
+
+    class MockBackend : public TileBackend
+    {
+    public:
+        MockBackend()
+            : m_capacity(1000)
+            , m_cameraX(0.0f)
+            , m_cameraZ(0.0f)
+            , m_loads(0)
+            , m_pinnedDetaches(0)
+            , m_doubleAttaches(0)
+            , m_gated(false)
+            , m_waiting(0)
+        {
+        }
+
+        // Tiles of different sizes, so the budget is not a tile count
+        static uint64_t getBytes(int32_t x, int32_t z) { return 1000 + uint64_t((x * 7 + z * 3) % 5) * 100; }
+
+        bool load(int32_t x, int32_t z, CityTile& tile) override
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_loads++;
+            m_waiting++;
+            m_changed.notify_all();
+            m_changed.wait(lock, [this]() { return !m_gated; });
+            m_waiting--;
+            tile.clear();
+            tile.m_x = x;
+            tile.m_z = z;
+            return true;
+        }
+
+        bool attach(const CityTile& tile, uint64_t& bytes) override
+        {
+            if(int32_t(m_attached.size()) >= m_capacity)
+            {
+                return false;
+            }
+            m_doubleAttaches += m_attached.count(std::make_pair(tile.m_x, tile.m_z)) != 0 ? 1 : 0;
+            m_attached.insert(std::make_pair(tile.m_x, tile.m_z));
+            bytes = getBytes(tile.m_x, tile.m_z);
+            return true;
+        }
+
+        void detach(int32_t x, int32_t z) override
+        {
+            m_attached.erase(std::make_pair(x, z));
+            if(getDistance(x, z, m_cameraX, m_cameraZ) <= Visible)
+            {
+                m_pinnedDetaches++;
+            }
+        }
+
+        // Reads block until open() once closed; only for the threaded streamer
+        void close()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_gated = true;
+        }
+
+        void open()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_gated = false;
+            }
+            m_changed.notify_all();
+        }
+
+        void waitForBlockedRead()
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_changed.wait(lock, [this]() { return m_waiting != 0; });
+        }
+
+        int32_t getLoads()
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_loads;
+        }
+
+        bool isAttached(int32_t x, int32_t z) const { return m_attached.count(std::make_pair(x, z)) != 0; }
+
+        std::set<std::pair<int32_t, int32_t> > m_attached;
+        int32_t                 m_capacity;
+        float                   m_cameraX;          // of the current update, to tell pinned tiles
+        float                   m_cameraZ;
+        int32_t                 m_loads;
+        int32_t                 m_pinnedDetaches;
+        int32_t                 m_doubleAttaches;
+
+    private:
+        std::mutex              m_mutex;
+        std::condition_variable m_changed;
+        bool                    m_gated;
+        int32_t                 m_waiting;
+    };
+
+    void update(CityStreamer& streamer, MockBackend& backend, float x, float z)
+    {
+        backend.m_cameraX = x;
+        backend.m_cameraZ = z;
+        streamer.update(x, z);
+    }
+
+    uint64_t getPinnedBytes(float x, float z)
+    {
+        uint64_t bytes = 0;
+        for(int32_t tz = 0; tz < TileCount; tz++)
+        {
+            for(int32_t tx = 0; tx < TileCount; tx++)
+            {
+                bytes += getDistance(tx, tz, x, z) <= Visible ? MockBackend::getBytes(tx, tz) : 0;
+            }
+        }
+        return bytes;
+    }
+
+    void testCameraPath()
+    {
+        const uint64_t budget = 30 * 1000;
+        MockBackend backend;
+        CityStreamer streamer(backend, TileCount, TileCount, TileSize, Origin, Origin, budget, false);
+        streamer.setRadii(Visible, Prefetch);
+        streamer.setLookAhead(10.0f);
+
+        // A still camera: everything in view ends up attached
+        for(int32_t i = 0; i < 50; i++)
+        {
+            update(streamer, backend, 0.3f, 0.3f);
+        }
+        const CityStreamer::Counters& counters = streamer.getCounters();
+        CHECK(counters.m_misses == 0);
+        CHECK(streamer.isResident(10, 10) && backend.isAttached(10, 10));
+        CHECK(counters.m_residentBytes <= budget);
+
+        // Around a circle, several times through tiles that were evicted before
+        for(int32_t frame = 0; frame < 3000; frame++)
+        {
+            const float angle = float(frame) * 0.005f;
+            const float x = 6.0f * std::cos(angle);
+            const float z = 6.0f * std::sin(angle);
+            update(streamer, backend, x, z);
+
+            CHECK(getPinnedBytes(x, z) > budget || counters.m_residentBytes <= budget);
+            CHECK(counters.m_residentTiles == backend.m_attached.size());
+            for(int32_t tz = 0; tz < TileCount; tz++)
+            {
+                for(int32_t tx = 0; tx < TileCount; tx++)
+                {
+                    CHECK(streamer.isResident(tx, tz) == backend.isAttached(tx, tz));
+                }
+            }
+        }
+        CHECK(counters.m_peakResidentBytes <= budget);
+        CHECK(counters.m_evictions > 0);
+        CHECK(backend.m_pinnedDetaches == 0);
+        CHECK(backend.m_doubleAttaches == 0);
+        CHECK(counters.m_failures == 0);
+
+        streamer.releaseAll();
+        CHECK(backend.m_attached.empty());
+        CHECK(counters.m_residentBytes == 0);
+    }
+
+    void testPinnedOverBudget()
+    {
+        // Less than the tiles in view take
+        const uint64_t budget = 3 * 1000;
+        MockBackend backend;
+        CityStreamer streamer(backend, TileCount, TileCount, TileSize, Origin, Origin, budget, false);
+        streamer.setRadii(Visible, Prefetch);
+        CHECK(getPinnedBytes(0.0f, 0.0f) > budget);
+
+        for(int32_t i = 0; i < 30; i++)
+        {
+            update(streamer, backend, 0.0f, 0.0f);
+        }
+        const CityStreamer::Counters& counters = streamer.getCounters();
+        CHECK(counters.m_misses == 0);
+        CHECK(counters.m_residentBytes == getPinnedBytes(0.0f, 0.0f));
+
+        // Over the budget, but nothing is evicted and read again
+        const uint32_t reads = counters.m_reads;
+        for(int32_t i = 0; i < 30; i++)
+        {
+            update(streamer, backend, 0.0f, 0.0f);
+        }
+        CHECK(counters.m_reads == reads);
+        CHECK(counters.m_misses == 0);
+        CHECK(backend.m_pinnedDetaches == 0);
+
+        // Moving on, the tiles left behind go and the new view is attached
+        for(int32_t i = 0; i < 30; i++)
+        {
+            update(streamer, backend, 4.0f, 0.0f);
+        }
+        CHECK(counters.m_misses == 0);
+        CHECK(counters.m_residentBytes == getPinnedBytes(4.0f, 0.0f));
+        CHECK(!streamer.isResident(10, 10));
+        CHECK(backend.m_pinnedDetaches == 0);
+    }
+
+    void testAttachFailure()
+    {
+        MockBackend backend;
+        backend.m_capacity = 3;
+        CityStreamer streamer(backend, TileCount, TileCount, TileSize, Origin, Origin, 1000 * 1000, false);
+        streamer.setRadii(Visible, Prefetch);
+        for(int32_t i = 0; i < 10; i++)
+        {
+            update(streamer, backend, 0.0f, 0.0f);
+        }
+        CHECK(streamer.getCounters().m_residentTiles == 3);
+        CHECK(streamer.getCounters().m_failures > 0);
+        CHECK(streamer.getCounters().m_misses > 0);
+
+        // Room again: the tiles in view are asked for again
+        backend.m_capacity = 1000;
+        for(int32_t i = 0; i < 20; i++)
+        {
+            update(streamer, backend, 0.0f, 0.0f);
+        }
+        CHECK(streamer.getCounters().m_misses == 0);
+    }
+
+    void testCancelledReads()
+    {
+        // Reads finish on the next update; a camera that is gone by then gets nothing attached
+        {
+            MockBackend backend;
+            CityStreamer streamer(backend, TileCount, TileCount, TileSize, Origin, Origin, 1000 * 1000, false);
+            streamer.setRadii(Visible, Prefetch);
+            update(streamer, backend, 0.0f, 0.0f);
+            CHECK(streamer.getCounters().m_reads == CityStreamer::MaxReads);
+
+            update(streamer, backend, 8.0f, 8.0f);
+            CHECK(streamer.getCounters().m_cancelled == CityStreamer::MaxReads);
+            CHECK(streamer.getCounters().m_attached == 0);
+            CHECK(backend.m_attached.empty());
+            CHECK(!streamer.isResident(10, 10));
+        }
+
+        // Threaded: one read blocks on the I/O thread while the others queue behind it
+        {
+            MockBackend backend;
+            backend.close();
+            CityStreamer streamer(backend, TileCount, TileCount, TileSize, Origin, Origin, 1000 * 1000, true);
+            streamer.setRadii(Visible, Prefetch);
+            update(streamer, backend, 0.0f, 0.0f);
+            backend.waitForBlockedRead();
+            CHECK(streamer.getCounters().m_readingTiles == CityStreamer::MaxReads);
+
+            // The queued reads are dropped unread, the blocked one is cancelled once it finishes
+            update(streamer, backend, 8.0f, 8.0f);
+            CHECK(streamer.getCounters().m_cancelled == CityStreamer::MaxReads - 1);
+            backend.open();
+            for(int32_t i = 0; i < 1000 && streamer.getCounters().m_misses != 0; i++)
+            {
+                update(streamer, backend, 8.0f, 8.0f);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            CHECK(streamer.getCounters().m_misses == 0);
+            CHECK(streamer.getCounters().m_cancelled == CityStreamer::MaxReads);
+            CHECK(!streamer.isResident(10, 10) && !backend.isAttached(10, 10));
+            CHECK(backend.getLoads() == int32_t(streamer.getCounters().m_reads - (CityStreamer::MaxReads - 1)));
+
+            streamer.releaseAll();
+            CHECK(backend.m_attached.empty());
+        }
+    }
+}
+
+
+int main()
+{
+    testCameraPath();
+    testPinnedOverBudget();
+    testAttachFailure();
+    testCancelledReads();
+    return Check::result("CityStreamerTest");
+}
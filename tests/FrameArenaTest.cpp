@@ -0,0 +1,156 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/FrameArenaTest.cpp
+//
+// Allocation, alignment and overflow of the FrameArena, what survives a
+// rewind, and that a frame of settled size does not touch the heap: neither the
+// arena alone nor the uniform upload path of a frame (DirtyRangeTracker runs
+// queued as immediate UploadQueue jobs on the arena, drained through the GL
+// stubs). Built with FRAME_ARENA_COUNT_HEAP so the global operator new is counted.
+//
+//   g++ -std=c++14 -O2 -DFRAME_ARENA_COUNT_HEAP -Isrc -Itests/stubs tests/FrameArenaTest.cpp tests/GLStubs.cpp
+//       src/FrameArena.cpp src/UploadQueue.cpp src/DirtyRangeTracker.cpp src/GLBackend.cpp src/MemoryTracker.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "DirtyRangeTracker.h"
+#include "FrameArena.h"
+#include "GLStubs.h"
+#include "UploadQueue.h"
+#include <cstring>
+#include <string>
+
+namespace
+{
+    void testAllocation()
+    {
+        FrameArena arena(1024, 2);
+        arena.beginFrame();
+
+        const char* small = arena.format("frame %d", 42);
+        CHECK(strcmp(small, "frame 42") == 0);
+
+        // Larger than the block, served from the heap
+        const std::string big(5000, 'x');
+        const char* large = arena.format("%s!", big.c_str());
+        CHECK(strlen(large) == 5001 && large[5000] == '!');
+        CHECK(strcmp(small, "frame 42") == 0);
+
+        double* doubles = arena.allocateArray<double>(10);
+        CHECK((uintptr_t(doubles) & (alignof(double) - 1)) == 0);
+        for(size_t alignment = 1; alignment <= 4096; alignment *= 2)
+        {
+            CHECK((uintptr_t(arena.allocate(3, alignment)) & (alignment - 1)) == 0);
+        }
+
+        const FrameArena::Stats stats = arena.getStats();
+        CHECK(stats.m_usedBytes >= 5002 + 10 * sizeof(double));
+
+        // The next frame uses the other block, so this frame's data stays valid
+        arena.beginFrame();
+        CHECK(strcmp(small, "frame 42") == 0);
+        CHECK(arena.getStats().m_lastFrameBytes == stats.m_usedBytes);
+        CHECK(arena.getStats().m_overflowBytes > 5000);
+
+        // Once both blocks have been rewound they are grown to the high water mark
+        arena.beginFrame();
+        arena.beginFrame();
+        CHECK(arena.getStats().m_capacityBytes >= arena.getStats().m_highWaterBytes);
+        CHECK(arena.getStats().m_growths == 2);
+
+        FrameVector<int> list((FrameAllocator<int>(arena)));
+        list.reserve(100);
+        for(int i = 0; i < 100; i++)
+        {
+            list.push_back(i);
+        }
+        CHECK(list[99] == 99);
+    }
+
+    void testSteadyStateHeap()
+    {
+        CHECK(FrameArena::isCountingHeapAllocations());
+
+        FrameArena arena(256, 2);
+        const uint32_t warmupFrames = 4, measuredFrames = 16;
+        uint64_t heapAllocations = 0;
+        for(uint32_t frame = 0; frame < warmupFrames + measuredFrames; frame++)
+        {
+            if(frame == warmupFrames)
+            {
+                heapAllocations = FrameArena::getHeapAllocationCount();
+            }
+            arena.beginFrame();
+            for(int32_t i = 0; i < 64; i++)
+            {
+                arena.format("item %d of frame %u", i, frame);
+            }
+            arena.allocateArray<float>(4096);
+        }
+        CHECK(FrameArena::getHeapAllocationCount() == heapAllocations);
+        CHECK(arena.getStats().m_overflowBytes == 0);
+
+        // And the counter does see the heap
+        std::string* counted = new std::string("counted");
+        CHECK(FrameArena::getHeapAllocationCount() > heapAllocations);
+        delete counted;
+    }
+
+    struct Uniforms
+    {
+        float m_values[4];
+    };
+
+    void testSteadyStateFramePath()
+    {
+        const uint32_t count = 256;
+        GLuint buffers[2];
+        glGenBuffers(2, buffers);
+        glNamedBufferDataEXT(buffers[0], count * sizeof(Uniforms), nullptr, GL_DYNAMIC_DRAW);
+
+        GLDirectBackend   gl;
+        FrameArena        arena(1024, 2);
+        UploadQueue       uploads(gl, buffers[1], 1 << 20, 0.0);
+        DirtyRangeTracker dirty(sizeof(Uniforms), count, 2);
+        uploads.setFrameArena(&arena);
+        std::vector<Uniforms> uniforms(count);
+        memset(&uniforms[0], 0, count * sizeof(Uniforms));
+
+        // Every frame one element in eight changes, a different one each frame: always 32 runs of one element
+        const uint32_t warmupFrames = 4, measuredFrames = 16;
+        uint64_t heapAllocations = 0;
+        for(uint32_t frame = 0; frame < warmupFrames + measuredFrames; frame++)
+        {
+            if(frame == warmupFrames)
+            {
+                heapAllocations = FrameArena::getHeapAllocationCount();
+            }
+            arena.beginFrame();
+            for(uint32_t i = frame % 8; i < count; i += 8)
+            {
+                uniforms[i].m_values[0] = float(frame);
+            }
+            const std::vector<DirtyRangeTracker::Range>& ranges = dirty.update(&uniforms[0], 0, count);
+            CHECK(frame == 0 || ranges.size() == count / 8);
+            for(size_t r = 0; r < ranges.size(); r++)
+            {
+                uploads.enqueueBuffer(UploadQueue::KindUniform, UploadQueue::PriorityImmediate, buffers[0], ranges[r].m_first * sizeof(Uniforms),
+                                      &uniforms[ranges[r].m_first], ranges[r].m_count * sizeof(Uniforms));
+            }
+            uploads.drain();
+            CHECK(uploads.isEmpty());
+            arena.format("uploads: %u jobs, %u copies", uploads.getFrameCounters().m_jobsIssued, uploads.getFrameCounters().m_copies);
+        }
+        CHECK(FrameArena::getHeapAllocationCount() == heapAllocations);
+        CHECK(uploads.getFrameCounters().m_jobsIssued == count / 8);
+        CHECK(arena.getStats().m_overflowBytes == 0);
+        glDeleteBuffers(2, buffers);
+    }
+}
+
+
+int main()
+{
+    testAllocation();
+    testSteadyStateHeap();
+    testSteadyStateFramePath();
+    return Check::result("FrameArenaTest");
+}
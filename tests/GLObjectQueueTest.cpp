@@ -0,0 +1,297 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/GLObjectQueueTest.cpp
+//
+// The batching and lifetime rules of GLObjectQueue against a mock backend that
+// signals fences when the test says so: one gen call per batch, nothing deleted
+// before the fence behind its release has signaled, resident buffers made
+// non-resident before they are deleted, borrowed handles never released, and
+// finish() draining every pending and spare name.
+//
+//   g++ -std=c++14 -O2 -Isrc -Itests/stubs tests/GLObjectQueueTest.cpp tests/GLStubs.cpp
+//       src/GLObjectQueue.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "GLStubs.h"
+#include "GLObjectQueue.h"
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    class MockBackend : public GLObjectBackend
+    {
+    public:
+        MockBackend()
+            : m_next(1)
+            , m_genCalls(0)
+            , m_deleteCalls(0)
+            , m_nonResidentCalls(0)
+            , m_errors(0)
+            , m_nextFence(1)
+            , m_signaledUpTo(0)
+        {
+        }
+
+        void genBuffers(GLsizei count, GLuint* names) override          { generate(count, names, m_liveBuffers); }
+        void genTextures(GLsizei count, GLuint* names) override         { generate(count, names, m_liveTextures); }
+
+        void deleteBuffers(GLsizei count, const GLuint* names) override
+        {
+            m_deleteCalls++;
+            for(GLsizei i = 0; i < count; i++)
+            {
+                m_errors += m_liveBuffers.erase(names[i]) == 1 ? 0 : 1;
+                m_errors += m_resident.count(names[i]) == 0 ? 0 : 1;
+            }
+        }
+
+        void deleteTextures(GLsizei count, const GLuint* names) override
+        {
+            m_deleteCalls++;
+            for(GLsizei i = 0; i < count; i++)
+            {
+                m_errors += m_liveTextures.erase(names[i]) == 1 ? 0 : 1;
+            }
+        }
+
+        void makeBuffersNonResident(GLsizei count, const GLuint* names) override
+        {
+            m_nonResidentCalls++;
+            for(GLsizei i = 0; i < count; i++)
+            {
+                m_errors += m_resident.erase(names[i]) == 1 ? 0 : 1;
+            }
+        }
+
+        // Fences are numbered in order and signal once the test moves m_signaledUpTo past them
+        GLsync fence() override
+        {
+            m_fences.insert(m_nextFence);
+            return reinterpret_cast<GLsync>(m_nextFence++);
+        }
+
+        bool isSignaled(GLsync fence) override  { return reinterpret_cast<uintptr_t>(fence) <= m_signaledUpTo; }
+
+        void wait(GLsync fence) override
+        {
+            m_signaledUpTo = std::max(m_signaledUpTo, reinterpret_cast<uintptr_t>(fence));
+        }
+
+        void deleteFence(GLsync fence) override
+        {
+            m_errors += m_fences.erase(reinterpret_cast<uintptr_t>(fence)) == 1 ? 0 : 1;
+        }
+
+        GLuint              m_next;
+        std::set<GLuint>    m_liveBuffers;
+        std::set<GLuint>    m_liveTextures;
+        std::set<GLuint>    m_resident;
+        int32_t             m_genCalls;
+        int32_t             m_deleteCalls;
+        int32_t             m_nonResidentCalls;
+        int32_t             m_errors;           // deleting a dead name or a resident buffer, fences alike
+        std::set<uintptr_t> m_fences;
+        uintptr_t           m_nextFence;
+        uintptr_t           m_signaledUpTo;
+
+    private:
+        void generate(GLsizei count, GLuint* names, std::set<GLuint>& live)
+        {
+            m_genCalls++;
+            for(GLsizei i = 0; i < count; i++)
+            {
+                names[i] = m_next++;
+                live.insert(names[i]);
+            }
+        }
+    };
+
+    GLBufferHandle createResident(GLObjectQueue& queue, MockBackend& backend)
+    {
+        GLBufferHandle handle = GLBufferHandle::create(&queue);
+        backend.m_resident.insert(handle.get());
+        handle.setResident(true);
+        return handle;
+    }
+
+    void testBatches()
+    {
+        MockBackend backend;
+        {
+            GLObjectQueue queue(backend, 64);
+            std::vector<GLBufferHandle> buffers;
+            for(int32_t i = 0; i < 1000; i++)
+            {
+                buffers.push_back(GLBufferHandle::create(&queue));
+            }
+            CHECK(backend.m_genCalls == 16);
+            CHECK(queue.getCounters().m_genCalls == 16);
+            CHECK(queue.getCounters().m_created == 1000);
+            CHECK(queue.getCounters().m_spare == 24);
+
+            // Handed out in the order they were generated
+            CHECK(buffers[0].get() == 1 && buffers[999].get() == 1000);
+
+            // Textures come from a batch of their own
+            GLTextureHandle texture = GLTextureHandle::create(&queue);
+            CHECK(backend.m_genCalls == 17);
+            CHECK(backend.m_liveTextures.count(texture.get()) == 1);
+
+            // Growing the vector moves the handles, nothing is released
+            buffers.reserve(5000);
+            CHECK(queue.getCounters().m_pending == 0);
+        }
+        CHECK(backend.m_liveBuffers.empty() && backend.m_liveTextures.empty());
+        CHECK(backend.m_errors == 0);
+    }
+
+    void testFencedDelete()
+    {
+        MockBackend backend;
+        GLObjectQueue queue(backend, 16);
+
+        std::vector<GLBufferHandle> buffers;
+        for(int32_t i = 0; i < 10; i++)
+        {
+            buffers.push_back(i % 2 != 0 ? createResident(queue, backend) : GLBufferHandle::create(&queue));
+        }
+        const GLuint first = buffers[0].get();
+        buffers.clear();
+        CHECK(queue.getCounters().m_pending == 10);
+        CHECK(backend.m_deleteCalls == 0);
+
+        // Frame 0 is fenced, but the GPU has not passed the fence
+        queue.endFrame();
+        CHECK(queue.getCounters().m_fences == 1);
+        CHECK(backend.m_deleteCalls == 0 && backend.m_liveBuffers.count(first) == 1);
+        CHECK(backend.m_resident.size() == 5);
+
+        // A frame without releases costs no fence
+        queue.endFrame();
+        CHECK(queue.getCounters().m_fences == 1);
+
+        GLTextureHandle texture = GLTextureHandle::create(&queue);
+        const GLuint textureName = texture.get();
+        texture.reset();
+        queue.endFrame();
+        CHECK(queue.getCounters().m_fences == 2);
+
+        // The first fence signals: frame 0's buffers go, in one non-resident and one delete call
+        backend.m_signaledUpTo = 1;
+        queue.endFrame();
+        CHECK(backend.m_nonResidentCalls == 1 && backend.m_deleteCalls == 1);
+        CHECK(backend.m_resident.empty() && backend.m_liveBuffers.count(first) == 0);
+        CHECK(backend.m_liveTextures.count(textureName) == 1);
+        CHECK(queue.getCounters().m_pending == 1);
+
+        backend.m_signaledUpTo = 2;
+        queue.endFrame();
+        CHECK(backend.m_deleteCalls == 2 && backend.m_liveTextures.count(textureName) == 0);
+        CHECK(queue.getCounters().m_pending == 0 && queue.getCounters().m_deleted == 11);
+        CHECK(backend.m_fences.empty());
+
+        // Several signaled frames are retired together
+        for(int32_t frame = 0; frame < 3; frame++)
+        {
+            GLBufferHandle buffer = createResident(queue, backend);
+            buffer.reset();
+            queue.endFrame();
+        }
+        CHECK(backend.m_deleteCalls == 2);
+        backend.m_signaledUpTo = 5;
+        queue.endFrame();
+        CHECK(backend.m_deleteCalls == 3 && backend.m_nonResidentCalls == 2);
+        CHECK(queue.getCounters().m_pending == 0);
+        CHECK(backend.m_errors == 0);
+    }
+
+    void testBorrowed()
+    {
+        MockBackend backend;
+        GLObjectQueue queue(backend, 4);
+        GLBufferHandle owner = GLBufferHandle::create(&queue);
+        {
+            GLBufferHandle borrowed = GLBufferHandle::borrow(owner.get());
+            CHECK(borrowed && !borrowed.isOwned());
+            GLBufferHandle moved = std::move(borrowed);
+            CHECK(!borrowed && moved.get() == owner.get());
+        }
+        CHECK(queue.getCounters().m_pending == 0);
+
+        // Moved into itself, the handle keeps its name
+        GLBufferHandle handle = GLBufferHandle::create(&queue);
+        const GLuint name = handle.get();
+        GLBufferHandle& self = handle;
+        handle = std::move(self);
+        CHECK(handle.get() == name && queue.getCounters().m_pending == 0);
+
+        // Assigning over an owning handle releases its old name once
+        handle = std::move(owner);
+        CHECK(!owner && queue.getCounters().m_pending == 1);
+        handle.reset();
+        handle.reset();
+        CHECK(queue.getCounters().m_pending == 2);
+        queue.finish();
+        CHECK(backend.m_liveBuffers.empty() && backend.m_errors == 0);
+    }
+
+    void testFinish()
+    {
+        MockBackend backend;
+        {
+            GLObjectQueue queue(backend, 8);
+            std::vector<GLBufferHandle> buffers;
+            for(int32_t i = 0; i < 20; i++)
+            {
+                buffers.push_back(createResident(queue, backend));
+            }
+            GLTextureHandle texture = GLTextureHandle::create(&queue);
+
+            // Fenced and not signaled, then released in a frame that has no fence yet
+            buffers.resize(10);
+            queue.endFrame();
+            buffers.resize(5);
+            texture.reset();
+            CHECK(queue.getCounters().m_pending == 16);
+
+            queue.finish();
+            CHECK(queue.getCounters().m_pending == 0 && queue.getCounters().m_spare == 0);
+            CHECK(backend.m_liveTextures.empty() && backend.m_liveBuffers.size() == 5);
+            CHECK(backend.m_fences.empty());
+
+            // Handles outliving finish() still go back to the queue, which deletes them when destroyed
+            buffers.clear();
+        }
+        CHECK(backend.m_liveBuffers.empty() && backend.m_resident.empty());
+        CHECK(backend.m_fences.empty() && backend.m_errors == 0);
+    }
+
+    void testWithoutQueue()
+    {
+        // Generated and deleted on their own, straight through GL
+        const size_t buffers = GLStubs::getLiveBuffers();
+        {
+            GLBufferHandle buffer = GLBufferHandle::create(nullptr);
+            GLTextureHandle texture = GLTextureHandle::create(nullptr);
+            CHECK(buffer && texture && buffer.isOwned());
+            CHECK(GLStubs::isBufferLive(buffer.get()));
+            CHECK(GLStubs::getLiveBuffers() == buffers + 1 && GLStubs::getLiveTextures() == 1);
+        }
+        CHECK(GLStubs::getLiveBuffers() == buffers && GLStubs::getLiveTextures() == 0);
+        CHECK(GLStubs::getErrors() == 0);
+    }
+}
+
+
+int main()
+{
+    testBatches();
+    testFencedDelete();
+    testBorrowed();
+    testFinish();
+    testWithoutQueue();
+    return Check::result("GLObjectQueueTest");
+}
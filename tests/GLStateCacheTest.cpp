@@ -0,0 +1,233 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/GLStateCacheTest.cpp
+//
+// GLStateCache in front of a RecordingGLBackend: repeated uniform values, binds
+// and vertex formats never reach the recorder, enable/disable pairs between two
+// draws cost nothing, indexed uniform binds count as binds of the generic target,
+// beginFrame() and invalidate() forget what they should, and the counters add up
+// to the calls that were forwarded and dropped.
+//
+//   g++ -std=c++14 -O2 -Isrc -Itests/stubs tests/GLStateCacheTest.cpp tests/GLStubs.cpp
+//       src/GLStateCache.cpp src/GLBackend.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "GLStateCache.h"
+
+namespace
+{
+    typedef RecordingGLBackend R;
+
+    void testUniforms()
+    {
+        RecordingGLBackend recording;
+        GLStateCache cache(recording);
+
+        // Looked up once per program and name
+        const GLint frame = cache.getUniformLocation(1, "CurrentFrame");
+        CHECK(cache.getUniformLocation(1, "CurrentFrame") == frame);
+        const GLint other = cache.getUniformLocation(2, "CurrentFrame");
+        CHECK(recording.countCalls(R::OpGetUniformLocation) == 2);
+
+        cache.programUniform1i(1, frame, 5);
+        cache.programUniform1i(1, frame, 5);
+        cache.programUniform1i(2, other, 5);        // same location and value, another program
+        cache.programUniform1i(1, frame, 6);
+        CHECK(recording.countCalls(R::OpProgramUniform1i) == 3);
+        CHECK(recording.getCalls().back().m_args[2] == 6);
+
+        // Arrays compare by contents and by length
+        const GLuint64EXT handles[3] = { 10, 20, 30 };
+        cache.programUniformui64v(1, 4, 3, handles);
+        cache.programUniformui64v(1, 4, 3, handles);
+        cache.programUniformui64v(1, 4, 2, handles);
+        const GLuint64EXT changed[3] = { 10, 20, 31 };
+        cache.programUniformui64v(1, 4, 3, changed);
+        CHECK(recording.countCalls(R::OpProgramUniformui64v) == 3);
+
+        // Location -1 is dropped like GL would ignore it
+        cache.programUniform1i(1, -1, 7);
+        CHECK(recording.countCalls(R::OpProgramUniform1i) == 3);
+
+        // Uniform values outlive a frame, but not invalidateProgram()
+        cache.beginFrame();
+        cache.programUniform1i(1, frame, 6);
+        cache.programUniform1i(2, other, 5);
+        CHECK(recording.countCalls(R::OpProgramUniform1i) == 3);
+        cache.invalidateProgram(1);
+        cache.programUniform1i(1, frame, 6);
+        cache.programUniform1i(2, other, 5);
+        CHECK(recording.countCalls(R::OpProgramUniform1i) == 4);
+        CHECK(cache.getUniformLocation(1, "CurrentFrame") == frame);
+        CHECK(recording.countCalls(R::OpGetUniformLocation) == 3);
+
+        cache.invalidate();
+        cache.programUniform1i(2, other, 5);
+        CHECK(recording.countCalls(R::OpProgramUniform1i) == 5);
+    }
+
+    void testBinds()
+    {
+        RecordingGLBackend recording;
+        GLStateCache cache(recording);
+
+        cache.bindBuffer(GL_ARRAY_BUFFER, 3);
+        cache.bindBuffer(GL_ARRAY_BUFFER, 3);
+        cache.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, 3);
+        cache.bindBuffer(GL_ARRAY_BUFFER, 4);
+        CHECK(recording.countCalls(R::OpBindBuffer) == 3);
+
+        // Targets the cache does not track always go through
+        cache.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 5);
+        cache.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 5);
+        CHECK(recording.countCalls(R::OpBindBuffer) == 5);
+
+        // An indexed bind binds the generic target as well
+        cache.bindBufferBase(GL_UNIFORM_BUFFER, 2, 8);
+        cache.bindBuffer(GL_UNIFORM_BUFFER, 8);
+        cache.bindBufferBase(GL_UNIFORM_BUFFER, 2, 8);
+        CHECK(recording.countCalls(R::OpBindBuffer) == 5);
+        CHECK(recording.countCalls(R::OpBindBufferBase) == 1);
+
+        // ... so after another generic bind the same indexed bind has to go out again
+        cache.bindBuffer(GL_UNIFORM_BUFFER, 9);
+        cache.bindBufferBase(GL_UNIFORM_BUFFER, 2, 8);
+        CHECK(recording.countCalls(R::OpBindBufferBase) == 2);
+
+        // Ranges compare offset and size, and a range differs from a whole buffer
+        cache.bindBufferRange(GL_UNIFORM_BUFFER, 2, 8, 256, 64);
+        cache.bindBufferRange(GL_UNIFORM_BUFFER, 2, 8, 256, 64);
+        cache.bindBufferRange(GL_UNIFORM_BUFFER, 2, 8, 512, 64);
+        cache.bindBufferRange(GL_UNIFORM_BUFFER, 3, 8, 512, 64);
+        CHECK(recording.countCalls(R::OpBindBufferRange) == 3);
+        cache.bindBufferBase(GL_UNIFORM_BUFFER, 2, 8);
+        CHECK(recording.countCalls(R::OpBindBufferBase) == 3);
+
+        // Vertex formats
+        cache.vertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, 28);
+        cache.vertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, 28);
+        cache.vertexAttribFormat(1, 3, GL_FLOAT, GL_FALSE, 28);
+        cache.vertexAttribFormat(0, 4, GL_UNSIGNED_BYTE, GL_TRUE, 28);
+        CHECK(recording.countCalls(R::OpVertexAttribFormat) == 3);
+
+        // beginFrame() forgets bindings and formats, other code may have changed them
+        cache.beginFrame();
+        cache.bindBuffer(GL_ARRAY_BUFFER, 4);
+        cache.bindBufferBase(GL_UNIFORM_BUFFER, 2, 8);
+        cache.vertexAttribFormat(1, 3, GL_FLOAT, GL_FALSE, 28);
+        CHECK(recording.countCalls(R::OpBindBuffer) == 7);
+        CHECK(recording.countCalls(R::OpBindBufferBase) == 4);
+        CHECK(recording.countCalls(R::OpVertexAttribFormat) == 4);
+    }
+
+    void testDeferredEnables()
+    {
+        RecordingGLBackend recording;
+        GLStateCache cache(recording);
+
+        // Nothing goes out until the draw
+        cache.enableClientState(GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV);
+        cache.enableVertexAttribArray(0);
+        cache.enableVertexAttribArray(1);
+        CHECK(recording.getCalls().empty());
+        cache.drawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, 0);
+        CHECK(recording.countCalls(R::OpEnableVertexAttribArray) == 2);
+        CHECK(recording.countCalls(R::OpEnableClientState) == 1);
+        CHECK(recording.getCalls().back().m_op == R::OpDrawElements);
+
+        // Disabled after one mesh and enabled again for the next: nothing between the draws
+        recording.clear();
+        for(int32_t mesh = 0; mesh < 10; mesh++)
+        {
+            cache.enableClientState(GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV);
+            cache.enableVertexAttribArray(0);
+            cache.enableVertexAttribArray(1);
+            cache.drawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, 0);
+            cache.disableVertexAttribArray(1);
+            cache.disableVertexAttribArray(0);
+            cache.disableClientState(GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV);
+        }
+        CHECK(recording.getCalls().size() == 10);
+        CHECK(recording.countCalls(R::OpDrawElements) == 10);
+
+        // A bit that really changes goes out once at flush(), VAO 0 through DSA is tracked separately
+        cache.enableVertexArrayAttrib(0, 2);
+        cache.enableVertexArrayAttrib(5, 2);        // other VAOs are not tracked
+        CHECK(recording.countCalls(R::OpEnableVertexArrayAttrib) == 1);
+        cache.flush();
+        CHECK(recording.countCalls(R::OpDisableVertexAttribArray) == 2);
+        CHECK(recording.countCalls(R::OpDisableClientState) == 1);
+        CHECK(recording.countCalls(R::OpEnableVertexArrayAttrib) == 2);
+        cache.flush();
+        CHECK(recording.countCalls(R::OpEnableVertexArrayAttrib) == 2);
+
+        // Untracked caps and indices go straight through
+        cache.enableClientState(GL_VERTEX_ARRAY);
+        cache.enableVertexAttribArray(20);
+        CHECK(recording.countCalls(R::OpEnableClientState) == 1);
+        CHECK(recording.countCalls(R::OpEnableVertexAttribArray) == 1);
+
+        // After beginFrame() the GL state is unknown, so even a disable goes out
+        cache.beginFrame();
+        cache.disableVertexAttribArray(0);
+        cache.flush();
+        CHECK(recording.countCalls(R::OpDisableVertexAttribArray) == 3);
+    }
+
+    void testCounters()
+    {
+        RecordingGLBackend recording;
+        GLStateCache cache(recording);
+        const GLint location = cache.getUniformLocation(1, "UseBindlessUniforms");
+        cache.getUniformLocation(1, "UseBindlessUniforms");
+        cache.programUniform1i(1, location, 1);
+        cache.programUniform1i(1, location, 1);
+        cache.bindBuffer(GL_ARRAY_BUFFER, 3);
+        cache.bindBuffer(GL_ARRAY_BUFFER, 3);
+        cache.bindBuffer(GL_ARRAY_BUFFER, 3);
+        cache.vertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, 28);
+        cache.vertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, 28);
+        cache.enableVertexAttribArray(0);
+        cache.drawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, 0);
+        cache.disableVertexAttribArray(0);
+        cache.enableVertexAttribArray(0);
+        cache.drawElements(GL_TRIANGLES, 3, GL_UNSIGNED_SHORT, 0);
+        cache.namedBufferSubData(3, 0, 4, &location);
+
+        // Nothing is published until the next frame starts
+        CHECK(cache.getFrameCounters().m_issued == 0);
+        cache.beginFrame();
+        const GLStateCache::Counters& counters = cache.getFrameCounters();
+        CHECK(counters.m_issued == recording.getCalls().size());
+        CHECK(counters.m_issued == 8);
+        CHECK(counters.m_locationMisses == 1 && counters.m_locationHits == 1);
+        CHECK(counters.m_skippedUniforms == 1);
+        CHECK(counters.m_skippedBinds == 2);
+        CHECK(counters.m_skippedState == 3);
+
+        // Disabled, every call goes through and is counted as issued
+        cache.setEnabled(false);
+        recording.clear();
+        cache.getUniformLocation(1, "UseBindlessUniforms");
+        cache.programUniform1i(1, location, 1);
+        cache.programUniform1i(1, location, 1);
+        cache.bindBuffer(GL_ARRAY_BUFFER, 3);
+        cache.bindBuffer(GL_ARRAY_BUFFER, 3);
+        cache.enableVertexAttribArray(0);
+        cache.disableVertexAttribArray(0);
+        cache.beginFrame();
+        CHECK(recording.getCalls().size() == 7);
+        CHECK(cache.getFrameCounters().m_issued == 7);
+        CHECK(cache.getFrameCounters().m_skippedBinds == 0 && cache.getFrameCounters().m_skippedUniforms == 0);
+        CHECK(cache.getFrameCounters().m_skippedState == 0);
+    }
+}
+
+
+int main()
+{
+    testUniforms();
+    testBinds();
+    testDeferredEnables();
+    testCounters();
+    return Check::result("GLStateCacheTest");
+}
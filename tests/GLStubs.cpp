@@ -0,0 +1,186 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/GLStubs.cpp
+//----------------------------------------------------------------------------------
+#include "GLStubs.h"
+#include <cstring>
+#include <map>
+#include <set>
+
+namespace
+{
+    GLuint           s_nextName = 1;
+    std::set<GLuint> s_buffers;
+    std::map<GLuint, std::vector<uint8_t> > s_contents;
+    std::set<GLuint> s_residentBuffers;
+    std::set<GLuint> s_textures;
+    size_t           s_errors = 0;
+}
+
+
+size_t GLStubs::getLiveBuffers()                { return s_buffers.size(); }
+size_t GLStubs::getLiveTextures()               { return s_textures.size(); }
+bool   GLStubs::isBufferLive(GLuint name)       { return s_buffers.count(name) != 0; }
+bool   GLStubs::isBufferResident(GLuint name)   { return s_residentBuffers.count(name) != 0; }
+size_t GLStubs::getErrors()                     { return s_errors; }
+
+const std::vector<uint8_t>& GLStubs::getBufferContents(GLuint name)
+{
+    return s_contents[name];
+}
+
+
+extern "C"
+{
+    void APIENTRY glGenBuffers(GLsizei n, GLuint* buffers)
+    {
+        for(GLsizei i = 0; i < n; i++)
+        {
+            buffers[i] = s_nextName++;
+            s_buffers.insert(buffers[i]);
+        }
+    }
+
+    void APIENTRY glDeleteBuffers(GLsizei n, const GLuint* buffers)
+    {
+        for(GLsizei i = 0; i < n; i++)
+        {
+            if(buffers[i] == 0) continue;
+            s_errors += s_buffers.erase(buffers[i]) == 0 ? 1 : 0;
+            s_errors += s_residentBuffers.count(buffers[i]);
+            s_contents.erase(buffers[i]);
+        }
+    }
+
+    void APIENTRY glGenTextures(GLsizei n, GLuint* textures)
+    {
+        for(GLsizei i = 0; i < n; i++)
+        {
+            textures[i] = s_nextName++;
+            s_textures.insert(textures[i]);
+        }
+    }
+
+    void APIENTRY glDeleteTextures(GLsizei n, const GLuint* textures)
+    {
+        for(GLsizei i = 0; i < n; i++)
+        {
+            if(textures[i] == 0) continue;
+            s_errors += s_textures.erase(textures[i]) == 0 ? 1 : 0;
+        }
+    }
+
+    void APIENTRY glNamedBufferDataEXT(GLuint buffer, GLsizeiptr size, const void* data, GLenum)
+    {
+        std::vector<uint8_t>& contents = s_contents[buffer];
+        contents.assign(size_t(size), 0);
+        if(data != nullptr && size != 0)
+        {
+            memcpy(&contents[0], data, size_t(size));
+        }
+    }
+
+    void APIENTRY glNamedBufferSubDataEXT(GLuint buffer, GLintptr offset, GLsizeiptr size, const void* data)
+    {
+        std::vector<uint8_t>& contents = s_contents[buffer];
+        if(offset < 0 || size_t(offset + size) > contents.size())
+        {
+            s_errors++;
+            return;
+        }
+        if(size != 0)
+        {
+            memcpy(&contents[size_t(offset)], data, size_t(size));
+        }
+    }
+
+    void APIENTRY glGetNamedBufferParameterivEXT(GLuint buffer, GLenum, GLint* params)
+    {
+        *params = GLint(s_contents[buffer].size());
+    }
+
+    void APIENTRY glGetNamedBufferSubDataEXT(GLuint buffer, GLintptr offset, GLsizeiptr size, void* data)
+    {
+        const std::vector<uint8_t>& contents = s_contents[buffer];
+        if(offset < 0 || size_t(offset + size) > contents.size())
+        {
+            s_errors++;
+            return;
+        }
+        if(size != 0)
+        {
+            memcpy(data, &contents[size_t(offset)], size_t(size));
+        }
+    }
+
+    void APIENTRY glGetNamedBufferParameterui64vNV(GLuint buffer, GLenum, GLuint64EXT* params)
+    {
+        *params = GLuint64EXT(buffer) << 32;
+    }
+
+    void APIENTRY glMakeNamedBufferResidentNV(GLuint buffer, GLenum)
+    {
+        s_residentBuffers.insert(buffer);
+    }
+
+    void APIENTRY glMakeNamedBufferNonResidentNV(GLuint buffer)
+    {
+        s_errors += s_residentBuffers.erase(buffer) == 0 ? 1 : 0;
+    }
+
+    GLsync APIENTRY glFenceSync(GLenum, GLbitfield)
+    {
+        return reinterpret_cast<GLsync>(uintptr_t(1));
+    }
+
+    GLenum APIENTRY glClientWaitSync(GLsync, GLbitfield, GLuint64)
+    {
+        return GL_ALREADY_SIGNALED;
+    }
+
+    void APIENTRY glDeleteSync(GLsync)
+    {
+    }
+
+    // GLDirectBackend, never called by the tests
+    GLint APIENTRY glGetUniformLocation(GLuint, const GLchar*)                                              { return -1; }
+    void APIENTRY glProgramUniform1iEXT(GLuint, GLint, GLint)                                               {}
+    void APIENTRY glProgramUniformui64vNV(GLuint, GLint, GLsizei, const GLuint64EXT*)                       {}
+    void APIENTRY glEnableVertexAttribArray(GLuint)                                                         {}
+    void APIENTRY glDisableVertexAttribArray(GLuint)                                                        {}
+    void APIENTRY glEnableVertexArrayAttribEXT(GLuint, GLuint)                                              {}
+    void APIENTRY glDisableVertexArrayAttribEXT(GLuint, GLuint)                                             {}
+    void APIENTRY glEnableClientState(GLenum)                                                               {}
+    void APIENTRY glDisableClientState(GLenum)                                                              {}
+    void APIENTRY glVertexAttribFormatNV(GLuint, GLint, GLenum, GLboolean, GLsizei)                         {}
+    void APIENTRY glVertexArrayVertexAttribOffsetEXT(GLuint, GLuint, GLuint, GLint, GLenum, GLboolean, GLsizei, GLintptr) {}
+    void APIENTRY glVertexAttribI2i(GLuint, GLint, GLint)                                                   {}
+    void APIENTRY glBindBuffer(GLenum, GLuint)                                                              {}
+    void APIENTRY glBindBufferBase(GLenum, GLuint, GLuint)                                                  {}
+    void APIENTRY glBindBufferRange(GLenum, GLuint, GLuint, GLintptr, GLsizeiptr)                           {}
+    void APIENTRY glBufferAddressRangeNV(GLenum, GLuint, GLuint64EXT, GLsizeiptr)                           {}
+    void APIENTRY glNamedCopyBufferSubDataEXT(GLuint, GLuint, GLintptr, GLintptr, GLsizeiptr)               {}
+    void APIENTRY glCompressedTextureSubImage2DEXT(GLuint, GLenum, GLint, GLint, GLint, GLsizei, GLsizei, GLenum, GLsizei, const void*) {}
+    void APIENTRY glDrawElements(GLenum, GLsizei, GLenum, const void*)                                      {}
+
+    // Shader and program objects: there is no compiler, every object is 0 and nothing compiles or links
+    GLuint APIENTRY glCreateShader(GLenum)                                                                  { return 0; }
+    void APIENTRY glShaderSource(GLuint, GLsizei, const GLchar* const*, const GLint*)                       {}
+    void APIENTRY glCompileShader(GLuint)                                                                   {}
+    void APIENTRY glGetShaderiv(GLuint, GLenum, GLint*)                                                     {}
+    void APIENTRY glGetShaderInfoLog(GLuint, GLsizei, GLsizei*, GLchar*)                                    {}
+    void APIENTRY glDeleteShader(GLuint)                                                                    {}
+    GLuint APIENTRY glCreateProgram()                                                                       { return 0; }
+    void APIENTRY glAttachShader(GLuint, GLuint)                                                            {}
+    void APIENTRY glDetachShader(GLuint, GLuint)                                                            {}
+    void APIENTRY glProgramParameteri(GLuint, GLenum, GLint)                                                {}
+    void APIENTRY glLinkProgram(GLuint)                                                                     {}
+    void APIENTRY glGetProgramiv(GLuint, GLenum, GLint*)                                                    {}
+    void APIENTRY glGetProgramInfoLog(GLuint, GLsizei, GLsizei*, GLchar*)                                   {}
+    void APIENTRY glGetProgramBinary(GLuint, GLsizei, GLsizei*, GLenum*, void*)                             {}
+    void APIENTRY glProgramBinary(GLuint, GLenum, const void*, GLsizei)                                     {}
+    void APIENTRY glDeleteProgram(GLuint)                                                                   {}
+
+    // GLResidencyBackend, never called by the tests
+    void APIENTRY glMakeTextureHandleResidentNV(GLuint64)                                                   {}
+    void APIENTRY glMakeTextureHandleNonResidentNV(GLuint64)                                                {}
+}
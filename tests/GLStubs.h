@@ -0,0 +1,32 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/GLStubs.h
+//
+// The GL entry points the tested sources call, defined in GLStubs.cpp without a
+// driver. Buffer and texture names are handed out in order and remembered until
+// they are deleted, so a test can check what is alive and resident. Buffers keep
+// the contents written to them.
+//
+// The entry points of GLDirectBackend are defined as well, doing nothing, so
+// tests can link GLBackend.cpp for RecordingGLBackend. So are the shader and
+// program entry points, where nothing ever compiles.
+//----------------------------------------------------------------------------------
+#ifndef GL_STUBS_H
+#define GL_STUBS_H
+
+#include "cinder/gl/gl.h"
+#include <cstddef>
+#include <vector>
+
+namespace GLStubs
+{
+    size_t getLiveBuffers();
+    size_t getLiveTextures();
+    bool   isBufferLive(GLuint name);
+    bool   isBufferResident(GLuint name);
+    // Empty for a buffer that was never written
+    const std::vector<uint8_t>& getBufferContents(GLuint name);
+    // Deleting a name that is not alive, or a buffer that is still resident
+    size_t getErrors();
+}
+
+#endif
@@ -0,0 +1,360 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/GLTraceTest.cpp
+//
+// Trace writing and parsing without a driver: every op through encode() and
+// decode(), varints and argument masks at their edges, corrupt input refused,
+// the process pointer check with and without relocations, and a replay into a
+// RecordingGLBackend that remaps buffer names, GPU addresses (relocated ones in
+// buffer contents too) and uniform locations.
+//
+//   g++ -std=c++14 -O2 -Isrc -Itests/stubs tests/GLTraceTest.cpp tests/GLStubs.cpp src/GLTrace.cpp
+//       src/GLBackend.cpp src/AtomicFile.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "GLStubs.h"
+#include "GLTrace.h"
+#include <cstring>
+
+namespace
+{
+    typedef RecordingGLBackend R;
+
+    GLTrace::Call makeCall(R::Op op, uint64_t a0 = 0, uint64_t a1 = 0, uint64_t a2 = 0, uint64_t a3 = 0,
+                           uint64_t a4 = 0, uint64_t a5 = 0, uint64_t a6 = 0, uint64_t a7 = 0)
+    {
+        GLTrace::Call call;
+        call.m_op = op;
+        const uint64_t args[8] = { a0, a1, a2, a3, a4, a5, a6, a7 };
+        memcpy(call.m_args, args, sizeof(args));
+        return call;
+    }
+
+    std::vector<uint8_t> makeWord(uint64_t value)
+    {
+        std::vector<uint8_t> data(8);
+        memcpy(&data[0], &value, sizeof(value));
+        return data;
+    }
+
+    uint64_t readWord(const std::vector<uint8_t>& data, size_t offset)
+    {
+        uint64_t value;
+        memcpy(&value, &data[offset], sizeof(value));
+        return value;
+    }
+
+    void writeVarint(std::vector<uint8_t>& out, uint64_t value)
+    {
+        while(value >= 0x80)
+        {
+            out.push_back(uint8_t(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(uint8_t(value));
+    }
+
+    bool sameCalls(const std::vector<GLTrace::Call>& a, const std::vector<GLTrace::Call>& b)
+    {
+        if(a.size() != b.size())
+        {
+            return false;
+        }
+        for(size_t i = 0; i < a.size(); i++)
+        {
+            if(a[i].m_op != b[i].m_op || memcmp(a[i].m_args, b[i].m_args, sizeof(a[i].m_args)) != 0 || a[i].m_data != b[i].m_data)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // One call of every op with varied arguments, some with payloads
+    GLTrace makeTrace()
+    {
+        GLTrace trace;
+        GLTrace::Buffer buffer;
+        buffer.m_name    = 100;
+        buffer.m_address = 0x100000000ull;
+        buffer.m_contents.assign(64, 7);
+        trace.m_buffers.push_back(buffer);
+        buffer.m_name    = 200;
+        buffer.m_address = 0;
+        buffer.m_contents.clear();
+        trace.m_buffers.push_back(buffer);
+        trace.addRelocation(200, 8);
+        trace.addRelocation(100, 16);
+
+        trace.m_frames.resize(3);
+        std::vector<GLTrace::Call>& calls = trace.m_frames[0].m_calls;
+        for(int32_t op = 0; op < R::OpCount; op++)
+        {
+            calls.push_back(makeCall(R::Op(op), uint64_t(op), uint64_t(op) << 20, 0, uint64_t(1) << 63, op % 2, 0x7f, 0x80, ~uint64_t(0)));
+            if(op % 3 == 0)
+            {
+                calls.back().m_data.assign(size_t(op + 1), uint8_t(op));
+            }
+        }
+        // All eight arguments set, and none
+        trace.m_frames[1].m_calls.push_back(makeCall(R::OpDrawElements, 1, 2, 3, 4, 5, 6, 7, 8));
+        trace.m_frames[1].m_calls.push_back(makeCall(R::OpDrawElements));
+        return trace;
+    }
+
+    void testRoundTrip()
+    {
+        const GLTrace trace = makeTrace();
+        std::vector<uint8_t> encoded;
+        trace.encode(encoded);
+
+        GLTrace decoded;
+        CHECK(decoded.decode(&encoded[0], encoded.size()));
+        CHECK(decoded.m_buffers.size() == 2);
+        CHECK(decoded.m_buffers[0].m_name == 100 && decoded.m_buffers[0].m_address == 0x100000000ull);
+        CHECK(decoded.m_buffers[0].m_contents == trace.m_buffers[0].m_contents);
+        CHECK(decoded.m_buffers[1].m_contents.empty());
+        CHECK(decoded.m_relocations.size() == 2);
+        CHECK(decoded.isRelocated(100, 16) && decoded.isRelocated(200, 8) && !decoded.isRelocated(100, 8));
+        CHECK(decoded.m_frames.size() == 3);
+        for(size_t f = 0; f < trace.m_frames.size(); f++)
+        {
+            CHECK(sameCalls(decoded.m_frames[f].m_calls, trace.m_frames[f].m_calls));
+        }
+        CHECK(decoded.getCallCount() == uint64_t(R::OpCount) + 2);
+
+        // Encoding again gives the same bytes
+        std::vector<uint8_t> again;
+        decoded.encode(again);
+        CHECK(again == encoded);
+
+        // Zero arguments cost nothing: a call without arguments or payload is op, mask and length
+        GLTrace small;
+        small.m_frames.resize(1);
+        small.m_frames[0].m_calls.push_back(makeCall(R::OpDrawElements));
+        std::vector<uint8_t> empty, one;
+        GLTrace().encode(empty);
+        small.encode(one);
+        CHECK(one.size() == empty.size() + 4);
+
+        GLTrace file;
+        CHECK(trace.write("GLTraceTest.gltrace") && file.read("GLTraceTest.gltrace"));
+        CHECK(sameCalls(file.m_frames[0].m_calls, trace.m_frames[0].m_calls));
+        remove("GLTraceTest.gltrace");
+    }
+
+    void testCorruptInput()
+    {
+        std::vector<uint8_t> encoded;
+        makeTrace().encode(encoded);
+
+        GLTrace decoded;
+        for(size_t size = 0; size < encoded.size(); size++)
+        {
+            CHECK(!decoded.decode(&encoded[0], size));
+            CHECK(decoded.m_frames.empty() && decoded.m_buffers.empty() && decoded.m_relocations.empty());
+        }
+        std::vector<uint8_t> padded(encoded);
+        padded.push_back(0);
+        CHECK(!decoded.decode(&padded[0], padded.size()));
+
+        // Header: magic, version, buffer and frame counts
+        std::vector<uint8_t> header;
+        writeVarint(header, 0x52544c47);
+        writeVarint(header, 2);
+
+        std::vector<uint8_t> data(header);
+        writeVarint(data, uint64_t(1) << 40);
+        writeVarint(data, 0);
+        CHECK(!decoded.decode(&data[0], data.size()));
+
+        data = header;
+        writeVarint(data, 0);
+        writeVarint(data, 0);
+        writeVarint(data, 1000);                // relocations
+        CHECK(!decoded.decode(&data[0], data.size()));
+
+        data = header;
+        writeVarint(data, 0);
+        writeVarint(data, 1);
+        writeVarint(data, 0);
+        writeVarint(data, uint64_t(1) << 50);   // calls
+        CHECK(!decoded.decode(&data[0], data.size()));
+
+        // A varint longer than 64 bits
+        data = header;
+        data.insert(data.end(), 11, 0xff);
+        CHECK(!decoded.decode(&data[0], data.size()));
+
+        data = header;
+        writeVarint(data, 0);
+        writeVarint(data, 1);
+        writeVarint(data, 0);
+        writeVarint(data, 1);
+        data.push_back(uint8_t(R::OpCount));   // op
+        data.push_back(0);                      // mask
+        data.push_back(0);                      // payload
+        CHECK(!decoded.decode(&data[0], data.size()));
+        data[data.size() - 3] = uint8_t(R::OpDrawElements);
+        CHECK(decoded.decode(&data[0], data.size()) && decoded.getCallCount() == 1);
+
+        // Version 1 had no relocations; other versions are refused
+        data.clear();
+        writeVarint(data, 0x52544c47);
+        writeVarint(data, 1);
+        writeVarint(data, 0);
+        writeVarint(data, 1);
+        writeVarint(data, 0);
+        CHECK(decoded.decode(&data[0], data.size()) && decoded.m_frames.size() == 1);
+        data[5] = 3;
+        CHECK(!decoded.decode(&data[0], data.size()));
+    }
+
+    void testProcessPointers()
+    {
+        GLTrace trace;
+        GLTrace::Buffer buffer;
+        buffer.m_name    = 1;
+        buffer.m_address = 0x500000000ull;
+        buffer.m_contents.assign(256, 0);
+        trace.m_buffers.push_back(buffer);
+        buffer.m_name    = 2;
+        buffer.m_address = 0;
+        buffer.m_contents.assign(32, 0);
+        trace.m_buffers.push_back(buffer);
+        trace.m_frames.resize(1);
+        CHECK(!trace.hasProcessPointers());
+
+        // An address inside buffer 1, stored in buffer 2's snapshot
+        const std::vector<uint8_t> pointer = makeWord(0x500000000ull + 128);
+        memcpy(&trace.m_buffers[1].m_contents[16], &pointer[0], 8);
+        CHECK(trace.hasProcessPointers());
+        trace.addRelocation(2, 16);
+        CHECK(!trace.hasProcessPointers());
+
+        // Just past the buffer is not inside it
+        const std::vector<uint8_t> past = makeWord(0x500000000ull + 256);
+        memcpy(&trace.m_buffers[1].m_contents[24], &past[0], 8);
+        CHECK(!trace.hasProcessPointers());
+
+        // Written at offset 8 the word lands on relocated offset 16, at 12 on 20, which is not aligned for a pointer
+        GLTrace::Call write = makeCall(R::OpNamedBufferSubData, 2, 8, 16);
+        write.m_data = makeWord(0);
+        write.m_data.insert(write.m_data.end(), pointer.begin(), pointer.end());
+        trace.m_frames[0].m_calls.push_back(write);
+        CHECK(!trace.hasProcessPointers());
+        trace.m_frames[0].m_calls.back().m_args[1] = 12;
+        CHECK(!trace.hasProcessPointers());
+        trace.m_frames[0].m_calls.back().m_args[1] = 0;
+        CHECK(trace.hasProcessPointers());
+
+        trace.m_frames[0].m_calls.clear();
+        GLTrace::Call data = makeCall(R::OpNamedBufferData, 1, 8);
+        data.m_data = pointer;
+        trace.m_frames[0].m_calls.push_back(data);
+        CHECK(trace.hasProcessPointers());
+
+        // Bindless texture handles in a uniform
+        trace.m_frames[0].m_calls.clear();
+        trace.m_frames[0].m_calls.push_back(makeCall(R::OpProgramUniformui64v, 3, 1, 1));
+        CHECK(trace.hasProcessPointers());
+    }
+
+    void testReplay()
+    {
+        // Buffer 10 is resident at 0x700000000 and holds vertex data, buffer 20 holds a pointer into it at offset 8
+        GLTrace trace;
+        GLTrace::Buffer buffer;
+        buffer.m_name    = 10;
+        buffer.m_address = 0x700000000ull;
+        buffer.m_contents.assign(64, 3);
+        trace.m_buffers.push_back(buffer);
+        buffer.m_name    = 20;
+        buffer.m_address = 0;
+        buffer.m_contents.assign(16, 0);
+        memcpy(&buffer.m_contents[8], &makeWord(0x700000000ull + 32)[0], 8);
+        trace.m_buffers.push_back(buffer);
+        trace.addRelocation(20, 8);
+
+        trace.m_frames.resize(1);
+        std::vector<GLTrace::Call>& calls = trace.m_frames[0].m_calls;
+        GLTrace::Call lookup = makeCall(R::OpGetUniformLocation, 5, 9);
+        const char name[] = "CurrentFrame";
+        lookup.m_data.assign(name, name + sizeof(name));
+        calls.push_back(lookup);
+        calls.push_back(makeCall(R::OpProgramUniform1i, 5, 9, 42));
+        calls.push_back(makeCall(R::OpBindBufferBase, GL_UNIFORM_BUFFER, 2, 20));
+        calls.push_back(makeCall(R::OpBindBuffer, GL_ARRAY_BUFFER, 99));
+        calls.push_back(makeCall(R::OpBufferAddressRange, GL_VERTEX_ATTRIB_ARRAY_ADDRESS_NV, 0, 0x700000000ull + 16, 48));
+        calls.push_back(makeCall(R::OpVertexAttribI2i, 2, 0x10, 0x7));
+        GLTrace::Call write = makeCall(R::OpNamedBufferSubData, 20, 0, 16);
+        write.m_data.assign(16, 0);
+        memcpy(&write.m_data[8], &makeWord(0x700000000ull + 40)[0], 8);
+        calls.push_back(write);
+        calls.push_back(makeCall(R::OpDrawElements, GL_TRIANGLES, 36, GL_UNSIGNED_SHORT));
+        CHECK(!trace.hasProcessPointers());
+
+        // The stand-in replays without buffers: names and addresses pass through
+        {
+            GLTraceReplayer replayer(trace);
+            RecordingGLBackend recording;
+            const GLTraceReplayer::Stats stats = replayer.replay(recording, 2);
+            CHECK(stats.m_frames == 2 && stats.m_calls == 2 * calls.size());
+            CHECK(recording.getCalls().size() == 2 * calls.size());
+            CHECK(recording.getCalls()[2].m_args[2] == 20);
+            CHECK(readWord(recording.getCalls()[6].m_data, 8) == 0x700000000ull + 40);
+        }
+
+        const size_t liveBuffers = GLStubs::getLiveBuffers();
+        GLTraceReplayer replayer(trace);
+        CHECK(replayer.createBuffers() && replayer.canDraw());
+        CHECK(GLStubs::getLiveBuffers() == liveBuffers + 2);
+        replayer.setProgram(77);
+
+        RecordingGLBackend recording;
+        replayer.replay(recording, 1);
+        const std::vector<GLTrace::Call>& replayed = recording.getCalls();
+        CHECK(replayed.size() == calls.size());
+
+        // The stubs give buffer n the address n << 32
+        const GLuint   newUniforms = GLuint(replayed[2].m_args[2]);
+        CHECK(newUniforms != 20 && GLStubs::isBufferLive(newUniforms));
+        CHECK(replayed[3].m_args[1] == 99);
+        const uint64_t newAddress = replayed[4].m_args[2] - 16;
+        CHECK(GLStubs::isBufferResident(GLuint(newAddress >> 32)) && newAddress != 0x700000000ull);
+        CHECK((replayed[5].m_args[2] << 32 | replayed[5].m_args[1]) == newAddress + 0x700000010ull - 0x700000000ull);
+
+        // Program replaced, and the location looked up again by name in it
+        CHECK(replayed[0].m_args[0] == 77 && replayed[1].m_args[0] == 77);
+        CHECK(replayed[1].m_args[1] == replayed[0].m_args[1] && replayed[1].m_args[1] != 9);
+        CHECK(replayed[1].m_args[2] == 42);
+
+        // The relocated pointer in the write and in the snapshot points into the new buffer
+        CHECK(readWord(replayed[6].m_data, 8) == newAddress + 40);
+        CHECK(readWord(replayed[6].m_data, 0) == 0);
+        CHECK(readWord(GLStubs::getBufferContents(newUniforms), 8) == newAddress + 32);
+        CHECK(GLStubs::getBufferContents(GLuint(newAddress >> 32)) == trace.m_buffers[0].m_contents);
+        // The trace itself is left alone
+        CHECK(readWord(calls[6].m_data, 8) == 0x700000000ull + 40);
+
+        replayer.releaseBuffers();
+        CHECK(!replayer.canDraw() && GLStubs::getLiveBuffers() == liveBuffers);
+
+        // Without the relocation the pointer stays the capturing process's, and the trace is not drawn
+        GLTrace unrelocated(trace);
+        unrelocated.m_relocations.clear();
+        GLTraceReplayer refused(unrelocated);
+        CHECK(!refused.createBuffers() && !refused.canDraw());
+        CHECK(GLStubs::getLiveBuffers() == liveBuffers);
+        CHECK(GLStubs::getErrors() == 0);
+    }
+}
+
+
+int main()
+{
+    testRoundTrip();
+    testCorruptInput();
+    testProcessPointers();
+    testReplay();
+    return Check::result("GLTraceTest");
+}
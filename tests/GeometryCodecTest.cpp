@@ -0,0 +1,210 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/GeometryCodecTest.cpp
+//
+// Round trips of the geometry codec: every vertex stride up to MaxVertexStride
+// with counts on and off the 16 vertex groups, random and degenerate index
+// streams, and truncated, padded or random input, which has to be rejected (or
+// at least decoded without touching memory past the output).
+//
+//   g++ -std=c++14 -O2 -msse2 -Isrc tests/GeometryCodecTest.cpp src/GeometryCodec.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "GeometryCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+    std::mt19937 s_random(1);
+
+    uint32_t random(uint32_t range)
+    {
+        return uint32_t(s_random() % range);
+    }
+
+    // Mostly small values with some noise, so all the plane widths are used
+    void fillVertices(std::vector<uint8_t>& data)
+    {
+        for(size_t i = 0; i < data.size(); i++)
+        {
+            data[i] = random(3) == 0 ? uint8_t(s_random()) : uint8_t(random(4));
+        }
+    }
+
+    void checkVertices(const std::vector<uint8_t>& source, size_t count, size_t stride)
+    {
+        std::vector<uint8_t> encoded;
+        CHECK(GeometryCodec::encodeVertices(source.data(), count, stride, encoded));
+
+        // One guard byte behind the output
+        std::vector<uint8_t> decoded(stride * count + 1, 0xCD);
+        CHECK(GeometryCodec::decodeVertices(encoded.data(), encoded.size(), decoded.data(), count, stride));
+        CHECK(source.empty() || memcmp(source.data(), decoded.data(), source.size()) == 0);
+        CHECK(decoded[stride * count] == 0xCD);
+
+        // Every shorter stream fails, and so does a longer one
+        for(size_t size = 0; size < encoded.size(); size += (encoded.size() > 64 ? 7 : 1))
+        {
+            CHECK(!GeometryCodec::decodeVertices(encoded.data(), size, decoded.data(), count, stride));
+        }
+        std::vector<uint8_t> padded(encoded);
+        padded.push_back(0);
+        CHECK(!GeometryCodec::decodeVertices(padded.data(), padded.size(), decoded.data(), count, stride));
+        CHECK(decoded[stride * count] == 0xCD);
+
+        // Random bytes may decode to anything, but only within the output
+        for(int32_t g = 0; g < 8; g++)
+        {
+            std::vector<uint8_t> junk(encoded.size());
+            for(size_t i = 0; i < junk.size(); i++)
+            {
+                junk[i] = uint8_t(s_random());
+            }
+            GeometryCodec::decodeVertices(junk.data(), junk.size(), decoded.data(), count, stride);
+            CHECK(decoded[stride * count] == 0xCD);
+        }
+    }
+
+    void testVertices()
+    {
+        const size_t counts[] = { 0, 1, 2, 15, 16, 17, 31, 33, 100, 1000 };
+        for(size_t stride = 4; stride <= GeometryCodec::MaxVertexStride; stride += 4)
+        {
+            for(size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+            {
+                // The long strides with the large count only every so often, to keep the run short
+                if(counts[c] == 1000 && stride % 64 != 0 && stride != 4 && stride != 28)
+                {
+                    continue;
+                }
+                std::vector<uint8_t> source(stride * counts[c]);
+                fillVertices(source);
+                checkVertices(source, counts[c], stride);
+            }
+        }
+
+        // Constant, all zero and all ones data
+        for(size_t stride = 4; stride <= GeometryCodec::MaxVertexStride; stride *= 2)
+        {
+            std::vector<uint8_t> zeros(stride * 37, 0), ones(stride * 37, 0xFF), constant(stride * 37);
+            for(size_t i = 0; i < constant.size(); i++)
+            {
+                constant[i] = uint8_t(i % stride);
+            }
+            checkVertices(zeros, 37, stride);
+            checkVertices(ones, 37, stride);
+            checkVertices(constant, 37, stride);
+        }
+
+        // Strides the codec does not take
+        std::vector<uint8_t> encoded;
+        const uint8_t vertex[512] = { 0 };
+        CHECK(!GeometryCodec::encodeVertices(vertex, 1, 6, encoded));
+        CHECK(!GeometryCodec::encodeVertices(vertex, 1, 0, encoded));
+        CHECK(!GeometryCodec::encodeVertices(vertex, 1, GeometryCodec::MaxVertexStride + 4, encoded));
+    }
+
+    void checkIndices(const std::vector<uint32_t>& indices)
+    {
+        std::vector<uint8_t> encoded;
+        GeometryCodec::encodeIndices(indices.data(), indices.size(), encoded);
+
+        std::vector<uint32_t> decoded(indices.size() + 1, 0xCDCDCDCDu);
+        CHECK(GeometryCodec::decodeIndices(encoded.data(), encoded.size(), decoded.data(), indices.size()));
+        CHECK(std::equal(indices.begin(), indices.end(), decoded.begin()));
+        CHECK(decoded[indices.size()] == 0xCDCDCDCDu);
+
+        for(size_t size = 0; size < encoded.size(); size += (encoded.size() > 64 ? 5 : 1))
+        {
+            CHECK(!GeometryCodec::decodeIndices(encoded.data(), size, decoded.data(), indices.size()));
+        }
+
+        for(int32_t g = 0; g < 8; g++)
+        {
+            std::vector<uint8_t> junk(encoded.size());
+            for(size_t i = 0; i < junk.size(); i++)
+            {
+                junk[i] = uint8_t(s_random());
+            }
+            GeometryCodec::decodeIndices(junk.data(), junk.size(), decoded.data(), indices.size());
+            CHECK(decoded[indices.size()] == 0xCDCDCDCDu);
+        }
+    }
+
+    void testIndices()
+    {
+        // Random triangles, mostly over a small vertex range
+        for(int32_t run = 0; run < 200; run++)
+        {
+            std::vector<uint32_t> indices(random(100) * 3);
+            for(size_t i = 0; i < indices.size(); i++)
+            {
+                indices[i] = random(4) == 0 ? uint32_t(s_random()) : random(50);
+            }
+            checkIndices(indices);
+        }
+
+        std::vector<uint32_t> indices;
+        checkIndices(indices);
+
+        // Degenerate: one vertex repeated, and repeated triangles
+        indices.assign(300, 0);
+        checkIndices(indices);
+        indices.assign(300, 7);
+        checkIndices(indices);
+        indices.clear();
+        for(int32_t i = 0; i < 100; i++)
+        {
+            const uint32_t triangle[3] = { 3, 4, 5 };
+            indices.insert(indices.end(), triangle, triangle + 3);
+        }
+        checkIndices(indices);
+
+        // Two equal indices in each triangle, and the largest index values
+        indices.clear();
+        for(uint32_t i = 0; i < 100; i++)
+        {
+            const uint32_t triangle[3] = { i, i, i + 1 };
+            indices.insert(indices.end(), triangle, triangle + 3);
+        }
+        checkIndices(indices);
+        indices.clear();
+        for(uint32_t i = 0; i < 99; i++)
+        {
+            indices.push_back(0xFFFFFFFFu - random(3));
+        }
+        checkIndices(indices);
+
+        // The shapes the two bit codes are for: new triangles, fans and strips
+        indices.clear();
+        for(uint32_t i = 0; i < 300; i++)
+        {
+            indices.push_back(i);
+        }
+        checkIndices(indices);
+        indices.clear();
+        for(uint32_t i = 1; i < 100; i++)
+        {
+            const uint32_t triangle[3] = { 0, i, i + 1 };
+            indices.insert(indices.end(), triangle, triangle + 3);
+        }
+        checkIndices(indices);
+        indices.clear();
+        for(uint32_t i = 0; i < 100; i++)
+        {
+            const uint32_t triangle[3] = { i, i + 1, i + 2 };
+            indices.insert(indices.end(), triangle, triangle + 3);
+        }
+        checkIndices(indices);
+    }
+}
+
+
+int main()
+{
+    testVertices();
+    testIndices();
+    return Check::result("GeometryCodecTest");
+}
@@ -0,0 +1,166 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/MaterialTableTest.cpp
+//
+// The CPU side of the material table: the 32 byte Material the shader indexes,
+// the animation frame each material samples as its phase wraps, materials that
+// would read past the handle array being refused, and the runs update() reports
+// after edits (everything once, then only what changed).
+//
+//   g++ -std=c++14 -O2 -Isrc tests/MaterialTableTest.cpp src/MaterialTable.cpp src/DirtyRangeTracker.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "MaterialTable.h"
+#include <cstddef>
+
+namespace
+{
+    typedef MaterialTable::Material Material;
+
+    // std430 layout of struct Material in simple_vertex.glsl
+    static_assert(sizeof(Material) == 32, "Material is 8 words in the shader");
+    static_assert(offsetof(Material, m_frameCount) == 8, "Material layout");
+    static_assert(offsetof(Material, m_tint) == 16, "Material layout");
+    static_assert(offsetof(Material, m_displacementScale) == 20, "Material layout");
+
+    Material makeMaterial(uint32_t firstTexture, uint32_t firstDisplacement, uint32_t frameCount, uint32_t phase)
+    {
+        const Material material = { firstTexture, firstDisplacement, frameCount, phase, 0xffffffff, 1.0f, { 0, 0 } };
+        return material;
+    }
+
+    void testLayout()
+    {
+        MaterialTable table(10, 10, 0);
+        CHECK(table.getMaterialBufferBytes() == 10 * 32);
+        CHECK(table.getHandleBufferBytes() == 10 * 8);
+
+        // Capacities are clamped to what the 16 bit ID reaches, and never empty
+        MaterialTable big(1000000, 0, 0);
+        CHECK(big.getMaterialCapacity() == MaterialTable::MaxMaterials);
+        CHECK(big.getHandleCapacity() == 1);
+        MaterialTable empty(0, 0, 0);
+        CHECK(empty.getMaterialBufferBytes() == 32);
+        CHECK(empty.updateMaterials().empty());
+    }
+
+    void testFrames()
+    {
+        CHECK(MaterialTable::getFrame(makeMaterial(0, 0, 1, 0), 12345) == 0);
+
+        const Material material = makeMaterial(0, 0, 4, 3);
+        const uint32_t expected[] = { 3, 0, 1, 2, 3, 0, 1, 2, 3 };
+        for(uint32_t frame = 0; frame < 9; frame++)
+        {
+            CHECK(MaterialTable::getFrame(material, frame) == expected[frame]);
+        }
+        // A phase beyond the frame count wraps as well
+        CHECK(MaterialTable::getFrame(makeMaterial(0, 0, 4, 9), 0) == 1);
+        CHECK(MaterialTable::getFrame(makeMaterial(0, 0, 3, 5), 1000) == 0);
+
+        // The handles each frame samples, colors and displacements alike
+        MaterialTable table(4, 10, 0);
+        const uint64_t handles[6] = { 11, 12, 13, 21, 22, 23 };
+        CHECK(table.addHandles(handles, 6) == 0);
+        CHECK(table.add(makeMaterial(0, 3, 3, 0)) == 0);
+        CHECK(table.add(makeMaterial(0, 3, 3, 1)) == 1);
+        CHECK(table.getTexture(0, 0) == 11 && table.getTexture(0, 4) == 12);
+        CHECK(table.getTexture(1, 2) == 11 && table.getDisplacement(1, 0) == 22);
+        CHECK(table.getTexture(1, 3 * 1000 + 2) == 11);
+    }
+
+    void testValidation()
+    {
+        MaterialTable table(3, 8, 0);
+        const uint64_t handles[6] = { 1, 2, 3, 4, 5, 6 };
+        CHECK(table.addHandles(handles, 3) == 0);
+        CHECK(table.addHandles(handles, 3) == 3);
+        CHECK(table.addHandles(handles, 3) == MaterialTable::InvalidId);
+        CHECK(table.getHandleCount() == 6);
+        CHECK(!table.setHandle(6, 1));
+
+        CHECK(table.add(makeMaterial(0, 0, 0, 0)) == MaterialTable::InvalidId);
+        CHECK(table.add(makeMaterial(4, 0, 3, 0)) == MaterialTable::InvalidId);
+        CHECK(table.add(makeMaterial(0, 0xffffffff, 2, 0)) == MaterialTable::InvalidId);
+        CHECK(table.add(makeMaterial(3, 0, 3, 0)) == 0);
+
+        // A refused edit leaves the entry as it was
+        CHECK(!table.set(0, makeMaterial(0, 4, 3, 0)));
+        CHECK(!table.set(1, makeMaterial(0, 0, 1, 0)));
+        CHECK(table.getMaterial(0).m_firstTexture == 3);
+
+        CHECK(table.add(makeMaterial(0, 0, 1, 0)) == 1);
+        CHECK(table.add(makeMaterial(0, 0, 1, 0)) == 2);
+        CHECK(table.add(makeMaterial(0, 0, 1, 0)) == MaterialTable::InvalidId);
+        CHECK(table.getMaterialCount() == 3);
+    }
+
+    void testDirtyRanges()
+    {
+        MaterialTable table(16, 16, 1);
+        const uint64_t handles[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        table.addHandles(handles, 8);
+        for(uint32_t i = 0; i < 10; i++)
+        {
+            table.add(makeMaterial(i % 4, 4, 1, 0));
+        }
+
+        // Everything in use is sent once, then nothing while no one edits
+        const std::vector<DirtyRangeTracker::Range>& materials = table.updateMaterials();
+        CHECK(materials.size() == 1 && materials[0].m_first == 0 && materials[0].m_count == 10);
+        CHECK(table.updateMaterials().empty());
+        CHECK(table.getMaterialStats().m_uploadedBytes == 0);
+        const std::vector<DirtyRangeTracker::Range>& first = table.updateHandles();
+        CHECK(first.size() == 1 && first[0].m_count == 8);
+        CHECK(table.updateHandles().empty());
+
+        // One edit is one material
+        Material material = table.getMaterial(5);
+        material.m_tint = 5;
+        CHECK(table.set(5, material));
+        const std::vector<DirtyRangeTracker::Range>& one = table.updateMaterials();
+        CHECK(one.size() == 1 && one[0].m_first == 5 && one[0].m_count == 1);
+        CHECK(table.getMaterialStats().m_uploadedBytes == 32);
+
+        // Setting what is there already changes nothing
+        CHECK(table.set(5, material));
+        CHECK(table.updateMaterials().empty());
+
+        // Edits one apart are merged across the gap, further ones are not
+        material.m_tint = 6;
+        table.set(1, material);
+        table.set(3, material);
+        table.set(8, material);
+        const std::vector<DirtyRangeTracker::Range>& runs = table.updateMaterials();
+        CHECK(runs.size() == 2);
+        CHECK(runs[0].m_first == 1 && runs[0].m_count == 3);
+        CHECK(runs[1].m_first == 8 && runs[1].m_count == 1);
+        CHECK(table.getMaterialStats().m_changedElements == 3);
+        CHECK(table.getMaterialStats().m_uploadedElements == 4);
+
+        // Added materials and edited handles
+        CHECK(table.add(material) == 10);
+        CHECK(table.setHandle(4, 99));
+        const std::vector<DirtyRangeTracker::Range>& added = table.updateMaterials();
+        CHECK(added.size() == 1 && added[0].m_first == 10 && added[0].m_count == 1);
+        const std::vector<DirtyRangeTracker::Range>& edited = table.updateHandles();
+        CHECK(edited.size() == 1 && edited[0].m_first == 4 && edited[0].m_count == 1);
+        CHECK(table.getDisplacement(0, 0) == 99);
+
+        // New buffers get everything again
+        table.invalidate();
+        const std::vector<DirtyRangeTracker::Range>& all = table.updateMaterials();
+        CHECK(all.size() == 1 && all[0].m_first == 0 && all[0].m_count == 11);
+        CHECK(table.updateHandles().size() == 1);
+        CHECK(table.updateMaterials().empty() && table.updateHandles().empty());
+    }
+}
+
+
+int main()
+{
+    testLayout();
+    testFrames();
+    testValidation();
+    testDirtyRanges();
+    return Check::result("MaterialTableTest");
+}
@@ -0,0 +1,176 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/MipGeneratorTest.cpp
+//
+// Golden values for the CPU mip chain: a checker averages to the midpoint in
+// linear space and to the sRGB encoding of it in sRGB space, constant images
+// stay constant through the whole chain with either filter, box levels are the
+// block averages, and odd sizes are area weighted.
+//
+//   g++ -std=c++14 -O2 -msse2 -Isrc tests/MipGeneratorTest.cpp src/MipGenerator.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "MipGenerator.h"
+#include <cstdlib>
+#include <vector>
+
+namespace
+{
+    void fill(uint8_t* texel, uint8_t rgb, uint8_t a)
+    {
+        texel[0] = texel[1] = texel[2] = rgb;
+        texel[3] = a;
+    }
+
+    void testSrgb()
+    {
+        for(int32_t i = 0; i < 256; i++)
+        {
+            CHECK(MipGenerator::linearToSrgb(MipGenerator::srgbToLinear(uint8_t(i))) == i);
+        }
+        CHECK(MipGenerator::srgbToLinear(0) == 0.0f);
+        CHECK(MipGenerator::srgbToLinear(255) == 1.0f);
+        // The sRGB encoding of half intensity
+        CHECK(MipGenerator::linearToSrgb(0.5f) == 188);
+    }
+
+    void testLevelCount()
+    {
+        CHECK(MipGenerator::getLevelCount(100, 100) == 7);
+        CHECK(MipGenerator::getLevelCount(1, 1) == 1);
+        CHECK(MipGenerator::getLevelCount(4, 1) == 3);
+        CHECK(MipGenerator::getLevelSize(25, 1) == 12);
+        CHECK(MipGenerator::getLevelSize(3, 4) == 1);
+    }
+
+    void testChecker()
+    {
+        // 2x2 black and white checker, alpha alike
+        uint8_t checker[16];
+        for(int32_t i = 0; i < 4; i++)
+        {
+            const uint8_t value = (i == 0 || i == 3) ? 255 : 0;
+            fill(checker + i * 4, value, value);
+        }
+
+        uint8_t out[4];
+        MipGenerator::resample(checker, 2, 2, out, 1, 1, MipGenerator::FilterBox, 0);
+        CHECK(out[0] == 128 && out[1] == 128 && out[2] == 128 && out[3] == 128);
+
+        // Averaged as light, which is brighter than the average of the encoded values; alpha stays linear
+        MipGenerator::resample(checker, 2, 2, out, 1, 1, MipGenerator::FilterBox, MipGenerator::SrgbColor);
+        CHECK(out[0] == 188 && out[1] == 188 && out[2] == 188 && out[3] == 128);
+
+        // A larger checker through the whole chain: every level is the flat midpoint
+        const int32_t size = 64;
+        std::vector<uint8_t> image(size * size * 4);
+        for(int32_t y = 0; y < size; y++)
+        {
+            for(int32_t x = 0; x < size; x++)
+            {
+                const uint8_t value = ((x + y) & 1) ? 255 : 0;
+                fill(&image[(y * size + x) * 4], value, value);
+            }
+        }
+        std::vector<MipGenerator::Level> levels;
+        MipGenerator::generateChain(&image[0], size, size, MipGenerator::FilterBox, MipGenerator::SrgbColor, levels);
+        CHECK(levels.size() == 6);
+        for(size_t l = 0; l < levels.size(); l++)
+        {
+            for(size_t i = 0; i < levels[l].m_rgba.size(); i += 4)
+            {
+                CHECK(levels[l].m_rgba[i] == 188 && levels[l].m_rgba[i + 3] == 128);
+            }
+        }
+    }
+
+    void testConstant()
+    {
+        std::vector<uint8_t> image(100 * 100 * 4);
+        for(size_t i = 0; i < image.size(); i++)
+        {
+            image[i] = uint8_t(37 + (i & 3) * 50);
+        }
+
+        const MipGenerator::Filter filters[] = { MipGenerator::FilterBox, MipGenerator::FilterKaiser };
+        for(int32_t f = 0; f < 2; f++)
+        {
+            std::vector<MipGenerator::Level> levels;
+            MipGenerator::generateChain(&image[0], 100, 100, filters[f], MipGenerator::SrgbColor, levels);
+            CHECK(levels.size() == 6);
+            CHECK(levels[0].m_width == 50 && levels[1].m_width == 25 && levels[2].m_width == 12);
+            CHECK(levels[5].m_width == 1 && levels[5].m_height == 1);
+            for(size_t l = 0; l < levels.size(); l++)
+            {
+                CHECK(levels[l].m_rgba.size() == size_t(levels[l].m_width * levels[l].m_height * 4));
+                for(size_t i = 0; i < levels[l].m_rgba.size(); i++)
+                {
+                    CHECK(levels[l].m_rgba[i] == image[i & 3]);
+                }
+            }
+        }
+    }
+
+    void testBlockAverages()
+    {
+        uint8_t image[64];
+        for(int32_t i = 0; i < 64; i++)
+        {
+            image[i] = uint8_t(i * 4);
+        }
+        uint8_t out[16];
+        MipGenerator::resample(image, 4, 4, out, 2, 2, MipGenerator::FilterBox, 0);
+        for(int32_t y = 0; y < 2; y++)
+        {
+            for(int32_t x = 0; x < 2; x++)
+            {
+                for(int32_t c = 0; c < 4; c++)
+                {
+                    int32_t sum = 0;
+                    for(int32_t dy = 0; dy < 2; dy++)
+                    {
+                        for(int32_t dx = 0; dx < 2; dx++)
+                        {
+                            sum += image[((y * 2 + dy) * 4 + x * 2 + dx) * 4 + c];
+                        }
+                    }
+                    CHECK(abs(out[(y * 2 + x) * 4 + c] - (sum + 2) / 4) <= 1);
+                }
+            }
+        }
+    }
+
+    void testOddSizes()
+    {
+        // 3 -> 1 averages all three texels with equal weight
+        uint8_t row[12] = { 0, 0, 0, 0, 90, 90, 90, 90, 210, 210, 210, 210 };
+        uint8_t out[8];
+        MipGenerator::resample(row, 3, 1, out, 1, 1, MipGenerator::FilterBox, 0);
+        CHECK(out[0] == 100 && out[3] == 100);
+
+        // 3 -> 2: each output covers one and a half texels, the middle one shared
+        MipGenerator::resample(row, 3, 1, out, 2, 1, MipGenerator::FilterBox, 0);
+        CHECK(out[0] == 30 && out[4] == 170);
+
+        // Odd sizes all the way down end at 1x1, and the sizes halve rounding down
+        std::vector<uint8_t> image(25 * 7 * 4, 200);
+        std::vector<MipGenerator::Level> levels;
+        MipGenerator::generateChain(&image[0], 25, 7, MipGenerator::FilterKaiser, MipGenerator::SrgbColor, levels);
+        CHECK(levels.size() == 4);
+        CHECK(levels[0].m_width == 12 && levels[0].m_height == 3);
+        CHECK(levels[1].m_width == 6 && levels[1].m_height == 1);
+        CHECK(levels[3].m_width == 1 && levels[3].m_height == 1);
+        CHECK(levels[3].m_rgba[0] == 200);
+    }
+}
+
+
+int main()
+{
+    testSrgb();
+    testLevelCount();
+    testChecker();
+    testConstant();
+    testBlockAverages();
+    testOddSizes();
+    return Check::result("MipGeneratorTest");
+}
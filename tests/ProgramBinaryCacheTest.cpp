@@ -0,0 +1,205 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/ProgramBinaryCacheTest.cpp
+//
+// The parts of ProgramBinaryCache and ShaderVariants that do not need a driver:
+// cache keys that change with every input (also when text moves from one input
+// to the next), defines placed after the #version/#extension preamble of sources
+// with and without a license comment or a trailing newline, cache entries that
+// survive a store/load round trip while wrong, corrupt and truncated ones are
+// refused, and the variant keys, defines and names. Nothing compiles in the GL
+// stubs, so programs come back as 0.
+//
+//   g++ -std=c++14 -O2 -Isrc -Itests/stubs tests/ProgramBinaryCacheTest.cpp tests/GLStubs.cpp
+//       src/ProgramBinaryCache.cpp src/ShaderVariants.cpp src/AtomicFile.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "GLStubs.h"
+#include "ShaderVariants.h"
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+namespace
+{
+    const char* Directory = ".";
+
+    std::vector<uint8_t> readFile(const std::string& path)
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        return std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    }
+
+    void writeFile(const std::string& path, const std::vector<uint8_t>& data)
+    {
+        std::ofstream file(path.c_str(), std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    }
+
+    void testKeys()
+    {
+        ProgramBinaryCache cache(Directory, "renderer 1.0");
+        const uint64_t key = cache.computeKey("vertex", "fragment", "#define A\n");
+        CHECK(cache.computeKey("vertex", "fragment", "#define A\n") == key);
+
+        // Every part counts, the driver identity included
+        CHECK(cache.computeKey("vertex ", "fragment", "#define A\n") != key);
+        CHECK(cache.computeKey("vertex", "fragmenT", "#define A\n") != key);
+        CHECK(cache.computeKey("vertex", "fragment", "#define B\n") != key);
+        CHECK(cache.computeKey("vertex", "fragment", "") != key);
+        CHECK(ProgramBinaryCache(Directory, "renderer 1.1").computeKey("vertex", "fragment", "#define A\n") != key);
+
+        // Text moved from one part to the next
+        CHECK(cache.computeKey("vertexf", "ragment", "#define A\n") != key);
+        CHECK(cache.computeKey("vertex", "fragment#define A\n", "") != key);
+        CHECK(cache.computeKey("", "vertexfragment", "#define A\n") != cache.computeKey("vertexfragment", "", "#define A\n"));
+        CHECK(ProgramBinaryCache(Directory, "").computeKey("a", "b", "c") != ProgramBinaryCache(Directory, "c").computeKey("a", "b", ""));
+
+        // The hash chains through its seed
+        CHECK(ProgramBinaryCache::hash("abcd", 4) == ProgramBinaryCache::hash("cd", 2, ProgramBinaryCache::hash("ab", 2)));
+        CHECK(ProgramBinaryCache::hash("", 0) == 0xcbf29ce484222325ULL);
+
+        CHECK(ProgramBinaryCache("cache", "").getPath(0x1234abcdULL) == "cache/000000001234abcd.bin");
+    }
+
+    void testInjectDefines()
+    {
+        const std::string defines = "#define USE_BINDLESS_UNIFORMS\n";
+        CHECK(ProgramBinaryCache::injectDefines("#version 420\nvoid main() {}\n", "") == "#version 420\nvoid main() {}\n");
+
+        // License comment, then the preamble, then a comment: the defines go right after the last directive
+        const std::string shader =
+            "//------\r\n"
+            "// License\r\n"
+            "//\r\n"
+            "#version 420\r\n"
+            "\r\n"
+            "  #extension GL_NV_shader_buffer_load : require\r\n"
+            "#extension GL_NV_gpu_shader5 : require // uint64_t\r\n"
+            "// USE_BINDLESS_UNIFORMS is injected\r\n"
+            "struct PerMeshUniforms;\r\n";
+        const size_t split = shader.find("// USE_");
+        CHECK(ProgramBinaryCache::injectDefines(shader, defines) == shader.substr(0, split) + defines + shader.substr(split));
+
+        // Without a preamble they come first, comments or not
+        CHECK(ProgramBinaryCache::injectDefines("void main() {}\n", defines) == defines + "void main() {}\n");
+        CHECK(ProgramBinaryCache::injectDefines("// comment\nvoid main() {}", defines) == defines + "// comment\nvoid main() {}");
+
+        // A directive after the first line of code is not part of the preamble
+        CHECK(ProgramBinaryCache::injectDefines("#version 420\nint x;\n#extension GL_foo : enable\n", defines) ==
+              "#version 420\n" + defines + "int x;\n#extension GL_foo : enable\n");
+
+        // No trailing newline after the preamble, or after the defines
+        CHECK(ProgramBinaryCache::injectDefines("#version 420", defines) == "#version 420\n" + defines);
+        CHECK(ProgramBinaryCache::injectDefines("#version 420\n#extension GL_foo : enable", "#define A") ==
+              "#version 420\n#extension GL_foo : enable\n#define A\n");
+        CHECK(ProgramBinaryCache::injectDefines("", "#define A") == "#define A\n");
+    }
+
+    void testStoreLoad()
+    {
+        ProgramBinaryCache cache(Directory, "renderer 1.0");
+        const uint64_t key = cache.computeKey("vertex", "fragment", "");
+        std::vector<uint8_t> binary(1000);
+        for(size_t i = 0; i < binary.size(); i++)
+        {
+            binary[i] = uint8_t(i * 7);
+        }
+
+        GLenum               format = 0;
+        std::vector<uint8_t> loaded;
+        cache.remove(key);
+        CHECK(!cache.load(key, format, loaded));
+        CHECK(cache.store(key, 0x8741, binary));
+        CHECK(cache.load(key, format, loaded));
+        CHECK(format == 0x8741 && loaded == binary);
+
+        // Nothing to store, and no directory
+        CHECK(!cache.store(key + 1, 0x8741, std::vector<uint8_t>()));
+        ProgramBinaryCache disabled("", "renderer 1.0");
+        CHECK(!disabled.store(key, 0x8741, binary) && !disabled.load(key, format, loaded));
+
+        // The entry of another key under this key's name
+        const uint64_t other = key ^ 1;
+        const std::vector<uint8_t> file = readFile(cache.getPath(key));
+        writeFile(cache.getPath(other), file);
+        CHECK(!cache.load(other, format, loaded));
+
+        // One payload byte changed
+        std::vector<uint8_t> corrupt(file);
+        corrupt.back() ^= 0x10;
+        writeFile(cache.getPath(key), corrupt);
+        CHECK(!cache.load(key, format, loaded) && loaded.empty());
+
+        // Cut short in the payload and in the header
+        writeFile(cache.getPath(key), std::vector<uint8_t>(file.begin(), file.end() - 1));
+        CHECK(!cache.load(key, format, loaded));
+        writeFile(cache.getPath(key), std::vector<uint8_t>(file.begin(), file.begin() + 10));
+        CHECK(!cache.load(key, format, loaded));
+
+        // Another magic
+        corrupt = file;
+        corrupt[0] ^= 0xff;
+        writeFile(cache.getPath(key), corrupt);
+        CHECK(!cache.load(key, format, loaded));
+
+        // Storing again replaces the broken entry
+        CHECK(cache.store(key, 0x8741, binary) && cache.load(key, format, loaded) && loaded == binary);
+
+        cache.remove(key);
+        cache.remove(other);
+        CHECK(!cache.load(key, format, loaded));
+
+        // Nothing compiles without a driver, and a failed program is not cached
+        std::string log;
+        CHECK(cache.createProgram("vertex", "fragment", "", log) == 0);
+        CHECK(cache.getCounters().m_misses == 1 && cache.getCounters().m_hits == 0);
+        CHECK(!cache.load(key, format, loaded));
+    }
+
+    void testVariants()
+    {
+        // One bit per feature, every combination a key of its own
+        CHECK(ShaderVariants::makeKey(false, false) == 0);
+        CHECK(ShaderVariants::makeKey(true, false) == ShaderVariants::FeatureBindlessUniforms);
+        CHECK(ShaderVariants::makeKey(false, true) == ShaderVariants::FeatureBindlessTextures);
+        CHECK(ShaderVariants::makeKey(true, true) == ShaderVariants::KeyCount - 1);
+
+        CHECK(ShaderVariants::getDefines(0).empty());
+        CHECK(ShaderVariants::getDefines(ShaderVariants::makeKey(true, false)) == "#define USE_BINDLESS_UNIFORMS\n");
+        CHECK(ShaderVariants::getDefines(ShaderVariants::makeKey(true, true)) == "#define USE_BINDLESS_UNIFORMS\n#define USE_BINDLESS_TEXTURES\n");
+
+        CHECK(ShaderVariants::getName(0) == "base");
+        CHECK(ShaderVariants::getName(ShaderVariants::makeKey(false, true)) == "bindless textures");
+        CHECK(ShaderVariants::getName(ShaderVariants::makeKey(true, true)) == "bindless uniforms + bindless textures");
+
+        // So every variant has its own cache entry
+        ProgramBinaryCache cache("", "renderer 1.0");
+        for(ShaderVariants::Key a = 0; a < ShaderVariants::KeyCount; a++)
+        {
+            for(ShaderVariants::Key b = a + 1; b < ShaderVariants::KeyCount; b++)
+            {
+                CHECK(cache.computeKey("v", "f", ShaderVariants::getDefines(a)) != cache.computeKey("v", "f", ShaderVariants::getDefines(b)));
+            }
+        }
+
+        // A variant is attempted once, whether it built or not
+        ShaderVariants variants(cache, "#version 420\n", "#version 420\n");
+        CHECK(variants.getProgram(ShaderVariants::KeyCount) == 0 && cache.getCounters().m_misses == 0);
+        CHECK(variants.getProgram(1) == 0 && variants.isBuilt(1) && !variants.isBuilt(0));
+        CHECK(variants.getProgram(1) == 0 && cache.getCounters().m_misses == 1);
+        CHECK(variants.compilePending(2) == 2 && variants.compilePending(10) == 1 && variants.compilePending(10) == 0);
+        CHECK(cache.getCounters().m_misses == ShaderVariants::KeyCount);
+        variants.release();
+        CHECK(!variants.isBuilt(1));
+    }
+}
+
+
+int main()
+{
+    testKeys();
+    testInjectDefines();
+    testStoreLoad();
+    testVariants();
+    return Check::result("ProgramBinaryCacheTest");
+}
@@ -0,0 +1,347 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/TaskGraphTest.cpp
+//
+// TaskGraph and JobSystem on real threads: no task starts before the tasks that
+// precede it have finished, every slice of a resized task runs exactly once, a
+// task over no items still releases its successors, repeated launch/wait cycles
+// give the same output on one, two and many threads, and the job queues grow
+// past their initial size when one thread submits more than fits.
+//
+//   g++ -std=c++14 -O2 -pthread -Isrc tests/TaskGraphTest.cpp src/TaskGraph.cpp src/JobSystem.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "TaskGraph.h"
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace
+{
+    // Counts how often each item ran, and checks that the tasks before it had finished when it did
+    struct CountingTask
+    {
+        CountingTask()
+            : m_count(0)
+            , m_done(0)
+            , m_errors(0)
+        {
+        }
+
+        void resize(uint32_t count)
+        {
+            m_hits.reset(new std::atomic<uint32_t>[count]);
+            m_count = count;
+            reset();
+        }
+
+        void reset()
+        {
+            for(uint32_t i = 0; i < m_count; i++)
+            {
+                m_hits[i] = 0;
+            }
+            m_done = 0;
+        }
+
+        bool ranOnce() const
+        {
+            for(uint32_t i = 0; i < m_count; i++)
+            {
+                if(m_hits[i] != 1)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static void run(void* context, uint32_t begin, uint32_t end)
+        {
+            CountingTask& task = *static_cast<CountingTask*>(context);
+            for(size_t i = 0; i < task.m_before.size(); i++)
+            {
+                if(task.m_before[i]->m_done.load() != task.m_before[i]->m_count)
+                {
+                    task.m_errors++;
+                }
+            }
+            for(uint32_t i = begin; i < end; i++)
+            {
+                task.m_errors += i < task.m_count ? 0 : 1;
+                if(i < task.m_count)
+                {
+                    task.m_hits[i]++;
+                }
+            }
+            task.m_done += end - begin;
+        }
+
+        std::unique_ptr<std::atomic<uint32_t>[]> m_hits;
+        uint32_t                   m_count;
+        std::atomic<uint32_t>      m_done;
+        std::atomic<uint32_t>      m_errors;
+        std::vector<CountingTask*> m_before;
+    };
+
+    void testOrder()
+    {
+        JobSystem jobs(4);
+        TaskGraph graph(jobs);
+
+        // A diamond with a tail: a before b and c, both before d, d before e
+        CountingTask tasks[5];
+        const uint32_t counts[5] = { 100, 1000, 37, 500, 1 };
+        for(uint32_t i = 0; i < 5; i++)
+        {
+            tasks[i].resize(counts[i]);
+            graph.add("task", &CountingTask::run, &tasks[i], counts[i], 8);
+        }
+        const TaskGraph::TaskId edges[5][2] = { { 0, 1 }, { 0, 2 }, { 1, 3 }, { 2, 3 }, { 3, 4 } };
+        for(uint32_t i = 0; i < 5; i++)
+        {
+            graph.precede(edges[i][0], edges[i][1]);
+            tasks[edges[i][1]].m_before.push_back(&tasks[edges[i][0]]);
+        }
+        CHECK(graph.getTaskCount() == 5);
+
+        for(int32_t run = 0; run < 50; run++)
+        {
+            for(uint32_t i = 0; i < 5; i++)
+            {
+                tasks[i].reset();
+            }
+            graph.launch();
+            CHECK(graph.isLaunched());
+            graph.wait();
+            CHECK(!graph.isLaunched());
+            for(uint32_t i = 0; i < 5; i++)
+            {
+                CHECK(tasks[i].ranOnce() && tasks[i].m_errors == 0);
+            }
+            for(uint32_t i = 0; i < 5; i++)
+            {
+                CHECK(graph.getFinishOrder(edges[i][0]) < graph.getFinishOrder(edges[i][1]));
+            }
+            CHECK(graph.getFinishOrder(0) == 0 && graph.getFinishOrder(4) == 4);
+        }
+    }
+
+    void testSetCount()
+    {
+        JobSystem jobs(3);
+        TaskGraph graph(jobs);
+        CountingTask task;
+        const TaskGraph::TaskId id = graph.add("resized", &CountingTask::run, &task, 0, 7);
+
+        // Counts on and off the grain, one item, and larger than anything before
+        const uint32_t counts[] = { 1000, 1001, 6, 7, 8, 1, 5000, 13 };
+        for(size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+        {
+            task.resize(counts[c]);
+            graph.setCount(id, counts[c]);
+            graph.run();
+            CHECK(task.ranOnce() && task.m_done == counts[c]);
+            CHECK(task.m_errors == 0);
+        }
+    }
+
+    void testZeroCount()
+    {
+        JobSystem jobs(2);
+        TaskGraph graph(jobs);
+        CountingTask empty, after;
+        after.resize(10);
+        after.m_before.push_back(&empty);
+        const TaskGraph::TaskId first = graph.add("empty", &CountingTask::run, &empty, 0);
+        const TaskGraph::TaskId second = graph.add("after", &CountingTask::run, &after, 10, 3);
+        graph.precede(first, second);
+
+        for(int32_t run = 0; run < 10; run++)
+        {
+            after.reset();
+            graph.run();
+            CHECK(empty.m_done == 0 && after.ranOnce());
+            CHECK(graph.getFinishOrder(first) == 0 && graph.getFinishOrder(second) == 1);
+        }
+        CHECK(empty.m_errors == 0 && after.m_errors == 0);
+
+        // A graph of nothing but empty tasks, and no tasks at all
+        graph.setCount(second, 0);
+        after.reset();
+        graph.run();
+        CHECK(after.m_done == 0);
+        graph.clear();
+        CHECK(graph.getTaskCount() == 0);
+        graph.run();
+    }
+
+    // Three stages over the same arrays: fill, combine mirrored items, then a serial checksum
+    struct Pipeline
+    {
+        static const uint32_t Count = 4096;
+
+        Pipeline()
+            : m_a(Count)
+            , m_b(Count)
+            , m_frame(0)
+        {
+        }
+
+        static void fill(void* context, uint32_t begin, uint32_t end)
+        {
+            Pipeline& p = *static_cast<Pipeline*>(context);
+            for(uint32_t i = begin; i < end; i++)
+            {
+                p.m_a[i] = i * 2654435761u + p.m_frame;
+            }
+        }
+
+        static void combine(void* context, uint32_t begin, uint32_t end)
+        {
+            Pipeline& p = *static_cast<Pipeline*>(context);
+            for(uint32_t i = begin; i < end; i++)
+            {
+                p.m_b[i] = (p.m_a[i] ^ (p.m_a[Count - 1 - i] >> 3)) * 31u;
+            }
+        }
+
+        static void checksum(void* context, uint32_t, uint32_t)
+        {
+            Pipeline& p = *static_cast<Pipeline*>(context);
+            uint64_t sum = 0;
+            for(uint32_t i = 0; i < Count; i++)
+            {
+                sum = sum * 1099511628211ull + p.m_b[i];
+            }
+            p.m_sums.push_back(sum);
+            p.m_frame++;
+        }
+
+        std::vector<uint32_t> m_a;
+        std::vector<uint32_t> m_b;
+        std::vector<uint64_t> m_sums;
+        uint32_t              m_frame;
+    };
+
+    std::vector<uint64_t> runPipeline(uint32_t threadCount, uint32_t frames)
+    {
+        JobSystem jobs(threadCount);
+        TaskGraph graph(jobs);
+        Pipeline pipeline;
+        const TaskGraph::TaskId fill = graph.add("fill", &Pipeline::fill, &pipeline, Pipeline::Count, 64);
+        const TaskGraph::TaskId combine = graph.add("combine", &Pipeline::combine, &pipeline, Pipeline::Count, 100);
+        const TaskGraph::TaskId checksum = graph.add("checksum", &Pipeline::checksum, &pipeline);
+        graph.precede(fill, combine);
+        graph.precede(combine, checksum);
+        for(uint32_t frame = 0; frame < frames; frame++)
+        {
+            graph.launch();
+            graph.wait();
+        }
+        return pipeline.m_sums;
+    }
+
+    void testDeterminism()
+    {
+        // The same stages run serially on this thread
+        Pipeline serial;
+        for(uint32_t frame = 0; frame < 30; frame++)
+        {
+            Pipeline::fill(&serial, 0, Pipeline::Count);
+            Pipeline::combine(&serial, 0, Pipeline::Count);
+            Pipeline::checksum(&serial, 0, 1);
+        }
+
+        const uint32_t threadCounts[] = { 1, 2, 8 };
+        for(size_t t = 0; t < sizeof(threadCounts) / sizeof(threadCounts[0]); t++)
+        {
+            CHECK(runPipeline(threadCounts[t], 30) == serial.m_sums);
+        }
+    }
+
+    void countItems(void* context, uint32_t begin, uint32_t end)
+    {
+        std::atomic<uint32_t>* hits = static_cast<std::atomic<uint32_t>*>(context);
+        for(uint32_t i = begin; i < end; i++)
+        {
+            hits[i]++;
+        }
+    }
+
+    // Each job submits a batch of its own from a worker thread, into that worker's queue
+    struct Spawner
+    {
+        JobSystem*             m_jobs;
+        std::atomic<uint32_t>* m_hits;
+        uint32_t               m_children;
+        JobSystem::Counter*    m_counter;
+
+        static void run(void* context, uint32_t begin, uint32_t end)
+        {
+            Spawner& s = *static_cast<Spawner*>(context);
+            for(uint32_t i = begin; i < end; i++)
+            {
+                for(uint32_t c = 0; c < s.m_children; c++)
+                {
+                    s.m_jobs->submit(&countItems, s.m_hits, i * s.m_children + c, i * s.m_children + c + 1, s.m_counter);
+                }
+            }
+        }
+    };
+
+    void testQueueGrowth()
+    {
+        JobSystem jobs(4);
+        const JobSystem::Stats before = jobs.getStats();
+
+        // Ten thousand single item jobs from the main thread, more than the 256 the shared queue starts with
+        const uint32_t count = 10000;
+        std::unique_ptr<std::atomic<uint32_t>[]> hits(new std::atomic<uint32_t>[count]);
+        for(uint32_t i = 0; i < count; i++)
+        {
+            hits[i] = 0;
+        }
+        JobSystem::Counter counter(0);
+        jobs.submitRange(&countItems, hits.get(), count, 1, &counter);
+        jobs.wait(counter);
+        CHECK(counter == 0);
+        uint32_t once = 0;
+        for(uint32_t i = 0; i < count; i++)
+        {
+            once += hits[i] == 1 ? 1 : 0;
+            hits[i] = 0;
+        }
+        CHECK(once == count);
+        CHECK(jobs.getStats().m_jobsRun - before.m_jobsRun == count);
+
+        // Eight jobs that each queue 1000 more on whichever thread runs them
+        Spawner spawner = { &jobs, hits.get(), 1000, &counter };
+        jobs.submitRange(&Spawner::run, &spawner, 8, 1, &counter);
+        jobs.wait(counter);
+        once = 0;
+        for(uint32_t i = 0; i < 8000; i++)
+        {
+            once += hits[i] == 1 ? 1 : 0;
+        }
+        CHECK(once == 8000);
+
+        uint32_t sum = 0;
+        jobs.parallelFor(count, 16, [&](uint32_t begin, uint32_t end) { hits[begin] += end - begin; });
+        for(uint32_t i = 0; i < count; i += 16)
+        {
+            sum += hits[i] - (i < 8000 ? 1 : 0);
+        }
+        CHECK(sum == count);
+    }
+}
+
+
+int main()
+{
+    testOrder();
+    testSetCount();
+    testZeroCount();
+    testDeterminism();
+    testQueueGrowth();
+    return Check::result("TaskGraphTest");
+}
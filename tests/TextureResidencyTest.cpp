@@ -0,0 +1,289 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/TextureResidencyTest.cpp
+//
+// The residency policy of TextureResidencyManager against a mock backend that
+// tracks which handles are resident: the window wraps around the current frame
+// both ways, needed entries stay resident even over budget, the others are
+// evicted least recently used first, every update() issues at most one batch
+// per direction (evictions first), and the counters and releaseAll() add up.
+//
+//   g++ -std=c++14 -O2 -Isrc -Itests/stubs tests/TextureResidencyTest.cpp tests/GLStubs.cpp
+//       src/TextureResidency.cpp src/MemoryTracker.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "TextureResidency.h"
+#include <set>
+#include <vector>
+
+namespace
+{
+    class MockBackend : public ResidencyBackend
+    {
+    public:
+        struct Batch
+        {
+            bool                     m_resident;
+            std::vector<GLuint64EXT> m_handles;
+        };
+
+        MockBackend()
+            : m_errors(0)
+        {
+        }
+
+        void makeResident(const GLuint64EXT* handles, size_t count) override
+        {
+            record(true, handles, count);
+            for(size_t i = 0; i < count; i++)
+            {
+                m_errors += m_resident.insert(handles[i]).second ? 0 : 1;
+            }
+        }
+
+        void makeNonResident(const GLuint64EXT* handles, size_t count) override
+        {
+            record(false, handles, count);
+            for(size_t i = 0; i < count; i++)
+            {
+                m_errors += m_resident.erase(handles[i]) == 1 ? 0 : 1;
+            }
+        }
+
+        std::vector<Batch>    m_batches;
+        std::set<GLuint64EXT> m_resident;
+        int32_t               m_errors;        // a handle made resident twice, or non-resident while it was not
+
+    private:
+        void record(bool resident, const GLuint64EXT* handles, size_t count)
+        {
+            Batch batch;
+            batch.m_resident = resident;
+            batch.m_handles.assign(handles, handles + count);
+            m_batches.push_back(batch);
+        }
+    };
+
+    // Entry i has the single handle 100 + i
+    void addEntries(TextureResidencyManager& manager, int32_t count, uint64_t bytes)
+    {
+        for(int32_t i = 0; i < count; i++)
+        {
+            const GLuint64EXT handle = GLuint64EXT(100 + i);
+            manager.addEntry(&handle, 1, bytes);
+        }
+    }
+
+    std::set<int32_t> getResident(const TextureResidencyManager& manager)
+    {
+        std::set<int32_t> resident;
+        for(int32_t i = 0; i < manager.getEntryCount(); i++)
+        {
+            if(manager.isResident(i))
+            {
+                resident.insert(i);
+            }
+        }
+        return resident;
+    }
+
+    std::set<int32_t> makeSet(std::initializer_list<int32_t> entries)
+    {
+        return std::set<int32_t>(entries);
+    }
+
+    void testWindow()
+    {
+        MockBackend backend;
+        TextureResidencyManager manager(backend, 2, 3, 0);
+        addEntries(manager, 10, 100);
+
+        // With no budget only the window stays: two behind, three ahead, wrapping at both ends
+        manager.update(0);
+        CHECK(getResident(manager) == makeSet({ 8, 9, 0, 1, 2, 3 }));
+        manager.update(9);
+        CHECK(getResident(manager) == makeSet({ 7, 8, 9, 0, 1, 2 }));
+        manager.update(5);
+        CHECK(getResident(manager) == makeSet({ 3, 4, 5, 6, 7, 8 }));
+
+        // A frame outside [0, count) wraps as well
+        manager.update(-1);
+        CHECK(getResident(manager) == makeSet({ 7, 8, 9, 0, 1, 2 }));
+        manager.update(21);
+        CHECK(getResident(manager) == makeSet({ 9, 0, 1, 2, 3, 4 }));
+
+        // A window wider than the animation pins every entry once
+        backend.m_batches.clear();
+        manager.setWindow(8, 8);
+        manager.update(0);
+        CHECK(manager.getFrameCounters().m_residentCount == 10);
+        CHECK(backend.m_batches.size() == 1 && backend.m_batches[0].m_handles.size() == 4);
+
+        // Touched entries count as needed for one frame
+        manager.setWindow(0, 0);
+        manager.touch(5);
+        manager.update(0);
+        CHECK(getResident(manager) == makeSet({ 0, 5 }));
+        manager.update(0);
+        CHECK(getResident(manager) == makeSet({ 0 }));
+        CHECK(backend.m_errors == 0);
+    }
+
+    void testBudget()
+    {
+        MockBackend backend;
+        TextureResidencyManager manager(backend, 1, 1, 150);
+        addEntries(manager, 8, 100);
+
+        // The window alone is twice the budget, and stays
+        manager.update(4);
+        CHECK(getResident(manager) == makeSet({ 3, 4, 5 }));
+        CHECK(manager.getFrameCounters().m_residentBytes == 300 && manager.getFrameCounters().m_evictions == 0);
+
+        // Whatever left the window goes, since the window already exceeds the budget
+        manager.update(5);
+        CHECK(getResident(manager) == makeSet({ 4, 5, 6 }));
+        CHECK(manager.getFrameCounters().m_evictions == 1);
+
+        // With room, recently used entries stay
+        manager.setBudget(500);
+        manager.update(6);
+        manager.update(7);
+        CHECK(getResident(manager) == makeSet({ 4, 5, 6, 7, 0 }));
+        CHECK(manager.getFrameCounters().m_evictions == 0);
+        CHECK(backend.m_errors == 0);
+    }
+
+    void testLru()
+    {
+        MockBackend backend;
+        TextureResidencyManager manager(backend, 0, 0, 300);
+        addEntries(manager, 6, 100);
+
+        manager.update(0);
+        manager.update(1);
+        manager.update(2);
+        CHECK(getResident(manager) == makeSet({ 0, 1, 2 }));
+
+        // Over budget: the least recently used entry goes
+        backend.m_batches.clear();
+        manager.update(3);
+        CHECK(getResident(manager) == makeSet({ 1, 2, 3 }));
+        CHECK(backend.m_batches.size() == 2);
+        CHECK(!backend.m_batches[0].m_resident && backend.m_batches[0].m_handles == std::vector<GLuint64EXT>(1, 100));
+        CHECK(backend.m_batches[1].m_resident && backend.m_batches[1].m_handles == std::vector<GLuint64EXT>(1, 103));
+
+        // Touching entry 1 makes it the most recent, so entry 2 goes next
+        manager.touch(1);
+        manager.update(4);
+        CHECK(getResident(manager) == makeSet({ 1, 3, 4 }));
+
+        // Several at once, oldest first: entry 3 was last used a frame before entries 1 and 4
+        manager.setBudget(100);
+        backend.m_batches.clear();
+        manager.update(5);
+        CHECK(getResident(manager) == makeSet({ 5 }));
+        CHECK(manager.getFrameCounters().m_evictions == 3);
+        const std::vector<GLuint64EXT>& evicted = backend.m_batches[0].m_handles;
+        CHECK(evicted.size() == 3 && evicted[0] == 103);
+        CHECK(std::set<GLuint64EXT>(evicted.begin() + 1, evicted.end()) == std::set<GLuint64EXT>({ 101, 104 }));
+        CHECK(backend.m_errors == 0);
+    }
+
+    void testBatches()
+    {
+        MockBackend backend;
+        TextureResidencyManager manager(backend, 1, 2, 400);
+
+        // Entries of several handles each (color and displacement, say)
+        for(int32_t i = 0; i < 12; i++)
+        {
+            const GLuint64EXT handles[3] = { GLuint64EXT(1000 + i * 3), GLuint64EXT(1001 + i * 3), GLuint64EXT(1002 + i * 3) };
+            manager.addEntry(handles, 3, 100);
+        }
+
+        for(int32_t frame = 0; frame < 40; frame++)
+        {
+            const size_t before = backend.m_batches.size();
+            manager.update(frame * 5);
+            const size_t batches = backend.m_batches.size() - before;
+            CHECK(batches <= 2);
+            if(batches == 2)
+            {
+                CHECK(!backend.m_batches[before].m_resident && backend.m_batches[before + 1].m_resident);
+            }
+            for(size_t b = before; b < backend.m_batches.size(); b++)
+            {
+                CHECK(!backend.m_batches[b].m_handles.empty() && backend.m_batches[b].m_handles.size() % 3 == 0);
+            }
+            CHECK(backend.m_resident.size() == size_t(manager.getFrameCounters().m_residentCount) * 3);
+            CHECK(manager.getFrameCounters().m_residentBytes <= 400);
+        }
+
+        // Nothing changes, nothing is issued
+        manager.update(0);
+        const size_t before = backend.m_batches.size();
+        manager.update(0);
+        CHECK(backend.m_batches.size() == before);
+        CHECK(backend.m_errors == 0);
+
+        // No entries, no work
+        TextureResidencyManager empty(backend, 1, 1, 0);
+        empty.update(3);
+        empty.releaseAll();
+        CHECK(backend.m_batches.size() == before);
+    }
+
+    void testCounters()
+    {
+        MockBackend backend;
+        {
+            TextureResidencyManager manager(backend, 0, 1, 200);
+            addEntries(manager, 5, 100);
+
+            manager.update(0);
+            TextureResidencyManager::Counters counters = manager.getFrameCounters();
+            CHECK(counters.m_hits == 0 && counters.m_misses == 2 && counters.m_evictions == 0);
+            CHECK(counters.m_residentCount == 2 && counters.m_residentBytes == 200);
+
+            manager.update(1);
+            counters = manager.getFrameCounters();
+            CHECK(counters.m_hits == 1 && counters.m_misses == 1 && counters.m_evictions == 1);
+            CHECK(counters.m_residentCount == 2);
+
+            manager.update(1);
+            counters = manager.getFrameCounters();
+            CHECK(counters.m_hits == 2 && counters.m_misses == 0 && counters.m_evictions == 0);
+
+            const TextureResidencyManager::Counters& total = manager.getTotalCounters();
+            CHECK(total.m_hits == 3 && total.m_misses == 3 && total.m_evictions == 1);
+            CHECK(total.m_residentCount == 2 && total.m_residentBytes == 200);
+
+            // releaseAll() drops everything in one batch and clears the resident counts
+            const size_t before = backend.m_batches.size();
+            manager.releaseAll();
+            CHECK(backend.m_batches.size() == before + 1 && !backend.m_batches.back().m_resident);
+            CHECK(backend.m_batches.back().m_handles.size() == 2 && backend.m_resident.empty());
+            CHECK(getResident(manager).empty());
+            CHECK(manager.getFrameCounters().m_residentCount == 0 && manager.getTotalCounters().m_residentBytes == 0);
+            CHECK(manager.getTotalCounters().m_misses == 3);
+
+            // ... and the entries come back on the next update
+            manager.update(3);
+            CHECK(manager.getFrameCounters().m_misses == 2 && backend.m_resident.size() == 2);
+        }
+
+        // The destructor releases what is left
+        CHECK(backend.m_resident.empty() && backend.m_errors == 0);
+    }
+}
+
+
+int main()
+{
+    testWindow();
+    testBudget();
+    testLru();
+    testBatches();
+    testCounters();
+    return Check::result("TextureResidencyTest");
+}
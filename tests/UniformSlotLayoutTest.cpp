@@ -0,0 +1,125 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/UniformSlotLayoutTest.cpp
+//
+// Offsets of the padded uniform slots: alignUp with power of two and other
+// alignments, the span of 0, 1 and N slots, and scatter writing each element
+// at its slot's offset without touching the padding.
+//
+//   g++ -std=c++14 -O2 -Isrc tests/UniformSlotLayoutTest.cpp src/UniformSlotLayout.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "UniformSlotLayout.h"
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    void testAlignUp()
+    {
+        CHECK(UniformSlotLayout::alignUp(0, 64) == 0);
+        CHECK(UniformSlotLayout::alignUp(16, 256) == 256);
+        CHECK(UniformSlotLayout::alignUp(256, 256) == 256);
+        CHECK(UniformSlotLayout::alignUp(257, 256) == 512);
+        CHECK(UniformSlotLayout::alignUp(16, 0) == 16);
+        CHECK(UniformSlotLayout::alignUp(16, 1) == 16);
+
+        // The GL only promises some alignment, not a power of two
+        CHECK(UniformSlotLayout::alignUp(16, 48) == 48);
+        CHECK(UniformSlotLayout::alignUp(48, 48) == 48);
+        CHECK(UniformSlotLayout::alignUp(49, 48) == 96);
+        CHECK(UniformSlotLayout::alignUp(100, 3) == 102);
+        CHECK(UniformSlotLayout::alignUp(168, 160) == 320);
+        for(size_t alignment = 1; alignment < 300; alignment += 7)
+        {
+            for(size_t value = 0; value < 1000; value += 13)
+            {
+                const size_t aligned = UniformSlotLayout::alignUp(value, alignment);
+                CHECK(aligned % alignment == 0 && aligned >= value && aligned - value < alignment);
+            }
+        }
+    }
+
+    void testLayout()
+    {
+        UniformSlotLayout slots(16, 256, 10001);
+        CHECK(slots.getStride() == 256);
+        CHECK(slots.getOffset(0) == 0);
+        CHECK(slots.getOffset(3) == 768);
+        CHECK(slots.getSpanBytes(0) == 0);
+        CHECK(slots.getSpanBytes(1) == 16);
+        CHECK(slots.getSpanBytes(5) == 4 * 256 + 16);
+        CHECK(slots.getBufferBytes() == 10000 * 256 + 16);
+
+        // Elements that are aligned already are not padded
+        UniformSlotLayout packed(16, 16, 4);
+        CHECK(packed.getStride() == 16 && packed.getBufferBytes() == 64);
+
+        // An element larger than the alignment takes several alignment units
+        UniformSlotLayout large(168, 64, 3);
+        CHECK(large.getStride() == 192);
+        CHECK(large.getSpanBytes(2) == 192 + 168);
+
+        UniformSlotLayout odd(168, 48, 3);
+        CHECK(odd.getStride() == 192);
+        CHECK(odd.getOffset(2) == 384);
+
+        UniformSlotLayout empty(0, 64, 2);
+        CHECK(empty.getStride() == 64);
+
+        UniformSlotLayout unaligned(20, 0, 2);
+        CHECK(unaligned.getStride() == 20);
+    }
+
+    void testScatter()
+    {
+        std::vector<uint32_t> elements(40);
+        for(uint32_t i = 0; i < elements.size(); i++)
+        {
+            elements[i] = i;
+        }
+
+        UniformSlotLayout slots(16, 64, 10);
+        std::vector<uint8_t> padded(slots.getBufferBytes(), 0xAA);
+        slots.scatter(&elements[0], 2, 3, &padded[0]);
+        for(uint32_t slot = 0; slot < 10; slot++)
+        {
+            for(size_t byte = 0; byte < slots.getElementBytes() && slots.getOffset(slot) + byte < padded.size(); byte += 4)
+            {
+                uint32_t value;
+                memcpy(&value, &padded[slots.getOffset(slot) + byte], sizeof(value));
+                if(slot >= 2 && slot < 5)
+                {
+                    CHECK(value == slot * 4 + byte / 4);
+                }
+                else
+                {
+                    CHECK(value == 0xAAAAAAAAu);
+                }
+            }
+        }
+        // The padding behind the scattered elements is left alone
+        for(uint32_t slot = 2; slot < 5; slot++)
+        {
+            for(size_t byte = slots.getOffset(slot) + 16; byte < slots.getOffset(slot + 1); byte++)
+            {
+                CHECK(padded[byte] == 0xAA);
+            }
+        }
+
+        // The last slot is only element sized, scattering into it stays in the buffer
+        std::vector<uint8_t> tight(slots.getBufferBytes());
+        slots.scatter(&elements[0], 0, 10, &tight[0]);
+        uint32_t last;
+        memcpy(&last, &tight[slots.getOffset(9) + 12], sizeof(last));
+        CHECK(last == 39);
+    }
+}
+
+
+int main()
+{
+    testAlignUp();
+    testLayout();
+    testScatter();
+    return Check::result("UniformSlotLayoutTest");
+}
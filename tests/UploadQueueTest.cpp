@@ -0,0 +1,287 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/UploadQueueTest.cpp
+//
+// UploadQueue scheduling against a RecordingGLBackend: jobs leave in priority
+// order and FIFO within a priority, the byte budget holds back the rest (a job
+// larger than the budget still goes, alone), adjacent and overlapping buffer
+// ranges become one copy with the newest data on top, textures are read from
+// the staging buffer bound as the pixel unpack buffer, and tickets and latency
+// counters follow the jobs through the frames.
+//
+//   g++ -std=c++14 -O2 -Isrc -Itests/stubs tests/UploadQueueTest.cpp tests/GLStubs.cpp
+//       src/UploadQueue.cpp src/GLBackend.cpp src/FrameArena.cpp src/MemoryTracker.cpp
+//----------------------------------------------------------------------------------
+#include "Check.h"
+#include "UploadQueue.h"
+#include <vector>
+
+namespace
+{
+    typedef RecordingGLBackend R;
+
+    const GLuint Staging = 50;
+
+    std::vector<uint8_t> makeData(size_t size, uint8_t value)
+    {
+        return std::vector<uint8_t>(size, value);
+    }
+
+    // The textures uploaded by the recorded calls, in order
+    std::vector<GLuint> getTextures(const RecordingGLBackend& recording)
+    {
+        std::vector<GLuint> textures;
+        for(size_t i = 0; i < recording.getCalls().size(); i++)
+        {
+            if(recording.getCalls()[i].m_op == R::OpCompressedTextureSubImage2D)
+            {
+                textures.push_back(GLuint(recording.getCalls()[i].m_args[0]));
+            }
+        }
+        return textures;
+    }
+
+    const R::Call* findCall(const RecordingGLBackend& recording, R::Op op, size_t nth = 0)
+    {
+        for(size_t i = 0; i < recording.getCalls().size(); i++)
+        {
+            if(recording.getCalls()[i].m_op == op && nth-- == 0)
+            {
+                return &recording.getCalls()[i];
+            }
+        }
+        return nullptr;
+    }
+
+    void testPriorities()
+    {
+        RecordingGLBackend recording;
+        UploadQueue queue(recording, Staging, 1 << 20, 0.0);
+        const std::vector<uint8_t> data = makeData(32, 1);
+        queue.enqueueCompressedTexture(UploadQueue::PriorityLow, 1, 0, 8, 8, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, &data[0], 32);
+        queue.enqueueCompressedTexture(UploadQueue::PriorityNormal, 2, 0, 8, 8, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, &data[0], 32);
+        queue.enqueueCompressedTexture(UploadQueue::PriorityHigh, 3, 0, 8, 8, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, &data[0], 32);
+        queue.enqueueCompressedTexture(UploadQueue::PriorityNormal, 4, 0, 8, 8, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, &data[0], 32);
+        queue.enqueueCompressedTexture(UploadQueue::PriorityImmediate, 5, 0, 8, 8, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, &data[0], 32);
+        CHECK(recording.getCalls().empty() && !queue.isEmpty());
+
+        queue.drain();
+        const GLuint expected[] = { 5, 3, 2, 4, 1 };
+        CHECK(getTextures(recording) == std::vector<GLuint>(expected, expected + 5));
+        CHECK(queue.isEmpty());
+
+        // Within the budget the order holds across drains, too
+        recording.clear();
+        queue.setBudget(64, 0.0);
+        for(GLuint texture = 10; texture < 16; texture++)
+        {
+            queue.enqueueCompressedTexture(UploadQueue::PriorityNormal, texture, 0, 8, 8, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, &data[0], 32);
+        }
+        std::vector<GLuint> order;
+        while(!queue.isEmpty())
+        {
+            recording.clear();
+            queue.drain();
+            const std::vector<GLuint> textures = getTextures(recording);
+            CHECK(textures.size() == 2);
+            order.insert(order.end(), textures.begin(), textures.end());
+        }
+        const GLuint fifo[] = { 10, 11, 12, 13, 14, 15 };
+        CHECK(order == std::vector<GLuint>(fifo, fifo + 6));
+    }
+
+    void testBudget()
+    {
+        RecordingGLBackend recording;
+        UploadQueue queue(recording, Staging, 100, 0.0);
+        const std::vector<uint8_t> data = makeData(500, 2);
+
+        for(GLuint buffer = 1; buffer <= 5; buffer++)
+        {
+            queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, buffer, 0, &data[0], 40);
+        }
+        queue.drain();
+        CHECK(queue.getFrameCounters().m_jobsIssued == 2 && queue.getFrameCounters().m_bytesIssued == 80);
+        CHECK(queue.getFrameCounters().m_queuedJobs == 3 && queue.getFrameCounters().m_queuedBytes == 120);
+        queue.drain();
+        queue.drain();
+        CHECK(queue.getFrameCounters().m_jobsIssued == 1 && queue.isEmpty());
+
+        // Over the whole budget on its own: goes out, but nothing with it
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityHigh, 1, 0, &data[0], 500);
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityHigh, 2, 0, &data[0], 10);
+        queue.drain();
+        CHECK(queue.getFrameCounters().m_jobsIssued == 1 && queue.getFrameCounters().m_bytesIssued == 500);
+        queue.drain();
+        CHECK(queue.getFrameCounters().m_jobsIssued == 1 && queue.isEmpty());
+
+        // A job that does not fit stops the drain, smaller ones behind it do not overtake
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, 1, 0, &data[0], 80);
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, 2, 0, &data[0], 30);
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityLow, 3, 0, &data[0], 10);
+        queue.drain();
+        CHECK(queue.getFrameCounters().m_jobsIssued == 1);
+
+        // Immediate jobs go regardless, and use up the budget of the others
+        for(int32_t i = 0; i < 3; i++)
+        {
+            queue.enqueueBuffer(UploadQueue::KindUniform, UploadQueue::PriorityImmediate, 9, i * 90, &data[0], 90);
+        }
+        queue.drain();
+        CHECK(queue.getFrameCounters().m_jobsIssued == 3 && queue.getFrameCounters().m_bytesIssued == 270);
+        CHECK(queue.getFrameCounters().m_queuedJobs == 2);
+
+        // flush() ignores the budget
+        queue.flush();
+        CHECK(queue.getFrameCounters().m_jobsIssued == 2 && queue.isEmpty());
+        CHECK(queue.getFrameCounters().m_bytesByKind[UploadQueue::KindGeometry] == 40);
+    }
+
+    void testCoalescing()
+    {
+        RecordingGLBackend recording;
+        UploadQueue queue(recording, Staging, 1 << 20, 0.0);
+
+        // Buffer 7: [8, 24) then [0, 16) over it, [16, 32) next to it and [100, 110) apart; buffer 8: [0, 16)
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, 7, 8, &makeData(16, 0xA)[0], 16);
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, 8, 0, &makeData(16, 0xE)[0], 16);
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, 7, 0, &makeData(16, 0xB)[0], 16);
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, 7, 100, &makeData(10, 0xD)[0], 10);
+        queue.enqueueBuffer(UploadQueue::KindUniform, UploadQueue::PriorityHigh, 7, 16, &makeData(16, 0xC)[0], 16);
+        queue.drain();
+
+        const UploadQueue::Counters& counters = queue.getFrameCounters();
+        CHECK(counters.m_jobsIssued == 5 && counters.m_jobsCoalesced == 2 && counters.m_copies == 3);
+        CHECK(counters.m_bytesByKind[UploadQueue::KindUniform] == 16 && counters.m_bytesByKind[UploadQueue::KindGeometry] == 58);
+
+        // One upload to the staging buffer, then the copies in buffer and offset order
+        CHECK(recording.countCalls(R::OpNamedBufferData) == 1 && recording.countCalls(R::OpCopyNamedBufferSubData) == 3);
+        const R::Call& upload = *findCall(recording, R::OpNamedBufferData);
+        CHECK(upload.m_args[0] == Staging);
+        const R::Call& run = *findCall(recording, R::OpCopyNamedBufferSubData, 0);
+        CHECK(run.m_args[0] == Staging && run.m_args[1] == 7 && run.m_args[3] == 0 && run.m_args[4] == 32);
+        const R::Call& apart = *findCall(recording, R::OpCopyNamedBufferSubData, 1);
+        CHECK(apart.m_args[1] == 7 && apart.m_args[3] == 100 && apart.m_args[4] == 10);
+        const R::Call& other = *findCall(recording, R::OpCopyNamedBufferSubData, 2);
+        CHECK(other.m_args[1] == 8 && other.m_args[3] == 0 && other.m_args[4] == 16);
+
+        // Staging offsets are aligned, and where the ranges overlap the newest data is on top
+        CHECK(apart.m_args[2] % 16 == 0 && other.m_args[2] % 16 == 0);
+        const std::vector<uint8_t>& staging = upload.m_data;
+        CHECK(staging.size() >= other.m_args[2] + 16);
+        std::vector<uint8_t> expected = makeData(16, 0xB);
+        const std::vector<uint8_t> tail = makeData(16, 0xC);
+        expected.insert(expected.end(), tail.begin(), tail.end());
+        CHECK(std::vector<uint8_t>(staging.begin(), staging.begin() + 32) == expected);
+        CHECK(staging[apart.m_args[2]] == 0xD && staging[apart.m_args[2] + 9] == 0xD);
+        CHECK(staging[other.m_args[2]] == 0xE);
+
+        // An older job on top of a newer one is overwritten where they overlap, and kept where they do not
+        recording.clear();
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, 7, 0, &makeData(32, 1)[0], 32);
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, 7, 4, &makeData(8, 2)[0], 8);
+        queue.drain();
+        CHECK(recording.countCalls(R::OpCopyNamedBufferSubData) == 1);
+        const std::vector<uint8_t>& merged = findCall(recording, R::OpNamedBufferData)->m_data;
+        CHECK(merged[3] == 1 && merged[4] == 2 && merged[11] == 2 && merged[12] == 1 && merged[31] == 1);
+    }
+
+    void testTextures()
+    {
+        RecordingGLBackend recording;
+        UploadQueue queue(recording, Staging, 1 << 20, 0.0);
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, 7, 0, &makeData(20, 3)[0], 20);
+        queue.enqueueCompressedTexture(UploadQueue::PriorityNormal, 30, 2, 16, 8, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, &makeData(64, 4)[0], 64);
+        queue.enqueueCompressedTexture(UploadQueue::PriorityNormal, 31, 0, 4, 4, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, &makeData(8, 5)[0], 8);
+        queue.drain();
+        CHECK(queue.getFrameCounters().m_copies == 3);
+        CHECK(queue.getFrameCounters().m_bytesByKind[UploadQueue::KindTexture] == 72);
+
+        // The staging buffer is the unpack buffer for exactly the texture uploads
+        const std::vector<R::Call>& calls = recording.getCalls();
+        size_t bind = calls.size(), unbind = calls.size();
+        for(size_t i = 0; i < calls.size(); i++)
+        {
+            if(calls[i].m_op == R::OpBindBuffer && calls[i].m_args[0] == GL_PIXEL_UNPACK_BUFFER)
+            {
+                (calls[i].m_args[1] == Staging ? bind : unbind) = i;
+            }
+        }
+        CHECK(bind < unbind && unbind == calls.size() - 1);
+        CHECK(calls[bind + 1].m_op == R::OpCompressedTextureSubImage2D && calls[bind + 2].m_op == R::OpCompressedTextureSubImage2D);
+
+        // texture, target, level, x and y, width and height, format, size, and an unpack offset behind the buffer data
+        const R::Call& first = calls[bind + 1];
+        CHECK(first.m_args[0] == 30 && first.m_args[1] == GL_TEXTURE_2D && first.m_args[2] == 2);
+        CHECK(first.m_args[3] == 0 && first.m_args[4] == (uint64_t(16) << 32 | 8));
+        CHECK(first.m_args[5] == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT && first.m_args[6] == 64);
+        const uint64_t firstOffset = first.m_args[7];
+        const uint64_t secondOffset = calls[bind + 2].m_args[7];
+        CHECK(firstOffset >= 20 && firstOffset % 16 == 0 && secondOffset >= firstOffset + 64 && secondOffset % 16 == 0);
+        const std::vector<uint8_t>& staging = findCall(recording, R::OpNamedBufferData)->m_data;
+        CHECK(staging[firstOffset] == 4 && staging[firstOffset + 63] == 4 && staging[secondOffset + 7] == 5);
+
+        // No textures, no unpack binding
+        recording.clear();
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, 7, 0, &makeData(20, 3)[0], 20);
+        queue.drain();
+        CHECK(recording.countCalls(R::OpBindBuffer) == 0);
+
+        // Nothing queued, nothing issued
+        recording.clear();
+        queue.drain();
+        CHECK(recording.getCalls().empty());
+    }
+
+    void testTicketsAndLatency()
+    {
+        RecordingGLBackend recording;
+        UploadQueue queue(recording, Staging, 64, 0.0);
+        const std::vector<uint8_t> data = makeData(64, 6);
+
+        UploadQueue::Ticket tickets[4];
+        for(int32_t i = 0; i < 4; i++)
+        {
+            tickets[i] = queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, GLuint(i + 1), 0, &data[0], 64);
+        }
+        const UploadQueue::Ticket urgent = queue.enqueueBuffer(UploadQueue::KindUniform, UploadQueue::PriorityImmediate, 9, 0, &data[0], 4);
+        CHECK(!queue.isIssued(tickets[0]) && !queue.isIssued(urgent));
+        CHECK(!queue.isIssued(urgent + 1));
+
+        // The immediate job uses some of the budget, so only that goes in the first frame
+        queue.drain();
+        CHECK(queue.isIssued(urgent) && !queue.isIssued(tickets[0]));
+        CHECK(queue.getFrameCounters().m_maxLatencyFrames == 0);
+        queue.drain();
+        CHECK(queue.isIssued(tickets[0]) && !queue.isIssued(tickets[1]) && !queue.isIssued(tickets[3]));
+        CHECK(queue.getFrameCounters().m_maxLatencyFrames == 1);
+        queue.drain();
+        queue.drain();
+        CHECK(queue.isIssued(tickets[2]) && !queue.isIssued(tickets[3]));
+        CHECK(queue.getFrameCounters().m_maxLatencyFrames == 3 && queue.getFrameCounters().m_avgLatencyFrames == 3.0f);
+        CHECK(queue.getFrameCounters().m_maxLatencySeconds >= 0.0);
+
+        // Two jobs in one drain, one new and one four frames old
+        queue.setBudget(1 << 20, 0.0);
+        queue.enqueueBuffer(UploadQueue::KindGeometry, UploadQueue::PriorityNormal, 5, 0, &data[0], 64);
+        queue.drain();
+        CHECK(queue.isIssued(tickets[3]) && queue.isEmpty());
+        CHECK(queue.getFrameCounters().m_jobsIssued == 2);
+        CHECK(queue.getFrameCounters().m_maxLatencyFrames == 4 && queue.getFrameCounters().m_avgLatencyFrames == 2.0f);
+        CHECK(queue.getFrameCounters().m_queuedJobs == 0 && queue.getFrameCounters().m_queuedBytes == 0);
+
+        // Drains without jobs report none
+        queue.drain();
+        CHECK(queue.getFrameCounters().m_jobsIssued == 0 && queue.getFrameCounters().m_avgLatencyFrames == 0.0f);
+    }
+}
+
+
+int main()
+{
+    testPriorities();
+    testBudget();
+    testCoalescing();
+    testTextures();
+    testTicketsAndLatency();
+    return Check::result("UploadQueueTest");
+}
@@ -0,0 +1,19 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/stubs/cinder/app/App.h
+//
+// Stand-in for Cinder's App header in the standalone tests: console() only.
+//----------------------------------------------------------------------------------
+#ifndef TESTS_CINDER_APP_H
+#define TESTS_CINDER_APP_H
+
+#include <iostream>
+
+namespace ci
+{
+    namespace app
+    {
+        inline std::ostream& console() { return std::cout; }
+    }
+}
+
+#endif
@@ -0,0 +1,16 @@
+//----------------------------------------------------------------------------------
+// File:        BindlessApp/tests/stubs/cinder/gl/gl.h
+//
+// Stand-in for Cinder's GL header in the standalone tests: the system GL
+// headers with prototypes. tests/GLStubs.cpp defines the entry points the
+// tested code calls.
+//----------------------------------------------------------------------------------
+#ifndef TESTS_CINDER_GL_H
+#define TESTS_CINDER_GL_H
+
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <cstdint>
+
+#endif